@@ -0,0 +1,316 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang, dev@z-yx.cc
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+
+// Vendor control requests understood by the firmware.
+// Keep in sync with firmware/include/control.h
+export enum Request {
+    FilterClear = 0x10,
+    FilterStage = 0x11,
+    FilterCommit = 0x12,
+    CaptureStats = 0x13,
+    ClockSync = 0x14,
+    RouteSet = 0x30,
+    RouteGet = 0x31,
+    PerfDevice = 0x40,
+    PerfPort = 0x41,
+    PerfReset = 0x42,
+    StoreStart = 0x50,
+    StoreStop = 0x51,
+    StoreExpose = 0x52,
+    StoreStatus = 0x53,
+}
+
+export const VENDOR_ID = 0x0483;
+export const PRODUCT_ID = 0x5740;
+
+const usb = (navigator as any).usb as any | undefined;
+
+export async function openDevice(): Promise<any | null> {
+    if (!usb) return null;
+    const devices: any[] = await usb.getDevices();
+    const device = devices.find(
+        (d) => d.vendorId === VENDOR_ID && d.productId === PRODUCT_ID
+    );
+    if (!device) return null;
+    if (!device.opened) await device.open();
+    return device;
+}
+
+async function controlOut(
+    device: any,
+    request: Request,
+    value = 0,
+    index = 0,
+    data?: ArrayBuffer
+) {
+    const setup = {
+        requestType: "vendor",
+        recipient: "device",
+        request,
+        value,
+        index,
+    };
+    const result = await device.controlTransferOut(setup, data);
+    if (result.status !== "ok")
+        throw new Error(`Request 0x${request.toString(16)}: ${result.status}`);
+}
+
+async function controlIn(
+    device: any,
+    request: Request,
+    length: number,
+    value = 0,
+    index = 0
+): Promise<DataView> {
+    const setup = {
+        requestType: "vendor",
+        recipient: "device",
+        request,
+        value,
+        index,
+    };
+    const result = await device.controlTransferIn(setup, length);
+    if (result.status !== "ok" || !result.data)
+        throw new Error(`Request 0x${request.toString(16)}: ${result.status}`);
+    return result.data;
+}
+
+// ---------- Capture filter ----------
+
+export type FilterRule = {
+    // Header bytes compared against the first 8 bytes of each message
+    match: number[];
+    mask: number[];
+    // Inclusive message length range, maxLen = 0 for unbounded
+    minLen?: number;
+    maxLen?: number;
+    // Capture one out of every N matching messages
+    decimate?: number;
+    // Bit per source interface, 0 for all interfaces
+    interfaces?: number;
+    action: "pass" | "drop";
+};
+
+const FILTER_HEADER_LEN = 8;
+const FILTER_RULE_SIZE = 24;
+const FILTER_MAX_RULES = 16;
+
+function encodeRule(rule: FilterRule): ArrayBuffer {
+    const buf = new ArrayBuffer(FILTER_RULE_SIZE);
+    const view = new DataView(buf);
+    for (let i = 0; i < FILTER_HEADER_LEN; i++) {
+        view.setUint8(i, rule.match[i] ?? 0);
+        view.setUint8(FILTER_HEADER_LEN + i, rule.mask[i] ?? 0);
+    }
+    view.setUint16(16, rule.minLen ?? 0, true);
+    view.setUint16(18, rule.maxLen ?? 0, true);
+    view.setUint16(20, rule.decimate ?? 1, true);
+    view.setUint8(22, rule.interfaces ?? 0);
+    view.setUint8(23, rule.action === "pass" ? 1 : 0);
+    return buf;
+}
+
+export async function setCaptureFilter(
+    device: any,
+    rules: FilterRule[],
+    fallback: "pass" | "drop" = "drop"
+) {
+    if (rules.length > FILTER_MAX_RULES)
+        throw new Error(`At most ${FILTER_MAX_RULES} filter rules supported`);
+    for (const [i, rule] of rules.entries())
+        await controlOut(device, Request.FilterStage, i, 0, encodeRule(rule));
+    await controlOut(
+        device,
+        Request.FilterCommit,
+        rules.length,
+        fallback === "pass" ? 1 : 0
+    );
+}
+
+export async function clearCaptureFilter(device: any) {
+    await controlOut(device, Request.FilterClear);
+}
+
+export async function getCaptureStats(device: any) {
+    const view = await controlIn(device, Request.CaptureStats, 24);
+    const rawBytes = view.getUint32(12, true);
+    const wireBytes = view.getUint32(16, true);
+    return {
+        records: view.getUint32(0, true),
+        filtered: view.getUint32(4, true),
+        dropped: view.getUint32(8, true),
+        rawBytes,
+        wireBytes,
+        // > 1 when capture compression is enabled in the firmware
+        compressionRatio: wireBytes ? rawBytes / wireBytes : 1,
+        compressMicros: view.getUint32(20, true),
+    };
+}
+
+// ---------- Routing ----------
+// Ports are numbered CDC interfaces first, then the hardware UART when the
+// firmware bridges one; the same numbers identify capture sources.
+
+const ROUTE_MAX_PORTS = 8;
+
+// Destination ports of every port, indexed by source port
+export async function getRoutes(device: any): Promise<number[][]> {
+    const view = await controlIn(device, Request.RouteGet, ROUTE_MAX_PORTS);
+    const routes: number[][] = [];
+    for (let src = 0; src < view.byteLength; src++) {
+        const mask = view.getUint8(src);
+        routes.push(
+            [...Array(ROUTE_MAX_PORTS).keys()].filter((p) => mask & (1 << p))
+        );
+    }
+    return routes;
+}
+
+// Send what `source` receives to `destinations` (empty to discard it)
+export async function setRoute(
+    device: any,
+    source: number,
+    destinations: number[]
+) {
+    const mask = destinations.reduce((m, port) => m | (1 << port), 0);
+    await controlOut(device, Request.RouteSet, mask, source);
+}
+
+// ---------- Performance counters ----------
+// Also carried by every capture heartbeat, see CaptureDecoder.stats.device;
+// these requests read them on demand. Counters are cumulative, take rates
+// from the difference of two reads.
+
+export async function getDevicePerf(device: any) {
+    const view = await controlIn(device, Request.PerfDevice, 12);
+    return {
+        uptime: view.getUint32(0, true),
+        tudLoops: view.getUint32(4, true),
+        ports: view.getUint8(8),
+    };
+}
+
+export async function getPortPerf(device: any, port: number) {
+    const view = await controlIn(device, Request.PerfPort, 40, 0, port);
+    const count = view.getUint32(36, true);
+    return {
+        rxBytes: view.getUint32(0, true),
+        rxChunks: view.getUint32(4, true),
+        txBytes: view.getUint32(8, true),
+        txChunks: view.getUint32(12, true),
+        txFull: view.getUint32(16, true),
+        rxFifoPeak: view.getUint16(20, true),
+        txFifoPeak: view.getUint16(22, true),
+        latency: {
+            min: view.getUint32(24, true),
+            max: view.getUint32(28, true),
+            avg: count ? view.getUint32(32, true) / count : 0,
+            count,
+        },
+    };
+}
+
+export async function resetPerf(device: any) {
+    await controlOut(device, Request.PerfReset);
+}
+
+// ---------- Capture store ----------
+// Firmware built with CAPTURE_STORE records the capture stream to segment
+// files (CAPnnnnn.BIN) on a flash volume, and hands the volume to the host
+// as a USB drive on request. Open the copied files with the addon's
+// CaptureFile and feed them to CaptureDecoder.pushFile().
+
+export const STORE_STATES = [
+    "off",
+    "idle",
+    "armed",
+    "recording",
+    "stopping",
+    "exposed",
+] as const;
+
+export type StoreState = (typeof STORE_STATES)[number];
+
+export async function getStoreStatus(device: any) {
+    const view = await controlIn(device, Request.StoreStatus, 24);
+    return {
+        state: STORE_STATES[view.getUint8(0)] ?? "off",
+        segment: view.getUint32(4, true),
+        bytes: view.getUint32(8, true),
+        dropped: view.getUint32(12, true),
+        errors: view.getUint32(16, true),
+        freeKB: view.getUint32(20, true),
+    };
+}
+
+// Recording starts with the next heartbeat (within a second)
+export async function startRecording(device: any) {
+    await controlOut(device, Request.StoreStart);
+}
+
+export async function stopRecording(device: any) {
+    await controlOut(device, Request.StoreStop);
+}
+
+// Stops recording and switches the volume over; resolves once the device
+// reports the new owner
+export async function exposeStore(device: any, usb = true, timeoutMs = 5000) {
+    await controlOut(device, Request.StoreExpose, usb ? 1 : 0);
+    const want: StoreState = usb ? "exposed" : "idle";
+    const deadline = Date.now() + timeoutMs;
+    for (;;) {
+        const status = await getStoreStatus(device);
+        if (status.state === want) return status;
+        if (Date.now() > deadline)
+            throw new Error(`Capture store stuck in state "${status.state}"`);
+        await new Promise((resolve) => setTimeout(resolve, 50));
+    }
+}
+
+// ---------- Clock synchronization ----------
+
+// Host side of the sync exchange; implemented by the addon's Clock
+export interface ClockModel {
+    sample(t0: number, device: number, t3: number): boolean;
+}
+
+// One NTP-style exchange: device time bracketed by two host clock reads
+export async function syncClock(
+    device: any,
+    model: ClockModel,
+    now: () => number
+) {
+    const t0 = now();
+    const view = await controlIn(device, Request.ClockSync, 8);
+    const t3 = now();
+    return model.sample(t0, Number(view.getBigInt64(0, true)), t3);
+}
+
+// Keep `model` up to date; returns a function that stops syncing
+export function startClockSync(
+    device: any,
+    model: ClockModel,
+    now: () => number,
+    intervalMs = 10_000
+) {
+    let timer: ReturnType<typeof setTimeout> | undefined;
+    let stopped = false;
+    const tick = async (burst: number) => {
+        try {
+            // A short burst gives the model a good first estimate quickly
+            for (let i = 0; i < burst && !stopped; i++)
+                await syncClock(device, model, now);
+        } catch (e) {
+            console.warn("Clock sync failed:", e);
+        }
+        if (!stopped) timer = setTimeout(() => tick(1), intervalMs);
+    };
+    tick(8);
+    return () => {
+        stopped = true;
+        clearTimeout(timer);
+    };
+}
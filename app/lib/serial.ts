@@ -1,3 +1,5 @@
+import fs from "node:fs";
+import path from "node:path";
 import { SerialPort } from "serialport";
 import { markRaw, Raw, ref, Ref } from "vue";
 
@@ -23,9 +25,44 @@ type PacketType = Packet["type"];
 
 export const queue = ref<(Packet | UserHint)[] | null>(null);
 
+// Virtual devices (firmware/test/host/sim) publish their CDC ports as links
+// named usb-<vid>_<pid>_<manufacturer>_<product>_<serial>-if<nn>
+const SIM_DIR = process.env.PROTOAI_SIM_DIR ?? "/tmp/protoai-sim";
+const SIM_LINK =
+    /^usb-([0-9a-f]{4})_([0-9a-f]{4})_([^_]+)_.+_([^_]+)-if[0-9]{2}$/;
+
+function listSimulatedPorts(): PortInfo[] {
+    let names: string[];
+    try {
+        names = fs.readdirSync(SIM_DIR);
+    } catch {
+        return [];
+    }
+    return names.flatMap((name) => {
+        const match = SIM_LINK.exec(name);
+        const link = path.join(SIM_DIR, name);
+        // Links of a simulation that was killed point nowhere
+        if (!match || !fs.existsSync(link)) return [];
+        const [, vendorId, productId, manufacturer, serialNumber] = match;
+        return [
+            {
+                path: link,
+                manufacturer,
+                serialNumber,
+                pnpId: name,
+                locationId: undefined,
+                vendorId,
+                productId,
+            },
+        ];
+    });
+}
+
 export async function enumeratePorts() {
     console.log("Enumerating ports...");
-    ports.value = (await SerialPort.list()).map((p) => markRaw(p));
+    ports.value = [...(await SerialPort.list()), ...listSimulatedPorts()].map(
+        (p) => markRaw(p)
+    );
     if (!upStream.value) {
         const candidates = ports.value
             .filter((p) => p.manufacturer === "ProtoAI")
@@ -17,6 +17,14 @@ using namespace Napi;
 Object init(Env env, Object exports) {
   Dispatcher::init(env);
   CORE_OBJECT_EXPORT(CounterObject, env, exports);
+  CORE_OBJECT_EXPORT(ClockObject, env, exports);
+  CORE_OBJECT_EXPORT(CaptureObject, env, exports);
+  CORE_OBJECT_EXPORT(CaptureFileObject, env, exports);
+  CORE_OBJECT_EXPORT(CaptureReceiverObject, env, exports);
+  CORE_OBJECT_EXPORT(MetricsObject, env, exports);
+  EXTERN(exportLog, Napi::Env, Napi::Object &)(env, exports);
+  EXTERN(exportTrace, Napi::Env, Napi::Object &)(env, exports);
+  EXTERN(exportBench, Napi::Env, Napi::Object &)(env, exports);
   return exports;
 }
 
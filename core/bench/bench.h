@@ -0,0 +1,167 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Minimal harness shared by the core microbenchmarks.
+ *
+ * Every result is one line: a table row by default, with --json an object
+ *   {"bench", "threads", "ops", "seconds", "ops_per_s",
+ *    "p50_ns", "p90_ns", "p99_ns", "p999_ns", "max_ns"}
+ * in the schema napi.cjs prints too, so that compare.cjs can diff any two
+ * runs of either.
+ */
+namespace Bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
+struct Options {
+  std::vector<unsigned> threads = {1, 2, 4, 8, 16, 32};
+  size_t ops = 200000;
+  bool json = false;
+  // Only run benchmarks whose name contains this
+  std::string filter;
+};
+
+/** Latency samples of one run, in ns */
+class Samples {
+public:
+  void reserve(size_t n) { ns.reserve(n); }
+  void add(uint64_t v) { ns.push_back(v); }
+  void merge(const Samples &other) {
+    ns.insert(ns.end(), other.ns.begin(), other.ns.end());
+  }
+  size_t size() const { return ns.size(); }
+
+  /** Sorts on first use; call after all samples are in */
+  uint64_t percentile(double p) {
+    if (ns.empty())
+      return 0;
+    if (!sorted) {
+      std::sort(ns.begin(), ns.end());
+      sorted = true;
+    }
+    const size_t i = (size_t)(p * (double)(ns.size() - 1) + 0.5);
+    return ns[std::min(i, ns.size() - 1)];
+  }
+
+private:
+  std::vector<uint64_t> ns;
+  bool sorted = false;
+};
+
+/**
+ * Wall time of a multi-threaded run: from the first thread starting work to
+ * the last one finishing, as seen by the threads themselves
+ */
+class Window {
+public:
+  void begin() { update(first, now_ns(), std::less<uint64_t>()); }
+  void end() { update(last, now_ns(), std::greater<uint64_t>()); }
+  double seconds() const { return (double)(last - first) * 1e-9; }
+
+private:
+  template <typename Cmp>
+  static void update(std::atomic<uint64_t> &slot, uint64_t t, Cmp better) {
+    uint64_t cur = slot.load(std::memory_order_relaxed);
+    while (better(t, cur) &&
+           !slot.compare_exchange_weak(cur, t, std::memory_order_relaxed))
+      ;
+  }
+  std::atomic<uint64_t> first{UINT64_MAX}, last{0};
+};
+
+[[noreturn]] inline void usage(const char *prog) {
+  std::fprintf(stderr,
+               "usage: %s [options] [filter]\n"
+               "  --threads 1,2,...  thread counts to sweep (1-32)\n"
+               "  --ops N            operations per run\n"
+               "  --json             one JSON object per result line\n",
+               prog);
+  std::exit(2);
+}
+
+inline Options parse(int argc, char **argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    auto value = [&] {
+      if (++i >= argc)
+        usage(argv[0]);
+      return argv[i];
+    };
+    if (arg == "--threads") {
+      opt.threads.clear();
+      for (const char *s = value(); *s;) {
+        char *end;
+        const unsigned long n = std::strtoul(s, &end, 10);
+        if (end == s || n == 0 || n > 32)
+          usage(argv[0]);
+        opt.threads.push_back((unsigned)n);
+        s = *end ? end + 1 : end;
+      }
+    } else if (arg == "--ops") {
+      opt.ops = std::strtoul(value(), nullptr, 10);
+      if (opt.ops == 0)
+        usage(argv[0]);
+    } else if (arg == "--json") {
+      opt.json = true;
+    } else if (arg[0] == '-') {
+      usage(argv[0]);
+    } else {
+      opt.filter = arg;
+    }
+  }
+  return opt;
+}
+
+inline bool selected(const Options &opt, const char *bench) {
+  return opt.filter.empty() ||
+         std::string(bench).find(opt.filter) != std::string::npos;
+}
+
+inline void report(const Options &opt, const char *bench, unsigned threads,
+                   size_t ops, double seconds, Samples &latency) {
+  const double rate = seconds > 0 ? (double)ops / seconds : 0;
+  const uint64_t p50 = latency.percentile(0.5), p90 = latency.percentile(0.9),
+                 p99 = latency.percentile(0.99),
+                 p999 = latency.percentile(0.999),
+                 max = latency.percentile(1.0);
+  if (opt.json) {
+    std::printf("{\"bench\":\"%s\",\"threads\":%u,\"ops\":%zu,"
+                "\"seconds\":%.6f,\"ops_per_s\":%.0f,\"p50_ns\":%llu,"
+                "\"p90_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,"
+                "\"max_ns\":%llu}\n",
+                bench, threads, ops, seconds, rate, (unsigned long long)p50,
+                (unsigned long long)p90, (unsigned long long)p99,
+                (unsigned long long)p999, (unsigned long long)max);
+  } else {
+    std::printf("%-16s %3u threads %12.0f ops/s  p50 %8llu  p99 %8llu  "
+                "p99.9 %9llu  max %10llu ns\n",
+                bench, threads, rate, (unsigned long long)p50,
+                (unsigned long long)p99, (unsigned long long)p999,
+                (unsigned long long)max);
+  }
+  std::fflush(stdout);
+}
+
+} // namespace Bench
@@ -0,0 +1,135 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+// Microbenchmarks of the strict-identity cache of CoreObject
+// (utils/identity-table.h) against the unordered_map it replaced, on real
+// heap addresses:
+//
+//   identity_hit    look up a live object among 64k
+//   identity_churn  create (lookup miss, insert) and finalize (erase), with
+//                   64k objects alive at any time
+//   map_hit, map_churn  the same with Map<uintptr_t, V>
+//
+// The N-API reference itself is replaced by a pointer-sized stand-in, so
+// this measures the table alone; napi.cjs `wrap` measures it in place.
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "utils/identity-table.h"
+#include "utils/map-set.h"
+
+using namespace Bench;
+
+// Stand-in for Napi::ObjectReference: movable, empties when moved from
+struct Ref {
+  void *ref = nullptr;
+  Ref() = default;
+  explicit Ref(void *ref) : ref(ref) {}
+  Ref(Ref &&other) : ref(other.ref) { other.ref = nullptr; }
+  Ref &operator=(Ref &&other) {
+    ref = other.ref;
+    other.ref = nullptr;
+    return *this;
+  }
+};
+
+static constexpr size_t LIVE = 1 << 16;
+
+// Addresses of live cores, as CoreObject keys them
+static std::vector<std::unique_ptr<long>> cores(size_t n) {
+  std::vector<std::unique_ptr<long>> out;
+  for (size_t i = 0; i < n; i++)
+    out.push_back(std::make_unique<long>(i));
+  return out;
+}
+
+static inline uintptr_t key(const std::unique_ptr<long> &p) {
+  return (uintptr_t)p.get();
+}
+
+// Defeat dead-code elimination of lookups
+static volatile uintptr_t sink;
+
+struct Table {
+  IdentityTable<Ref> table;
+  void *find(uintptr_t k) {
+    auto ref = table.find(k);
+    return ref ? ref->ref : nullptr;
+  }
+  void set(uintptr_t k, const void *owner) {
+    table.set(k, owner, Ref((void *)k));
+  }
+  void erase(uintptr_t k, const void *owner) { table.erase(k, owner); }
+};
+
+// What CoreObject had before: prune on lookup, keyed erase
+struct MapTable {
+  Map<uintptr_t, Ref> table;
+  void *find(uintptr_t k) {
+    if (!table.has(k))
+      return nullptr;
+    return table.get(k).ref;
+  }
+  void set(uintptr_t k, const void *) { table[k] = Ref((void *)k); }
+  void erase(uintptr_t k, const void *) { table.erase(k); }
+};
+
+template <typename T> static void hit(const Options &opt, const char *name) {
+  T table;
+  auto live = cores(LIVE);
+  for (auto &c : live)
+    table.set(key(c), c.get());
+  std::mt19937 rng(1);
+  std::vector<uint32_t> order(opt.ops);
+  for (auto &i : order)
+    i = rng() % LIVE;
+  Samples latency;
+  latency.reserve(opt.ops);
+  const uint64_t t0 = now_ns();
+  for (size_t i = 0; i < opt.ops; i++) {
+    const uint64_t t = now_ns();
+    sink = (uintptr_t)table.find(key(live[order[i]]));
+    latency.add(now_ns() - t);
+  }
+  report(opt, name, 1, opt.ops, (now_ns() - t0) * 1e-9, latency);
+}
+
+template <typename T> static void churn(const Options &opt, const char *name) {
+  T table;
+  // A ring of live objects: each new one finalizes the oldest
+  std::vector<std::unique_ptr<long>> live(LIVE);
+  Samples latency;
+  latency.reserve(opt.ops);
+  const uint64_t t0 = now_ns();
+  for (size_t i = 0; i < opt.ops; i++) {
+    auto &slot = live[i % LIVE];
+    auto next = std::make_unique<long>(i);
+    const uint64_t t = now_ns();
+    if (slot)
+      table.erase(key(slot), slot.get());
+    if (!table.find(key(next)))
+      table.set(key(next), next.get());
+    latency.add(now_ns() - t);
+    slot = std::move(next);
+  }
+  report(opt, name, 1, opt.ops, (now_ns() - t0) * 1e-9, latency);
+}
+
+int main(int argc, char **argv) {
+  const Options opt = parse(argc, argv);
+  // One env, one thread: there is no thread count to sweep
+  if (selected(opt, "identity_hit"))
+    hit<Table>(opt, "identity_hit");
+  if (selected(opt, "identity_churn"))
+    churn<Table>(opt, "identity_churn");
+  if (selected(opt, "map_hit"))
+    hit<MapTable>(opt, "map_hit");
+  if (selected(opt, "map_churn"))
+    churn<MapTable>(opt, "map_churn");
+  return 0;
+}
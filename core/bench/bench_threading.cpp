@@ -0,0 +1,213 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+// Microbenchmarks of the Node-free core runtime: threading::FIFO,
+// Stream<T> / Subscriber<T> and threading::Pool, throughput and per-item
+// latency over a sweep of thread counts.
+//
+//   fifo          half the threads write a bounded FIFO, half read it
+//   fifo_unbounded  the same without a size limit
+//   stream        every thread pushes into one Stream, one Subscriber
+//   stream_fanout one thread pushes into a Stream with a Subscriber per
+//                 thread count; latency is the push() call
+//   pool          a Pool of that many workers runs a Group of empty jobs
+//                 submitted from outside; latency is submit to start
+//   pool_nested   the same jobs, each submitted from a job on the pool
+//   task_hop      one threading::Task rescheduling itself on the Pool;
+//                 latency is co_await schedule() to resume
+//
+// Latency is stamped by the writer and taken by the reader, so it includes
+// the time an item waited in the queue.
+
+#include <atomic>
+#include <latch>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Stream.h"
+#include "bench.h"
+#include "threading/FIFO.h"
+#include "threading/Pool.h"
+#include "threading/Task.h"
+
+using namespace Bench;
+
+struct Item {
+  uint64_t stamp;
+};
+
+// Writers get an equal share, the first one the remainder
+static size_t share(size_t ops, unsigned n, unsigned i) {
+  return ops / n + (i == 0 ? ops % n : 0);
+}
+
+static void fifo(const Options &opt, const char *name, unsigned threads,
+                 size_t capacity) {
+  threading::FIFO<Item> queue(capacity);
+  Samples latency;
+  latency.reserve(opt.ops);
+
+  if (threads == 1) {
+    // Uncontended: one thread writes and reads back every item
+    const uint64_t t0 = now_ns();
+    for (size_t i = 0; i < opt.ops; i++) {
+      queue.write(Item{now_ns()});
+      const Item item = queue.read();
+      latency.add(now_ns() - item.stamp);
+    }
+    report(opt, name, threads, opt.ops, (now_ns() - t0) * 1e-9, latency);
+    return;
+  }
+
+  const unsigned writers = (threads + 1) / 2, readers = threads - writers;
+  std::latch start(threads);
+  Window window;
+  std::atomic<int64_t> remaining{(int64_t)opt.ops};
+  std::vector<Samples> samples(readers);
+  std::vector<std::thread> pool;
+  for (unsigned w = 0; w < writers; w++)
+    pool.emplace_back([&, w] {
+      start.arrive_and_wait();
+      window.begin();
+      for (size_t i = share(opt.ops, writers, w); i > 0; i--)
+        queue.write(Item{now_ns()});
+      window.end();
+    });
+  for (unsigned r = 0; r < readers; r++)
+    pool.emplace_back([&, r] {
+      Samples &s = samples[r];
+      s.reserve(opt.ops / readers + 1);
+      start.arrive_and_wait();
+      window.begin();
+      // FIFO::read() throws once closed, so readers take a count instead
+      while (remaining.fetch_sub(1, std::memory_order_relaxed) > 0) {
+        const Item item = queue.read();
+        s.add(now_ns() - item.stamp);
+      }
+      window.end();
+    });
+  for (auto &t : pool)
+    t.join();
+  for (auto &s : samples)
+    latency.merge(s);
+  report(opt, name, threads, opt.ops, window.seconds(), latency);
+}
+
+// Records delivery latency; Stream::push() calls it under the stream lock
+class Probe : public Subscriber<Item> {
+public:
+  Samples samples;
+  explicit Probe(Stream<Item> *stream) : Subscriber<Item>(stream) {}
+
+protected:
+  void push(Item item) override { samples.add(now_ns() - item.stamp); }
+};
+
+static void stream(const Options &opt, unsigned threads) {
+  Stream<Item> stream;
+  Probe probe(&stream);
+  probe.samples.reserve(opt.ops);
+  std::latch start(threads);
+  Window window;
+  std::vector<std::thread> pool;
+  for (unsigned w = 0; w < threads; w++)
+    pool.emplace_back([&, w] {
+      start.arrive_and_wait();
+      window.begin();
+      for (size_t i = share(opt.ops, threads, w); i > 0; i--)
+        stream.push(Item{now_ns()});
+      window.end();
+    });
+  for (auto &t : pool)
+    t.join();
+  report(opt, "stream", threads, opt.ops, window.seconds(), probe.samples);
+}
+
+static void stream_fanout(const Options &opt, unsigned threads) {
+  Stream<Item> stream;
+  std::vector<std::unique_ptr<Probe>> probes;
+  for (unsigned i = 0; i < threads; i++)
+    probes.push_back(std::make_unique<Probe>(&stream));
+  for (auto &p : probes)
+    p->samples.reserve(opt.ops);
+  Samples latency;
+  latency.reserve(opt.ops);
+  const uint64_t t0 = now_ns();
+  for (size_t i = 0; i < opt.ops; i++) {
+    const uint64_t t = now_ns();
+    stream.push(Item{t});
+    latency.add(now_ns() - t);
+  }
+  const uint64_t t1 = now_ns();
+  report(opt, "stream_fanout", threads, opt.ops, (t1 - t0) * 1e-9, latency);
+}
+
+static void pool(const Options &opt, const char *name, unsigned threads,
+                 bool nested) {
+  threading::Pool pool(threads);
+  std::vector<uint64_t> stamps(opt.ops), started(opt.ops);
+  const uint64_t t0 = now_ns();
+  {
+    threading::Group group(pool);
+    auto submit = [&] {
+      for (size_t i = 0; i < opt.ops; i++) {
+        stamps[i] = now_ns();
+        group.run([&, i] { started[i] = now_ns(); });
+      }
+    };
+    if (nested)
+      group.run(submit);
+    else
+      submit();
+    group.wait();
+  }
+  const uint64_t t1 = now_ns();
+  Samples latency;
+  latency.reserve(opt.ops);
+  for (size_t i = 0; i < opt.ops; i++)
+    latency.add(started[i] - stamps[i]);
+  report(opt, name, threads, opt.ops, (t1 - t0) * 1e-9, latency);
+}
+
+static threading::Task<> hops(threading::Pool &pool, Samples &latency,
+                              size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    const uint64_t t = now_ns();
+    co_await threading::schedule(pool);
+    latency.add(now_ns() - t);
+  }
+}
+
+static void task_hop(const Options &opt, unsigned threads) {
+  threading::Pool pool(threads);
+  Samples latency;
+  latency.reserve(opt.ops);
+  const uint64_t t0 = now_ns();
+  threading::sync_wait(hops(pool, latency, opt.ops));
+  const uint64_t t1 = now_ns();
+  report(opt, "task_hop", threads, opt.ops, (t1 - t0) * 1e-9, latency);
+}
+
+int main(int argc, char **argv) {
+  const Options opt = parse(argc, argv);
+  for (unsigned threads : opt.threads) {
+    if (selected(opt, "fifo"))
+      fifo(opt, "fifo", threads, 1024);
+    if (selected(opt, "fifo_unbounded"))
+      fifo(opt, "fifo_unbounded", threads, 0);
+    if (selected(opt, "stream"))
+      stream(opt, threads);
+    if (selected(opt, "stream_fanout"))
+      stream_fanout(opt, threads);
+    if (selected(opt, "pool"))
+      pool(opt, "pool", threads, false);
+    if (selected(opt, "pool_nested"))
+      pool(opt, "pool_nested", threads, true);
+    if (selected(opt, "task_hop"))
+      task_hop(opt, threads);
+  }
+  return 0;
+}
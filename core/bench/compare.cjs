@@ -0,0 +1,72 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+
+// Diff two runs of core_bench / napi.cjs saved with --json:
+//
+//   node bench/compare.cjs base.jsonl head.jsonl [--threshold 5]
+//
+// Prints throughput and tail latency of every (bench, threads) pair found
+// in both, flagging changes beyond the threshold (percent). Exits with 1
+// if anything got worse by more than that, so it can gate a change.
+
+const { readFileSync } = require("node:fs");
+
+const args = process.argv.slice(2);
+let threshold = 5;
+const files = [];
+for (let i = 0; i < args.length; i++)
+    if (args[i] === "--threshold") threshold = Number(args[++i]);
+    else files.push(args[i]);
+if (files.length !== 2 || !(threshold >= 0)) {
+    console.error(
+        "usage: node bench/compare.cjs base.jsonl head.jsonl [--threshold 5]"
+    );
+    process.exit(2);
+}
+
+function load(file) {
+    const runs = new Map();
+    for (const line of readFileSync(file, "utf8").split("\n")) {
+        if (!line.trim().startsWith("{")) continue;
+        const r = JSON.parse(line);
+        runs.set(`${r.bench}/${r.threads}`, r);
+    }
+    return runs;
+}
+
+const [base, head] = files.map(load);
+// Higher is better for throughput, lower for latency
+const metrics = [
+    ["ops_per_s", +1],
+    ["p50_ns", -1],
+    ["p99_ns", -1],
+    ["p999_ns", -1],
+];
+
+let worse = 0;
+const fmt = (v) => String(v).padStart(10);
+console.log(
+    "bench/threads".padEnd(24) +
+        metrics.map(([m]) => m.padStart(10) + "        ").join("")
+);
+for (const [key, b] of base) {
+    const h = head.get(key);
+    if (!h) continue;
+    let row = key.padEnd(24);
+    for (const [m, sign] of metrics) {
+        const change = b[m] ? ((h[m] - b[m]) / b[m]) * 100 : 0;
+        const flag =
+            Math.abs(change) <= threshold
+                ? " "
+                : sign * change > 0
+                ? "+"
+                : (worse++, "-");
+        const pct = `${change >= 0 ? "+" : ""}${change.toFixed(1)}%`;
+        row += `${fmt(h[m])} ${pct.padStart(6)}${flag}`;
+    }
+    console.log(row);
+}
+process.exit(worse ? 1 : 0);
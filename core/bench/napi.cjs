@@ -0,0 +1,140 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+
+// Microbenchmarks of the N-API side of the core runtime, run under the
+// Node the addon was built for:
+//
+//   create      Counter.create(): CoreObject::Create() and its registry
+//   wrap        CoreObject::Create() called from native code, no JS call
+//   rewrap      the same, always for one native object: identity cache hits
+//   call        a method call into a CoreObject (Counter.next())
+//   getter      an accessor on a CoreObject (Counter.value)
+//   throw       a native TypeError thrown and caught, stack left unread
+//   dispatch    Dispatcher::dispatch() from 1-32 native threads, latency
+//               from dispatch to the task running on the main thread
+//   hop         a coroutine moving main -> pool -> main (utils/coro.h),
+//               latency of each round trip
+//
+//   node bench/napi.cjs [--threads 1,2,...] [--ops N] [--json] [filter]
+//
+// Output follows bench.h, so compare.cjs diffs these with core_bench.
+
+const core = require("..");
+
+function parse(argv) {
+    const opt = { threads: [1, 2, 4, 8, 16, 32], ops: 200000, json: false };
+    for (let i = 0; i < argv.length; i++) {
+        const arg = argv[i];
+        if (arg === "--threads")
+            opt.threads = argv[++i].split(",").map(Number);
+        else if (arg === "--ops") opt.ops = Number(argv[++i]);
+        else if (arg === "--json") opt.json = true;
+        else if (arg.startsWith("-")) usage();
+        else opt.filter = arg;
+    }
+    if (!(opt.ops > 0) || opt.threads.some((n) => !(n >= 1 && n <= 32)))
+        usage();
+    return opt;
+}
+
+function usage() {
+    console.error(
+        "usage: node bench/napi.cjs [--threads 1,2,...] [--ops N] [--json] [filter]"
+    );
+    process.exit(2);
+}
+
+function percentile(sorted, p) {
+    if (sorted.length === 0) return 0;
+    const i = Math.round(p * (sorted.length - 1));
+    return Math.round(sorted[Math.min(i, sorted.length - 1)]);
+}
+
+function report(opt, bench, threads, ops, seconds, latency) {
+    const sorted = Float64Array.from(latency).sort();
+    const r = {
+        bench,
+        threads,
+        ops,
+        seconds: Number(seconds.toFixed(6)),
+        ops_per_s: Math.round(seconds > 0 ? ops / seconds : 0),
+        p50_ns: percentile(sorted, 0.5),
+        p90_ns: percentile(sorted, 0.9),
+        p99_ns: percentile(sorted, 0.99),
+        p999_ns: percentile(sorted, 0.999),
+        max_ns: percentile(sorted, 1),
+    };
+    if (opt.json) return console.log(JSON.stringify(r));
+    const n = (v, w) => String(v).padStart(w);
+    console.log(
+        `${r.bench.padEnd(16)} ${n(threads, 3)} threads ${n(r.ops_per_s, 12)}` +
+            ` ops/s  p50 ${n(r.p50_ns, 8)}  p99 ${n(r.p99_ns, 8)}` +
+            `  p99.9 ${n(r.p999_ns, 9)}  max ${n(r.max_ns, 10)} ns`
+    );
+}
+
+// Times `fn` once per op on the main thread
+function single(opt, bench, fn) {
+    const latency = new Float64Array(opt.ops);
+    const t0 = process.hrtime.bigint();
+    for (let i = 0; i < opt.ops; i++) {
+        const t = process.hrtime.bigint();
+        fn(i);
+        latency[i] = Number(process.hrtime.bigint() - t);
+    }
+    const seconds = Number(process.hrtime.bigint() - t0) * 1e-9;
+    report(opt, bench, 1, opt.ops, seconds, latency);
+}
+
+async function main() {
+    const opt = parse(process.argv.slice(2));
+    const selected = (name) => !opt.filter || name.includes(opt.filter);
+    const { Counter } = core;
+
+    // The main-thread probes have nothing to sweep
+    if (selected("create")) {
+        const keep = new Array(opt.ops);
+        single(opt, "create", (i) => (keep[i] = Counter.create(i)));
+        keep.forEach((c) => c.destroy());
+    }
+    for (const [name, same] of [["wrap", false], ["rewrap", true]]) {
+        if (!selected(name)) continue;
+        const t0 = process.hrtime.bigint();
+        const latency = core.__bench__.wrap(opt.ops, same);
+        const seconds = Number(process.hrtime.bigint() - t0) * 1e-9;
+        report(opt, name, 1, opt.ops, seconds, latency);
+    }
+    const counter = Counter.create();
+    if (selected("call")) single(opt, "call", () => counter.next());
+    if (selected("getter")) single(opt, "getter", () => counter.value);
+    if (selected("throw"))
+        single(opt, "throw", () => {
+            try {
+                counter.value = "not a number";
+            } catch {}
+        });
+    counter.destroy();
+
+    if (selected("dispatch"))
+        for (const threads of opt.threads) {
+            const perThread = Math.max(1, Math.floor(opt.ops / threads));
+            const t0 = process.hrtime.bigint();
+            const latency = await core.__bench__.dispatch(threads, perThread);
+            const seconds = Number(process.hrtime.bigint() - t0) * 1e-9;
+            report(opt, "dispatch", threads, latency.length, seconds, latency);
+        }
+    if (selected("hop")) {
+        const t0 = process.hrtime.bigint();
+        const latency = await core.__bench__.hop(opt.ops);
+        const seconds = Number(process.hrtime.bigint() - t0) * 1e-9;
+        report(opt, "hop", 1, opt.ops, seconds, latency);
+    }
+}
+
+main().catch((e) => {
+    console.error(e);
+    process.exit(1);
+});
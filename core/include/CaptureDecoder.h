@@ -0,0 +1,393 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Lz.h"
+#include "Metrics.h"
+
+/**
+ * Host side of the capture record protocol (firmware/include/record.h):
+ * COBS-framed records delimited by zero bytes, each carrying a sequence
+ * number, a device timestamp and a CRC-16/CCITT-FALSE.
+ *
+ * Resynchronization is O(1): a zero byte never occurs inside an encoded
+ * record, so after any corruption the decoder drops what it has buffered and
+ * restarts at the next delimiter. Loss is measured from sequence numbers,
+ * which the device advances even for records it had to drop.
+ *
+ * Compressed streams carry each record inside an LZ frame (Lz.h). The LZ
+ * history only stays valid while no frame is lost; after a loss LZ frames
+ * are skipped until the device restarts its history (LZ_START). Records
+ * inside LZ frames carry seq and time as deltas to the previous record of
+ * the chain.
+ *
+ * PERF records (device performance counters, firmware/include/perf.h) are
+ * not passed on as records; the latest snapshot, with rates against the
+ * previous one, is kept in device().
+ */
+namespace Capture {
+
+enum Type : uint8_t {
+  DATA = 0x01,
+  SYNC = 0x02,
+  LZ = 0x03,
+  LZ_START = 0x04,
+  PERF = 0x05,
+};
+
+constexpr size_t HEADER_LEN = 9; // type, seq, time
+constexpr size_t CRC_LEN = 2;
+constexpr size_t SYNC_BODY_LEN = 16;
+constexpr size_t PERF_DEVICE_LEN = 12;
+constexpr size_t PERF_PORT_LEN = 40;
+
+struct Record {
+  Type type;
+  uint32_t seq;
+  uint64_t time; // device time (us), extended to 64 bits
+  // DATA
+  uint8_t src = 0;
+  const uint8_t *payload = nullptr; // valid during the callback only
+  size_t len = 0;
+  // SYNC: device-side counters
+  uint32_t records = 0, filtered = 0, dropped = 0;
+};
+
+/** Counters of one bridge port, cumulative since device boot */
+struct PortPerf {
+  uint32_t rx_bytes = 0, rx_chunks = 0, tx_bytes = 0, tx_chunks = 0;
+  uint32_t tx_full = 0; // writes cut short by a full TX FIFO
+  uint16_t rx_fifo_hwm = 0, tx_fifo_hwm = 0;
+  // Signalled-to-forwarded latency, us
+  uint32_t latency_min = 0, latency_max = 0;
+  uint32_t latency_total = 0, latency_count = 0;
+  // Per second, over the interval since the previous snapshot
+  double rx_rate = 0, tx_rate = 0;
+};
+
+struct DevicePerf {
+  bool valid = false;
+  uint32_t uptime_ms = 0;
+  uint32_t tud_loops = 0;
+  double tud_loop_rate = 0; // TinyUSB task passes per second
+  std::vector<PortPerf> ports;
+};
+
+struct Stats {
+  uint64_t records = 0; // valid records decoded
+  uint64_t bytes = 0;   // wire bytes consumed
+  uint64_t gaps = 0;    // discontinuities in the sequence
+  uint64_t lost = 0;    // records missing according to the sequence
+  uint64_t corrupt = 0; // frames dropped: bad COBS, CRC, length or type
+  uint64_t resets = 0;  // sequence went backwards (device restarted)
+  uint64_t compressed = 0; // LZ frames received
+  uint64_t inflated = 0;   // bytes those frames decompressed to
+  uint64_t stale = 0;      // LZ frames skipped waiting for a history reset
+};
+
+inline uint16_t crc16(const uint8_t *data, size_t len) {
+  static const auto table = [] {
+    std::array<uint16_t, 256> t{};
+    for (unsigned i = 0; i < 256; i++) {
+      uint16_t c = (uint16_t)(i << 8);
+      for (int b = 0; b < 8; b++)
+        c = (c & 0x8000) ? (uint16_t)((c << 1) ^ 0x1021) : (uint16_t)(c << 1);
+      t[i] = c;
+    }
+    return t;
+  }();
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++)
+    crc = (uint16_t)((crc << 8) ^ table[(crc >> 8) ^ data[i]]);
+  return crc;
+}
+
+/** In-place COBS decode, returns decoded length or SIZE_MAX if malformed */
+inline size_t cobs_decode(uint8_t *buf, size_t len) {
+  size_t in = 0, out = 0;
+  while (in < len) {
+    const uint8_t code = buf[in++];
+    if (code == 0 || in + code - 1 > len)
+      return SIZE_MAX;
+    std::memmove(buf + out, buf + in, code - 1);
+    in += code - 1;
+    out += code - 1;
+    // Every block but the last and 254-byte blocks imply a zero
+    if (code != 0xFF && in < len)
+      buf[out++] = 0;
+  }
+  return out;
+}
+
+class Decoder {
+public:
+  typedef std::shared_ptr<Decoder> Ptr;
+  template <typename... Args> static inline Ptr create(Args &&...args) {
+    return std::make_shared<Decoder>(std::forward<Args>(args)...);
+  }
+
+  // Encoded frames longer than this are treated as corrupt
+  static constexpr size_t DEFAULT_MAX_FRAME = 4096;
+
+  // Where pushed bytes come from: live traffic counts in the capture.*
+  // metrics, bytes replayed from files in capture.replay.*
+  enum Source { LIVE, REPLAY };
+
+  Decoder(size_t max_frame = DEFAULT_MAX_FRAME) : max_frame(max_frame) {
+    frame.reserve(max_frame);
+  }
+
+  /** Feed wire bytes, `on_record(const Record &)` runs per valid record */
+  template <typename F>
+  void push(const uint8_t *data, size_t len, F &&on, Source source = LIVE) {
+    totals = &metrics(source);
+    stats.bytes += len;
+    while (len > 0) {
+      auto end = static_cast<const uint8_t *>(std::memchr(data, 0, len));
+      const size_t n = end ? (size_t)(end - data) : len;
+      if (!overlong) {
+        if (frame.size() + n > max_frame) {
+          overlong = true;
+          frame.clear();
+        } else {
+          frame.insert(frame.end(), data, data + n);
+        }
+      }
+      if (!end)
+        return;
+      finish(on);
+      data += n + 1;
+      len -= n + 1;
+    }
+  }
+
+  const Stats &statistics() const { return stats; }
+  const DevicePerf &device() const { return perf; }
+
+  /** Forget partial input and sequence state (e.g. after reopening) */
+  void reset() {
+    frame.clear();
+    lz_valid = false;
+    overlong = false;
+    synced = false;
+    time_hi = 0;
+    last_time = 0;
+  }
+
+private:
+  const size_t max_frame;
+  std::vector<uint8_t> frame; // encoded bytes since the last delimiter
+  bool overlong = false;
+  bool synced = false; // expected_seq is valid
+  uint32_t expected_seq = 0;
+  uint32_t time_hi = 0, last_time = 0;
+  Stats stats;
+  DevicePerf perf;
+  Lz::Decoder lz;
+  bool lz_valid = false;
+  uint32_t chain_seq = 0, chain_time = 0;
+  std::vector<uint8_t> record; // un-delta'd copy of an LZ block
+
+  static inline uint32_t u32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+           (uint32_t)p[3] << 24;
+  }
+
+  static inline uint16_t u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+  }
+
+  static inline void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+  }
+
+  template <typename F> void finish(F &on) {
+    const bool was_overlong = overlong;
+    overlong = false;
+    if (frame.empty() && !was_overlong)
+      return; // back-to-back delimiters are legal padding
+    if (was_overlong || !unframe(on)) {
+      stats.corrupt++;
+      totals->corrupt.add();
+      // Whatever was lost may have been an LZ frame
+      lz_valid = false;
+    }
+    frame.clear();
+  }
+
+  template <typename F> bool unframe(F &on) {
+    const size_t len = cobs_decode(frame.data(), frame.size());
+    if (len == SIZE_MAX || len < 1)
+      return false;
+    if (frame[0] != LZ && frame[0] != LZ_START)
+      return parse(frame.data(), len, on, false);
+    stats.compressed++;
+    const bool chained = frame[0] == LZ;
+    if (!chained) {
+      lz.reset();
+      lz_valid = true;
+      chain_seq = chain_time = 0;
+    } else if (!lz_valid) {
+      stats.stale++;
+      return true;
+    }
+    const uint8_t *block;
+    size_t n;
+    if (!lz.decompress(frame.data() + 1, len - 1, max_frame, block, n) ||
+        n < HEADER_LEN)
+      return false;
+    stats.inflated += n;
+    // The block stays in the history as is; undo the deltas on a copy
+    record.assign(block, block + n);
+    chain_seq += u32(block + 1);
+    chain_time += u32(block + 5);
+    put_u32(record.data() + 1, chain_seq);
+    put_u32(record.data() + 5, chain_time);
+    return parse(record.data(), n, on, chained);
+  }
+
+  template <typename F>
+  bool parse(const uint8_t *p, size_t len, F &on, bool chained) {
+    if (len < HEADER_LEN + CRC_LEN)
+      return false;
+    const size_t body = len - CRC_LEN;
+    if (crc16(p, body) != (uint16_t)(p[body] | p[body + 1] << 8))
+      return false;
+
+    Record r;
+    r.type = (Type)p[0];
+    r.seq = u32(p + 1);
+    // A gap within a chain of LZ frames means a frame vanished without a
+    // trace and the history is suspect (the device restarts the chain after
+    // its own drops)
+    if (!sequence(r.seq) && chained)
+      return false;
+    const uint32_t lo = u32(p + 5);
+    switch (r.type) {
+    case DATA:
+      if (body < HEADER_LEN + 1)
+        return false;
+      r.src = p[HEADER_LEN];
+      r.payload = p + HEADER_LEN + 1;
+      r.len = body - HEADER_LEN - 1;
+      totals->bytes[r.src].add(r.len);
+      totals->packets[r.src].add();
+      // Carry into the high half when the 32-bit time wraps (~71 min)
+      if (lo < last_time && last_time - lo > 0x80000000u)
+        time_hi++;
+      break;
+    case SYNC:
+      if (body != HEADER_LEN + SYNC_BODY_LEN)
+        return false;
+      time_hi = u32(p + HEADER_LEN);
+      r.records = u32(p + HEADER_LEN + 4);
+      r.filtered = u32(p + HEADER_LEN + 8);
+      r.dropped = u32(p + HEADER_LEN + 12);
+      break;
+    case PERF:
+      if (!device_perf(p + HEADER_LEN, body - HEADER_LEN))
+        return false;
+      last_time = lo;
+      stats.records++;
+      return true;
+    default:
+      return false;
+    }
+    last_time = lo;
+    r.time = (uint64_t)time_hi << 32 | lo;
+    stats.records++;
+    on(static_cast<const Record &>(r));
+    return true;
+  }
+
+  bool device_perf(const uint8_t *p, size_t len) {
+    if (len < PERF_DEVICE_LEN)
+      return false;
+    const size_t n = p[8];
+    if (len != PERF_DEVICE_LEN + n * PERF_PORT_LEN)
+      return false;
+    DevicePerf next;
+    next.valid = true;
+    next.uptime_ms = u32(p);
+    next.tud_loops = u32(p + 4);
+    next.ports.resize(n);
+    // Rates need a previous snapshot from the same boot
+    const bool delta = perf.valid && perf.ports.size() == n &&
+                       next.uptime_ms > perf.uptime_ms;
+    const double dt = delta ? (next.uptime_ms - perf.uptime_ms) / 1e3 : 0;
+    if (delta)
+      next.tud_loop_rate = (uint32_t)(next.tud_loops - perf.tud_loops) / dt;
+    for (size_t i = 0; i < n; i++) {
+      const uint8_t *q = p + PERF_DEVICE_LEN + i * PERF_PORT_LEN;
+      PortPerf &port = next.ports[i];
+      port.rx_bytes = u32(q);
+      port.rx_chunks = u32(q + 4);
+      port.tx_bytes = u32(q + 8);
+      port.tx_chunks = u32(q + 12);
+      port.tx_full = u32(q + 16);
+      port.rx_fifo_hwm = u16(q + 20);
+      port.tx_fifo_hwm = u16(q + 22);
+      port.latency_min = u32(q + 24);
+      port.latency_max = u32(q + 28);
+      port.latency_total = u32(q + 32);
+      port.latency_count = u32(q + 36);
+      if (delta) {
+        const PortPerf &prev = perf.ports[i];
+        port.rx_rate = (uint32_t)(port.rx_bytes - prev.rx_bytes) / dt;
+        port.tx_rate = (uint32_t)(port.tx_bytes - prev.tx_bytes) / dt;
+      }
+    }
+    perf = std::move(next);
+    return true;
+  }
+
+  // Totals over every decoder in the process, per source interface
+  struct Totals {
+    explicit Totals(const std::string &prefix)
+        : bytes(prefix + ".bytes"), packets(prefix + ".packets"),
+          lost(Metrics::counter(prefix + ".lost")),
+          corrupt(Metrics::counter(prefix + ".corrupt")) {}
+    Metrics::CounterFamily<> bytes, packets;
+    Metrics::Counter &lost, &corrupt;
+  };
+  static Totals &metrics(Source source) {
+    static Totals live("capture"), replay("capture.replay");
+    return source == LIVE ? live : replay;
+  }
+  Totals *totals = &metrics(LIVE); // of the source being pushed
+
+  /** Returns false on a discontinuity */
+  bool sequence(uint32_t seq) {
+    const bool continuous = !synced || seq == expected_seq;
+    if (!continuous) {
+      const uint32_t skipped = seq - expected_seq;
+      if (skipped < 0x80000000u) {
+        stats.gaps++;
+        stats.lost += skipped;
+        totals->lost.add(skipped);
+      } else {
+        stats.resets++;
+        time_hi = last_time = 0;
+      }
+    }
+    synced = true;
+    expected_seq = seq + 1;
+    return continuous;
+  }
+};
+
+} // namespace Capture
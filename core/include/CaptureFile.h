@@ -0,0 +1,92 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/trace.h"
+
+/**
+ * Read-only memory mapping of a capture segment recorded by the device's
+ * capture store (CAPnnnnn.BIN, firmware/include/capture_store.h). Segments
+ * hold the raw wire bytes of the capture channel, so the mapping feeds
+ * Capture::Decoder::push() directly: the page cache is the only copy.
+ */
+namespace Capture {
+
+class File {
+public:
+  using Ptr = std::shared_ptr<File>;
+
+  static Ptr create(const std::string &path) {
+    return std::make_shared<File>(path);
+  }
+
+  explicit File(const std::string &path) : path_(path) {
+    TRACE_SPAN("Capture::File::open");
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      fail("open");
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      const int err = errno;
+      ::close(fd);
+      errno = err;
+      fail("stat");
+    }
+    size_ = (size_t)st.st_size;
+    // mmap() rejects empty mappings; an empty segment is just empty
+    if (size_ > 0) {
+      void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      const int err = errno;
+      ::close(fd);
+      if (p == MAP_FAILED) {
+        errno = err;
+        fail("mmap");
+      }
+      data_ = static_cast<const uint8_t *>(p);
+      // Decoding walks the file once, front to back
+      ::madvise(p, size_, MADV_SEQUENTIAL);
+    } else {
+      ::close(fd);
+    }
+  }
+
+  ~File() {
+    if (data_)
+      ::munmap(const_cast<uint8_t *>(data_), size_);
+  }
+
+  File(const File &) = delete;
+  File &operator=(const File &) = delete;
+
+  const uint8_t *data() const { return data_; }
+  size_t size() const { return size_; }
+  const std::string &path() const { return path_; }
+
+private:
+  [[noreturn]] void fail(const char *what) const {
+    throw std::runtime_error("CaptureFile: " + std::string(what) + " " +
+                             path_ + ": " + std::strerror(errno));
+  }
+
+  std::string path_;
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+} // namespace Capture
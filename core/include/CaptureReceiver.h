@@ -0,0 +1,266 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "CaptureDecoder.h"
+#include "Metrics.h"
+#include "utils/trace.h"
+
+/**
+ * Receiver for the capture stream the firmware sends as UDP datagrams over
+ * its USB network interface (CAPTURE_NET, firmware/include/capture_net.h).
+ *
+ * A background thread keeps the subscription alive (one datagram to the
+ * device every SUBSCRIBE_INTERVAL), drains the socket with recvmmsg(), up to
+ * BATCH datagrams per system call, and decodes them right there. Each
+ * wakeup hands the records it produced to the callback in one Batch, so the
+ * consumer pays per batch, not per record or datagram.
+ *
+ * Datagrams hold whole records; a lost one shows up as a sequence gap in
+ * the decoder statistics like any other loss.
+ */
+namespace Capture {
+
+struct ReceiverOptions {
+  std::string device = "192.168.7.1"; // CAPTURE_NET_ADDR
+  uint16_t port = 5270;               // CAPTURE_NET_PORT
+  uint16_t local_port = 0;            // 0: any
+};
+
+class Receiver {
+public:
+  typedef std::shared_ptr<Receiver> Ptr;
+  template <typename... Args> static inline Ptr create(Args &&...args) {
+    return std::make_shared<Receiver>(std::forward<Args>(args)...);
+  }
+
+  /** Records decoded in one wakeup of the receive thread */
+  struct Batch {
+    std::vector<Record> records;
+    // DATA payloads, Record::payload points in here
+    std::vector<uint8_t> payload;
+  };
+  /** Runs on the receive thread */
+  using Callback = std::function<void(Batch &&)>;
+
+  using Options = ReceiverOptions;
+
+  static constexpr size_t BATCH = 64;
+  // Larger than any datagram the device sends (one Ethernet frame)
+  static constexpr size_t DATAGRAM_MAX = 2048;
+  static constexpr std::chrono::milliseconds SUBSCRIBE_INTERVAL{1000};
+  // Upper bound on how long close() waits for the thread
+  static constexpr int POLL_MS = 100;
+
+  Receiver(Callback callback, const Options &options = Options())
+      : callback(std::move(callback)), buffers(BATCH * DATAGRAM_MAX) {
+    std::memset(&device_addr, 0, sizeof(device_addr));
+    device_addr.sin_family = AF_INET;
+    device_addr.sin_port = htons(options.port);
+    if (inet_pton(AF_INET, options.device.c_str(), &device_addr.sin_addr) != 1)
+      throw std::runtime_error("CaptureReceiver: bad device address " +
+                               options.device);
+    fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+      fail("socket");
+    // Room for bursts while the consumer is busy
+    const int rcvbuf = 4 << 20;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(options.local_port);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0)
+      fail("bind");
+    thread = std::thread([this] { run(); });
+  }
+
+  ~Receiver() { close(); }
+
+  Receiver(const Receiver &) = delete;
+  Receiver &operator=(const Receiver &) = delete;
+
+  /**
+   * Stop receiving; the callback is not called after this returns, and
+   * is released along with what it holds
+   */
+  void close() {
+    if (stop.exchange(true))
+      return;
+    if (thread.joinable())
+      thread.join();
+    ::close(fd);
+    fd = -1;
+    callback = nullptr;
+  }
+
+  bool closed() const { return stop.load(); }
+
+  uint16_t localPort() const {
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    if (fd < 0 ||
+        ::getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) != 0)
+      return 0;
+    return ntohs(addr.sin_port);
+  }
+
+  Stats statistics() const {
+    std::scoped_lock lock(mutex);
+    return decoder.statistics();
+  }
+
+  DevicePerf device() const {
+    std::scoped_lock lock(mutex);
+    return decoder.device();
+  }
+
+  uint64_t datagrams() const { return received.load(); }
+  // Datagrams cut short by DATAGRAM_MAX (decoded as corrupt records)
+  uint64_t truncated() const { return cut.load(); }
+
+private:
+  [[noreturn]] void fail(const char *what) {
+    const int err = errno;
+    if (fd >= 0)
+      ::close(fd);
+    throw std::runtime_error("CaptureReceiver: " + std::string(what) + ": " +
+                             std::strerror(err));
+  }
+
+  void subscribe() {
+    static const char hello[] = "CAPTURE";
+    ::sendto(fd, hello, sizeof(hello) - 1, 0,
+             reinterpret_cast<const sockaddr *>(&device_addr),
+             sizeof(device_addr));
+  }
+
+  // Decode `n` datagrams from `buffers`, collecting into `batch`
+  void decode(const size_t *lengths, size_t n, Batch &batch,
+              std::vector<size_t> &offsets) {
+    std::scoped_lock lock(mutex);
+    for (size_t i = 0; i < n; i++) {
+      decoder.push(&buffers[i * DATAGRAM_MAX], lengths[i],
+                   [&](const Record &r) {
+                     offsets.push_back(batch.payload.size());
+                     batch.payload.insert(batch.payload.end(), r.payload,
+                                          r.payload + r.len);
+                     batch.records.push_back(r);
+                   });
+    }
+  }
+
+  // Receive what is waiting, up to BATCH datagrams; 0 when drained
+  size_t receive(size_t *lengths) {
+#if defined(__linux__)
+    mmsghdr msgs[BATCH];
+    iovec iov[BATCH];
+    for (size_t i = 0; i < BATCH; i++) {
+      iov[i] = {&buffers[i * DATAGRAM_MAX], DATAGRAM_MAX};
+      msgs[i] = {};
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    const int n = ::recvmmsg(fd, msgs, BATCH, MSG_DONTWAIT, nullptr);
+    if (n <= 0)
+      return 0;
+    for (int i = 0; i < n; i++) {
+      lengths[i] = msgs[i].msg_len;
+      if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+        cut++;
+        truncated_total.add();
+      }
+    }
+    return (size_t)n;
+#else
+    size_t n = 0;
+    while (n < BATCH) {
+      const ssize_t len = ::recv(fd, &buffers[n * DATAGRAM_MAX], DATAGRAM_MAX,
+                                 MSG_DONTWAIT | MSG_TRUNC);
+      if (len < 0)
+        break;
+      if ((size_t)len > DATAGRAM_MAX) {
+        cut++;
+        truncated_total.add();
+      }
+      lengths[n++] = std::min((size_t)len, DATAGRAM_MAX);
+    }
+    return n;
+#endif
+  }
+
+  void run() {
+    using clock = std::chrono::steady_clock;
+    auto next_subscribe = clock::now();
+    size_t lengths[BATCH];
+    std::vector<size_t> offsets;
+    while (!stop.load()) {
+      const auto now = clock::now();
+      if (now >= next_subscribe) {
+        subscribe();
+        next_subscribe = now + SUBSCRIBE_INTERVAL;
+      }
+      pollfd p = {fd, POLLIN, 0};
+      if (::poll(&p, 1, POLL_MS) <= 0)
+        continue;
+      TRACE_SPAN("Receiver::wakeup");
+      // One system call per wakeup keeps batches bounded under a flood
+      size_t n;
+      {
+        TRACE_SPAN("Receiver::recv");
+        n = receive(lengths);
+      }
+      received += n;
+      datagrams_total.add(n);
+      Batch batch;
+      offsets.clear();
+      {
+        TRACE_SPAN("Receiver::decode");
+        decode(lengths, n, batch, offsets);
+      }
+      if (batch.records.empty())
+        continue;
+      // Payloads moved while growing: point records at their final place
+      for (size_t i = 0; i < batch.records.size(); i++)
+        batch.records[i].payload = batch.payload.data() + offsets[i];
+      TRACE_SPAN("Receiver::deliver");
+      callback(std::move(batch));
+    }
+  }
+
+  Callback callback;
+  int fd = -1;
+  sockaddr_in device_addr;
+  std::vector<uint8_t> buffers; // BATCH datagrams of DATAGRAM_MAX bytes
+  mutable std::mutex mutex;     // guards the decoder
+  Decoder decoder;
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> received{0}, cut{0};
+  // The same over every receiver in the process
+  Metrics::Counter &datagrams_total = Metrics::counter("capture.datagrams");
+  Metrics::Counter &truncated_total = Metrics::counter("capture.truncated");
+  std::thread thread;
+};
+
+} // namespace Capture
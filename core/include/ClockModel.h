@@ -0,0 +1,177 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+/**
+ * Drift-corrected linear mapping from device time (esp_timer) to host time
+ * (steady clock, CLOCK_MONOTONIC on Linux), both in microseconds.
+ *
+ * Fed with NTP-style exchanges: the host reads its clock (t0), asks the
+ * device for its time (d), then reads its clock again (t3). Assuming the
+ * device sampled d half way through, d corresponds to host time (t0+t3)/2
+ * with an uncertainty of (t3-t0)/2. A weighted least-squares fit over a
+ * sliding window of such samples gives offset and drift; samples delayed by
+ * host scheduling or USB bus contention (large round trip) are rejected
+ * relative to the best round trip in the window.
+ */
+class ClockModel {
+public:
+  typedef std::shared_ptr<ClockModel> Ptr;
+  template <typename... Args> static inline Ptr create(Args &&...args) {
+    return std::make_shared<ClockModel>(std::forward<Args>(args)...);
+  }
+
+  // ~10 minutes of history at the default 10 s sync interval
+  static constexpr size_t WINDOW = 64;
+  // Drift below this span is indistinguishable from jitter
+  static constexpr double MIN_SPAN_US = 1e6;
+  // Samples slower than REJECT x the best round trip get no weight
+  static constexpr double REJECT = 3.0;
+  // Round trip floor, keeps weights finite for sub-us exchanges
+  static constexpr double RTT_FLOOR_US = 1.0;
+
+  /** Host clock in microseconds */
+  static inline double now() {
+    using namespace std::chrono;
+    return (double)duration_cast<nanoseconds>(
+               steady_clock::now().time_since_epoch())
+               .count() /
+           1e3;
+  }
+
+  /** Add one exchange, returns false if it was discarded as malformed */
+  bool sample(double t0, double device, double t3) {
+    if (!(t3 >= t0) || !std::isfinite(device))
+      return false;
+    std::scoped_lock lock(mutex);
+    auto &s = window[count++ % WINDOW];
+    s.device = device;
+    s.host = (t0 + t3) / 2;
+    s.rtt = t3 - t0;
+    fit();
+    return true;
+  }
+
+  /** Map a device timestamp to host time */
+  double toHost(double device) const {
+    std::scoped_lock lock(mutex);
+    return model.host + (device - model.device) * model.slope;
+  }
+
+  /** Map a host timestamp to device time */
+  double toDevice(double host) const {
+    std::scoped_lock lock(mutex);
+    return model.device + (host - model.host) / model.slope;
+  }
+
+  /** Host minus device time at the current host time (us) */
+  double offset() const {
+    const double h = now();
+    return h - toDevice(h);
+  }
+
+  /** Device clock rate error relative to host, parts per million */
+  double drift() const {
+    std::scoped_lock lock(mutex);
+    return (1 / model.slope - 1) * 1e6;
+  }
+
+  /** Weighted RMS residual of the accepted samples (us) */
+  double error() const {
+    std::scoped_lock lock(mutex);
+    return model.error;
+  }
+
+  /** Half of the best round trip in the window: bound on path asymmetry */
+  double bound() const {
+    std::scoped_lock lock(mutex);
+    return model.bound;
+  }
+
+  size_t samples() const {
+    std::scoped_lock lock(mutex);
+    return count < WINDOW ? count : WINDOW;
+  }
+
+  bool synced() const { return samples() > 0; }
+
+private:
+  struct Sample {
+    double device, host, rtt;
+  };
+  struct Model {
+    // host = host_c + (device - device_c) * slope
+    double device = 0, host = 0, slope = 1;
+    double error = 0, bound = 0;
+  };
+
+  mutable std::mutex mutex;
+  Sample window[WINDOW];
+  size_t count = 0;
+  Model model;
+
+  /** Caller holds mutex */
+  void fit() {
+    const size_t n = count < WINDOW ? count : WINDOW;
+    double best = INFINITY;
+    for (size_t i = 0; i < n; i++)
+      best = std::fmin(best, window[i].rtt);
+    const double limit = std::fmax(best, RTT_FLOOR_US) * REJECT;
+    // Weighted centroid; anchor on the first sample to keep the sums small
+    const double d0 = window[0].device, h0 = window[0].host;
+    double sw = 0, sd = 0, sh = 0, lo = INFINITY, hi = -INFINITY;
+    for (size_t i = 0; i < n; i++) {
+      const auto &s = window[i];
+      if (s.rtt > limit)
+        continue;
+      const double w = weight(s);
+      sw += w;
+      sd += w * (s.device - d0);
+      sh += w * (s.host - h0);
+      lo = std::fmin(lo, s.device);
+      hi = std::fmax(hi, s.device);
+    }
+    const double dc = sd / sw, hc = sh / sw;
+    double slope = model.slope;
+    if (hi - lo >= MIN_SPAN_US) {
+      double sdd = 0, sdh = 0;
+      for (size_t i = 0; i < n; i++) {
+        const auto &s = window[i];
+        if (s.rtt > limit)
+          continue;
+        const double w = weight(s), x = s.device - d0 - dc;
+        sdd += w * x * x;
+        sdh += w * x * (s.host - h0 - hc);
+      }
+      slope = sdh / sdd;
+    }
+    double se = 0;
+    for (size_t i = 0; i < n; i++) {
+      const auto &s = window[i];
+      if (s.rtt > limit)
+        continue;
+      const double r = (s.host - h0 - hc) - (s.device - d0 - dc) * slope;
+      se += weight(s) * r * r;
+    }
+    model.device = d0 + dc;
+    model.host = h0 + hc;
+    model.slope = slope;
+    model.error = std::sqrt(se / sw);
+    model.bound = best / 2;
+  }
+
+  static inline double weight(const Sample &s) {
+    const double r = std::fmax(s.rtt, RTT_FLOOR_US);
+    return 1 / (r * r);
+  }
+};
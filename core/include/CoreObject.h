@@ -4,16 +4,21 @@
 // You may find the full license in project root directory.
 // -------------------------------------------------------
 #pragma once
+#include <charconv>
 #include <memory>
 #include <napi.h>
 #include <stdexcept>
 
+#include "utils/identity-table.h"
 #include "utils/map-set.h"
 #include "utils/napi-helper.h"
 #include "utils/pointer.h"
 #include "utils/type-name.h"
 
-#define CORE_OBJECT_FEAT_STRICT_EQ 0
+// Same native object, same JS object; build with 0 to always wrap anew
+#ifndef CORE_OBJECT_FEAT_STRICT_EQ
+#define CORE_OBJECT_FEAT_STRICT_EQ 1
+#endif
 #if defined(CORE_OBJECT_FEAT_STRICT_EQ) && CORE_OBJECT_FEAT_STRICT_EQ
 #define FEAT_STRICT_EQ(...) __VA_ARGS__
 #else
@@ -42,7 +47,8 @@ Napi::Value CreateObject(Napi::Value, const P &) noexcept;
 
 #define CORE_OBJECT_EXPORT(OBJECT, ...)                                        \
   void export##OBJECT(Napi::Env, Napi::Object &);                              \
-  VERBOSE("Calling export" #OBJECT "() @ %p", &export##OBJECT);                \
+  LOG_DEBUG("addon", "Calling export" #OBJECT "() @ %p",                       \
+            (void *)&export##OBJECT);                                          \
   export##OBJECT(__VA_ARGS__);
 
 /**
@@ -65,16 +71,17 @@ protected:
       return std::make_shared<Local>(std::forward<Args>(args)...);
     }
     Napi::FunctionReference constructor;
-    FEAT_STRICT_EQ(Map<uintptr_t, Napi::Reference<Napi::Value>> instances);
-    Local(Napi::Function &fn)
-        : constructor(Napi::Persistent(fn)) FEAT_STRICT_EQ(, instances())
-
-    {}
+    // Weak references to live wrappers by core address
+    FEAT_STRICT_EQ(IdentityTable<Napi::ObjectReference> instances);
+    Local(Napi::Function &fn) : constructor(Napi::Persistent(fn)) {}
     ~Local() { constructor.Reset(); }
   };
-  /** Packed by Napi::External and passed to object constructor */
+  /**
+   * Packed by Napi::External and passed to object constructor, which takes
+   * ownership: one allocation per object, no control block
+   */
   typedef struct Payload {
-    typedef std::shared_ptr<Payload> Ptr;
+    typedef std::unique_ptr<Payload> Ptr;
     static inline Ptr extract(Napi::Value val) {
       return Ptr(&::extract<Payload>(val));
     }
@@ -84,8 +91,19 @@ protected:
   /** Local DB Per Env */
   static inline std::mutex local_mutex;
   static inline Map<napi_env, typename Local::Ptr> locals;
+  /**
+   * Local of the env last seen on this thread. An env only runs on its own
+   * thread, so after the first call getLocal() takes neither the lock nor
+   * the map lookup; __deinit__ drops the entry on that same thread.
+   */
+  static inline thread_local struct {
+    napi_env env = nullptr;
+    typename Local::Ptr local;
+  } cached;
   // Retrieve or create local context
-  static inline Local::Ptr getLocal(Napi::Env env) {
+  static inline const Local::Ptr &getLocal(Napi::Env env) {
+    if (cached.env == env)
+      return cached.local;
     std::scoped_lock lock(local_mutex);
     if (!locals.has(env)) {
       __init__(env);
@@ -94,13 +112,16 @@ protected:
         throw JS::Error(env,
                         "Cannot dynamically initialize " + type_name<Obj>());
     }
-    return locals.get(env);
+    cached.local = locals.get(env);
+    cached.env = env;
+    return cached.local;
   }
 
 private:
   static inline Napi::Value __init__(Napi::Env env) {
     if (!locals.has(env)) {
-      VERBOSE("Initializing local context for %s", Obj::name.c_str());
+      LOG_DEBUG("core-object", "Initializing local context for %s",
+                Obj::name.c_str());
       auto fn = Obj::Init(env);
       locals.set(env, Local::create(fn));
       env.AddCleanupHook(__deinit__, static_cast<napi_env>(env));
@@ -109,7 +130,12 @@ private:
   }
 
   static void __deinit__(napi_env env) {
-    VERBOSE("De-initializing local context for %s", Obj::name.c_str());
+    LOG_DEBUG("core-object", "De-initializing local context for %s",
+              Obj::name.c_str());
+    if (cached.env == env) {
+      cached.env = nullptr;
+      cached.local.reset();
+    }
     std::scoped_lock lock(local_mutex);
     locals.erase(env);
   }
@@ -128,28 +154,26 @@ public:
 
 private:
   typedef CoreObject<Obj, Core> Self;
-  static inline Napi::Value __create__(Napi::Env env, Local::Ptr &local,
+  static inline Napi::Value __create__(Napi::Env env, const Local::Ptr &local,
                                        Payload *p) {
     auto ext = Napi::External<Payload>::New(env, p);
-    auto obj = local->constructor.New({ext});
-    FEAT_STRICT_EQ(local->instances.set(uintptr(p->core), obj));
-    return obj;
+    return local->constructor.New({ext});
   }
 
 public:
+// An empty reference is a wrapper collected but not yet finalized: the new
+// one takes over its entry in __assign__()
 #define TRY_REUSE(INSTANCES, KEY)                                              \
-  if (INSTANCES.has(KEY)) {                                                    \
-    auto &ref = INSTANCES.get(KEY);                                            \
-    if (!ref.IsEmpty())                                                        \
-      return ref.Value();                                                      \
-    else                                                                       \
-      INSTANCES.erase(KEY);                                                    \
+  if (auto ref = INSTANCES.find(KEY)) {                                        \
+    auto obj = ref->Value();                                                   \
+    if (!obj.IsEmpty())                                                        \
+      return obj;                                                              \
   }
 
   static Napi::Value inline Create(Napi::Env env, Core &core) noexcept {
     JS_EXCEPT_RET(
         {
-          auto local = getLocal(env);
+          const auto &local = getLocal(env);
           FEAT_STRICT_EQ(TRY_REUSE(local->instances, uintptr(core)));
           return __create__(env, local,
                             new Payload{.local = local, .core = core});
@@ -162,7 +186,7 @@ public:
     JS_EXCEPT_RET(
         {
           Core core(std::forward<Args>(args)...);
-          auto local = getLocal(env);
+          const auto &local = getLocal(env);
           FEAT_STRICT_EQ(TRY_REUSE(local->instances, uintptr(core)));
           return __create__(
               env, local, new Payload{.local = local, .core = std::move(core)});
@@ -177,7 +201,7 @@ public:
       return Create(env, core);
     JS_EXCEPT_RET(
         {
-          auto local = getLocal(env);
+          const auto &local = getLocal(env);
           FEAT_STRICT_EQ(TRY_REUSE(local->instances, uintptr(core)));
           return __create__(env, local,
                             new Payload{.local = local, .core = core});
@@ -194,7 +218,7 @@ public:
     JS_EXCEPT_RET(
         {
           Core core(std::forward<Args>(args)...);
-          auto local = getLocal(env);
+          const auto &local = getLocal(env);
           FEAT_STRICT_EQ(TRY_REUSE(local->instances, uintptr(core)));
           return __create__(
               env, local, new Payload{.local = local, .core = std::move(core)});
@@ -255,10 +279,11 @@ private:
     if (info.Env() != env)
       throw JS::Error(env, "Mismatched Napi::Env");
     payload = Payload::extract(info[0]);
-    FEAT_STRICT_EQ(auto ref = Napi::Weak(info.This());
-                   payload->local->instances.set(address(), ref);)
+    FEAT_STRICT_EQ(payload->local->instances.set(
+        address(), this, Napi::Weak(info.This().As<Napi::Object>())));
     Obj::construct(static_cast<Obj *>(this));
-    VERBOSE("Constructed: %s", str(static_cast<Obj *>(this)).c_str());
+    LOG_DEBUG("core-object", "Constructed: %s",
+              str(static_cast<Obj *>(this)).c_str());
   }
 
 protected:
@@ -267,24 +292,27 @@ protected:
       return;
     auto tag = str(static_cast<Obj *>(this));
     Obj::destruct(static_cast<Obj *>(this));
-    FEAT_STRICT_EQ(payload->local->instances.erase(address()));
+    // Only if still ours: a newer wrapper may have taken over the entry
+    FEAT_STRICT_EQ(payload->local->instances.erase(address(), this));
     payload.reset();
-    VERBOSE("Destructed: %s", tag.c_str());
+    LOG_DEBUG("core-object", "Destructed: %s", tag.c_str());
   };
 
 public:
-  inline constexpr std::string type() const { return type_name<Obj>(); }
+  inline constexpr std::string_view type() const {
+    return type_name_view<Obj>();
+  }
   inline const uintptr_t address() const { return uintptr(core()); }
   inline const std::string id() const {
-    std::stringstream ss;
-    ss << "0x" << std::hex << address();
-    return ss.str();
+    char buf[2 + 2 * sizeof(uintptr_t)] = {'0', 'x'};
+    auto end = std::to_chars(buf + 2, std::end(buf), address(), 16).ptr;
+    return std::string(buf, end);
   }
   inline const Core &core() const {
     // Accessing core of a destroyed object will crash the program.
     // This is strictly forbidden, and is not recoverable by JS try-catch.
     if (payload == nullptr)
-      throw JS::Error(env, type() + " object already destroyed");
+      throw JS::Error(env, std::string(type()) + " object already destroyed");
     return payload->core;
   }
   CoreObject(const Napi::CallbackInfo &info)
@@ -4,13 +4,39 @@
 // You may find the full license in project root directory.
 // -------------------------------------------------------
 #include <functional>
+#include <memory>
 #include <napi.h>
 #include <uv.h>
 
 namespace Dispatcher {
 
 using Task = std::function<void(Napi::Env)>;
-void dispatch(Napi::Env env, Task task);
+
+class Dispatcher;
+/**
+ * The dispatcher of one env: taken on its JS thread, kept by whatever
+ * dispatches to it from other threads. Once the env is torn down, tasks
+ * sent through it are dropped, even if a new env took the same address.
+ *
+ * A dropped task is destroyed without running, on the dispatching thread
+ * or during the teardown of the env; what it owns must be safe to release
+ * there (let the env free Napi references: SuppressDestruct()).
+ */
+using Handle = std::shared_ptr<Dispatcher>;
+
+/** JS thread of `env` only; null before init(env) */
+Handle handle(Napi::Env env);
+/** From any thread */
+void dispatch(const Handle &dispatcher, Task task);
+/**
+ * Keep the event loop alive for work that will dispatch back (e.g. a job
+ * on the pool), until the matching release(). hold() on the JS thread
+ * only; release() from any thread, it is forwarded there.
+ */
+void hold(const Handle &dispatcher);
+void release(const Handle &dispatcher);
 void init(Napi::Env &env);
+/** Whether the calling thread is the one `dispatcher` runs tasks on */
+bool onThread(const Handle &dispatcher);
 
 } // namespace Dispatcher
@@ -0,0 +1,123 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * Decompressor for the firmware's streaming LZ (firmware/include/lz.h):
+ * LZ4 sequence format, blocks decoded against a history that spans earlier
+ * blocks of the same stream.
+ *
+ * Literals and matches at least 16 bytes back are moved in 16-byte steps
+ * that the compiler lowers to vector loads/stores; only short-offset
+ * (overlapping) matches go byte by byte.
+ */
+namespace Lz {
+
+constexpr size_t WINDOW = 2048;
+constexpr size_t MIN_MATCH = 4;
+
+class Decoder {
+public:
+  // History is compacted once this much has been decoded
+  static constexpr size_t CAPACITY = 64 * 1024;
+
+  Decoder() : buf(CAPACITY) {}
+
+  void reset() { len = 0; }
+
+  /**
+   * Decompress one block of at most `max_out` bytes into the history.
+   * On success `out` points at the block (valid until the next call). On
+   * failure the history is no longer trustworthy; callers reset().
+   */
+  bool decompress(const uint8_t *in, size_t n, size_t max_out,
+                  const uint8_t *&out, size_t &out_len) {
+    if (max_out + WINDOW > CAPACITY)
+      return false;
+    if (len + max_out > CAPACITY)
+      compact();
+    uint8_t *const base = buf.data();
+    const uint8_t *ip = in, *const iend = in + n;
+    size_t op = len;
+    const size_t limit = len + max_out;
+    while (ip < iend) {
+      const uint8_t token = *ip++;
+      size_t lit = token >> 4;
+      if (lit == 15 && !length(ip, iend, lit))
+        return false;
+      if ((size_t)(iend - ip) < lit || limit - op < lit)
+        return false;
+      wildcopy(base + op, ip, lit);
+      ip += lit;
+      op += lit;
+      if (ip == iend)
+        break; // last sequence: literals only
+      if (iend - ip < 2)
+        return false;
+      const size_t offset = ip[0] | (size_t)ip[1] << 8;
+      ip += 2;
+      size_t match = token & 15;
+      if (match == 15 && !length(ip, iend, match))
+        return false;
+      match += MIN_MATCH;
+      if (offset == 0 || offset > op || limit - op < match)
+        return false;
+      const uint8_t *src = base + op - offset;
+      uint8_t *dst = base + op;
+      if (offset >= 16) {
+        wildcopy(dst, src, match);
+      } else {
+        // Overlapping: the match repeats a short pattern
+        for (size_t i = 0; i < match; i++)
+          dst[i] = src[i];
+      }
+      op += match;
+    }
+    out = base + len;
+    out_len = op - len;
+    len = op;
+    return true;
+  }
+
+private:
+  std::vector<uint8_t> buf;
+  size_t len = 0; // history in use
+
+  // Keep only the last WINDOW bytes of history
+  void compact() {
+    if (len <= WINDOW)
+      return;
+    std::memmove(buf.data(), buf.data() + len - WINDOW, WINDOW);
+    len = WINDOW;
+  }
+
+  static inline bool length(const uint8_t *&ip, const uint8_t *iend,
+                            size_t &n) {
+    for (;;) {
+      if (ip >= iend)
+        return false;
+      const uint8_t b = *ip++;
+      n += b;
+      if (b != 255)
+        return true;
+    }
+  }
+
+  // Forward copy in 16-byte steps; safe for overlap when dst - src >= 16
+  static inline void wildcopy(uint8_t *dst, const uint8_t *src, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+      std::memcpy(dst + i, src + i, 16);
+    std::memcpy(dst + i, src + i, n - i);
+  }
+};
+
+} // namespace Lz
@@ -0,0 +1,290 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Process-wide live metrics: counters, gauges and latency histograms that
+ * hot paths update with relaxed atomics, read all at once as one array of
+ * doubles (the Metrics CoreObject hands it to JS as a Float64Array).
+ *
+ *   static auto &bytes = Metrics::counter("capture.bytes");
+ *   bytes.add(len);
+ *
+ * Metrics register on first use and live as long as the process; look them
+ * up once (a static local) and keep the reference. Every registration bumps
+ * the layout generation, so a reader re-fetches names() only when the
+ * generation in slot 0 of a snapshot changes.
+ *
+ * Snapshot layout, one name per slot:
+ *   [generation, time_ms, ...metrics]
+ * a counter or gauge takes one slot, a histogram HISTOGRAM_SLOTS
+ * ("<name>.count", ".mean", ".p50", ".p90", ".p99", ".p999", ".max").
+ * Counters are cumulative; rates come from the difference between two
+ * snapshots over the difference of their time_ms.
+ */
+namespace Metrics {
+
+class Counter {
+public:
+  inline void add(uint64_t n = 1) { v.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t value() const { return v.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> v{0};
+};
+
+class Gauge {
+public:
+  inline void set(int64_t n) { v.store(n, std::memory_order_relaxed); }
+  inline void add(int64_t n = 1) { v.fetch_add(n, std::memory_order_relaxed); }
+  inline void sub(int64_t n = 1) { v.fetch_sub(n, std::memory_order_relaxed); }
+  int64_t value() const { return v.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<int64_t> v{0};
+};
+
+/**
+ * Log-linear histogram in the manner of HDR histograms: SUB buckets per
+ * power of two, so any recorded value is reported within 1 / SUB (6.25%)
+ * of itself, from 0 to 2^64 with a fixed 8 KB of buckets.
+ */
+class Histogram {
+public:
+  static constexpr unsigned SUB_BITS = 4;
+  static constexpr unsigned SUB = 1u << SUB_BITS;
+  static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+  inline void record(uint64_t v) {
+    buckets[index(v)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(v, std::memory_order_relaxed);
+    uint64_t m = peak.load(std::memory_order_relaxed);
+    while (v > m &&
+           !peak.compare_exchange_weak(m, v, std::memory_order_relaxed))
+      ;
+  }
+
+  static inline size_t index(uint64_t v) {
+    if (v < SUB)
+      return (size_t)v;
+    const unsigned msb = 63 - (unsigned)__builtin_clzll(v);
+    const unsigned shift = msb - SUB_BITS;
+    return (size_t)(msb - SUB_BITS + 1) * SUB + ((v >> shift) & (SUB - 1));
+  }
+
+  /** Middle of the values that land in bucket `i` */
+  static inline uint64_t value(size_t i) {
+    if (i < SUB)
+      return i;
+    const unsigned shift = (unsigned)(i / SUB) - 1;
+    const uint64_t low = (uint64_t)(SUB + i % SUB) << shift;
+    return low + ((1ull << shift) >> 1);
+  }
+
+  /** count, mean, p50, p90, p99, p999, max */
+  void summarize(double *out) const {
+    std::array<uint64_t, BUCKETS> copy;
+    uint64_t count = 0;
+    for (size_t i = 0; i < BUCKETS; i++)
+      count += copy[i] = buckets[i].load(std::memory_order_relaxed);
+    out[0] = (double)count;
+    out[1] = count ? (double)sum.load(std::memory_order_relaxed) / count : 0;
+    static constexpr double ranks[] = {0.5, 0.9, 0.99, 0.999};
+    size_t i = 0;
+    uint64_t seen = 0;
+    for (size_t r = 0; r < 4; r++) {
+      const uint64_t target =
+          std::max<uint64_t>(1, (uint64_t)std::ceil(ranks[r] * (double)count));
+      while (i < BUCKETS - 1 && seen + copy[i] < target)
+        seen += copy[i++];
+      out[2 + r] = count ? (double)value(i) : 0;
+    }
+    out[6] = (double)peak.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+  std::atomic<uint64_t> sum{0}, peak{0};
+};
+
+constexpr size_t HISTOGRAM_SLOTS = 7;
+
+/** A value computed when a snapshot is taken, e.g. from the allocator */
+using Sampler = std::function<double()>;
+
+class Registry {
+public:
+  typedef std::shared_ptr<Registry> Ptr;
+
+  static const Ptr &global() {
+    // Never freed: pool threads still count into it at exit
+    static const Ptr *registry = new Ptr(std::make_shared<Registry>());
+    return *registry;
+  }
+
+  Counter &counter(const std::string &name) {
+    return lookup(name, COUNTER).counter;
+  }
+  Gauge &gauge(const std::string &name) { return lookup(name, GAUGE).gauge; }
+  Histogram &histogram(const std::string &name) {
+    return *lookup(name, HISTOGRAM).histogram;
+  }
+  void sampled(const std::string &name, Sampler fn) {
+    Entry &e = lookup(name, SAMPLED);
+    std::scoped_lock lock(mutex); // snapshot() may be calling it
+    e.sampler = std::move(fn);
+  }
+
+  uint32_t generation() const {
+    return layout.load(std::memory_order_acquire);
+  }
+
+  /** Name of every snapshot slot */
+  std::vector<std::string> names() const {
+    std::scoped_lock lock(mutex);
+    std::vector<std::string> out = {"generation", "time_ms"};
+    for (const auto &e : entries) {
+      if (e.kind != HISTOGRAM) {
+        out.push_back(e.name);
+        continue;
+      }
+      for (const char *suffix :
+           {".count", ".mean", ".p50", ".p90", ".p99", ".p999", ".max"})
+        out.push_back(e.name + suffix);
+    }
+    return out;
+  }
+
+  /** Slots a snapshot currently needs */
+  size_t size() const {
+    std::scoped_lock lock(mutex);
+    return slots;
+  }
+
+  /**
+   * Fill `out` with up to `n` slots; returns the number of slots of the
+   * current layout, which may exceed `n` when metrics were added since the
+   * caller sized its buffer
+   */
+  size_t snapshot(double *out, size_t n) const {
+    std::scoped_lock lock(mutex);
+    double tmp[HISTOGRAM_SLOTS];
+    size_t at = 0;
+    auto put = [&](double v) {
+      if (at < n)
+        out[at] = v;
+      at++;
+    };
+    put((double)generation());
+    put(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+    for (const auto &e : entries) {
+      switch (e.kind) {
+      case COUNTER:
+        put((double)e.counter.value());
+        break;
+      case GAUGE:
+        put((double)e.gauge.value());
+        break;
+      case SAMPLED:
+        put(e.sampler ? e.sampler() : 0);
+        break;
+      case HISTOGRAM:
+        e.histogram->summarize(tmp);
+        for (double v : tmp)
+          put(v);
+        break;
+      }
+    }
+    return at;
+  }
+
+private:
+  enum Kind { COUNTER, GAUGE, HISTOGRAM, SAMPLED };
+
+  struct Entry {
+    std::string name;
+    Kind kind;
+    Counter counter;
+    Gauge gauge;
+    std::unique_ptr<Histogram> histogram; // 8 KB, only for histograms
+    Sampler sampler;
+  };
+
+  Entry &lookup(const std::string &name, Kind kind) {
+    std::scoped_lock lock(mutex);
+    for (auto &e : entries) {
+      if (e.name != name)
+        continue;
+      if (e.kind != kind)
+        throw std::logic_error("Metric " + name + " has another type");
+      return e;
+    }
+    // deque: references stay valid as entries are added
+    Entry &e = entries.emplace_back();
+    e.name = name;
+    e.kind = kind;
+    if (kind == HISTOGRAM)
+      e.histogram = std::make_unique<Histogram>();
+    slots += kind == HISTOGRAM ? HISTOGRAM_SLOTS : 1;
+    layout.fetch_add(1, std::memory_order_release);
+    return e;
+  }
+
+  mutable std::mutex mutex;
+  std::deque<Entry> entries;
+  size_t slots = 2; // generation, time_ms
+  std::atomic<uint32_t> layout{0};
+};
+
+inline Counter &counter(const std::string &name) {
+  return Registry::global()->counter(name);
+}
+inline Gauge &gauge(const std::string &name) {
+  return Registry::global()->gauge(name);
+}
+inline Histogram &histogram(const std::string &name) {
+  return Registry::global()->histogram(name);
+}
+
+/**
+ * Counters of one quantity split by a small key (a USB interface, a
+ * direction), named "<name>.<key>" and registered as keys show up
+ */
+template <size_t N = 256> class CounterFamily {
+public:
+  explicit CounterFamily(std::string name) : name(std::move(name)) {}
+
+  inline Counter &operator[](size_t key) {
+    Counter *c = members[key % N].load(std::memory_order_acquire);
+    if (!c) {
+      c = &counter(name + "." + std::to_string(key % N));
+      members[key % N].store(c, std::memory_order_release);
+    }
+    return *c;
+  }
+
+private:
+  const std::string name;
+  std::array<std::atomic<Counter *>, N> members{};
+};
+
+} // namespace Metrics
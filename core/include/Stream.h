@@ -5,11 +5,16 @@
 // -------------------------------------------------------
 #pragma once
 
+#include <condition_variable>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <stdexcept>
+#include <string>
 
-#include <napi.h>
-
+#include "utils/log.h"
 #include "utils/map-set.h"
+#include "utils/trace.h"
 #include "utils/type-name.h"
 
 template <typename T> class Subscriber;
@@ -22,7 +27,7 @@ template <typename T> class Stream {
   Set<Subscriber<T> *> subscribers;
 
   inline void __stream_close__() {
-    VERBOSE("Stream<%s>::close()", type_name<T>().c_str());
+    LOG_DEBUG("stream", "Stream<%s>::close()", type_name<T>().c_str());
     if (state != CLOSED && on_close)
       on_close();
     state = CLOSED;
@@ -57,6 +62,7 @@ public:
 
   Stream(std::function<void()> on_close = nullptr) : on_close(on_close) {}
   void push(T data) {
+    TRACE_SPAN("Stream::push");
     std::scoped_lock lock(mutex);
     for (auto sub : subscribers)
       sub->push(data);
@@ -120,5 +126,7 @@ public:
   ~Subscriber() { close(); }
 };
 
+#if __has_include("Frame.h")
 #include "Frame.h"
 using CameraStream = Stream<Frame::Ptr>;
+#endif
@@ -0,0 +1,157 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include <napi.h>
+
+#include "Dispatcher.h"
+#include "threading/Task.h"
+
+/**
+ * C++20 coroutines across the JS thread and the core pool.
+ *
+ *   Napi::Promise analyze(Napi::Env env, Capture::File::Ptr file) {
+ *     co_await Coro::onPool();           // leave the JS thread
+ *     auto stats = decode(file);         // or co_await a threading::Task
+ *     co_await Coro::onMain();           // come back to it
+ *     co_return toJS(env, stats);        // resolves the Promise
+ *   }
+ *
+ * A coroutine returning Napi::Promise must be called on the JS thread and
+ * take a Napi::Env or a Napi::CallbackInfo among its parameters: its
+ * Promise is created on entry, resolved by co_return (on the JS thread),
+ * and rejected by any exception that escapes it, on whichever thread.
+ * Each hop resumes the same frame, so a pipeline of stages allocates no
+ * worker object per stage. JS values do not survive a hop: the scope they
+ * were created in ends with it.
+ *
+ * If the env is torn down while the coroutine is away, the hop back is
+ * dropped and the frame destroyed where it was: nothing in it may need
+ * the JS thread to be released.
+ */
+namespace Coro {
+
+class PromiseBridge;
+
+/** co_await onMain(): continue on the JS thread the coroutine started on */
+class MainThread {
+public:
+  bool await_ready() const noexcept { return false; }
+  bool await_suspend(std::coroutine_handle<PromiseBridge> h);
+  void await_resume() const noexcept {}
+};
+
+inline MainThread onMain() { return {}; }
+
+/** co_await onPool(): continue on a worker of the core pool */
+inline threading::Schedule onPool() { return threading::schedule(); }
+
+/** Promise type of every coroutine returning Napi::Promise */
+class PromiseBridge {
+public:
+  // Receives the coroutine's arguments, to find its env
+  template <typename... Args>
+  explicit PromiseBridge(Args &...args)
+      : env(env_of(args...)), dispatcher(Dispatcher::handle(env)),
+        deferred(Napi::Promise::Deferred::New(env)) {}
+
+  // The loop stays alive until the frame is gone: settled on the JS thread,
+  // rejected from anywhere (the release follows the rejection there), or
+  // destroyed by a dropped hop
+  Napi::Promise get_return_object() {
+    Dispatcher::hold(dispatcher);
+    return deferred.Promise();
+  }
+  ~PromiseBridge() { Dispatcher::release(dispatcher); }
+  std::suspend_never initial_suspend() noexcept { return {}; }
+  std::suspend_never final_suspend() noexcept { return {}; }
+
+  void return_value(Napi::Value value) { deferred.Resolve(value); }
+
+  void unhandled_exception() {
+    auto error = std::current_exception();
+    if (std::this_thread::get_id() == thread) {
+      reject(env, deferred, error);
+      return;
+    }
+    Dispatcher::dispatch(dispatcher,
+                         [deferred = deferred, error](Napi::Env env) {
+                           reject(env, deferred, error);
+                         });
+  }
+
+private:
+  friend class MainThread;
+
+  const Napi::Env env;
+  const Dispatcher::Handle dispatcher;
+  const Napi::Promise::Deferred deferred;
+  const std::thread::id thread = std::this_thread::get_id();
+
+  static Napi::Env env_of(const Napi::Env &env, const auto &...) {
+    return env;
+  }
+  static Napi::Env env_of(const Napi::CallbackInfo &info, const auto &...) {
+    return info.Env();
+  }
+  template <typename First, typename... Rest>
+  static Napi::Env env_of(const First &, const Rest &...rest) {
+    return env_of(rest...);
+  }
+  // No Napi::Env or Napi::CallbackInfo among the parameters
+  static Napi::Env env_of() = delete;
+
+  static void reject(Napi::Env env, const Napi::Promise::Deferred &deferred,
+                     std::exception_ptr error) {
+    Napi::HandleScope scope(env);
+    try {
+      std::rethrow_exception(error);
+    } catch (const threading::Cancelled &) {
+      auto e = Napi::Error::New(env, "The operation was aborted");
+      e.Set("name", Napi::String::New(env, "AbortError"));
+      deferred.Reject(e.Value());
+    } catch (const std::exception &e) {
+      deferred.Reject(Napi::Error::New(env, e.what()).Value());
+    } catch (...) {
+      deferred.Reject(Napi::Error::New(env, "Unknown error").Value());
+    }
+  }
+};
+
+inline bool MainThread::await_suspend(std::coroutine_handle<PromiseBridge> h) {
+  // Copied out of the frame, which a dropped hop destroys
+  const auto dispatcher = h.promise().dispatcher;
+  if (Dispatcher::onThread(dispatcher))
+    return false;
+  // Owns the frame until the hop resumes it
+  struct Frame {
+    explicit Frame(std::coroutine_handle<> h) : h(h) {}
+    Frame(const Frame &) = delete;
+    ~Frame() {
+      if (h)
+        h.destroy();
+    }
+    std::coroutine_handle<> h;
+  };
+  auto frame = std::make_shared<Frame>(h);
+  Dispatcher::dispatch(dispatcher, [frame](Napi::Env) {
+    std::exchange(frame->h, nullptr).resume();
+  });
+  return true;
+}
+
+} // namespace Coro
+
+template <typename... Args>
+struct std::coroutine_traits<Napi::Promise, Args...> {
+  using promise_type = Coro::PromiseBridge;
+};
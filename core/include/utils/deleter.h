@@ -14,8 +14,7 @@ template <typename T> void deleter(Napi::Env, void *, void *hint) {
   if (hint) {
     delete static_cast<T *>(hint);
     auto name = type_name<T>();
-    VERBOSE("[deleter] Collected: %.*s %p", static_cast<int>(name.size()),
-            name.data(), hint);
+    LOG_DEBUG("deleter", "Collected: %s %p", name.c_str(), hint);
   } else {
     throw std::runtime_error("Got null deleter hint pointer");
   }
@@ -0,0 +1,121 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * Open-addressing table from a native address to the one JS object that
+ * wraps it, behind CoreObject's strict identity (===). V is the weak
+ * reference to that object (Napi::ObjectReference), any default
+ * constructible, movable type will do.
+ *
+ * Every entry records its owner, the wrapper that registered it; only that
+ * owner removes it, from its destructor. Lookups never prune: a collected
+ * object whose finalizer has yet to run shows up as an empty reference, and
+ * the wrapper created in its place simply takes over the entry, after which
+ * the late finalizer no longer matches it.
+ *
+ * Linear probing at a load factor of at most 3/4, with backward-shift
+ * deletion (no tombstones), so lookups stay O(1) amortized however many
+ * objects come and go. Key 0 (a null core) is never stored.
+ */
+template <typename V> class IdentityTable {
+public:
+  /** Reference registered for `key`, nullptr if none */
+  V *find(uintptr_t key) {
+    if (!key || !count)
+      return nullptr;
+    for (size_t i = home(key);; i = (i + 1) & mask()) {
+      if (slots[i].key == key)
+        return &slots[i].value;
+      if (!slots[i].key)
+        return nullptr;
+    }
+  }
+
+  /** Register `value` for `key`, replacing whatever was there */
+  void set(uintptr_t key, const void *owner, V value) {
+    if (!key)
+      return;
+    if ((count + 1) * 4 > slots.size() * 3)
+      grow();
+    size_t i = home(key);
+    while (slots[i].key && slots[i].key != key)
+      i = (i + 1) & mask();
+    if (!slots[i].key)
+      count++;
+    slots[i].key = key;
+    slots[i].owner = owner;
+    slots[i].value = std::move(value);
+  }
+
+  /** Remove the entry of `key` if `owner` still holds it */
+  bool erase(uintptr_t key, const void *owner) {
+    if (!key || !count)
+      return false;
+    size_t i = home(key);
+    while (slots[i].key != key) {
+      if (!slots[i].key)
+        return false;
+      i = (i + 1) & mask();
+    }
+    if (slots[i].owner != owner)
+      return false;
+    slots[i] = Slot();
+    count--;
+    // Pull back entries that probed past the hole
+    for (size_t j = (i + 1) & mask(); slots[j].key; j = (j + 1) & mask()) {
+      const size_t k = home(slots[j].key);
+      // Move j into the hole unless its home lies cyclically in (i, j]
+      if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+        continue;
+      slots[i] = std::move(slots[j]);
+      slots[j] = Slot();
+      i = j;
+    }
+    return true;
+  }
+
+  size_t size() const { return count; }
+
+private:
+  struct Slot {
+    uintptr_t key = 0;
+    const void *owner = nullptr;
+    V value{};
+  };
+
+  static constexpr unsigned MIN_BITS = 4;
+
+  std::vector<Slot> slots;
+  size_t count = 0;
+  unsigned bits = 0;
+
+  inline size_t mask() const { return slots.size() - 1; }
+
+  // Fibonacci hashing: allocations are aligned, the low bits carry little
+  inline size_t home(uintptr_t key) const {
+    return (size_t)(((uint64_t)key * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+  }
+
+  void grow() {
+    std::vector<Slot> old = std::move(slots);
+    bits = old.empty() ? MIN_BITS : bits + 1;
+    slots = std::vector<Slot>((size_t)1 << bits);
+    for (auto &s : old) {
+      if (!s.key)
+        continue;
+      size_t i = home(s.key);
+      while (slots[i].key)
+        i = (i + 1) & mask();
+      slots[i] = std::move(s);
+    }
+  }
+};
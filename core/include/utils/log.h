@@ -0,0 +1,419 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Leveled, per-category logger that never blocks the thread logging.
+ *
+ *   LOG_DEBUG("stream", "Stream<%s>::close()", name.c_str());
+ *
+ * A disabled record costs one relaxed load. An enabled one copies its
+ * arguments (strings by value, everything else as is) into a slot of a
+ * bounded lock-free queue; a background thread formats them with the
+ * printf-style format and writes them out in batches. When the queue is
+ * full the record is dropped and counted, never waited for.
+ *
+ * Levels are set per category at runtime (Log::set_level), initially from
+ * CORE_LOG, e.g. CORE_LOG="warn,stream=debug,deleter=trace". The default
+ * is info.
+ */
+// Records that can wait to be written before new ones are dropped
+#ifndef CORE_LOG_SLOTS
+#define CORE_LOG_SLOTS 2048
+#endif
+
+namespace Log {
+
+// Not TRACE, DEBUG, ...: those are common macros (-DDEBUG)
+enum class Level : int { Trace, Debug, Info, Warn, Error, Off };
+
+inline const char *level_name(Level level) {
+  static const char *names[] = {"trace", "debug", "info",
+                                "warn",  "error", "off"};
+  const int l = (int)level;
+  return names[l < 0 || l > (int)Level::Off ? (int)Level::Off : l];
+}
+
+inline bool parse_level(std::string_view s, Level &out) {
+  for (int l = (int)Level::Trace; l <= (int)Level::Off; l++)
+    if (s == level_name((Level)l)) {
+      out = (Level)l;
+      return true;
+    }
+  return false;
+}
+
+class Category {
+public:
+  explicit Category(std::string name, Level level)
+      : name(std::move(name)), level((int)level) {}
+  inline bool enabled(Level l) const {
+    return (int)l >= level.load(std::memory_order_relaxed);
+  }
+  const std::string name;
+  std::atomic<int> level;
+};
+
+// ---------- Records ----------
+
+/** Arguments as kept until formatting: C strings are copied */
+template <typename A> struct Stored {
+  using type = std::decay_t<A>;
+};
+template <> struct Stored<const char *> {
+  using type = std::string;
+};
+template <> struct Stored<char *> {
+  using type = std::string;
+};
+template <> struct Stored<std::string_view> {
+  using type = std::string;
+};
+
+template <typename A> inline const A &unstore(const A &a) { return a; }
+inline const char *unstore(const std::string &s) { return s.c_str(); }
+
+/** Type-erased record, placement-constructed into a queue slot */
+struct Record {
+  Level level;
+  const Category *category;
+  const char *format;
+  std::chrono::system_clock::time_point time;
+  void (*render)(const Record *, std::string &out);
+  void (*dispose)(Record *);
+};
+
+template <typename... Args> struct RecordOf : Record {
+  std::tuple<typename Stored<Args>::type...> args;
+
+  template <typename... In>
+  RecordOf(In &&...in) : args(std::forward<In>(in)...) {}
+
+  static void print(const Record *r, std::string &out) {
+    auto self = static_cast<const RecordOf *>(r);
+    std::apply(
+        [&](const auto &...a) {
+          char buf[512];
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-security"
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+          int n = std::snprintf(buf, sizeof(buf), r->format, unstore(a)...);
+          if (n < 0)
+            return;
+          if ((size_t)n < sizeof(buf)) {
+            out.append(buf, (size_t)n);
+            return;
+          }
+          const size_t at = out.size();
+          out.resize(at + (size_t)n + 1);
+          std::snprintf(&out[at], (size_t)n + 1, r->format, unstore(a)...);
+          out.resize(at + (size_t)n);
+#pragma GCC diagnostic pop
+        },
+        self->args);
+  }
+  static void destroy(Record *r) { static_cast<RecordOf *>(r)->~RecordOf(); }
+};
+
+// ---------- Queue ----------
+
+/**
+ * Bounded multi-producer, single-consumer queue of fixed-size slots
+ * (Vyukov's bounded queue): producers claim a slot with one CAS, the
+ * consumer releases it by bumping its sequence number
+ */
+class Queue {
+public:
+  static constexpr size_t SLOTS = CORE_LOG_SLOTS;
+  static constexpr size_t SLOT_SIZE = 256;
+
+  Queue() : cells(new Cell[SLOTS]) {
+    for (size_t i = 0; i < SLOTS; i++)
+      cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  /** Storage for one record, null when the queue is full */
+  void *claim(size_t &ticket) {
+    size_t pos = tail.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell &c = cells[pos % SLOTS];
+      const size_t seq = c.seq.load(std::memory_order_acquire);
+      const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (tail.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+          ticket = pos;
+          return c.data;
+        }
+      } else if (diff < 0) {
+        return nullptr;
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void publish(size_t ticket) {
+    cells[ticket % SLOTS].seq.store(ticket + 1, std::memory_order_release);
+  }
+
+  /** Next published record, or null */
+  Record *front() {
+    Cell &c = cells[head % SLOTS];
+    if (c.seq.load(std::memory_order_acquire) != head + 1)
+      return nullptr;
+    return reinterpret_cast<Record *>(c.data);
+  }
+
+  void pop() {
+    cells[head % SLOTS].seq.store(head + SLOTS, std::memory_order_release);
+    head++;
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    alignas(std::max_align_t) unsigned char data[SLOT_SIZE];
+  };
+  std::unique_ptr<Cell[]> cells;
+  alignas(64) std::atomic<size_t> tail{0};
+  alignas(64) size_t head = 0; // consumer only
+};
+
+// ---------- Logger ----------
+
+class Logger {
+public:
+  static Logger &get() {
+    static Logger *logger = new Logger(); // outlives static destructors
+    return *logger;
+  }
+
+  Category &category(const std::string &name) {
+    std::scoped_lock lock(mutex);
+    auto it = categories.find(name);
+    if (it != categories.end())
+      return *it->second;
+    const auto lvl = overrides.find(name);
+    auto c = std::make_unique<Category>(
+        name, lvl != overrides.end() ? lvl->second : fallback);
+    return *(categories[name] = std::move(c));
+  }
+
+  /** Set one category, or every category and the default with "*" */
+  void set_level(const std::string &name, Level level) {
+    std::scoped_lock lock(mutex);
+    if (name == "*") {
+      fallback = level;
+      overrides.clear();
+      for (auto &[_, c] : categories)
+        c->level.store((int)level, std::memory_order_relaxed);
+      return;
+    }
+    overrides[name] = level;
+    auto it = categories.find(name);
+    if (it != categories.end())
+      it->second->level.store((int)level, std::memory_order_relaxed);
+  }
+
+  /** Level of every category seen so far, "*" being the default */
+  std::vector<std::pair<std::string, Level>> levels() {
+    std::scoped_lock lock(mutex);
+    std::vector<std::pair<std::string, Level>> out = {{"*", fallback}};
+    for (auto &[name, c] : categories)
+      out.emplace_back(name, (Level)c->level.load());
+    return out;
+  }
+
+  template <typename... Args>
+  void log(Level level, const Category &category, const char *format,
+           Args &&...args) {
+    using R = RecordOf<std::decay_t<Args>...>;
+    static_assert(sizeof(R) <= Queue::SLOT_SIZE, "Too many log arguments");
+    size_t ticket;
+    void *slot = queue.claim(ticket);
+    if (!slot) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    R *r = new (slot) R(std::forward<Args>(args)...);
+    r->level = level;
+    r->category = &category;
+    r->format = format;
+    r->time = std::chrono::system_clock::now();
+    r->render = &R::print;
+    r->dispose = &R::destroy;
+    queue.publish(ticket);
+    wake();
+  }
+
+  /** Wait until everything logged so far is written */
+  void flush() {
+    std::unique_lock lock(drain_mutex);
+    const uint64_t target = ++flush_requests;
+    sleeping.store(false, std::memory_order_relaxed);
+    ready.notify_one();
+    drained.wait(lock, [&] { return flushed >= target; });
+  }
+
+  uint64_t dropped_records() const { return dropped.load(); }
+
+private:
+  Logger() {
+    if (const char *env = std::getenv("CORE_LOG"))
+      configure(env);
+    std::thread([this] { run(); }).detach();
+    // What is still queued at exit gets written
+    std::atexit([] { get().flush(); });
+  }
+
+  // "warn,stream=debug"
+  void configure(std::string_view spec) {
+    while (!spec.empty()) {
+      const size_t comma = spec.find(',');
+      const std::string_view item = spec.substr(0, comma);
+      spec = comma == spec.npos ? std::string_view() : spec.substr(comma + 1);
+      const size_t eq = item.find('=');
+      Level level;
+      if (eq == item.npos) {
+        if (parse_level(item, level))
+          set_level("*", level);
+      } else if (parse_level(item.substr(eq + 1), level)) {
+        set_level(std::string(item.substr(0, eq)), level);
+      }
+    }
+  }
+
+  void wake() {
+    // Only a sleeping consumer needs the (system call) notification
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed)) {
+      std::scoped_lock lock(drain_mutex);
+      sleeping.store(false, std::memory_order_relaxed);
+      ready.notify_one();
+    }
+  }
+
+  void run() {
+    std::string out;
+    uint64_t reported = 0;
+    for (;;) {
+      uint64_t served;
+      {
+        std::scoped_lock lock(drain_mutex);
+        served = flush_requests;
+      }
+      out.clear();
+      for (Record *r; (r = queue.front()); queue.pop()) {
+        line(out, r);
+        r->dispose(r);
+        if (out.size() > 64 * 1024) {
+          std::fwrite(out.data(), 1, out.size(), stderr);
+          out.clear();
+        }
+      }
+      const uint64_t lost = dropped.load(std::memory_order_relaxed);
+      if (lost != reported) {
+        char buf[96];
+        std::snprintf(buf, sizeof(buf), "[log] %llu records dropped\n",
+                      (unsigned long long)(lost - reported));
+        out += buf;
+        reported = lost;
+      }
+      if (!out.empty()) {
+        std::fwrite(out.data(), 1, out.size(), stderr);
+        std::fflush(stderr);
+      }
+      std::unique_lock lock(drain_mutex);
+      flushed = served;
+      drained.notify_all();
+      if (flush_requests != served)
+        continue;
+      sleeping.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (queue.front())
+        continue;
+      ready.wait(lock, [&] {
+        return !sleeping.load(std::memory_order_relaxed) ||
+               flush_requests != served;
+      });
+    }
+  }
+
+  static void line(std::string &out, const Record *r) {
+    const auto t = std::chrono::system_clock::to_time_t(r->time);
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        r->time.time_since_epoch())
+                        .count() %
+                    1000;
+    std::tm tm;
+    localtime_r(&t, &tm);
+    char head[96];
+    std::snprintf(head, sizeof(head), "%02d:%02d:%02d.%03d %-5s [%s] ",
+                  tm.tm_hour, tm.tm_min, tm.tm_sec, (int)ms,
+                  level_name(r->level), r->category->name.c_str());
+    out += head;
+    r->render(r, out);
+    out += '\n';
+  }
+
+  std::mutex mutex; // guards the category table
+  std::unordered_map<std::string, std::unique_ptr<Category>> categories;
+  std::unordered_map<std::string, Level> overrides;
+  Level fallback = Level::Info;
+
+  Queue queue;
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<bool> sleeping{false};
+  std::mutex drain_mutex;
+  std::condition_variable ready, drained;
+  uint64_t flush_requests = 0, flushed = 0;
+};
+
+// Never called: lets the compiler check formats against their arguments
+#if defined(__GNUC__)
+__attribute__((format(printf, 1, 2)))
+#endif
+inline void check_format(const char *, ...) {}
+
+} // namespace Log
+
+#define LOG_AT(LEVEL, CAT, ...)                                                \
+  do {                                                                         \
+    static Log::Category &__log_category = Log::Logger::get().category(CAT);   \
+    if (__log_category.enabled(LEVEL)) {                                       \
+      if (false)                                                               \
+        Log::check_format(__VA_ARGS__);                                        \
+      Log::Logger::get().log(LEVEL, __log_category, __VA_ARGS__);              \
+    }                                                                          \
+  } while (0)
+
+#define LOG_TRACE(CAT, ...) LOG_AT(Log::Level::Trace, CAT, __VA_ARGS__)
+#define LOG_DEBUG(CAT, ...) LOG_AT(Log::Level::Debug, CAT, __VA_ARGS__)
+#define LOG_INFO(CAT, ...) LOG_AT(Log::Level::Info, CAT, __VA_ARGS__)
+#define LOG_WARN(CAT, ...) LOG_AT(Log::Level::Warn, CAT, __VA_ARGS__)
+#define LOG_ERROR(CAT, ...) LOG_AT(Log::Level::Error, CAT, __VA_ARGS__)
@@ -6,8 +6,11 @@
 #pragma once
 
 #include "napi.h"
+#include "utils/log.h"
 #include "utils/pointer.h"
 #include "utils/stacktrace.h"
+#include "utils/trace.h"
+#include <atomic>
 #include <exception>
 #include <functional>
 #include <sstream>
@@ -24,32 +27,84 @@
   InstanceAccessor<&CLS::get_##NAME, &CLS::set_##NAME>(                        \
       #NAME, (napi_property_attributes)(napi_writable | napi_enumerable))
 
+/**
+ * Native stack attached to a JS error. `stack` becomes an accessor that
+ * symbolizes the frames and appends them to the JS stack the first time it
+ * is read, then turns back into a plain value; errors nobody inspects
+ * never pay for symbolization.
+ */
+class LazyStack {
+public:
+  static inline const napi_type_tag tag = {0x6e617469766573ull,
+                                           0x7461636b6c617a79ull};
+
+  LazyStack(std::string js, Stacktrace::Frames frames)
+      : js(std::move(js)), frames(std::move(frames)) {}
+
+  static Napi::Value get(const Napi::CallbackInfo &info) {
+    auto self = static_cast<LazyStack *>(info.Data());
+    std::stringstream ss;
+    ss << self->js << std::endl
+       << std::endl
+       << "==== Native Stack ====" << std::endl
+       << self->frames.str();
+    auto stack = Napi::String::New(info.Env(), ss.str());
+    settle(info, stack);
+    return stack;
+  }
+
+  static void set(const Napi::CallbackInfo &info) {
+    settle(info, info.Length() > 0 ? info[0] : info.Env().Undefined());
+  }
+
+private:
+  // Replace the accessor by the value, as `stack` is on any other error
+  static void settle(const Napi::CallbackInfo &info, Napi::Value value) {
+    info.This().As<Napi::Object>().DefineProperty(
+        Napi::PropertyDescriptor::Value(
+            "stack", value,
+            (napi_property_attributes)(napi_writable | napi_configurable)));
+  }
+
+  const std::string js;
+  const Stacktrace::Frames frames;
+};
+
 inline const Napi::Error &injectNativeStack(const Napi::Error &error,
-                                            std::string stacktrace) {
-  std::stringstream ss;
-  ss << error.Value().Get("stack").ToString().Utf8Value() << std::endl
-     << std::endl
-     << "==== Native Stack ====" << std::endl
-     << stacktrace;
-  error.Value().Set("stack", Napi::String::New(error.Env(), ss.str()));
+                                            Stacktrace::Frames frames) {
+  auto obj = error.Value();
+  // Errors passed along keep the stack of where they were first made
+  if (obj.CheckTypeTag(&LazyStack::tag))
+    return error;
+  obj.TypeTag(&LazyStack::tag);
+  auto lazy =
+      new LazyStack(obj.Get("stack").ToString().Utf8Value(), std::move(frames));
+  obj.AddFinalizer([](Napi::Env, LazyStack *lazy) { delete lazy; }, lazy);
+  obj.DefineProperty(
+      Napi::PropertyDescriptor::Accessor<LazyStack::get, LazyStack::set>(
+          "stack", napi_configurable, lazy));
   return error;
 }
 
 inline const Napi::Error injectNativeStack(const Napi::Error error) {
-  return injectNativeStack(error, Stacktrace::capture());
+  return injectNativeStack(error, Stacktrace::Frames::capture());
 }
 
 #define JS_THROW(ERR, MSG)                                                     \
   {                                                                            \
     auto error = Napi::Error::New(env, MSG);                                   \
-    injectNativeStack(error).ThrowAsJavaScriptException();                     \
+    if (JS::ERR::native_stack.load(std::memory_order_relaxed))                 \
+      injectNativeStack(error);                                                \
+    error.ThrowAsJavaScriptException();                                        \
     return;                                                                    \
   }
 
 #define JS_THROW_RET(ERR, MSG, RET)                                            \
   {                                                                            \
     auto error = Napi::Error::New(env, MSG);                                   \
-    injectNativeStack(error).ThrowAsJavaScriptException();                     \
+    if (JS::ERR::native_stack.load(std::memory_order_relaxed))                 \
+      injectNativeStack(error);                                                \
+    error.ThrowAsJavaScriptException();                                        \
     return RET;                                                                \
   }
 
@@ -80,46 +135,49 @@ inline const Napi::Error injectNativeStack(const Napi::Error error) {
     JS_THROW_RET(Error, e.what(), RET);                                        \
   }
 
-#if defined(DEBUG) || defined(_DEBUG)
-#include <cstdio>
-#define VERBOSE(...)                                                           \
-  {                                                                            \
-    std::fprintf(stderr, "[ADDON] " __VA_ARGS__);                              \
-    std::putc('\n', stderr);                                                   \
-    std::fflush(stderr);                                                       \
-  }
-#else
-#define VERBOSE(MSG)
-#endif
-
 namespace JS {
 
+/**
+ * Errors bound for JS. Each class carries a native stack unless its
+ * `native_stack` is switched off, e.g. for errors that are expected in
+ * tight loops: JS::TypeError::native_stack = false;
+ */
 class Error : public std::exception {
   const Napi::Error error;
+  const std::string message;
+
+protected:
+  Error(Napi::Error error, bool native_stack)
+      : error(native_stack ? injectNativeStack(error) : error),
+        message(error.Message()) {}
 
 public:
-  Error(Napi::Error error) : error(injectNativeStack(error)) {}
+  static inline std::atomic<bool> native_stack{true};
+
+  Error(Napi::Error error) : Error(error, native_stack.load()) {}
   Error(Napi::Env env, std::string message)
-      : error(injectNativeStack(
-            Napi::Error::New(env, Napi::String::New(env, message)))) {}
+      : Error(Napi::Error::New(env, Napi::String::New(env, message)),
+              native_stack.load()) {}
   void Throw() const { error.ThrowAsJavaScriptException(); }
-  const char *what() const noexcept override { return error.Message().c_str(); }
+  const char *what() const noexcept override { return message.c_str(); }
 };
 
 class TypeError : public Error {
-  const Napi::Error error;
-
 public:
+  static inline std::atomic<bool> native_stack{true};
+
   TypeError(Napi::Env env, std::string message)
-      : Error(Napi::TypeError::New(env, Napi::String::New(env, message))) {}
+      : Error(Napi::TypeError::New(env, Napi::String::New(env, message)),
+              native_stack.load()) {}
 };
 
 class RangeError : public Error {
-  const Napi::Error error;
-
 public:
+  static inline std::atomic<bool> native_stack{true};
+
   RangeError(Napi::Env env, std::string message)
-      : Error(Napi::RangeError::New(env, Napi::String::New(env, message))) {}
+      : Error(Napi::RangeError::New(env, Napi::String::New(env, message)),
+              native_stack.load()) {}
 };
 
 } // namespace JS
@@ -163,7 +221,7 @@ template <SmartPtrLike R> class OneShotWorker : public Napi::AsyncWorker {
   Fn const fn;
   R result;
   Napi::Value container;
-  std::string stacktrace;
+  Stacktrace::Frames stacktrace;
   const Napi::Promise::Deferred deferred;
   OneShotWorker(Napi::Env env, Fn fn)
       : Napi::AsyncWorker(env), env(env), fn(fn), container(env.Undefined()),
@@ -172,13 +230,14 @@ template <SmartPtrLike R> class OneShotWorker : public Napi::AsyncWorker {
       : Napi::AsyncWorker(env), env(env), fn(fn), container(container),
         deferred(Napi::Promise::Deferred::New(env)) {}
   void Execute() override {
+    TRACE_SPAN("OneShotWorker::Execute");
     try {
       result = fn();
     } catch (const std::exception &e) {
-      stacktrace = Stacktrace::capture();
+      stacktrace = Stacktrace::Frames::capture();
       SetError(e.what());
     } catch (...) {
-      stacktrace = Stacktrace::capture();
+      stacktrace = Stacktrace::Frames::capture();
       SetError("Unknown error");
     }
   }
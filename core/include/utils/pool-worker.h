@@ -0,0 +1,205 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+
+#include <napi.h>
+
+#include "CoreObject.h"
+#include "Dispatcher.h"
+#include "threading/Pool.h"
+#include "utils/napi-helper.h"
+#include "utils/pointer.h"
+#include "utils/stacktrace.h"
+#include "utils/trace.h"
+
+/**
+ * What a job on the pool sees of the JS call that started it: the token
+ * that an AbortSignal cancels, and progress reporting to the onProgress
+ * callback, throttled and delivered on the main thread by the Dispatcher.
+ */
+class PoolJob {
+public:
+  // Progress reports closer together than this are dropped
+  static constexpr uint64_t PROGRESS_INTERVAL_NS = 50'000'000;
+
+  const threading::CancelToken token;
+
+  /**
+   * Callable from any thread working for the job (e.g. inside
+   * parallel_for) until the work returns; the final report, done >= total,
+   * always goes through
+   */
+  void progress(double done, double total) {
+    if (!listener)
+      return;
+    const uint64_t now = now_ns();
+    uint64_t last = last_progress.load(std::memory_order_relaxed);
+    if (done < total &&
+        (now - last < PROGRESS_INTERVAL_NS ||
+         !last_progress.compare_exchange_strong(last, now,
+                                                std::memory_order_relaxed)))
+      return;
+    auto listener = this->listener;
+    Dispatcher::dispatch(dispatcher, [listener, done, total](Napi::Env env) {
+      listener->Call({Napi::Number::New(env, done),
+                      Napi::Number::New(env, total)});
+    });
+  }
+
+private:
+  template <typename T> friend class PoolWorker;
+
+  PoolJob(Napi::Env env, Napi::FunctionReference *listener)
+      : dispatcher(Dispatcher::handle(env)), listener(listener) {}
+
+  static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  const Dispatcher::Handle dispatcher;
+  // Owned by the PoolWorker call; outlives every dispatched report
+  Napi::FunctionReference *const listener;
+  std::atomic<uint64_t> last_progress{0};
+};
+
+/**
+ * Counterpart of OneShotWorker for CPU-heavy work: runs on the addon's
+ * work-stealing pool instead of the libuv threadpool, so the work may
+ * split itself with threading::Group or parallel_for, and settles a
+ * Promise on the main thread.
+ *
+ * `options` may carry { onProgress(done, total), signal: AbortSignal };
+ * an aborted job rejects with an AbortError.
+ */
+template <typename T> class PoolWorker {
+public:
+  using Work = std::function<T(PoolJob &)>;
+  // Main thread: turns the result into the value the Promise resolves to
+  using Resolve = std::function<Napi::Value(Napi::Env, T &)>;
+
+  static Napi::Promise run(Napi::Env env, Work work, Resolve resolve,
+                           Napi::Value options) {
+    // JS handles only ever touched on the main thread; released with the
+    // task that settles the Promise, which the loop stays alive for
+    auto js = std::make_shared<Pending>(Napi::Promise::Deferred::New(env),
+                                        Dispatcher::handle(env));
+    auto promise = js->deferred.Promise();
+    if (options.IsObject()) {
+      auto opts = options.As<Napi::Object>();
+      if (opts.Get("onProgress").IsFunction())
+        js->listener =
+            Napi::Persistent(opts.Get("onProgress").As<Napi::Function>());
+    }
+    auto job = std::shared_ptr<PoolJob>(
+        new PoolJob(env, js->listener.IsEmpty() ? nullptr : &js->listener));
+    if (options.IsObject())
+      listen(env, options.As<Napi::Object>().Get("signal"), job->token);
+    threading::Pool::global().submit([job, js = std::move(js),
+                                      work = std::move(work),
+                                      resolve = std::move(resolve)]() mutable {
+      TRACE_SPAN("PoolWorker::run");
+      auto result = std::make_shared<std::optional<T>>();
+      std::exception_ptr error;
+      Stacktrace::Frames frames;
+      try {
+        result->emplace(work(*job));
+      } catch (...) {
+        error = std::current_exception();
+        frames = Stacktrace::Frames::capture();
+      }
+      // Moved into the task, so the handles go wherever the task goes
+      Dispatcher::dispatch(job->dispatcher, [js = std::move(js), result, error,
+                                             frames, resolve](Napi::Env env) {
+        js->settled = true;
+        Napi::HandleScope scope(env);
+        if (!error) {
+          try {
+            js->deferred.Resolve(resolve(env, **result));
+          } catch (const std::exception &e) {
+            js->deferred.Reject(Napi::Error::New(env, e.what()).Value());
+          }
+          return;
+        }
+        try {
+          std::rethrow_exception(error);
+        } catch (const threading::Cancelled &) {
+          auto e = Napi::Error::New(env, "The operation was aborted");
+          e.Set("name", Napi::String::New(env, "AbortError"));
+          js->deferred.Reject(e.Value());
+        } catch (const std::exception &e) {
+          js->deferred.Reject(
+              injectNativeStack(Napi::Error::New(env, e.what()), frames)
+                  .Value());
+        } catch (...) {
+          js->deferred.Reject(
+              Napi::Error::New(env, "Unknown error").Value());
+        }
+      });
+    });
+    return promise;
+  }
+
+  /** Resolve with the CoreObject wrapping the result, as OneShotWorker */
+  static Napi::Promise run(Napi::Env env, Work work, Napi::Value options)
+    requires SmartPtrLike<T>
+  {
+    return run(
+        env, std::move(work),
+        [](Napi::Env env, T &result) { return CreateObject(env, result); },
+        options);
+  }
+
+private:
+  struct Pending {
+    Pending(Napi::Promise::Deferred deferred, Dispatcher::Handle dispatcher)
+        : deferred(deferred), dispatcher(std::move(dispatcher)) {
+      Dispatcher::hold(this->dispatcher);
+    }
+    // Dropped unsettled, the env is being torn down and frees the reference
+    // itself, maybe off this thread
+    ~Pending() {
+      if (!settled)
+        listener.SuppressDestruct();
+      Dispatcher::release(dispatcher);
+    }
+    Napi::Promise::Deferred deferred;
+    Napi::FunctionReference listener;
+    const Dispatcher::Handle dispatcher;
+    bool settled = false;
+  };
+
+  // Cancel the token when the AbortSignal fires
+  static void listen(Napi::Env env, Napi::Value signal,
+                     threading::CancelToken token) {
+    if (!signal.IsObject())
+      return;
+    auto obj = signal.As<Napi::Object>();
+    if (obj.Get("aborted").ToBoolean()) {
+      token.cancel();
+      return;
+    }
+    auto add = obj.Get("addEventListener");
+    if (!add.IsFunction())
+      return;
+    auto once = Napi::Object::New(env);
+    once.Set("once", true);
+    add.As<Napi::Function>().Call(
+        obj, {Napi::String::New(env, "abort"),
+              Napi::Function::New(
+                  env, [token](const Napi::CallbackInfo &) { token.cancel(); },
+                  "abort"),
+              once});
+  }
+};
@@ -5,8 +5,10 @@
 // -------------------------------------------------------
 #pragma once
 
+#include <cstdlib>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #define STACKTRACE_ENABLED 1
 #if __has_include(<stacktrace>) && defined(__cpp_lib_stacktrace)
@@ -21,27 +23,63 @@
 
 namespace Stacktrace {
 
-inline std::string capture() {
-  std::stringstream out;
+/**
+ * Return addresses of a call stack. Capturing only walks the stack (a few
+ * us); symbolizing, the expensive part, waits until str() is called.
+ */
+class Frames {
+public:
+  static inline Frames capture() {
+    Frames f;
 #if HAVE_STD_STACKTRACE
-  auto st = std::stacktrace::current();
-  for (auto f : st) {
-    out << f.description() << " @ " << f.source_file() << ":" << f.source_line()
-        << std::endl;
+    f.st = std::stacktrace::current(1);
+#elif STACKTRACE_ENABLED
+    void *addrs[128];
+    const int n = ::backtrace(addrs, 128);
+    // Leave out capture() itself
+    if (n > 1)
+      f.addrs.assign(addrs + 1, addrs + n);
+#endif
+    return f;
   }
-  return out.str();
+
+  bool empty() const {
+#if HAVE_STD_STACKTRACE
+    return st.empty();
 #elif STACKTRACE_ENABLED
-  void *addrs[128];
-  int n = ::backtrace(addrs, 128);
-  char **syms = ::backtrace_symbols(addrs, n);
-  for (int i = 0; i < n; i++) {
-    out << syms[i] << std::endl;
+    return addrs.empty();
+#else
+    return true;
+#endif
   }
-  free(syms);
-  return out.str();
+
+  std::string str() const {
+    std::stringstream out;
+#if HAVE_STD_STACKTRACE
+    for (auto f : st) {
+      out << f.description() << " @ " << f.source_file() << ":"
+          << f.source_line() << std::endl;
+    }
+#elif STACKTRACE_ENABLED
+    char **syms = ::backtrace_symbols(addrs.data(), (int)addrs.size());
+    for (size_t i = 0; syms && i < addrs.size(); i++) {
+      out << syms[i] << std::endl;
+    }
+    free(syms);
 #else
-  return "(Stacktrace not supported on this platform)";
+    out << "(Stacktrace not supported on this platform)";
 #endif
-}
+    return out.str();
+  }
+
+private:
+#if HAVE_STD_STACKTRACE
+  std::stacktrace st;
+#elif STACKTRACE_ENABLED
+  std::vector<void *> addrs;
+#endif
+};
+
+inline std::string capture() { return Frames::capture().str(); }
 
 } // namespace Stacktrace
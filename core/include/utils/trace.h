@@ -0,0 +1,310 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#pragma once
+
+/**
+ * Native tracing, exported as Chrome trace_event JSON (chrome://tracing,
+ * Perfetto).
+ *
+ *   TRACE_SPAN("Stream::push");          // slice until end of scope
+ *   TRACE_INSTANT("Receiver::truncated");
+ *   TRACE_FLOW_BEGIN("dispatch", id);     // arrow from this slice ...
+ *   TRACE_FLOW_END("dispatch", id);       // ... to this one
+ *
+ * Names must be string literals (only the pointer is recorded). Every
+ * thread records into its own ring of CORE_TRACE_EVENTS events, allocated
+ * on its first event; writing one takes no lock and, once full, overwrites
+ * the oldest. While tracing is stopped a span costs one relaxed load.
+ *
+ * Build with -DCORE_TRACE=0 to compile every macro out.
+ */
+
+#ifndef CORE_TRACE
+#define CORE_TRACE 1
+#endif
+
+// Events kept per thread
+#ifndef CORE_TRACE_EVENTS
+#define CORE_TRACE_EVENTS 8192
+#endif
+
+#if CORE_TRACE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace Trace {
+
+// steady_clock is CLOCK_MONOTONIC on Linux, the clock Chrome traces use,
+// so native slices line up with a renderer profile taken at the same time
+inline uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Event {
+  const char *name;
+  uint64_t ts;  // ns
+  uint64_t dur; // ns, complete events only
+  uint64_t id;  // flow events only
+  char phase;   // 'X' complete, 'i' instant, 's' / 'f' flow
+};
+
+class Ring {
+public:
+  static constexpr size_t SIZE = CORE_TRACE_EVENTS;
+  static_assert((SIZE & (SIZE - 1)) == 0, "CORE_TRACE_EVENTS: power of 2");
+
+  explicit Ring(uint32_t tid) : tid(tid), events(SIZE) {
+    char buf[64] = {0};
+    if (pthread_getname_np(pthread_self(), buf, sizeof(buf)) == 0 && buf[0])
+      name = buf;
+    else
+      name = "thread " + std::to_string(tid);
+  }
+
+  // Owning thread only
+  inline void record(const Event &e) {
+    const uint64_t h = head.load(std::memory_order_relaxed);
+    events[h & (SIZE - 1)] = e;
+    head.store(h + 1, std::memory_order_release);
+  }
+
+  /**
+   * Copy out what was recorded, oldest first. The owner may keep writing:
+   * events it could have overwritten during the copy are dropped, including
+   * the one in the slot it may be writing right now.
+   */
+  std::vector<Event> snapshot() const {
+    const uint64_t end = head.load(std::memory_order_acquire);
+    const uint64_t begin = end > SIZE ? end - SIZE : 0;
+    std::vector<Event> out;
+    out.reserve(end - begin);
+    for (uint64_t i = begin; i < end; i++)
+      out.push_back(events[i & (SIZE - 1)]);
+    const uint64_t now = head.load(std::memory_order_acquire);
+    const uint64_t lost = now + 1 > SIZE + begin ? now + 1 - SIZE - begin : 0;
+    out.erase(out.begin(), out.begin() + std::min<uint64_t>(lost, out.size()));
+    return out;
+  }
+
+  const uint32_t tid;
+  std::string name;
+  // Set when the owning thread exits; the ring then goes with the next dump
+  std::atomic<bool> exited{false};
+
+private:
+  std::vector<Event> events;
+  std::atomic<uint64_t> head{0};
+};
+
+/** Rings of the threads that recorded, until dumped after they exited */
+class Registry {
+public:
+  static Registry &get() {
+    static Registry *registry = new Registry(); // outlives thread_locals
+    return *registry;
+  }
+
+  std::shared_ptr<Ring> add() {
+    std::scoped_lock lock(mutex);
+    rings.push_back(std::make_shared<Ring>(next_tid++));
+    return rings.back();
+  }
+
+  /** Every ring; those of exited threads are handed out one last time */
+  std::vector<std::shared_ptr<Ring>> collect() {
+    std::scoped_lock lock(mutex);
+    auto out = rings;
+    rings.erase(std::remove_if(rings.begin(), rings.end(),
+                               [](const std::shared_ptr<Ring> &r) {
+                                 return r->exited.load(
+                                     std::memory_order_acquire);
+                               }),
+                rings.end());
+    return out;
+  }
+
+private:
+  std::mutex mutex;
+  std::vector<std::shared_ptr<Ring>> rings;
+  uint32_t next_tid = 1;
+};
+
+inline std::atomic<bool> enabled{false};
+// Events before the last start() are left out of the export
+inline std::atomic<uint64_t> since{0};
+
+inline bool active() { return enabled.load(std::memory_order_relaxed); }
+
+// The calling thread's ring, flagged as exited along with the thread
+struct Owner {
+  const std::shared_ptr<Ring> ring = Registry::get().add();
+  ~Owner() { ring->exited.store(true, std::memory_order_release); }
+};
+
+inline Ring &ring() {
+  thread_local Owner owner;
+  return *owner.ring;
+}
+
+inline void record(char phase, const char *name, uint64_t ts, uint64_t dur = 0,
+                   uint64_t id = 0) {
+  ring().record(Event{name, ts, dur, id, phase});
+}
+
+/** Start recording, leaving out whatever was recorded before */
+inline void start() {
+  since.store(now_ns(), std::memory_order_relaxed);
+  enabled.store(true, std::memory_order_relaxed);
+}
+
+inline void stop() { enabled.store(false, std::memory_order_relaxed); }
+
+/** Unique id to pair TRACE_FLOW_BEGIN with TRACE_FLOW_END */
+inline uint64_t flow_id() {
+  static std::atomic<uint64_t> next{1};
+  return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+class Span {
+public:
+  explicit Span(const char *name) : name(name), ts(active() ? now_ns() : 0) {}
+  ~Span() {
+    if (ts)
+      record('X', name, ts, now_ns() - ts);
+  }
+  Span(const Span &) = delete;
+  Span &operator=(const Span &) = delete;
+
+private:
+  const char *name;
+  const uint64_t ts;
+};
+
+inline void json_string(std::string &out, const std::string &s) {
+  out += '"';
+  for (const char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if ((unsigned char)c < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += c;
+    }
+  }
+  out += '"';
+}
+
+/** Everything currently in the rings, as a trace_event JSON object */
+inline std::string json() {
+  const unsigned pid = (unsigned)::getpid();
+  const uint64_t from = since.load(std::memory_order_relaxed);
+  std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  char buf[256];
+  auto sep = [&] {
+    if (!first)
+      out += ',';
+    first = false;
+  };
+  for (const auto &r : Registry::get().collect()) {
+    auto events = r->snapshot();
+    events.erase(std::remove_if(events.begin(), events.end(),
+                                [&](const Event &e) { return e.ts < from; }),
+                 events.end());
+    if (events.empty())
+      continue;
+    sep();
+    std::snprintf(buf, sizeof(buf),
+                  "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%u,"
+                  "\"tid\":%u,\"args\":{\"name\":",
+                  pid, r->tid);
+    out += buf;
+    json_string(out, r->name);
+    out += "}}";
+    for (const auto &e : events) {
+      sep();
+      // trace_event timestamps are in us
+      std::snprintf(buf, sizeof(buf),
+                    "{\"ph\":\"%c\",\"cat\":\"core\",\"name\":\"%s\","
+                    "\"pid\":%u,\"tid\":%u,\"ts\":%.3f",
+                    e.phase, e.name, pid, r->tid, e.ts * 1e-3);
+      out += buf;
+      if (e.phase == 'X')
+        std::snprintf(buf, sizeof(buf), ",\"dur\":%.3f}", e.dur * 1e-3);
+      else if (e.phase == 'i')
+        std::snprintf(buf, sizeof(buf), ",\"s\":\"t\"}");
+      else // flows bind to the enclosing slices
+        std::snprintf(buf, sizeof(buf), ",\"id\":%llu,\"bp\":\"e\"}",
+                      (unsigned long long)e.id);
+      out += buf;
+    }
+  }
+  out += "]}";
+  return out;
+}
+
+} // namespace Trace
+
+#define TRACE_CONCAT_(A, B) A##B
+#define TRACE_CONCAT(A, B) TRACE_CONCAT_(A, B)
+#define TRACE_SPAN(NAME) Trace::Span TRACE_CONCAT(__trace_span_, __LINE__)(NAME)
+#define TRACE_INSTANT(NAME)                                                    \
+  do {                                                                         \
+    if (Trace::active())                                                       \
+      Trace::record('i', NAME, Trace::now_ns());                               \
+  } while (0)
+#define TRACE_FLOW_BEGIN(NAME, ID)                                             \
+  do {                                                                         \
+    if (Trace::active())                                                       \
+      Trace::record('s', NAME, Trace::now_ns(), 0, ID);                        \
+  } while (0)
+#define TRACE_FLOW_END(NAME, ID)                                               \
+  do {                                                                         \
+    if (Trace::active())                                                       \
+      Trace::record('f', NAME, Trace::now_ns(), 0, ID);                        \
+  } while (0)
+
+#else
+
+#include <cstdint>
+#include <string>
+
+// Enough for call sites that guard extra work with Trace::active()
+namespace Trace {
+constexpr bool active() { return false; }
+inline uint64_t flow_id() { return 0; }
+inline void start() {}
+inline void stop() {}
+inline std::string json() { return "{\"traceEvents\":[]}"; }
+} // namespace Trace
+
+#define TRACE_SPAN(NAME)
+#define TRACE_INSTANT(NAME)                                                    \
+  do {                                                                         \
+  } while (0)
+#define TRACE_FLOW_BEGIN(NAME, ID)                                             \
+  do {                                                                         \
+  } while (0)
+#define TRACE_FLOW_END(NAME, ID)                                               \
+  do {                                                                         \
+  } while (0)
+
+#endif
@@ -4,24 +4,36 @@
 // You may find the full license in project root directory.
 // -------------------------------------------------------
 #pragma once
+#include <cstddef>
 #include <string>
 #include <string_view>
 
-template <typename T> constexpr std::string type_name() {
-#if defined(__clang__)
-  std::string_view name = __PRETTY_FUNCTION__;
-  std::string_view prefix = "std::string type_name() [T = ";
-  std::string_view suffix = "]";
-#elif defined(__GNUC__)
-  std::string_view name = __PRETTY_FUNCTION__;
-  std::string_view prefix = "constexpr std::string type_name() [with T = ";
-  std::string_view suffix = "]";
-#elif defined(_MSC_VER)
-  std::string_view name = __FUNCSIG__;
-  std::string_view prefix = "std::string __cdecl type_name<";
-  std::string_view suffix = ">(void)";
+namespace type_name_detail {
+
+template <typename T> constexpr std::string_view signature() {
+#if defined(_MSC_VER)
+  return __FUNCSIG__;
+#else
+  return __PRETTY_FUNCTION__;
 #endif
-  name.remove_prefix(prefix.size());
-  name.remove_suffix(suffix.size());
-  return std::string(name);
+}
+
+// Where the type sits in signature<T>(), measured once on a known type so
+// that every compiler's decoration is handled the same way
+constexpr std::string_view probe = signature<double>();
+constexpr size_t prefix = probe.find("double");
+constexpr size_t suffix = probe.size() - prefix - sizeof("double") + 1;
+
+} // namespace type_name_detail
+
+/** Name of T, computed at compile time; points into static storage */
+template <typename T> constexpr std::string_view type_name_view() {
+  std::string_view name = type_name_detail::signature<T>();
+  name.remove_prefix(type_name_detail::prefix);
+  name.remove_suffix(type_name_detail::suffix);
+  return name;
+}
+
+template <typename T> constexpr std::string type_name() {
+  return std::string(type_name_view<T>());
 }
@@ -52,6 +52,57 @@ declare module "core" {
     /** Path to the resolved native module */
     export const __origin__: string;
 
+    export type LogLevel = "trace" | "debug" | "info" | "warn" | "error" | "off";
+
+    /**
+     * Native logger (core/include/utils/log.h), written to stderr from a
+     * background thread. Levels start from CORE_LOG, e.g.
+     * CORE_LOG="warn,stream=debug".
+     */
+    export const log: {
+        /** One category, or all of them and the default when omitted */
+        setLevel(level: LogLevel, category?: string): void;
+        /** Level per category seen so far; "*" is the default */
+        levels(): Record<string, LogLevel>;
+        /** Block until everything logged so far is written */
+        flush(): void;
+        /** Records lost to a full queue since start */
+        dropped(): number;
+    };
+
+    /**
+     * Native tracing (core/include/utils/trace.h). Spans are recorded
+     * between start() and stop(); dump() returns them as Chrome
+     * trace_event JSON, for Perfetto or chrome://tracing.
+     */
+    export const trace: {
+        /** False when the addon was built with CORE_TRACE=0 */
+        readonly enabled: boolean;
+        start(): void;
+        stop(): void;
+        active(): boolean;
+        dump(): string;
+    };
+
+    /** Probes for bench/napi.cjs, not part of the API */
+    export const __bench__: {
+        /**
+         * Dispatch `perThread` tasks from each of `threads` native threads;
+         * resolves with each task's dispatch-to-run latency in ns.
+         */
+        dispatch(threads: number, perThread: number): Promise<Float64Array>;
+        /**
+         * Create `n` Counters from native code, each for a new native
+         * object or all for the same one; ns spent on each
+         */
+        wrap(n: number, same?: boolean): Float64Array;
+        /**
+         * Move one coroutine from the main thread to the pool and back
+         * `n` times; resolves with each round trip's latency in ns.
+         */
+        hop(n: number): Promise<Float64Array>;
+    };
+
     class CoreObject {
         /**
          * Releases underlying native resources.
@@ -67,6 +118,190 @@ declare module "core" {
         get value(): number;
     }
 
+    /**
+     * Maps device timestamps (esp_timer, us) to host time (steady clock, us)
+     * using a drift-corrected linear model fed by periodic sync exchanges.
+     */
+    export class Clock extends CoreObject {
+        static create(): Clock;
+        /** Host steady clock in microseconds, the time base of this model */
+        static now(): number;
+        /**
+         * Add one exchange: host time before the request (t0), device time
+         * in the reply, host time after the reply (t3).
+         */
+        sample(t0: number, device: number, t3: number): boolean;
+        toHost(device: number): number;
+        toDevice(host: number): number;
+        /** Host minus device time, us */
+        get offset(): number;
+        /** Device clock rate error, ppm */
+        get drift(): number;
+        /** RMS residual of the fit, us */
+        get error(): number;
+        /** Half the best round trip, bound on path asymmetry, us */
+        get bound(): number;
+        get samples(): number;
+    }
+
+    /** Options of native work run on the core's work-stealing pool */
+    export type PoolOptions = {
+        /** Main thread, at most every 50 ms, and once when done */
+        onProgress?: (done: number, total: number) => any;
+        /** Rejects the Promise with an AbortError once aborted */
+        signal?: AbortSignal;
+    };
+
+    export type CaptureRecord = {
+        seq: number;
+        /** Device time (esp_timer, us), see Clock.toHost() */
+        time: number;
+    } & (
+        | { type: "data"; src: number; payload: Uint8Array }
+        | { type: "sync"; records: number; filtered: number; dropped: number }
+    );
+
+    export type CaptureStats = {
+        records: number;
+        bytes: number;
+        /** Discontinuities in the record sequence */
+        gaps: number;
+        /** Records missing according to sequence numbers */
+        lost: number;
+        /** Frames discarded for bad framing or CRC */
+        corrupt: number;
+        /** Sequence restarts (device reset) */
+        resets: number;
+        /** LZ frames received, and the bytes they decompressed to */
+        compressed: number;
+        inflated: number;
+        /** LZ frames skipped after a loss until the history restarted */
+        stale: number;
+        /** Latest device performance counters, null until the first heartbeat */
+        device: DevicePerf | null;
+    };
+
+    /** Counters of one bridge port, cumulative since device boot */
+    export type PortPerf = {
+        rxBytes: number;
+        rxChunks: number;
+        txBytes: number;
+        txChunks: number;
+        /** Writes cut short by a full TX FIFO */
+        txFull: number;
+        /** FIFO high-water marks, bytes */
+        rxFifoPeak: number;
+        txFifoPeak: number;
+        /** Bytes per second since the previous heartbeat */
+        rxRate: number;
+        txRate: number;
+        /** Data signalled to forwarded, us */
+        latency: { min: number; max: number; avg: number; count: number };
+    };
+
+    /** Device-side performance counters carried by capture heartbeats */
+    export type DevicePerf = {
+        /** Device uptime, ms */
+        uptime: number;
+        /** TinyUSB task loop passes, total and per second */
+        tudLoops: number;
+        tudLoopRate: number;
+        /** Indexed by bridge port: CDC interfaces, then the UART */
+        ports: PortPerf[];
+    };
+
+    /** Decoder for the COBS/CRC-16 framed capture stream */
+    export class CaptureDecoder extends CoreObject {
+        static create(maxFrame?: number): CaptureDecoder;
+        /**
+         * Decode whole capture segments in parallel, each with a decoder of
+         * its own, off the main thread; progress counts bytes
+         */
+        static scan(
+            files: CaptureFile[],
+            options?: PoolOptions,
+        ): Promise<CaptureStats[]>;
+        push(data: Uint8Array): CaptureRecord[];
+        /**
+         * Decode `length` bytes of a capture file from `offset` (default:
+         * the whole file) without copying them into JS
+         */
+        pushFile(
+            file: CaptureFile,
+            offset?: number,
+            length?: number,
+        ): CaptureRecord[];
+        reset(): void;
+        get stats(): CaptureStats;
+    }
+
+    /**
+     * Capture segment (CAPnnnnn.BIN) copied off the device's capture store,
+     * memory-mapped read-only
+     */
+    export class CaptureFile extends CoreObject {
+        static open(path: string): CaptureFile;
+        /**
+         * The file behind a token from `share()`, e.g. posted to a worker
+         * thread: the same mapping, not a copy. Throws once every env has
+         * released the file.
+         */
+        static adopt(token: number): CaptureFile;
+        /** A token for `CaptureFile.adopt()` in any env of this process */
+        share(): number;
+        get path(): string;
+        get size(): number;
+    }
+
+    export type CaptureReceiverOptions = {
+        /** Device address on the USB network link (default 192.168.7.1) */
+        device?: string;
+        /** Device UDP port (default 5270) */
+        port?: number;
+        /** Local UDP port, any if omitted */
+        localPort?: number;
+    };
+
+    /**
+     * Receives the capture stream over the device's USB network interface
+     * (UDP, firmware built with CAPTURE_NET); decoding runs off the main
+     * thread, records arrive in batches
+     */
+    export class CaptureReceiver extends CoreObject {
+        static create(
+            onRecords: (records: CaptureRecord[]) => any,
+            options?: CaptureReceiverOptions,
+        ): CaptureReceiver;
+        close(): void;
+        /** Local UDP port */
+        get port(): number;
+        get stats(): CaptureStats & {
+            datagrams: number;
+            /** Datagrams larger than the receive buffer */
+            truncated: number;
+        };
+    }
+
+    /**
+     * Native counters, gauges and latency histograms of the whole process
+     * (core/include/Metrics.h), read all at once. snapshot()[i] is the
+     * value named names[i]; slot 0 is the layout generation and slot 1 a
+     * steady-clock time in ms. Counters are cumulative: rates are the
+     * difference of two snapshots over the difference of their times.
+     * Histograms take 7 slots: .count .mean .p50 .p90 .p99 .p999 .max
+     */
+    export class Metrics extends CoreObject {
+        static global(): Metrics;
+        /**
+         * @param reuse the array of a previous call, refilled in place as
+         *  long as no metric was added since
+         */
+        snapshot(reuse?: Float64Array): Float64Array;
+        /** Changes whenever names does */
+        get generation(): number;
+        get names(): string[];
+    }
+
     export class PseudoTTY extends CoreObject {
         /**
          * @param tty path to the actual tty serial port of a physical device
@@ -10,4 +10,4 @@ const Module = require("./index.cjs");
 
 export default Module;
 // (optional) re-expose named exports for nicer ESM ergonomics:
-export const { Counter, __origin__ } = Module;
+export const { Counter, Clock, CaptureDecoder, __origin__ } = Module;
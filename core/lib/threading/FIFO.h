@@ -6,6 +6,7 @@
 #pragma once
 
 #include "exception.h"
+#include "utils/trace.h"
 
 #include <condition_variable>
 #include <mutex>
@@ -24,8 +25,11 @@ private:
 
   void push(T data) {
     std::unique_lock lock(mutex);
-    while (max_size > 0 && queue.size() >= max_size && !closed)
-      cond_r.wait(lock);
+    if (max_size > 0 && queue.size() >= max_size && !closed) {
+      TRACE_SPAN("FIFO::wait_write");
+      while (max_size > 0 && queue.size() >= max_size && !closed)
+        cond_r.wait(lock);
+    }
     if (closed) {
       lock.unlock();
       cond_w.notify_all();
@@ -37,8 +41,11 @@ private:
 
   void push(T &&data) {
     std::unique_lock lock(mutex);
-    while (max_size > 0 && queue.size() >= max_size && !closed)
-      cond_r.wait(lock);
+    if (max_size > 0 && queue.size() >= max_size && !closed) {
+      TRACE_SPAN("FIFO::wait_write");
+      while (max_size > 0 && queue.size() >= max_size && !closed)
+        cond_r.wait(lock);
+    }
     if (closed) {
       lock.unlock();
       cond_w.notify_all();
@@ -78,8 +85,11 @@ public:
 
   T read() {
     std::unique_lock lock(mutex);
-    while (queue.empty() && !closed)
-      cond_w.wait(lock);
+    if (queue.empty() && !closed) {
+      TRACE_SPAN("FIFO::wait_read");
+      while (queue.empty() && !closed)
+        cond_w.wait(lock);
+    }
     if (closed) {
       lock.unlock();
       cond_r.notify_all();
@@ -94,9 +104,12 @@ public:
 
   T read(unsigned timeout_ms) {
     std::unique_lock lock(mutex);
-    while (queue.empty() && !closed)
-      cond_w.wait_until(lock, std::chrono::steady_clock::now() +
-                                  std::chrono::milliseconds(timeout_ms));
+    if (queue.empty() && !closed) {
+      TRACE_SPAN("FIFO::wait_read");
+      while (queue.empty() && !closed)
+        cond_w.wait_until(lock, std::chrono::steady_clock::now() +
+                                    std::chrono::milliseconds(timeout_ms));
+    }
     if (closed) {
       lock.unlock();
       cond_r.notify_all();
@@ -0,0 +1,370 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#pragma once
+
+#include "Metrics.h"
+#include "exception.h"
+#include "utils/log.h"
+#include "utils/trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Addon-wide work-stealing executor for CPU-heavy analysis, kept apart
+ * from libuv's threadpool so that long jobs neither starve file I/O nor
+ * queue up behind each other.
+ *
+ *   threading::Group group;                 // on Pool::global()
+ *   for (auto &file : files)
+ *     group.run([&] { scan(file); });
+ *   group.wait();                           // rethrows the first failure
+ *
+ *   threading::parallel_for(0, n, 0, [&](size_t lo, size_t hi) { ... });
+ *
+ * Every worker owns a deque: it pushes and pops its own jobs at the back
+ * (newest first, still warm in cache) while idle workers steal from the
+ * front (oldest, usually the largest pieces of a split). Jobs submitted
+ * from outside the pool go through a shared injection queue. A thread
+ * waiting on a Group runs queued jobs meanwhile, so groups nest without
+ * tying up workers.
+ *
+ * The global pool has one worker per hardware thread, or CORE_THREADS.
+ */
+namespace threading {
+
+class Cancelled : public std::exception {
+public:
+  const char *what() const noexcept override { return "Cancelled"; }
+};
+
+/** Shared flag to stop work early; copies refer to the same flag */
+class CancelToken {
+public:
+  void cancel() const { flag->store(true, std::memory_order_relaxed); }
+  bool cancelled() const { return flag->load(std::memory_order_relaxed); }
+  /** Throws Cancelled once cancelled, for checkpoints inside long loops */
+  void check() const {
+    if (cancelled())
+      throw Cancelled();
+  }
+
+private:
+  std::shared_ptr<std::atomic<bool>> flag =
+      std::make_shared<std::atomic<bool>>(false);
+};
+
+class Pool {
+public:
+  using Job = std::function<void()>;
+
+  static Pool &global() {
+    // Never destroyed: workers may still be running at exit
+    static Pool *pool = new Pool(default_size());
+    return *pool;
+  }
+
+  static unsigned default_size() {
+    if (const char *env = std::getenv("CORE_THREADS")) {
+      const long n = std::strtol(env, nullptr, 10);
+      if (n > 0)
+        return (unsigned)std::min<long>(n, 256);
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  explicit Pool(unsigned size) {
+    for (unsigned i = 0; i < size; i++)
+      queues.push_back(std::make_unique<Queue>());
+    for (unsigned i = 0; i < size; i++)
+      threads.emplace_back([this, i] { work(i); });
+  }
+
+  /** Jobs still queued are dropped */
+  ~Pool() {
+    {
+      std::scoped_lock lock(sleep_mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto &t : threads)
+      t.join();
+  }
+
+  Pool(const Pool &) = delete;
+  Pool &operator=(const Pool &) = delete;
+
+  unsigned size() const { return (unsigned)threads.size(); }
+
+  /** Queue a job; on a worker of this pool it goes to that worker's deque */
+  void submit(Job job) {
+    Queue &q = current.pool == this ? *queues[current.index] : injected;
+    // Counted first, so that the count never drops below the jobs queued
+    queued.fetch_add(1);
+    {
+      std::scoped_lock lock(q.mutex);
+      q.jobs.push_back(std::move(job));
+    }
+    jobs.add();
+    // Pairs with the sleeper count in work(): either the sleeper sees the
+    // job, or this sees the sleeper and wakes it
+    if (sleepers.load() > 0) {
+      { std::scoped_lock lock(sleep_mutex); }
+      wake.notify_one();
+    }
+  }
+
+  /** Run one queued job on the calling thread; false if there was none */
+  bool run_one() {
+    Job job;
+    if (!take(job, current.pool == this ? current.index : SIZE_MAX))
+      return false;
+    run(job);
+    return true;
+  }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues; // one per worker
+  Queue injected;                             // from outside the pool
+  std::vector<std::thread> threads;
+
+  std::atomic<size_t> queued{0};
+  std::atomic<unsigned> sleepers{0};
+  std::mutex sleep_mutex;
+  std::condition_variable wake;
+  bool stopping = false;
+
+  // Zero-initialized: not a worker of any pool
+  static inline thread_local struct {
+    Pool *pool;
+    size_t index;
+  } current;
+
+  static inline Metrics::Counter &jobs = Metrics::counter("pool.jobs");
+  static inline Metrics::Counter &steals = Metrics::counter("pool.steals");
+
+  static bool pop_back(Queue &q, Job &out) {
+    std::scoped_lock lock(q.mutex);
+    if (q.jobs.empty())
+      return false;
+    out = std::move(q.jobs.back());
+    q.jobs.pop_back();
+    return true;
+  }
+
+  static bool pop_front(Queue &q, Job &out) {
+    std::scoped_lock lock(q.mutex);
+    if (q.jobs.empty())
+      return false;
+    out = std::move(q.jobs.front());
+    q.jobs.pop_front();
+    return true;
+  }
+
+  // Own deque first, then outside submissions, then the other workers
+  bool take(Job &out, size_t self) {
+    if (queued.load(std::memory_order_relaxed) == 0)
+      return false;
+    bool found = (self < queues.size() && pop_back(*queues[self], out)) ||
+                 pop_front(injected, out);
+    for (size_t i = 1; !found && i <= queues.size(); i++) {
+      const size_t victim = (self + i) % queues.size();
+      if (victim != self && pop_front(*queues[victim], out)) {
+        found = true;
+        steals.add();
+      }
+    }
+    if (found)
+      queued.fetch_sub(1, std::memory_order_relaxed);
+    return found;
+  }
+
+  static void run(Job &job) {
+    TRACE_SPAN("Pool::job");
+    try {
+      job();
+    } catch (const std::exception &e) {
+      LOG_ERROR("pool", "Job failed: %s", e.what());
+    } catch (...) {
+      LOG_ERROR("pool", "Job failed");
+    }
+  }
+
+  void work(size_t index) {
+    current.pool = this;
+    current.index = index;
+    const std::string name = "core-pool-" + std::to_string(index);
+#if defined(__APPLE__)
+    pthread_setname_np(name.c_str());
+#else
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#endif
+    for (;;) {
+      Job job;
+      if (take(job, index)) {
+        run(job);
+        continue;
+      }
+      std::unique_lock lock(sleep_mutex);
+      sleepers.fetch_add(1);
+      wake.wait(lock, [&] { return stopping || queued.load() > 0; });
+      sleepers.fetch_sub(1);
+      if (stopping)
+        return;
+    }
+  }
+};
+
+/**
+ * Jobs that are waited for together. A job that throws fails the group:
+ * jobs not yet started are skipped and wait() rethrows the exception.
+ * Cancelling the token skips them too, and wait() throws Cancelled.
+ */
+class Group {
+public:
+  explicit Group(Pool &pool = Pool::global(), CancelToken token = {})
+      : pool(pool), token_(std::move(token)) {}
+  explicit Group(CancelToken token) : Group(Pool::global(), std::move(token)) {}
+
+  // Jobs refer to the group, which therefore outlives them
+  ~Group() {
+    try {
+      wait();
+    } catch (...) {
+    }
+  }
+
+  Group(const Group &) = delete;
+  Group &operator=(const Group &) = delete;
+
+  void run(std::function<void()> fn) {
+    pending.fetch_add(1, std::memory_order_relaxed);
+    pool.submit([this, fn = std::move(fn)] {
+      if (!failed.load(std::memory_order_relaxed) && !token_.cancelled()) {
+        try {
+          fn();
+        } catch (...) {
+          fail(std::current_exception());
+        }
+      }
+      finish();
+    });
+  }
+
+  /** Block until every job has finished, running queued jobs meanwhile */
+  void wait() {
+    while (pending.load(std::memory_order_acquire) > 0) {
+      if (pool.run_one())
+        continue;
+      // Nothing to help with: the last jobs are running elsewhere. The
+      // timeout picks up jobs they may still spawn.
+      std::unique_lock lock(mutex);
+      done.wait_for(lock, std::chrono::microseconds(200), [&] {
+        return pending.load(std::memory_order_acquire) == 0;
+      });
+    }
+    std::scoped_lock lock(mutex);
+    if (error) {
+      auto e = error;
+      error = nullptr;
+      std::rethrow_exception(e);
+    }
+    token_.check();
+  }
+
+  const CancelToken &token() const { return token_; }
+
+private:
+  Pool &pool;
+  const CancelToken token_;
+  std::atomic<size_t> pending{0};
+  std::atomic<bool> failed{false};
+  std::mutex mutex;
+  std::condition_variable done;
+  std::exception_ptr error;
+
+  void fail(std::exception_ptr e) {
+    std::scoped_lock lock(mutex);
+    if (!error)
+      error = e;
+    failed.store(true, std::memory_order_relaxed);
+  }
+
+  // Under the mutex: once wait() has taken it after the count reached 0,
+  // no job touches the group any more
+  void finish() {
+    std::scoped_lock lock(mutex);
+    if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      done.notify_all();
+  }
+};
+
+/** Chunks of `grain` items, or about 4 per worker when grain is 0 */
+inline size_t grain_of(const Pool &pool, size_t n, size_t grain) {
+  if (grain > 0)
+    return grain;
+  return std::max<size_t>(1, n / ((size_t)pool.size() * 4));
+}
+
+/**
+ * fn(lo, hi) over [begin, end) split into chunks run on the pool; the
+ * calling thread takes part until all are done
+ */
+template <typename F>
+void parallel_for(size_t begin, size_t end, size_t grain, F &&fn,
+                  CancelToken token = {}, Pool &pool = Pool::global()) {
+  if (begin >= end)
+    return;
+  grain = grain_of(pool, end - begin, grain);
+  Group group(pool, std::move(token));
+  for (size_t lo = begin; lo < end; lo += grain) {
+    const size_t hi = std::min(end, lo + grain);
+    group.run([&fn, lo, hi] { fn(lo, hi); });
+  }
+  group.wait();
+}
+
+/**
+ * map(lo, hi) -> T over the chunks of [begin, end), folded with
+ * combine(T, T) -> T in chunk order, so the result does not depend on
+ * scheduling
+ */
+template <typename T, typename Map, typename Combine>
+T parallel_reduce(size_t begin, size_t end, size_t grain, T identity,
+                  Map &&map, Combine &&combine, CancelToken token = {},
+                  Pool &pool = Pool::global()) {
+  if (begin >= end)
+    return identity;
+  grain = grain_of(pool, end - begin, grain);
+  std::vector<T> partial((end - begin + grain - 1) / grain, identity);
+  auto chunk = [&](size_t lo, size_t hi) {
+    partial[(lo - begin) / grain] = map(lo, hi);
+  };
+  parallel_for(begin, end, grain, chunk, std::move(token), pool);
+  T out = std::move(identity);
+  for (auto &p : partial)
+    out = combine(std::move(out), std::move(p));
+  return out;
+}
+
+} // namespace threading
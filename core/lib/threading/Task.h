@@ -0,0 +1,198 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#pragma once
+
+#include "Pool.h"
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Coroutine tasks on the core's executors.
+ *
+ *   threading::Task<size_t> count(const File &file) {
+ *     co_await threading::schedule();       // continue on Pool::global()
+ *     co_return decode(file);
+ *   }
+ *
+ * A Task is lazy: it starts when awaited and resumes its awaiter with its
+ * result (or exception) on whichever thread it finished, without a hop of
+ * its own. schedule() moves the coroutine onto a pool worker; the JS
+ * thread is reached with Coro::onMain() (utils/coro.h), which is also where
+ * a coroutine returning Napi::Promise is defined.
+ */
+namespace threading {
+
+template <typename T = void> class Task;
+
+namespace detail {
+
+class TaskPromiseBase {
+public:
+  std::suspend_always initial_suspend() noexcept { return {}; }
+
+  // Hand the thread straight to the awaiter (symmetric transfer)
+  struct Final {
+    bool await_ready() noexcept { return false; }
+    template <typename P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+      auto next = h.promise().continuation;
+      return next ? next : std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+  };
+  Final final_suspend() noexcept { return {}; }
+
+  void unhandled_exception() { error = std::current_exception(); }
+
+  std::coroutine_handle<> continuation;
+  std::exception_ptr error;
+};
+
+template <typename T> class TaskPromise : public TaskPromiseBase {
+public:
+  Task<T> get_return_object();
+  void return_value(T v) { value.emplace(std::move(v)); }
+  T result() {
+    if (error)
+      std::rethrow_exception(error);
+    return std::move(*value);
+  }
+
+private:
+  std::optional<T> value;
+};
+
+template <> class TaskPromise<void> : public TaskPromiseBase {
+public:
+  Task<void> get_return_object();
+  void return_void() {}
+  void result() {
+    if (error)
+      std::rethrow_exception(error);
+  }
+};
+
+} // namespace detail
+
+template <typename T> class Task {
+public:
+  using promise_type = detail::TaskPromise<T>;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  explicit Task(Handle h) : h(h) {}
+  Task(Task &&other) noexcept : h(std::exchange(other.h, {})) {}
+  Task &operator=(Task &&other) noexcept {
+    if (this != &other) {
+      if (h)
+        h.destroy();
+      h = std::exchange(other.h, {});
+    }
+    return *this;
+  }
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+  ~Task() {
+    if (h)
+      h.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) {
+    h.promise().continuation = awaiter;
+    return h;
+  }
+  T await_resume() { return h.promise().result(); }
+
+private:
+  Handle h;
+};
+
+template <typename T> Task<T> detail::TaskPromise<T>::get_return_object() {
+  return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+inline Task<void> detail::TaskPromise<void>::get_return_object() {
+  return Task<void>(Task<void>::Handle::from_promise(*this));
+}
+
+/** co_await schedule(): resume on a worker of `pool` */
+class Schedule {
+public:
+  explicit Schedule(Pool &pool) : pool(pool) {}
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> h) {
+    pool.submit([h] { h.resume(); });
+  }
+  void await_resume() const noexcept {}
+
+private:
+  Pool &pool;
+};
+
+inline Schedule schedule(Pool &pool = Pool::global()) {
+  return Schedule(pool);
+}
+
+namespace detail {
+
+// Eager coroutine that frees itself, to drive a Task from plain code
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+template <typename T> struct SyncState {
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool done = false;
+  std::exception_ptr error;
+  std::optional<std::conditional_t<std::is_void_v<T>, char, T>> value;
+};
+
+template <typename T> Detached drive(Task<T> &task, SyncState<T> &state) {
+  try {
+    if constexpr (std::is_void_v<T>)
+      co_await task;
+    else
+      state.value.emplace(co_await task);
+  } catch (...) {
+    state.error = std::current_exception();
+  }
+  std::scoped_lock lock(state.mutex);
+  state.done = true;
+  state.cond.notify_all();
+}
+
+} // namespace detail
+
+/**
+ * Block the calling thread until `task` completes, for code outside any
+ * coroutine (benchmarks, tests). Never on the JS thread: a task that hops
+ * to it would wait forever.
+ */
+template <typename T> T sync_wait(Task<T> task) {
+  detail::SyncState<T> state;
+  detail::drive(task, state);
+  std::unique_lock lock(state.mutex);
+  state.cond.wait(lock, [&] { return state.done; });
+  if (state.error)
+    std::rethrow_exception(state.error);
+  if constexpr (!std::is_void_v<T>)
+    return std::move(*state.value);
+}
+
+} // namespace threading
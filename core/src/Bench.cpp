@@ -0,0 +1,133 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+// Probes for bench/napi.cjs: the parts of the runtime that only exist with
+// a live Node environment. Exported as `__bench__`, not part of the API.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <napi.h>
+
+#include "CoreObject.h"
+#include "Dispatcher.h"
+#include "utils/coro.h"
+#include "utils/napi-helper.h"
+
+using namespace Napi;
+
+static uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct DispatchRun {
+  DispatchRun(Napi::Env env, size_t total)
+      : deferred(Promise::Deferred::New(env)), latency(total),
+        remaining(total) {}
+  Promise::Deferred deferred;
+  std::vector<double> latency; // ns, from dispatch() to the task running
+  std::atomic<size_t> next{0}, remaining;
+};
+
+// dispatch(threads, perThread) -> Promise<Float64Array>
+// Every thread dispatches perThread stamped tasks at once; resolves with the
+// latency of each once the main thread has run them all.
+static FN(dispatch) {
+  auto env = info.Env();
+  JS_ASSERT_RET(info.Length() > 1 && info[0].IsNumber() && info[1].IsNumber(),
+                TypeError, "Expected (threads, perThread)", env.Undefined());
+  const uint32_t threads = info[0].As<Number>().Uint32Value();
+  const uint32_t per_thread = info[1].As<Number>().Uint32Value();
+  JS_ASSERT_RET(threads > 0 && threads <= 32 && per_thread > 0, RangeError,
+                "threads must be 1-32, perThread positive", env.Undefined());
+  auto run = std::make_shared<DispatchRun>(env, (size_t)threads * per_thread);
+  const auto promise = run->deferred.Promise();
+  const auto dispatcher = Dispatcher::handle(env);
+  // Until the last task ran: the threads do not keep the loop alive
+  Dispatcher::hold(dispatcher);
+  for (uint32_t t = 0; t < threads; t++)
+    std::thread([dispatcher, run, per_thread] {
+      for (uint32_t i = 0; i < per_thread; i++) {
+        const uint64_t stamp = now_ns();
+        Dispatcher::dispatch(dispatcher, [dispatcher, run,
+                                          stamp](Napi::Env env) {
+          run->latency[run->next++] = (double)(now_ns() - stamp);
+          if (--run->remaining > 0)
+            return;
+          Dispatcher::release(dispatcher);
+          auto out = Float64Array::New(env, run->latency.size());
+          std::copy(run->latency.begin(), run->latency.end(), out.Data());
+          run->deferred.Resolve(out);
+        });
+      }
+    }).detach();
+  return promise;
+}
+
+// The Counter of ExampleObject.cpp
+typedef std::shared_ptr<long> CounterPtr;
+template <>
+Napi::Value CreateObject<CounterPtr>(Napi::Env, const CounterPtr &) noexcept;
+
+// wrap(n, same = false) -> Float64Array
+// Creates and wraps n Counters from native code, without the JS call into
+// Counter.create(); returns the cost of CoreObject::Create() alone, in ns
+// per object. With `same`, every call wraps one core, so all but the first
+// are hits in the strict-identity cache.
+static FN(wrap) {
+  auto env = info.Env();
+  JS_ASSERT_RET(info.Length() > 0 && info[0].IsNumber(), TypeError,
+                "Expected (n, same?)", env.Undefined());
+  const uint32_t n = info[0].As<Number>().Uint32Value();
+  const bool same = info.Length() > 1 && info[1].ToBoolean();
+  auto latency = Float64Array::New(env, n);
+  const auto shared = std::make_shared<long>(0);
+  for (uint32_t i = 0; i < n; i++) {
+    HandleScope scope(env);
+    const auto core = same ? shared : std::make_shared<long>(i);
+    const uint64_t t = now_ns();
+    CreateObject(env, core);
+    latency[i] = (double)(now_ns() - t);
+  }
+  return latency;
+}
+
+// Round trips of a coroutine from the main thread to the pool and back
+static Promise hops(Napi::Env env, uint32_t n) {
+  std::vector<double> latency(n);
+  for (uint32_t i = 0; i < n; i++) {
+    const uint64_t t = now_ns();
+    co_await Coro::onPool();
+    co_await Coro::onMain();
+    latency[i] = (double)(now_ns() - t);
+  }
+  auto out = Float64Array::New(env, n);
+  std::copy(latency.begin(), latency.end(), out.Data());
+  co_return out;
+}
+
+// hop(n) -> Promise<Float64Array>
+// Resolves with the latency of each of n main -> pool -> main round trips
+// of one coroutine, in ns.
+static FN(hop) {
+  auto env = info.Env();
+  JS_ASSERT_RET(info.Length() > 0 && info[0].IsNumber(), TypeError,
+                "Expected (n)", env.Undefined());
+  return hops(env, info[0].As<Number>().Uint32Value());
+}
+
+void exportBench(Napi::Env env, Napi::Object &exports) {
+  auto bench = Object::New(env);
+  bench.Set("dispatch", Function::New(env, dispatch, "dispatch"));
+  bench.Set("wrap", Function::New(env, wrap, "wrap"));
+  bench.Set("hop", Function::New(env, hop, "hop"));
+  exports.DefineProperty(PropertyDescriptor::Value("__bench__", bench));
+}
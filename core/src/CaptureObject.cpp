@@ -0,0 +1,397 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <napi.h>
+
+#include "CaptureDecoder.h"
+#include "CaptureFile.h"
+#include "CaptureReceiver.h"
+#include "CoreObject.h"
+#include "Dispatcher.h"
+#include "threading/Pool.h"
+#include "utils/napi-helper.h"
+#include "utils/pool-worker.h"
+#include "utils/trace.h"
+
+using namespace Napi;
+
+class CaptureFileObject
+    : public CoreObject<CaptureFileObject, Capture::File::Ptr> {
+  CORE_OBJECT_DECL(CaptureFileObject);
+
+public:
+  using CoreObject::CoreObject;
+  static inline const std::string name = "CaptureFile";
+  static inline Function Init(Napi::Env env) {
+    auto fn = DefineClass(env, CaptureFileObject::name.c_str(),
+                          {CORE_OBJECT_REGISTER(CaptureFileObject, env), //
+                           INSTANCE_METHOD(CaptureFileObject, share),    //
+                           INSTANCE_GETTER(CaptureFileObject, path),     //
+                           INSTANCE_GETTER(CaptureFileObject, size)});
+    fn.Set("open", Function::New(env, CaptureFileObject::open));
+    fn.Set("adopt", Function::New(env, CaptureFileObject::adopt));
+    return fn;
+  }
+
+  static std::string describe(const CaptureFileObject *self) {
+    return self->core()->path();
+  }
+
+  // Map a segment file copied off the device's capture store
+  static FN(open) {
+    auto env = info.Env();
+    JS_ASSERT_RET(info.Length() > 0 && info[0].IsString(), TypeError,
+                  "Expected a path", env.Undefined());
+    const std::string path = info[0].As<Napi::String>();
+    JS_EXCEPT_RET(
+        {
+          return CaptureFileObject::Create(env, Capture::File::create(path));
+        },
+        env.Undefined());
+  }
+
+  // A token that CaptureFile.adopt() in any env of the process (e.g. a
+  // worker thread it is posted to) turns into the same mapping
+  FN(share) {
+    std::scoped_lock lock(shared_mutex);
+    std::erase_if(shared, [](const auto &e) { return e.second.expired(); });
+    shared.set(++last_token, std::weak_ptr<Capture::File>(core()));
+    return Napi::Number::New(env, (double)last_token);
+  }
+
+  // Read-only and uncopied, open until no env holds it any more
+  static FN(adopt) {
+    auto env = info.Env();
+    JS_ASSERT_RET(info.Length() > 0 && info[0].IsNumber(), TypeError,
+                  "Expected a token from CaptureFile.share()",
+                  env.Undefined());
+    const auto token = (uint64_t)info[0].As<Napi::Number>().Int64Value();
+    Capture::File::Ptr file;
+    {
+      std::scoped_lock lock(shared_mutex);
+      if (shared.has(token))
+        file = shared.get(token).lock();
+    }
+    JS_ASSERT_RET(file, Error, "CaptureFile no longer open", env.Undefined());
+    JS_EXCEPT_RET({ return CaptureFileObject::Create(env, file); },
+                  env.Undefined());
+  }
+
+  // The mapped file behind a JS CaptureFile, null for anything else
+  static Capture::File::Ptr from(const Napi::Value &value) {
+    if (!value.IsObject() ||
+        !value.As<Napi::Object>().InstanceOf(
+            getLocal(value.Env())->constructor.Value()))
+      return nullptr;
+    return Unwrap(value)->core();
+  }
+
+  GET(path) { return Napi::String::New(env, core()->path()); }
+  GET(size) { return Napi::Number::New(env, (double)core()->size()); }
+
+private:
+  // Shared across envs; weak, so a token keeps nothing open
+  static inline std::mutex shared_mutex;
+  static inline Map<uint64_t, std::weak_ptr<Capture::File>> shared;
+  static inline uint64_t last_token = 0;
+};
+
+CORE_OBJECT(Capture::File::Ptr, CaptureFileObject);
+
+class CaptureObject : public CoreObject<CaptureObject, Capture::Decoder::Ptr> {
+  CORE_OBJECT_DECL(CaptureObject);
+
+public:
+  using CoreObject::CoreObject;
+  static inline const std::string name = "CaptureDecoder";
+  static inline Function Init(Napi::Env env) {
+    auto fn = DefineClass(env, CaptureObject::name.c_str(),
+                          {CORE_OBJECT_REGISTER(CaptureObject, env), //
+                           INSTANCE_METHOD(CaptureObject, push),     //
+                           INSTANCE_METHOD(CaptureObject, pushFile), //
+                           INSTANCE_METHOD(CaptureObject, reset),    //
+                           INSTANCE_GETTER(CaptureObject, stats)});
+    fn.Set("create", Function::New(env, CaptureObject::create));
+    fn.Set("scan", Function::New(env, CaptureObject::scan));
+    return fn;
+  }
+
+  static FN(create) {
+    size_t max_frame = Capture::Decoder::DEFAULT_MAX_FRAME;
+    if (info.Length() > 0 && info[0].IsNumber())
+      max_frame = info[0].As<Napi::Number>().Uint32Value();
+    return CaptureObject::Create(info.Env(),
+                                 Capture::Decoder::create(max_frame));
+  }
+
+  static Napi::Object record(Napi::Env env, const Capture::Record &r) {
+    auto obj = Napi::Object::New(env);
+    obj.Set("seq", Napi::Number::New(env, r.seq));
+    obj.Set("time", Napi::Number::New(env, (double)r.time));
+    if (r.type == Capture::DATA) {
+      obj.Set("type", "data");
+      obj.Set("src", Napi::Number::New(env, r.src));
+      auto payload = Napi::Uint8Array::New(env, r.len);
+      std::memcpy(payload.Data(), r.payload, r.len);
+      obj.Set("payload", payload);
+    } else {
+      obj.Set("type", "sync");
+      obj.Set("records", Napi::Number::New(env, r.records));
+      obj.Set("filtered", Napi::Number::New(env, r.filtered));
+      obj.Set("dropped", Napi::Number::New(env, r.dropped));
+    }
+    return obj;
+  }
+
+  // Decode a chunk read from the capture interface, returns complete records
+  FN(push) {
+    TRACE_SPAN("CaptureDecoder::push");
+    JS_ASSERT_RET(info.Length() > 0 && info[0].IsTypedArray() &&
+                      info[0].As<Napi::TypedArray>().TypedArrayType() ==
+                          napi_uint8_array,
+                  TypeError, "Expected a Uint8Array", undefined());
+    auto data = info[0].As<Napi::Uint8Array>();
+    auto out = Napi::Array::New(env);
+    uint32_t n = 0;
+    core()->push(data.Data(), data.ByteLength(),
+                 [&](const Capture::Record &r) { out[n++] = record(env, r); });
+    return out;
+  }
+
+  // Decode (part of) a CaptureFile straight from its mapping, returns the
+  // complete records; a file continues where the previous chunk ended
+  FN(pushFile) {
+    TRACE_SPAN("CaptureDecoder::pushFile");
+    auto file = CaptureFileObject::from(info[0]);
+    JS_ASSERT_RET(file, TypeError, "Expected a CaptureFile", undefined());
+    size_t offset = 0, length = file->size();
+    if (info.Length() > 1 && info[1].IsNumber())
+      offset = (size_t)info[1].As<Napi::Number>().Int64Value();
+    JS_ASSERT_RET(offset <= file->size(), RangeError,
+                  "Offset beyond the end of the file", undefined());
+    length -= offset;
+    if (info.Length() > 2 && info[2].IsNumber())
+      length = std::min(length,
+                        (size_t)info[2].As<Napi::Number>().Int64Value());
+    auto out = Napi::Array::New(env);
+    uint32_t n = 0;
+    core()->push(
+        file->data() + offset, length,
+        [&](const Capture::Record &r) { out[n++] = record(env, r); },
+        Capture::Decoder::REPLAY);
+    return out;
+  }
+
+  FN(reset) {
+    core()->reset();
+    return undefined();
+  }
+
+  // Decode whole segments in parallel on the core pool, each with a decoder
+  // of its own; resolves with the statistics of each. Progress is in bytes.
+  static FN(scan) {
+    static constexpr size_t CHUNK = 1 << 20;
+    auto env = info.Env();
+    std::vector<Capture::File::Ptr> files;
+    if (info.Length() > 0 && info[0].IsArray()) {
+      auto list = info[0].As<Napi::Array>();
+      for (uint32_t i = 0; i < list.Length(); i++)
+        files.push_back(CaptureFileObject::from(list.Get(i)));
+    }
+    JS_ASSERT_RET(info.Length() > 0 && info[0].IsArray() &&
+                      std::find(files.begin(), files.end(), nullptr) ==
+                          files.end(),
+                  TypeError, "Expected an array of CaptureFile",
+                  env.Undefined());
+    using Decoders = std::vector<Capture::Decoder::Ptr>;
+    auto work = [files](PoolJob &job) {
+      Decoders out(files.size());
+      double total = 0;
+      for (const auto &file : files)
+        total += (double)file->size();
+      std::atomic<size_t> done{0};
+      threading::parallel_for(
+          0, files.size(), 1,
+          [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; i++) {
+              const auto &file = files[i];
+              auto decoder = Capture::Decoder::create();
+              for (size_t at = 0; at < file->size(); at += CHUNK) {
+                job.token.check();
+                const size_t n = std::min(CHUNK, file->size() - at);
+                decoder->push(file->data() + at, n,
+                              [](const Capture::Record &) {},
+                              Capture::Decoder::REPLAY);
+                job.progress((double)(done += n), total);
+              }
+              out[i] = decoder;
+            }
+          },
+          job.token);
+      return out;
+    };
+    auto resolve = [](Napi::Env env, Decoders &decoders) -> Napi::Value {
+      auto out = Napi::Array::New(env, decoders.size());
+      for (uint32_t i = 0; i < decoders.size(); i++)
+        out[i] = statistics(env, decoders[i]->statistics(),
+                            decoders[i]->device());
+      return out;
+    };
+    return PoolWorker<Decoders>::run(env, work, resolve,
+                                     info.Length() > 1 ? info[1]
+                                                       : env.Undefined());
+  }
+
+  static Napi::Value device(Napi::Env env, const Capture::DevicePerf &d) {
+    if (!d.valid)
+      return env.Null();
+    auto obj = Napi::Object::New(env);
+    obj.Set("uptime", Napi::Number::New(env, d.uptime_ms));
+    obj.Set("tudLoops", Napi::Number::New(env, d.tud_loops));
+    obj.Set("tudLoopRate", Napi::Number::New(env, d.tud_loop_rate));
+    auto ports = Napi::Array::New(env, d.ports.size());
+    for (uint32_t i = 0; i < d.ports.size(); i++) {
+      const auto &p = d.ports[i];
+      auto port = Napi::Object::New(env);
+      port.Set("rxBytes", Napi::Number::New(env, p.rx_bytes));
+      port.Set("rxChunks", Napi::Number::New(env, p.rx_chunks));
+      port.Set("txBytes", Napi::Number::New(env, p.tx_bytes));
+      port.Set("txChunks", Napi::Number::New(env, p.tx_chunks));
+      port.Set("txFull", Napi::Number::New(env, p.tx_full));
+      port.Set("rxFifoPeak", Napi::Number::New(env, p.rx_fifo_hwm));
+      port.Set("txFifoPeak", Napi::Number::New(env, p.tx_fifo_hwm));
+      port.Set("rxRate", Napi::Number::New(env, p.rx_rate));
+      port.Set("txRate", Napi::Number::New(env, p.tx_rate));
+      auto latency = Napi::Object::New(env);
+      latency.Set("min", Napi::Number::New(env, p.latency_min));
+      latency.Set("max", Napi::Number::New(env, p.latency_max));
+      latency.Set("avg", Napi::Number::New(
+                             env, p.latency_count ? (double)p.latency_total /
+                                                        p.latency_count
+                                                  : 0));
+      latency.Set("count", Napi::Number::New(env, p.latency_count));
+      port.Set("latency", latency);
+      ports[i] = port;
+    }
+    obj.Set("ports", ports);
+    return obj;
+  }
+
+  static Napi::Object statistics(Napi::Env env, const Capture::Stats &s,
+                                 const Capture::DevicePerf &d) {
+    auto obj = Napi::Object::New(env);
+    obj.Set("records", Napi::Number::New(env, (double)s.records));
+    obj.Set("bytes", Napi::Number::New(env, (double)s.bytes));
+    obj.Set("gaps", Napi::Number::New(env, (double)s.gaps));
+    obj.Set("lost", Napi::Number::New(env, (double)s.lost));
+    obj.Set("corrupt", Napi::Number::New(env, (double)s.corrupt));
+    obj.Set("resets", Napi::Number::New(env, (double)s.resets));
+    obj.Set("compressed", Napi::Number::New(env, (double)s.compressed));
+    obj.Set("inflated", Napi::Number::New(env, (double)s.inflated));
+    obj.Set("stale", Napi::Number::New(env, (double)s.stale));
+    obj.Set("device", device(env, d));
+    return obj;
+  }
+
+  GET(stats) {
+    return statistics(env, core()->statistics(), core()->device());
+  }
+};
+
+CORE_OBJECT(Capture::Decoder::Ptr, CaptureObject);
+
+class CaptureReceiverObject
+    : public CoreObject<CaptureReceiverObject, Capture::Receiver::Ptr> {
+  CORE_OBJECT_DECL(CaptureReceiverObject);
+
+public:
+  using CoreObject::CoreObject;
+  static inline const std::string name = "CaptureReceiver";
+  static inline Function Init(Napi::Env env) {
+    auto fn = DefineClass(env, CaptureReceiverObject::name.c_str(),
+                          {CORE_OBJECT_REGISTER(CaptureReceiverObject, env), //
+                           INSTANCE_METHOD(CaptureReceiverObject, close),    //
+                           INSTANCE_GETTER(CaptureReceiverObject, port),     //
+                           INSTANCE_GETTER(CaptureReceiverObject, stats)});
+    fn.Set("create", Function::New(env, CaptureReceiverObject::create));
+    return fn;
+  }
+
+  // Records arrive on the receive thread in batches; each batch becomes one
+  // callback on the main thread
+  static FN(create) {
+    auto env = info.Env();
+    JS_ASSERT_RET(info.Length() > 0 && info[0].IsFunction(), TypeError,
+                  "Expected a callback", env.Undefined());
+    Capture::Receiver::Options options;
+    if (info.Length() > 1 && info[1].IsObject()) {
+      auto opts = info[1].As<Napi::Object>();
+      if (opts.Get("device").IsString())
+        options.device = opts.Get("device").As<Napi::String>();
+      if (opts.Get("port").IsNumber())
+        options.port = opts.Get("port").As<Napi::Number>().Uint32Value();
+      if (opts.Get("localPort").IsNumber())
+        options.local_port =
+            opts.Get("localPort").As<Napi::Number>().Uint32Value();
+    }
+    auto listener = std::make_shared<Napi::FunctionReference>(
+        Napi::Persistent(info[0].As<Napi::Function>()));
+    // Keeps the process alive while receiving, as an open socket would;
+    // released with the callback when the receiver closes
+    const auto dispatcher = Dispatcher::handle(env);
+    Dispatcher::hold(dispatcher);
+    auto hold = std::shared_ptr<void>(nullptr, [dispatcher](void *) {
+      Dispatcher::release(dispatcher);
+    });
+    auto deliver = [dispatcher, listener,
+                    hold](Capture::Receiver::Batch &&batch) {
+      auto records =
+          std::make_shared<Capture::Receiver::Batch>(std::move(batch));
+      Dispatcher::dispatch(dispatcher, [listener, records](Napi::Env env) {
+        TRACE_SPAN("CaptureReceiver::callback");
+        auto out = Napi::Array::New(env, records->records.size());
+        for (uint32_t i = 0; i < records->records.size(); i++)
+          out[i] = CaptureObject::record(env, records->records[i]);
+        listener->Call({out});
+      });
+    };
+    JS_EXCEPT_RET(
+        {
+          return CaptureReceiverObject::Create(
+              env, Capture::Receiver::create(deliver, options));
+        },
+        env.Undefined());
+  }
+
+  static std::string describe(const CaptureReceiverObject *self) {
+    return self->core()->closed() ? "closed" : "receiving";
+  }
+
+  // Batches already received may still be delivered afterwards
+  FN(close) {
+    core()->close();
+    return undefined();
+  }
+
+  GET(port) { return Napi::Number::New(env, core()->localPort()); }
+
+  GET(stats) {
+    const auto &receiver = core();
+    auto obj = CaptureObject::statistics(env, receiver->statistics(),
+                                         receiver->device());
+    obj.Set("datagrams", Napi::Number::New(env, (double)receiver->datagrams()));
+    obj.Set("truncated", Napi::Number::New(env, (double)receiver->truncated()));
+    return obj;
+  }
+};
+
+CORE_OBJECT(Capture::Receiver::Ptr, CaptureReceiverObject);
@@ -0,0 +1,82 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#include <napi.h>
+
+#include "ClockModel.h"
+#include "CoreObject.h"
+#include "utils/napi-helper.h"
+
+using namespace Napi;
+
+class ClockObject : public CoreObject<ClockObject, ClockModel::Ptr> {
+  CORE_OBJECT_DECL(ClockObject);
+
+public:
+  using CoreObject::CoreObject;
+  static inline const std::string name = "Clock";
+  static inline Function Init(Napi::Env env) {
+    auto fn = DefineClass(env, ClockObject::name.c_str(),
+                          {CORE_OBJECT_REGISTER(ClockObject, env),   //
+                           INSTANCE_METHOD(ClockObject, sample),     //
+                           INSTANCE_METHOD(ClockObject, toHost),     //
+                           INSTANCE_METHOD(ClockObject, toDevice),   //
+                           INSTANCE_GETTER(ClockObject, offset),     //
+                           INSTANCE_GETTER(ClockObject, drift),      //
+                           INSTANCE_GETTER(ClockObject, error),      //
+                           INSTANCE_GETTER(ClockObject, bound),      //
+                           INSTANCE_GETTER(ClockObject, samples)});
+    fn.Set("create", Function::New(env, ClockObject::create));
+    fn.Set("now", Function::New(env, ClockObject::now));
+    return fn;
+  }
+
+  static FN(create) {
+    return ClockObject::Create(info.Env(), ClockModel::create());
+  }
+
+  static FN(now) { return Napi::Number::New(info.Env(), ClockModel::now()); }
+
+  static std::string describe(const ClockObject *self) {
+    auto &model = *self->core();
+    if (!model.synced())
+      return "unsynced";
+    std::stringstream ss;
+    ss << model.drift() << " ppm, +/- " << model.error() << " us";
+    return ss.str();
+  }
+
+  FN(sample) {
+    JS_ASSERT_RET(info.Length() >= 3 && info[0].IsNumber() &&
+                      info[1].IsNumber() && info[2].IsNumber(),
+                  TypeError, "Expected sample(t0, device, t3)", undefined());
+    return Napi::Boolean::New(
+        env, core()->sample(info[0].As<Napi::Number>().DoubleValue(),
+                            info[1].As<Napi::Number>().DoubleValue(),
+                            info[2].As<Napi::Number>().DoubleValue()));
+  }
+
+  FN(toHost) {
+    JS_ASSERT_RET(info.Length() > 0 && info[0].IsNumber(), TypeError,
+                  "Device time must be a number", undefined());
+    return Napi::Number::New(
+        env, core()->toHost(info[0].As<Napi::Number>().DoubleValue()));
+  }
+
+  FN(toDevice) {
+    JS_ASSERT_RET(info.Length() > 0 && info[0].IsNumber(), TypeError,
+                  "Host time must be a number", undefined());
+    return Napi::Number::New(
+        env, core()->toDevice(info[0].As<Napi::Number>().DoubleValue()));
+  }
+
+  GET(offset) { return Napi::Number::New(env, core()->offset()); }
+  GET(drift) { return Napi::Number::New(env, core()->drift()); }
+  GET(error) { return Napi::Number::New(env, core()->error()); }
+  GET(bound) { return Napi::Number::New(env, core()->bound()); }
+  GET(samples) { return Napi::Number::New(env, (double)core()->samples()); }
+};
+
+CORE_OBJECT(ClockModel::Ptr, ClockObject);
@@ -3,49 +3,69 @@
 // This source code is licensed under the MIT license.
 // You may find the full license in project root directory.
 // -------------------------------------------------------
+#include <chrono>
 #include <deque>
 #include <mutex>
 #include <stdexcept>
+#include <thread>
 
 #include "Dispatcher.h"
+#include "Metrics.h"
 
+#include "utils/log.h"
 #include "utils/map-set.h"
 #include "utils/napi-helper.h"
+#include "utils/trace.h"
 #include "uv.h"
 
 namespace Dispatcher {
 
-class Dispatcher {
+class Dispatcher : public std::enable_shared_from_this<Dispatcher> {
 public:
   typedef std::shared_ptr<Dispatcher> Ptr;
   static inline Ptr create(Napi::Env env) {
     return std::make_shared<Dispatcher>(env);
   }
   static void onAsync(uv_async_t *handle);
+  static void onClose(uv_handle_t *handle);
   Dispatcher(Napi::Env env);
-  ~Dispatcher();
   Task getNextTask();
   void updateRef();
-  inline void notify() { uv_async_send(&async); }
-  inline bool isClosing() {
-    return uv_is_closing(reinterpret_cast<uv_handle_t *>(&async));
-  }
+  void close(napi_async_cleanup_hook_handle hook);
 
   Napi::Env env;
+  const std::thread::id thread = std::this_thread::get_id();
   bool active = true;
   bool referenced = true; // uv handle is referenced by default
   uv_loop_t *loop = nullptr;
   uv_async_t async;
   std::mutex mutex;
-  std::deque<Task> queue;
+  // Tasks with the time they were dispatched, for the latency metric
+  std::deque<std::pair<Task, uint64_t>> queue;
+  // Outstanding work that will dispatch back, see hold()
+  size_t holds = 0;
+  // Set by close(): keeps the uv handle alive until libuv is done with it
+  Ptr closing;
+  napi_async_cleanup_hook_handle hook = nullptr;
 };
 
+static uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static auto &tasks = Metrics::counter("dispatch.tasks");
+static auto &depth = Metrics::gauge("dispatch.queue_depth");
+static auto &latency = Metrics::histogram("dispatch.latency_ns");
+
 static std::mutex registry_mutex;
 static Map<napi_env, Dispatcher::Ptr> registry;
 
 void Dispatcher::onAsync(uv_async_t *handle) {
   const auto self = static_cast<Dispatcher *>(handle->data);
   auto &env = self->env;
+  TRACE_SPAN("Dispatcher::onAsync");
   // Main thread: run queued tasks with proper N-API scopes
   Napi::HandleScope hs(env);
   for (;;) {
@@ -68,72 +88,164 @@ Dispatcher::Dispatcher(Napi::Env env) : env(env) {
   updateRef();
 }
 
-Dispatcher::~Dispatcher() {
+// Main thread, at env teardown. Tasks still queued are dropped; `active`
+// turns false under the mutex, so no thread touches the handle after it.
+void Dispatcher::close(napi_async_cleanup_hook_handle hook) {
+  std::deque<std::pair<Task, uint64_t>> dropped;
   {
     std::lock_guard<std::mutex> lock(mutex);
     active = false;
-    queue.clear();
+    depth.sub((int64_t)queue.size());
+    dropped.swap(queue);
   }
-  updateRef();
+  if (!dropped.empty())
+    LOG_DEBUG("dispatch", "%zu tasks dropped at env teardown",
+              dropped.size());
+  // Destroyed outside the mutex: what they own may dispatch in turn
+  dropped.clear();
+  this->hook = hook;
+  closing = shared_from_this();
+  uv_close(reinterpret_cast<uv_handle_t *>(&async), onClose);
+}
+
+void Dispatcher::onClose(uv_handle_t *handle) {
+  const auto self = static_cast<Dispatcher *>(handle->data);
+  const auto hook = self->hook;
+  self->closing.reset();
+  // Lets the env (a worker's) finish tearing down its loop
+  napi_remove_async_cleanup_hook(hook);
 }
 
 Task Dispatcher::getNextTask() {
   Task out = nullptr;
+  uint64_t stamp = 0;
   {
     std::lock_guard<std::mutex> lock(mutex);
     if (active && !queue.empty()) {
-      out = std::move(queue.front());
+      out = std::move(queue.front().first);
+      stamp = queue.front().second;
       queue.pop_front();
+      depth.sub();
     }
   }
+  if (out)
+    latency.record(now_ns() - stamp);
   return out;
 }
 
+// Main thread only, as every use of the uv handle but uv_async_send:
+// references it while work is held or tasks wait for the next onAsync
 void Dispatcher::updateRef() {
   auto handle = reinterpret_cast<uv_handle_t *>(&async);
-  if (isClosing())
-    return;
   std::scoped_lock lock(mutex);
-  if (!referenced && !queue.empty()) {
+  if (!active)
+    return;
+  const bool busy = holds > 0 || !queue.empty();
+  if (!referenced && busy) {
     uv_ref(handle);
     referenced = true;
-  } else if (referenced && (queue.empty() || !active)) {
+  } else if (referenced && !busy) {
     uv_unref(handle);
     referenced = false;
   }
 }
 
-Dispatcher::Ptr get(Napi::Env env) {
+Handle handle(Napi::Env env) {
   std::scoped_lock lock(registry_mutex);
-  if (!registry.has(env))
-    throw JS::Error(env, "Dispatcher not initialized for this env");
-  return registry.get(env);
+  return registry.has(env) ? registry.get(env) : nullptr;
 }
 
-void dispatch(Napi::Env env, Task task) {
-  auto dispatcher = get(env);
+void dispatch(const Handle &dispatcher, Task task) {
+  TRACE_SPAN("Dispatcher::dispatch");
+  if (Trace::active()) {
+    // Arrow from here to where the task runs on the main thread
+    const uint64_t id = Trace::flow_id();
+    TRACE_FLOW_BEGIN("Dispatcher::task", id);
+    task = [id, task = std::move(task)](Napi::Env env) {
+      TRACE_SPAN("Dispatcher::task");
+      TRACE_FLOW_END("Dispatcher::task", id);
+      task(env);
+    };
+  }
+  if (!dispatcher) {
+    LOG_DEBUG("dispatch", "Task without a dispatcher, dropped");
+    return;
+  }
   {
     std::lock_guard<std::mutex> lock(dispatcher->mutex);
-    if (!dispatcher->active)
+    if (dispatcher->active) {
+      dispatcher->queue.emplace_back(std::move(task), now_ns());
+      // With the push: getNextTask() cannot take the task off the gauge
+      // first
+      tasks.add();
+      depth.add();
+      // Under the mutex: close() cannot have started
+      uv_async_send(&dispatcher->async);
       return;
-    dispatcher->queue.push_back(std::move(task));
+    }
+  }
+  // Destroyed here, outside the mutex, as in close()
+  LOG_DEBUG("dispatch", "Task for an env torn down, dropped");
+  task = nullptr;
+}
+
+void hold(const Handle &dispatcher) {
+  if (!dispatcher)
+    return;
+  {
+    std::scoped_lock lock(dispatcher->mutex);
+    dispatcher->holds++;
   }
   dispatcher->updateRef();
-  dispatcher->notify();
 }
 
-void cleanup(napi_env env) {
-  std::scoped_lock lock(registry_mutex);
-  if (registry.has(env))
-    registry.erase(env);
+void release(const Handle &dispatcher) {
+  if (!dispatcher)
+    return;
+  if (!onThread(dispatcher)) {
+    // Dropped along with the task once the env is torn down
+    dispatch(dispatcher, [dispatcher](Napi::Env) { release(dispatcher); });
+    return;
+  }
+  {
+    std::scoped_lock lock(dispatcher->mutex);
+    dispatcher->holds--;
+  }
+  dispatcher->updateRef();
 }
 
+bool onThread(const Handle &dispatcher) {
+  return dispatcher && dispatcher->thread == std::this_thread::get_id();
+}
+
+// Async hook: the env, a worker's in particular, waits for the handle to
+// close before it tears down the loop
+static void cleanup(napi_async_cleanup_hook_handle hook, void *arg) {
+  const auto env = static_cast<napi_env>(arg);
+  Dispatcher::Ptr dispatcher;
+  {
+    std::scoped_lock lock(registry_mutex);
+    if (registry.has(env)) {
+      dispatcher = registry.get(env);
+      registry.erase(env);
+    }
+  }
+  if (dispatcher)
+    dispatcher->close(hook);
+  else
+    napi_remove_async_cleanup_hook(hook);
+}
+
+// Once per env: the main thread and every worker thread loading the addon
+// each get their own. Loading it again into the same env is a no-op.
 void init(Napi::Env &env) {
   std::scoped_lock lock(registry_mutex);
   if (registry.has(env))
-    throw JS::Error(env, "Dispatcher already initialized for this env");
+    return;
   registry.set(env, Dispatcher::create(env));
-  env.AddCleanupHook(cleanup, static_cast<napi_env>(env));
+  if (napi_add_async_cleanup_hook(env, cleanup, static_cast<napi_env>(env),
+                                  nullptr) != napi_ok)
+    throw JS::Error(env, "Failed to add Dispatcher cleanup hook");
 }
 
 } // namespace Dispatcher
@@ -0,0 +1,57 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+// `log`: runtime control of the native logger in utils/log.h
+
+#include <napi.h>
+
+#include "utils/log.h"
+#include "utils/napi-helper.h"
+
+using namespace Napi;
+
+// setLevel(level, category = "*")
+static FN(setLevel) {
+  auto env = info.Env();
+  Log::Level level;
+  JS_ASSERT_RET(info.Length() > 0 && info[0].IsString() &&
+                    Log::parse_level(info[0].As<String>().Utf8Value(), level),
+                TypeError,
+                "Expected a level: trace, debug, info, warn, error or off",
+                env.Undefined());
+  std::string category = "*";
+  if (info.Length() > 1 && info[1].IsString())
+    category = info[1].As<String>().Utf8Value();
+  Log::Logger::get().set_level(category, level);
+  return env.Undefined();
+}
+
+// { "*": default level, [category]: level }
+static FN(levels) {
+  auto env = info.Env();
+  auto out = Object::New(env);
+  for (const auto &[name, level] : Log::Logger::get().levels())
+    out.Set(name, Log::level_name(level));
+  return out;
+}
+
+static FN(flush) {
+  Log::Logger::get().flush();
+  return info.Env().Undefined();
+}
+
+static FN(dropped) {
+  return Number::New(info.Env(),
+                     (double)Log::Logger::get().dropped_records());
+}
+
+void exportLog(Napi::Env env, Napi::Object &exports) {
+  auto log = Object::New(env);
+  log.Set("setLevel", Function::New(env, setLevel, "setLevel"));
+  log.Set("levels", Function::New(env, levels, "levels"));
+  log.Set("flush", Function::New(env, flush, "flush"));
+  log.Set("dropped", Function::New(env, dropped, "dropped"));
+  exports.Set("log", log);
+}
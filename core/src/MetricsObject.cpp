@@ -0,0 +1,106 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+#include <cstring>
+
+#include <napi.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#endif
+
+#include "CoreObject.h"
+#include "Metrics.h"
+#include "utils/napi-helper.h"
+
+using namespace Napi;
+
+// Native heap as the allocator sees it; V8's heap is in process.memoryUsage()
+static void registerAllocator(Metrics::Registry &registry) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  registry.sampled("heap.in_use_bytes",
+                   [] { return (double)mallinfo2().uordblks; });
+  registry.sampled("heap.mapped_bytes", [] {
+    const auto m = mallinfo2();
+    return (double)(m.arena + m.hblkhd);
+  });
+#elif defined(__APPLE__)
+  registry.sampled("heap.in_use_bytes", [] {
+    malloc_statistics_t s;
+    malloc_zone_statistics(nullptr, &s);
+    return (double)s.size_in_use;
+  });
+  registry.sampled("heap.mapped_bytes", [] {
+    malloc_statistics_t s;
+    malloc_zone_statistics(nullptr, &s);
+    return (double)s.size_allocated;
+  });
+#else
+  (void)registry;
+#endif
+}
+
+class MetricsObject : public CoreObject<MetricsObject, Metrics::Registry::Ptr> {
+  CORE_OBJECT_DECL(MetricsObject);
+
+public:
+  using CoreObject::CoreObject;
+  static inline const std::string name = "Metrics";
+  static inline Function Init(Napi::Env env) {
+    auto fn = DefineClass(env, MetricsObject::name.c_str(),
+                          {CORE_OBJECT_REGISTER(MetricsObject, env),     //
+                           INSTANCE_METHOD(MetricsObject, snapshot),     //
+                           INSTANCE_GETTER(MetricsObject, names),        //
+                           INSTANCE_GETTER(MetricsObject, generation)});
+    fn.Set("global", Function::New(env, MetricsObject::global));
+    static const bool registered =
+        (registerAllocator(*Metrics::Registry::global()), true);
+    (void)registered;
+    return fn;
+  }
+
+  // The process-wide registry every native metric lives in
+  static FN(global) {
+    return MetricsObject::Create(info.Env(), Metrics::Registry::global());
+  }
+
+  static std::string describe(const MetricsObject *self) {
+    return std::to_string(self->core()->size()) + " slots";
+  }
+
+  // Every metric in one Float64Array, laid out as `names`; pass the array
+  // of the previous call to have it refilled instead of a new one
+  FN(snapshot) {
+    const auto &registry = core();
+    if (info.Length() > 0 && info[0].IsTypedArray() &&
+        info[0].As<TypedArray>().TypedArrayType() == napi_float64_array) {
+      auto out = info[0].As<Float64Array>();
+      if (registry->snapshot(out.Data(), out.ElementLength()) ==
+          out.ElementLength())
+        return out;
+    }
+    // First call, or the layout grew since
+    for (;;) {
+      const size_t n = registry->size();
+      auto out = Float64Array::New(env, n);
+      if (registry->snapshot(out.Data(), n) == n)
+        return out;
+    }
+  }
+
+  GET(names) {
+    const auto names = core()->names();
+    auto out = Napi::Array::New(env, names.size());
+    for (uint32_t i = 0; i < names.size(); i++)
+      out[i] = Napi::String::New(env, names[i]);
+    return out;
+  }
+
+  GET(generation) { return Napi::Number::New(env, core()->generation()); }
+};
+
+CORE_OBJECT(Metrics::Registry::Ptr, MetricsObject);
@@ -0,0 +1,39 @@
+// ------------------------------------------------------
+// Copyright (c) 2025 Yuxuan Zhang
+// This source code is licensed under the MIT license.
+// You may find the full license in project root directory.
+// -------------------------------------------------------
+// `trace`: control of the native tracing in utils/trace.h. dump() returns
+// Chrome trace_event JSON, to be saved and opened in Perfetto next to a
+// renderer profile.
+
+#include <napi.h>
+
+#include "utils/napi-helper.h"
+#include "utils/trace.h"
+
+using namespace Napi;
+
+static FN(start) {
+  Trace::start();
+  return info.Env().Undefined();
+}
+
+static FN(stop) {
+  Trace::stop();
+  return info.Env().Undefined();
+}
+
+static FN(dump) { return String::New(info.Env(), Trace::json()); }
+
+static FN(active) { return Boolean::New(info.Env(), Trace::active()); }
+
+void exportTrace(Napi::Env env, Napi::Object &exports) {
+  auto trace = Object::New(env);
+  trace.Set("start", Function::New(env, start, "start"));
+  trace.Set("stop", Function::New(env, stop, "stop"));
+  trace.Set("dump", Function::New(env, dump, "dump"));
+  trace.Set("active", Function::New(env, active, "active"));
+  trace.Set("enabled", Boolean::New(env, CORE_TRACE != 0));
+  exports.Set("trace", trace);
+}
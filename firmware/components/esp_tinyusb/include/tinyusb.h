@@ -173,6 +173,14 @@ esp_err_t tinyusb_driver_install(const tinyusb_config_t *config);
  */
 esp_err_t tinyusb_driver_uninstall(void);
 
+/**
+ * @brief Called by the TinyUSB task after every tud_task() pass
+ *
+ * Weak no-op by default; applications may override it to instrument the
+ * task. Runs in the TinyUSB task, must not block.
+ */
+void tinyusb_task_loop_hook(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,6 +26,8 @@ extern "C" {
 typedef enum {
     TINYUSB_CDC_ACM_0 = 0x0,
     TINYUSB_CDC_ACM_1,
+    TINYUSB_CDC_ACM_2,
+    TINYUSB_CDC_ACM_3,
     TINYUSB_CDC_ACM_MAX
 } tinyusb_cdcacm_itf_t;
 
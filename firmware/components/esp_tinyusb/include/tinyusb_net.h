@@ -82,15 +82,18 @@ esp_err_t tinyusb_net_send_sync(void *buffer, uint16_t len, void *buff_free_arg,
  * @brief TinyUSB NET driver send data asynchronously
  *
  * @note If using asynchronous sends, you must free the buffer using free_tx_buffer() callback.
- * @note It is possible to use sync and async send interchangeably.
- * @note Async flavor of the send is useful when the USB stack runs faster than the caller,
- * since we have no control over the transmitted packets, if they get accepted or discarded.
+ * @note It is possible to use sync and async send interchangeably; async packets keep their
+ * order among themselves, not relative to sync sends.
+ * @note The packet is queued without allocating (CONFIG_TINYUSB_NET_TX_QUEUE_LEN preallocated
+ * descriptors) and waits there until TinyUSB has a free transmit buffer for it. The buffer must
+ * stay valid until free_tx_buffer() is called.
  *
  * @param[in] buffer            USB send data
  * @param[in] len               Send data len
  * @param[in] buff_free_arg     Pointer to be passed to the free_tx_buffer() callback
- * @return  ESP_OK on success == packet has been consumed by tusb and will be freed
+ * @return  ESP_OK on success == packet has been queued and will be freed
  *                              by free_tx_buffer() callback (if non null)
+ *          ESP_ERR_NO_MEM if the transmit queue is full, the buffer stays with the caller
  *          ESP_ERR_INVALID_STATE if tusb not initialized
  */
 esp_err_t tinyusb_net_send_async(void *buffer, uint16_t len, void *buff_free_arg);
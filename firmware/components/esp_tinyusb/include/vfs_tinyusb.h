@@ -22,6 +22,12 @@ extern "C" {
  * Know limitation:
  * In case there are multiple CDC interfaces in the system, only one of them can be registered to VFS.
  *
+ * The file is opened in blocking mode unless O_NONBLOCK is given (or set with fcntl()):
+ * read() waits for data, write() waits for TX FIFO space while a host is connected, for
+ * up to 100 ms. Once a write has timed out, writes no longer wait until the host reads
+ * again. Writes from the TinyUSB task never wait.
+ * select() is supported with CONFIG_VFS_SUPPORT_SELECT.
+ *
  * @param[in] cdc_intf Interface number of TinyUSB's CDC
  * @param[in] path     Path where the CDC will be registered, `/dev/tusb_cdc` will be used if left NULL.
  * @return esp_err_t ESP_OK or ESP_FAIL
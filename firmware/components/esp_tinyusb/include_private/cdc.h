@@ -72,6 +72,16 @@ esp_err_t tinyusb_cdc_deinit(int itf);
  * @return esp_tusb_cdc_t* pointer to the interface or (NULL) on error
  */
 esp_tusb_cdc_t *tinyusb_cdc_get_intf(int itf_num);
+
+/**
+ * @brief Notify the VFS driver of CDC events, called from the TinyUSB task
+ *
+ * Weak no-ops unless vfs_tinyusb.c is linked in.
+ *
+ * @param itf - number of a CDC object
+ */
+void tinyusb_cdc_vfs_rx(int itf);
+void tinyusb_cdc_vfs_tx_done(int itf);
 /*********************************************************************** Functions*/
 
 #ifdef __cplusplus
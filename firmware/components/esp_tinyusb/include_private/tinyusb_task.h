@@ -55,6 +55,20 @@ esp_err_t tinyusb_task_start(tinyusb_port_t port, const tinyusb_task_config_t *t
  */
 esp_err_t tinyusb_task_stop(void);
 
+/**
+ * @brief Whether the calling task is the TinyUSB task, which must never wait for USB transfers
+ */
+bool tinyusb_task_is_current(void);
+
+/**
+ * @brief Retry packets waiting in the asynchronous NET transmit queue
+ *
+ * Called by the TinyUSB task after every pass of tud_task(), that is after every USB event,
+ * which includes the completion of a transmit buffer. Weak no-op unless tinyusb_net.c is
+ * linked in.
+ */
+void tinyusb_net_tx_resume(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,6 +7,7 @@
 #include "soc/soc_caps.h"
 #if SOC_USB_OTG_SUPPORTED
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
 #include "esp_system.h"
@@ -117,6 +118,9 @@ TEST_CASE("tinyusb_cdc", "[esp_tinyusb][cdc]")
     esp_vfs_tusb_cdc_set_tx_line_endings(ESP_LINE_ENDINGS_LF);
     FILE *cdc = fopen(VFS_PATH, "r+");
     TEST_ASSERT_NOT_NULL(cdc);
+    // Polled below, between reads of CDC 0: fread() must not wait for data
+    const int fd = fileno(cdc);
+    TEST_ASSERT_EQUAL(0, fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK));
 
     uint8_t buf[CONFIG_TINYUSB_CDC_RX_BUFSIZE + 1];
     while (true) {
@@ -85,9 +85,21 @@ void tud_cdc_line_state_cb(uint8_t itf, bool dtr, bool rts)
     }
 }
 
+// Overridden by vfs_tinyusb.c when it is built
+__attribute__((weak)) void tinyusb_cdc_vfs_rx(int itf)
+{
+    (void) itf;
+}
+
+__attribute__((weak)) void tinyusb_cdc_vfs_tx_done(int itf)
+{
+    (void) itf;
+}
+
 /* Invoked when CDC interface received data from host */
 void tud_cdc_rx_cb(uint8_t itf)
 {
+    tinyusb_cdc_vfs_rx(itf);
     esp_tusb_cdcacm_t *acm = get_acm(itf);
     if (acm) {
         CDC_ACM_ENTER_CRITICAL();
@@ -102,6 +114,12 @@ void tud_cdc_rx_cb(uint8_t itf)
     }
 }
 
+/* Invoked when a transfer to the host completed and TX FIFO space is free */
+void tud_cdc_tx_complete_cb(uint8_t itf)
+{
+    tinyusb_cdc_vfs_tx_done(itf);
+}
+
 // Invoked when line coding is change via SET_LINE_CODING
 void tud_cdc_line_coding_cb(uint8_t itf, cdc_line_coding_t const *p_line_coding)
 {
@@ -5,12 +5,15 @@
  */
 
 #include <string.h>
+#include <sys/param.h>
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_check.h"
 #include "esp_vfs_fat.h"
 #include "esp_partition.h"
 #include "esp_memory_utils.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "soc/soc_caps.h"
 #include "sdkconfig.h"
 #include "vfs_fat_internal.h"
@@ -30,25 +33,46 @@
 static const char *TAG = "tinyusb_msc_storage";
 
 #define MSC_STORAGE_MEM_ALIGN 4
-#define MSC_STORAGE_BUFFER_SIZE CONFIG_TINYUSB_MSC_BUFSIZE /*!< Size of the buffer, configured via menuconfig (MSC FIFO size) */
+#define MSC_STORAGE_BLOCK_SIZE CONFIG_TINYUSB_MSC_BLOCK_SIZE            /*!< Size of a write queue slot / read cache line, configured via menuconfig */
+#define MSC_STORAGE_WRITE_SLOTS CONFIG_TINYUSB_MSC_WRITE_SLOTS          /*!< Number of blocks the write queue holds */
+#define MSC_STORAGE_READ_BLOCKS CONFIG_TINYUSB_MSC_READ_CACHE_BLOCKS    /*!< Number of blocks the read cache holds */
 
-#if ((MSC_STORAGE_BUFFER_SIZE) % MSC_STORAGE_MEM_ALIGN != 0)
-#error "CONFIG_TINYUSB_MSC_BUFSIZE must be divisible by MSC_STORAGE_MEM_ALIGN. Adjust your configuration (MSC FIFO size) in menuconfig."
+#if ((MSC_STORAGE_BLOCK_SIZE) % MSC_STORAGE_MEM_ALIGN != 0)
+#error "CONFIG_TINYUSB_MSC_BLOCK_SIZE must be divisible by MSC_STORAGE_MEM_ALIGN. Adjust your configuration (MSC cache block size) in menuconfig."
 #endif
 
 #define TINYUSB_MSC_STORAGE_MAX_LUNS    2                               /*!< Maximum number of LUNs supported by TinyUSB MSC storage. Dafult value is 2 */
 #define TINYUSB_DEFAULT_BASE_PATH       CONFIG_TINYUSB_MSC_MOUNT_PATH   /*!< Default base path for the filesystem, configured via menuconfig */
 
 /**
- * @brief Structure representing a single write buffer for MSC operations.
+ * @brief One block-aligned buffer of the write queue or the read cache.
+ *
+ * A block is MSC_STORAGE_BLOCK_SIZE bytes of the medium, aligned to its own size, so that
+ * a complete block is written with a single erase-block aligned medium operation.
  */
 typedef struct {
-    uint8_t data_buffer[MSC_STORAGE_BUFFER_SIZE]; /*!< Buffer to store write data. The size is defined by MSC_STORAGE_BUFFER_SIZE. */
-    uint8_t lun;                           /*!< Logical Unit Number (LUN) for the current write operation. */
-    uint32_t lba;                          /*!< Logical Block Address for the current WRITE10 operation. */
-    uint32_t offset;                       /*!< Offset within the specified LBA for the current write operation. */
-    uint32_t bufsize;                      /*!< Number of bytes to be written in this operation. */
-} msc_storage_buffer_t;
+    uint8_t *data;                         /*!< MSC_STORAGE_BLOCK_SIZE bytes of block data. */
+    uint32_t block;                        /*!< Index of the block on the medium (byte address / MSC_STORAGE_BLOCK_SIZE). */
+    uint32_t lo;                           /*!< Start of the valid bytes within the block. */
+    uint32_t hi;                           /*!< End of the valid bytes within the block, lo == hi for an unused slot. */
+    uint32_t stamp;                        /*!< Last use, the slot with the lowest stamp is recycled first. */
+} msc_storage_slot_t;
+
+/**
+ * @brief Write queue and read cache of a storage object.
+ *
+ * Used from the TinyUSB task and from the task switching the mount point, always under `lock`.
+ */
+typedef struct {
+    msc_storage_slot_t write[MSC_STORAGE_WRITE_SLOTS]; /*!< Written data not yet on the medium, contiguous per slot. */
+#if MSC_STORAGE_READ_BLOCKS > 0
+    msc_storage_slot_t read[MSC_STORAGE_READ_BLOCKS];  /*!< Recently read blocks, always valid from 0 to hi. */
+#endif
+    uint8_t *memory;                       /*!< Backing memory of all slots. */
+    uint32_t clock;                        /*!< Source of slot stamps. */
+    bool flush_pending;                    /*!< A deferred flush of full slots is queued. */
+    SemaphoreHandle_t lock;                /*!< Guards everything above. */
+} msc_storage_cache_t;
 
 /**
  * @brief Handle for TinyUSB MSC storage interface.
@@ -70,8 +94,8 @@ typedef struct {
         bool do_not_format;                     /*!< If true, do not format the drive if filesystem is not present. */
         BYTE format_flags;                      /*!< Flags for formatting the filesystem, can be 0 to use default settings. */
     } fat_fs;
-    // Buffer for storage operations
-    msc_storage_buffer_t storage_buffer;        /*!< Buffer for storing data during write operations. */
+    // Buffers for storage operations
+    msc_storage_cache_t cache;                  /*!< Write queue and read cache. */
 } tinyusb_msc_storage_s;
 
 typedef tinyusb_msc_storage_s msc_storage_obj_t;
@@ -197,93 +221,370 @@ static inline esp_err_t msc_storage_unmap_from_lun(msc_storage_obj_t *storage)
     return ESP_ERR_NOT_FOUND;
 }
 
+//
+// ========================== TinyUSB MSC Write Queue and Read Cache =================================
+//
+// WRITE10 data is copied into block-aligned slots; writes to adjacent LBAs are combined into one
+// slot until the whole block is covered, then written to the medium with a single operation.
+// Complete blocks, and partial ones once their WRITE10 command is done, are flushed deferred to the
+// TinyUSB task so that the host can keep sending.
+// The block written last is kept open across WRITE10 commands; it is flushed when it completes,
+// when its slot is recycled, before the storage is mounted to the application or when the host
+// polls with TEST UNIT READY.
+// The task switching the mount point syncs the cache too, hence the mutex around every access.
+//
+
+static inline void msc_cache_lock(msc_storage_obj_t *storage)
+{
+    xSemaphoreTake(storage->cache.lock, portMAX_DELAY);
+}
+
+static inline void msc_cache_unlock(msc_storage_obj_t *storage)
+{
+    xSemaphoreGive(storage->cache.lock);
+}
+
+static inline uint64_t msc_storage_capacity(const msc_storage_obj_t *storage)
+{
+    return (uint64_t)storage->sector_count * storage->sector_size;
+}
+
+static inline bool msc_slot_used(const msc_storage_slot_t *slot)
+{
+    return slot->lo != slot->hi;
+}
+
+static inline bool msc_slot_full(const msc_storage_slot_t *slot)
+{
+    return slot->lo == 0 && slot->hi == MSC_STORAGE_BLOCK_SIZE;
+}
+
 /**
- * @brief Read a sector from the storage medium
- *
- * This function reads a sector from the storage medium associated with the specified LUN.
- *
- * @param[in] lun The logical unit number (LUN) to read from.
- * @param[in] lba Logical Block Address of the sector to read.
- * @param[in] offset Offset within the sector to read from.
- * @param[in] size Number of bytes to read.
- * @param[out] dest Pointer to the destination buffer where the read data will be stored.
+ * @brief Write the valid bytes of a write queue slot to the medium and release the slot
  */
-static inline esp_err_t msc_storage_read_sector(uint8_t lun, uint32_t lba, uint32_t offset, size_t size, void *dest)
+static esp_err_t msc_slot_flush(msc_storage_obj_t *storage, msc_storage_slot_t *slot)
 {
-    msc_storage_obj_t *storage;
-    ESP_RETURN_ON_ERROR(msc_storage_get_by_lun(lun, &storage), TAG, "Failed to get storage by LUN %d", lun);
-    return storage->medium->read(lba, offset, size, dest);
+    if (!msc_slot_used(slot)) {
+        return ESP_OK;
+    }
+    const uint64_t addr = (uint64_t)slot->block * MSC_STORAGE_BLOCK_SIZE + slot->lo;
+    esp_err_t err = storage->medium->write((uint32_t)(addr / storage->sector_size),
+                                           (uint32_t)(addr % storage->sector_size),
+                                           slot->hi - slot->lo, slot->data + slot->lo);
+    slot->lo = slot->hi = 0;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Write of block %"PRIu32" failed, error=0x%x", slot->block, err);
+    }
+    return err;
 }
 
 /**
- * @brief Write a sector to the storage medium
- *
- * This function writes a sector to the storage medium associated with the specified LUN.
+ * @brief Flush the write queue
  *
- * @param[in] lun The logical unit number (LUN) to write to.
- * @param[in] lba Logical Block Address of the sector to write to.
- * @param[in] offset Offset within the sector to write to.
- * @param[in] size Number of bytes to write.
- * @param[in] src Pointer to the source buffer containing the data to write.
+ * @param[in] storage Storage object
+ * @param[in] keep Slot to leave open, may be NULL
+ * @param[in] full_only Only flush slots holding a complete block
  */
-static inline esp_err_t msc_storage_write_sector(uint8_t lun, uint32_t lba, uint32_t offset, size_t size, const void *src)
+static esp_err_t msc_cache_flush(msc_storage_obj_t *storage, const msc_storage_slot_t *keep, bool full_only)
 {
-    msc_storage_obj_t *storage;
-    ESP_RETURN_ON_ERROR(msc_storage_get_by_lun(lun, &storage), TAG, "Failed to get storage by LUN %d", lun);
-    return storage->medium->write(lba, offset, size, src);
+    esp_err_t ret = ESP_OK;
+    for (int i = 0; i < MSC_STORAGE_WRITE_SLOTS; i++) {
+        msc_storage_slot_t *slot = &storage->cache.write[i];
+        if (slot == keep || (full_only && !msc_slot_full(slot))) {
+            continue;
+        }
+        esp_err_t err = msc_slot_flush(storage, slot);
+        if (ret == ESP_OK) {
+            ret = err;
+        }
+    }
+    return ret;
 }
 
 /**
- * @brief Handles deferred USB MSC write operations.
+ * @brief Flush the whole write queue, from any task
+ */
+static esp_err_t msc_cache_write_back(msc_storage_obj_t *storage)
+{
+    msc_cache_lock(storage);
+    esp_err_t ret = msc_cache_flush(storage, NULL, false);
+    msc_cache_unlock(storage);
+    return ret;
+}
+
+/**
+ * @brief Flush the write queue and drop the read cache, for when the application takes over the medium
  *
- * This function is invoked via TinyUSB's deferred execution mechanism to perform
- * write operations to the underlying storage. It writes data from the
- * `storage_buffer` stored within the `s_storage_handle`.
+ * A deferred flush still queued in the TinyUSB task finds the queue empty afterwards.
+ */
+static esp_err_t msc_cache_sync(msc_storage_obj_t *storage)
+{
+    if (storage->cache.memory == NULL) {
+        return ESP_OK;
+    }
+    msc_cache_lock(storage);
+    esp_err_t ret = msc_cache_flush(storage, NULL, false);
+#if MSC_STORAGE_READ_BLOCKS > 0
+    for (int i = 0; i < MSC_STORAGE_READ_BLOCKS; i++) {
+        storage->cache.read[i].lo = storage->cache.read[i].hi = 0;
+    }
+#endif
+    msc_cache_unlock(storage);
+    return ret;
+}
+
+/**
+ * @brief Deferred flush of the write queue, runs in the TinyUSB task
  *
- * @param param Pointer to the storage object containing the write parameters.
+ * Only the block written last stays open, if it is incomplete: a following sequential command continues it.
  */
-static void tusb_write_func(void *param)
+static void msc_cache_flush_func(void *param)
 {
     assert(param); // Ensure param is not NULL
     msc_storage_obj_t *storage = (msc_storage_obj_t *)param;
-    esp_err_t err = msc_storage_write_sector(
-                        storage->storage_buffer.lun,
-                        storage->storage_buffer.lba,
-                        storage->storage_buffer.offset,
-                        storage->storage_buffer.bufsize,
-                        (const void *)storage->storage_buffer.data_buffer
-                    );
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Write failed, error=0x%x", err);
+    msc_cache_lock(storage);
+    storage->cache.flush_pending = false;
+    const msc_storage_slot_t *last = &storage->cache.write[0];
+    for (int i = 1; i < MSC_STORAGE_WRITE_SLOTS; i++) {
+        if ((int32_t)(storage->cache.write[i].stamp - last->stamp) > 0) {
+            last = &storage->cache.write[i];
+        }
+    }
+    (void) msc_cache_flush(storage, msc_slot_full(last) ? NULL : last, false);
+    msc_cache_unlock(storage);
+}
+
+/**
+ * @brief Queue a deferred flush of the write queue, unless one is queued already; cache locked
+ */
+static void msc_cache_defer_flush(msc_storage_obj_t *storage)
+{
+    if (!storage->cache.flush_pending) {
+        storage->cache.flush_pending = true;
+        usbd_defer_func(msc_cache_flush_func, (void *)storage, false);
+    }
+}
+
+static esp_err_t msc_cache_init(msc_storage_obj_t *storage)
+{
+    ESP_RETURN_ON_FALSE(storage->sector_size != 0 && MSC_STORAGE_BLOCK_SIZE % storage->sector_size == 0,
+                        ESP_ERR_NOT_SUPPORTED, TAG,
+                        "MSC cache block size (%d) must be a multiple of the sector size (%"PRIu32"), please reconfigure the project.",
+                        MSC_STORAGE_BLOCK_SIZE, storage->sector_size);
+
+    msc_storage_cache_t *cache = &storage->cache;
+    cache->lock = xSemaphoreCreateMutex();
+    ESP_RETURN_ON_FALSE(cache->lock != NULL, ESP_ERR_NO_MEM, TAG, "Failed to create the MSC cache lock");
+    const size_t slots = MSC_STORAGE_WRITE_SLOTS + MSC_STORAGE_READ_BLOCKS;
+    cache->memory = (uint8_t *)heap_caps_aligned_calloc(MSC_STORAGE_MEM_ALIGN, slots, MSC_STORAGE_BLOCK_SIZE, MALLOC_CAP_DMA);
+    ESP_RETURN_ON_FALSE(cache->memory != NULL, ESP_ERR_NO_MEM, TAG, "Failed to allocate memory for MSC cache");
+
+    uint8_t *data = cache->memory;
+    for (int i = 0; i < MSC_STORAGE_WRITE_SLOTS; i++, data += MSC_STORAGE_BLOCK_SIZE) {
+        cache->write[i].data = data;
+    }
+#if MSC_STORAGE_READ_BLOCKS > 0
+    for (int i = 0; i < MSC_STORAGE_READ_BLOCKS; i++, data += MSC_STORAGE_BLOCK_SIZE) {
+        cache->read[i].data = data;
+    }
+#endif
+    return ESP_OK;
+}
+
+static void msc_cache_deinit(msc_storage_obj_t *storage)
+{
+    if (storage->cache.memory != NULL) {
+        heap_caps_free(storage->cache.memory);
+    }
+    if (storage->cache.lock != NULL) {
+        vSemaphoreDelete(storage->cache.lock);
+    }
+    memset(&storage->cache, 0, sizeof(storage->cache));
+}
+
+/**
+ * @brief Find the slot holding `block`, or the least recently used one
+ *
+ * @param[out] hit true if the returned slot holds `block`
+ */
+static msc_storage_slot_t *msc_slot_lookup(msc_storage_slot_t *slots, int count, uint32_t block, bool *hit)
+{
+    msc_storage_slot_t *victim = &slots[0];
+    for (int i = 0; i < count; i++) {
+        msc_storage_slot_t *slot = &slots[i];
+        if (msc_slot_used(slot) && slot->block == block) {
+            *hit = true;
+            return slot;
+        }
+        // Unused slots first, then the oldest
+        if (msc_slot_used(victim) && (!msc_slot_used(slot) || (int32_t)(slot->stamp - victim->stamp) < 0)) {
+            victim = slot;
+        }
     }
+    *hit = false;
+    return victim;
 }
 
-static inline esp_err_t msc_storage_write_sector_deferred(uint8_t lun, uint32_t lba, uint32_t offset, size_t size, const void *src)
+/**
+ * @brief Check a request against the capacity of the storage
+ *
+ * @param[out] addr Byte address of the request
+ */
+static esp_err_t msc_storage_check_range(msc_storage_obj_t *storage, uint32_t lba, uint32_t offset, size_t size, uint64_t *addr)
+{
+    *addr = (uint64_t)lba * storage->sector_size + offset;
+    ESP_RETURN_ON_FALSE(*addr + size <= msc_storage_capacity(storage), ESP_ERR_INVALID_SIZE, TAG,
+                        "Access beyond the end of the medium, lba %"PRIu32" offset %"PRIu32" size %zu", lba, offset, size);
+    return ESP_OK;
+}
+
+/**
+ * @brief Read `size` bytes at byte address `addr` through the read cache; cache locked
+ */
+static esp_err_t msc_cache_read(msc_storage_obj_t *storage, uint64_t addr, size_t size, uint8_t *dst)
+{
+    while (size > 0) {
+        const uint32_t block = (uint32_t)(addr / MSC_STORAGE_BLOCK_SIZE);
+        const uint32_t off = (uint32_t)(addr % MSC_STORAGE_BLOCK_SIZE);
+        const uint32_t n = MIN(size, MSC_STORAGE_BLOCK_SIZE - off);
+        bool hit;
+
+        msc_storage_slot_t *pending = msc_slot_lookup(storage->cache.write, MSC_STORAGE_WRITE_SLOTS, block, &hit);
+        const bool queued = hit;
+        if (queued && off < pending->hi && pending->lo < off + n) {
+            ESP_RETURN_ON_ERROR(msc_slot_flush(storage, pending), TAG, "Failed to flush before read");
+        }
+#if MSC_STORAGE_READ_BLOCKS > 0
+        msc_storage_slot_t *line = msc_slot_lookup(storage->cache.read, MSC_STORAGE_READ_BLOCKS, block, &hit);
+        if (hit || n < MSC_STORAGE_BLOCK_SIZE) {
+            if (!hit) {
+                // Fill the line with the whole block, or up to the end of the medium
+                const uint64_t start = (uint64_t)block * MSC_STORAGE_BLOCK_SIZE;
+                const uint32_t len = (uint32_t)MIN(MSC_STORAGE_BLOCK_SIZE, msc_storage_capacity(storage) - start);
+                line->lo = line->hi = 0;
+                ESP_RETURN_ON_ERROR(storage->medium->read((uint32_t)(start / storage->sector_size),
+                                                          (uint32_t)(start % storage->sector_size),
+                                                          len, line->data), TAG, "Failed to read block %"PRIu32, block);
+                // The medium does not have the bytes still queued for this block yet
+                if (queued && msc_slot_used(pending) && pending->lo < len) {
+                    memcpy(line->data + pending->lo, pending->data + pending->lo, MIN(pending->hi, len) - pending->lo);
+                }
+                line->block = block;
+                line->hi = len;
+            }
+            line->stamp = ++storage->cache.clock;
+            memcpy(dst, line->data + off, n);
+        } else
+#endif
+        {
+            // Whole blocks go straight to the caller's buffer
+            ESP_RETURN_ON_ERROR(storage->medium->read((uint32_t)(addr / storage->sector_size),
+                                                      (uint32_t)(addr % storage->sector_size),
+                                                      n, dst), TAG, "Failed to read");
+        }
+        addr += n;
+        dst += n;
+        size -= n;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Read from the storage medium through the read cache
+ *
+ * This function reads from the storage medium associated with the specified LUN. Queued writes to the
+ * requested range are flushed first; a cache line filled from the medium takes the queued bytes of its block.
+ *
+ * @param[in] lun The logical unit number (LUN) to read from.
+ * @param[in] lba Logical Block Address of the sector to read.
+ * @param[in] offset Offset within the sector to read from.
+ * @param[in] size Number of bytes to read.
+ * @param[out] dest Pointer to the destination buffer where the read data will be stored.
+ */
+static esp_err_t msc_storage_read_sector(uint8_t lun, uint32_t lba, uint32_t offset, size_t size, void *dest)
 {
     msc_storage_obj_t *storage;
+    uint64_t addr;
     ESP_RETURN_ON_ERROR(msc_storage_get_by_lun(lun, &storage), TAG, "Failed to get storage by LUN %d", lun);
+    ESP_RETURN_ON_ERROR(msc_storage_check_range(storage, lba, offset, size, &addr), TAG, "Invalid READ(10)");
 
-    // As we defer the write operation to the TinyUSB task, we need to ensure that
-    // the address does not overflow for SPI Flash storage medium
-    if (storage->medium->type == STORAGE_MEDIUM_TYPE_SPIFLASH) {
-        size_t addr = 0; // Address of the data to be read, relative to the beginning of the partition.
-        size_t temp = 0;
-        size_t sector_size = storage->sector_size;
-        ESP_RETURN_ON_FALSE(!__builtin_umul_overflow(lba, sector_size, &temp), ESP_ERR_INVALID_SIZE, TAG, "overflow lba %lu sector_size %u", lba, sector_size);
-        ESP_RETURN_ON_FALSE(!__builtin_uadd_overflow(temp, offset, &addr), ESP_ERR_INVALID_SIZE, TAG, "overflow addr %u offset %lu", temp, offset);
+    msc_cache_lock(storage);
+    esp_err_t ret = msc_cache_read(storage, addr, size, (uint8_t *)dest);
+    msc_cache_unlock(storage);
+    return ret;
+}
+
+/**
+ * @brief Queue `size` bytes for byte address `addr`; cache locked
+ */
+static esp_err_t msc_cache_write(msc_storage_obj_t *storage, uint64_t addr, size_t size, const uint8_t *data)
+{
+    bool queue_flush = false;
+    while (size > 0) {
+        const uint32_t block = (uint32_t)(addr / MSC_STORAGE_BLOCK_SIZE);
+        const uint32_t off = (uint32_t)(addr % MSC_STORAGE_BLOCK_SIZE);
+        const uint32_t n = MIN(size, MSC_STORAGE_BLOCK_SIZE - off);
+        bool hit;
+
+        msc_storage_slot_t *slot = msc_slot_lookup(storage->cache.write, MSC_STORAGE_WRITE_SLOTS, block, &hit);
+        // A slot holds one contiguous range: anything else goes to the medium first
+        if (!hit || off > slot->hi || off + n < slot->lo) {
+            ESP_RETURN_ON_ERROR(msc_slot_flush(storage, slot), TAG, "Failed to flush the write queue");
+        }
+        memcpy(slot->data + off, data, n);
+        if (msc_slot_used(slot)) {
+            slot->lo = MIN(slot->lo, off);
+            slot->hi = MAX(slot->hi, off + n);
+        } else {
+            slot->block = block;
+            slot->lo = off;
+            slot->hi = off + n;
+        }
+        slot->stamp = ++storage->cache.clock;
+        queue_flush |= msc_slot_full(slot);
+
+#if MSC_STORAGE_READ_BLOCKS > 0
+        // Keep a cached copy of the block current
+        msc_storage_slot_t *line = msc_slot_lookup(storage->cache.read, MSC_STORAGE_READ_BLOCKS, block, &hit);
+        if (hit && off < line->hi) {
+            memcpy(line->data + off, data, MIN(n, line->hi - off));
+        }
+#endif
+        addr += n;
+        data += n;
+        size -= n;
     }
 
-    // Copy data to the buffer
-    memcpy((void *)storage->storage_buffer.data_buffer, src, size);
-    storage->storage_buffer.lun = lun;
-    storage->storage_buffer.lba = lba;
-    storage->storage_buffer.offset = offset;
-    storage->storage_buffer.bufsize = size;
+    if (queue_flush) {
+        // Defer execution of the write to the TinyUSB task
+        msc_cache_defer_flush(storage);
+    }
+    return ESP_OK;
+}
 
-    // Defer execution of the write to the TinyUSB task
-    usbd_defer_func(tusb_write_func, (void *)storage, false);
+/**
+ * @brief Queue a write to the storage medium
+ *
+ * This function copies the data into the write queue of the storage associated with the specified LUN.
+ * Complete blocks are written to the medium by a deferred call in the TinyUSB task.
+ *
+ * @param[in] lun The logical unit number (LUN) to write to.
+ * @param[in] lba Logical Block Address of the sector to write to.
+ * @param[in] offset Offset within the sector to write to.
+ * @param[in] size Number of bytes to write.
+ * @param[in] src Pointer to the source buffer containing the data to write.
+ */
+static esp_err_t msc_storage_write_sector_deferred(uint8_t lun, uint32_t lba, uint32_t offset, size_t size, const void *src)
+{
+    msc_storage_obj_t *storage;
+    uint64_t addr;
+    ESP_RETURN_ON_ERROR(msc_storage_get_by_lun(lun, &storage), TAG, "Failed to get storage by LUN %d", lun);
+    ESP_RETURN_ON_ERROR(msc_storage_check_range(storage, lba, offset, size, &addr), TAG, "Invalid WRITE(10)");
 
-    return ESP_OK;
+    msc_cache_lock(storage);
+    esp_err_t ret = msc_cache_write(storage, addr, size, (const uint8_t *)src);
+    msc_cache_unlock(storage);
+    return ret;
 }
 
 static esp_err_t vfs_fat_format(BYTE format_flags)
@@ -354,6 +655,11 @@ esp_err_t msc_storage_mount(msc_storage_obj_t *storage)
         return ESP_OK;
     }
 
+    // Everything the host wrote must be on the medium before the filesystem sees it
+    if (msc_cache_sync(storage) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to flush the MSC write queue");
+    }
+
     tinyusb_event_cb(storage, TINYUSB_MSC_EVENT_MOUNT_START);
 
     // Mount VFS FAT at base path
@@ -425,6 +731,8 @@ static esp_err_t msc_storage_unmount(msc_storage_obj_t *storage)
         return err;
     }
     err = esp_vfs_fat_unregister_path(storage->fat_fs.base_path);
+    // The application may have changed cached blocks
+    (void) msc_cache_sync(storage);
     storage->mount_point = TINYUSB_MSC_STORAGE_MOUNT_USB;
 
     tinyusb_event_cb(storage, TINYUSB_MSC_EVENT_MOUNT_COMPLETE);
@@ -478,7 +786,7 @@ static esp_err_t msc_storage_config(msc_storage_obj_t *storage_obj,
              storage_obj->sector_count,
              storage_obj->sector_size);
 
-    return ESP_OK;
+    return msc_cache_init(storage_obj);
 }
 
 //
@@ -678,6 +986,8 @@ esp_err_t tinyusb_msc_delete_storage(tinyusb_msc_storage_handle_t handle)
     }
 
     ESP_RETURN_ON_ERROR(msc_storage_unmap_from_lun(storage), TAG, "Failed to unmap storage from LUN 0");
+    (void) msc_cache_sync(storage);
+    msc_cache_deinit(storage);
     storage->medium->close();
     heap_caps_free(storage);
 
@@ -820,6 +1130,8 @@ esp_err_t tinyusb_msc_format_storage(tinyusb_msc_storage_handle_t handle)
 /** User can add and use more codes as per the need of the application **/
 #define SCSI_CODE_ASC_MEDIUM_NOT_PRESENT                0x3A /** SCSI ASC code for 'MEDIUM NOT PRESENT' **/
 #define SCSI_CODE_ASC_INVALID_COMMAND_OPERATION_CODE    0x20 /** SCSI ASC code for 'INVALID COMMAND OPERATION CODE' **/
+#define SCSI_CMD_SYNCHRONIZE_CACHE_10                   0x35 /** SCSI opcode of SYNCHRONIZE CACHE(10), not in TinyUSB's list **/
+#define SCSI_CODE_ASC_WRITE_ERROR                       0x0C /** SCSI ASC code for 'WRITE ERROR' **/
 #define SCSI_CODE_ASCQ                                  0x00
 
 // Invoked when received GET_MAX_LUN request, required for multiple LUNs implementation
@@ -852,7 +1164,13 @@ void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16
 // return true allowing host to read/write this LUN e.g SD card inserted
 bool tud_msc_test_unit_ready_cb(uint8_t lun)
 {
-    (void) lun;
+    if (p_msc_driver != NULL && lun < TINYUSB_MSC_STORAGE_MAX_LUNS) {
+        msc_storage_obj_t *storage = p_msc_driver->dynamic.storage[lun];
+        if (storage != NULL && storage->mount_point == TINYUSB_MSC_STORAGE_MOUNT_USB) {
+            // Hosts poll while idle: a good time to write the open block
+            (void) msc_cache_write_back(storage);
+        }
+    }
 
     if (p_msc_driver != NULL) {
         msc_storage_obj_t *storage = p_msc_driver->dynamic.storage[0];
@@ -919,11 +1237,7 @@ int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void *buff
 // - Application write data from buffer to address contents (up to bufsize) and return number of written byte.
 int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t *buffer, uint32_t bufsize)
 {
-    // There is no way to return the error from the deferred function, so we need to check everything here
-    if (bufsize > MSC_STORAGE_BUFFER_SIZE) {
-        ESP_LOGE(TAG, "Buffer size %"PRIu32" exceeds maximum allowed size %d", bufsize, MSC_STORAGE_BUFFER_SIZE);
-        goto error;
-    }
+    // There is no way to return the error from the deferred flush, so we need to check everything here
     esp_err_t err = msc_storage_write_sector_deferred(lun, lba, offset, bufsize, buffer);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "WRITE(10) command failed, %s", esp_err_to_name(err));
@@ -937,6 +1251,19 @@ error:
     return -1; // Indicate an error occurred
 }
 
+// Invoked when a WRITE10 command is complete
+// The blocks it left partially written are flushed deferred, all but the last one
+void tud_msc_write10_complete_cb(uint8_t lun)
+{
+    msc_storage_obj_t *storage;
+    if (p_msc_driver == NULL || lun >= TINYUSB_MSC_STORAGE_MAX_LUNS || (storage = p_msc_driver->dynamic.storage[lun]) == NULL) {
+        return;
+    }
+    msc_cache_lock(storage);
+    msc_cache_defer_flush(storage);
+    msc_cache_unlock(storage);
+}
+
 /**
  * Invoked when received an SCSI command not in built-in list below.
  * - READ_CAPACITY10, READ_FORMAT_CAPACITY, INQUIRY, TEST_UNIT_READY, START_STOP_UNIT, MODE_SENSE6, REQUEST_SENSE
@@ -964,6 +1291,15 @@ int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void *buffer, u
         the storage media/partition. */
         ret = 0;
         break;
+    case SCSI_CMD_SYNCHRONIZE_CACHE_10: {
+        msc_storage_obj_t *storage;
+        ret = 0;
+        if (msc_storage_get_by_lun(lun, &storage) != ESP_OK || msc_cache_write_back(storage) != ESP_OK) {
+            tud_msc_set_sense(lun, SCSI_SENSE_MEDIUM_ERROR, SCSI_CODE_ASC_WRITE_ERROR, SCSI_CODE_ASCQ);
+            ret = -1;
+        }
+        break;
+    }
     default:
         ESP_LOGW(TAG, "tud_msc_scsi_cb() invoked: %d", scsi_cmd[0]);
         tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, SCSI_CODE_ASC_INVALID_COMMAND_OPERATION_CODE, SCSI_CODE_ASCQ);
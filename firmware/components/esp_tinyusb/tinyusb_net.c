@@ -6,12 +6,14 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "tinyusb_net.h"
+#include "tinyusb_task.h"
 #include "descriptors_control.h"
 #include "usb_descriptors.h"
 #include "device/usbd_pvt.h"
 #include "esp_check.h"
 
 #define MAC_ADDR_LEN 6
+#define TX_QUEUE_LEN CONFIG_TINYUSB_NET_TX_QUEUE_LEN
 
 typedef struct packet {
     void *buffer;
@@ -20,6 +22,22 @@ typedef struct packet {
     esp_err_t result;
 } packet_t;
 
+/**
+ * @brief Asynchronous transmit queue
+ *
+ * A FIFO ring of preallocated packet descriptors. Any task may append under the lock; only the
+ * TinyUSB task takes packets off the head, once TinyUSB has a free transmit buffer for them.
+ * Packets that do not fit wait in the queue for the next pass of the TinyUSB task instead of
+ * being dropped.
+ */
+typedef struct {
+    packet_t ring[TX_QUEUE_LEN];
+    uint8_t head;                   /*!< Oldest queued packet */
+    uint8_t count;                  /*!< Queued packets */
+    bool drain_pending;             /*!< A drain is deferred to the TinyUSB task */
+    portMUX_TYPE lock;
+} tx_queue_t;
+
 struct tinyusb_net_handle {
     bool initialized;
     SemaphoreHandle_t buffer_sema;
@@ -34,6 +52,7 @@ struct tinyusb_net_handle {
 
 const static int TX_FINISHED_BIT = BIT0;
 static struct tinyusb_net_handle s_net_obj = { };
+static tx_queue_t s_tx_queue = { .lock = portMUX_INITIALIZER_UNLOCKED };
 static const char *TAG = "tusb_net";
 
 static void do_send_sync(void *ctx)
@@ -54,16 +73,64 @@ static void do_send_sync(void *ctx)
     xEventGroupSetBits(s_net_obj.tx_flags, TX_FINISHED_BIT);
 }
 
-static void do_send_async(void *ctx)
+/**
+ * @brief Hand queued packets to TinyUSB, oldest first, until it runs out of transmit buffers
+ *
+ * Runs in the TinyUSB task only. The transmit callback copies the packet out before
+ * tud_network_xmit() returns, so the descriptor is free again right after.
+ */
+static void tx_queue_drain(void)
 {
-    packet_t *packet = ctx;
-    if (tud_network_can_xmit(packet->len)) {
+    tx_queue_t *q = &s_tx_queue;
+    for (;;) {
+        portENTER_CRITICAL(&q->lock);
+        q->drain_pending = false;
+        packet_t *packet = q->count ? &q->ring[q->head] : NULL;
+        portEXIT_CRITICAL(&q->lock);
+        if (packet == NULL || !tud_network_can_xmit(packet->len)) {
+            return;  // retried after the next USB event, see tinyusb_net_tx_resume()
+        }
         tud_network_xmit(packet, packet->len);
-    } else if (s_net_obj.tx_buff_free_cb) {
-        ESP_LOGW(TAG, "Packet cannot be accepted on USB interface, dropping");
-        s_net_obj.tx_buff_free_cb(packet->buff_free_arg, s_net_obj.ctx);
+        portENTER_CRITICAL(&q->lock);
+        q->head = (q->head + 1) % TX_QUEUE_LEN;
+        q->count--;
+        portEXIT_CRITICAL(&q->lock);
+    }
+}
+
+static void do_send_async(void *ctx)
+{
+    (void) ctx;
+    tx_queue_drain();
+}
+
+void tinyusb_net_tx_resume(void)
+{
+    // Unlocked peek: a packet queued meanwhile defers its own drain
+    if (s_tx_queue.count) {
+        tx_queue_drain();
+    }
+}
+
+/**
+ * @brief Release the buffers of packets that will never be sent
+ */
+static void tx_queue_flush(void)
+{
+    tx_queue_t *q = &s_tx_queue;
+    // Taken out under the lock: once it is released, send_async() may reuse the slots
+    void *args[TX_QUEUE_LEN];
+    portENTER_CRITICAL(&q->lock);
+    const uint8_t count = q->count;
+    for (uint8_t i = 0; i < count; i++) {
+        args[i] = q->ring[(q->head + i) % TX_QUEUE_LEN].buff_free_arg;
+    }
+    q->head = 0;
+    q->count = 0;
+    portEXIT_CRITICAL(&q->lock);
+    for (uint8_t i = 0; i < count && s_net_obj.tx_buff_free_cb; i++) {
+        s_net_obj.tx_buff_free_cb(args[i], s_net_obj.ctx);
     }
-    free(packet);
 }
 
 esp_err_t tinyusb_net_send_async(void *buffer, uint16_t len, void *buff_free_arg)
@@ -72,12 +139,25 @@ esp_err_t tinyusb_net_send_async(void *buffer, uint16_t len, void *buff_free_arg
         return ESP_ERR_INVALID_STATE;
     }
 
-    packet_t *packet = calloc(1, sizeof(packet_t));
-    packet->len = len;
+    tx_queue_t *q = &s_tx_queue;
+    portENTER_CRITICAL(&q->lock);
+    if (q->count == TX_QUEUE_LEN) {
+        portEXIT_CRITICAL(&q->lock);
+        return ESP_ERR_NO_MEM;
+    }
+    packet_t *packet = &q->ring[(q->head + q->count) % TX_QUEUE_LEN];
     packet->buffer = buffer;
+    packet->len = len;
     packet->buff_free_arg = buff_free_arg;
-    ESP_RETURN_ON_FALSE(packet, ESP_ERR_NO_MEM, TAG, "Failed to allocate packet to send");
-    usbd_defer_func(do_send_async, packet, false);
+    packet->result = ESP_OK;
+    q->count++;
+    const bool defer = !q->drain_pending;
+    q->drain_pending = true;
+    portEXIT_CRITICAL(&q->lock);
+
+    if (defer) {
+        usbd_defer_func(do_send_async, NULL, false);
+    }
     return ESP_OK;
 }
 
@@ -142,6 +222,7 @@ esp_err_t tinyusb_net_init(const tinyusb_net_config_t *cfg)
 
 void tinyusb_net_deinit(void)
 {
+    tx_queue_flush();
     if (s_net_obj.buffer_sema) {
         vSemaphoreDelete(s_net_obj.buffer_sema);
         s_net_obj.buffer_sema = NULL;
@@ -185,6 +266,8 @@ uint16_t tud_network_xmit_cb(uint8_t *dst, void *ref, uint16_t arg)
 
 void tud_network_init_cb(void)
 {
+    // The link (re)started, packets queued for the previous one are stale
+    tx_queue_flush();
     if (s_net_obj.init_cb) {
         s_net_obj.init_cb(s_net_obj.ctx);
     }
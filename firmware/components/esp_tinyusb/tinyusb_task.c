@@ -13,9 +13,18 @@
 #include "tinyusb.h"
 #include "sdkconfig.h"
 #include "descriptors_control.h"
+#include "tinyusb_task.h"
 
 const static char *TAG = "tinyusb_task";
 
+__attribute__((weak)) void tinyusb_task_loop_hook(void)
+{
+}
+
+__attribute__((weak)) void tinyusb_net_tx_resume(void)
+{
+}
+
 static portMUX_TYPE tusb_task_lock = portMUX_INITIALIZER_UNLOCKED;
 #define TINYUSB_TASK_ENTER_CRITICAL()    portENTER_CRITICAL(&tusb_task_lock)
 #define TINYUSB_TASK_EXIT_CRITICAL()     portEXIT_CRITICAL(&tusb_task_lock)
@@ -82,6 +91,8 @@ static void tinyusb_device_task(void *arg)
 
     while (1) { // RTOS forever loop
         tud_task();
+        tinyusb_net_tx_resume();
+        tinyusb_task_loop_hook();
     }
 
 desc_free:
@@ -160,6 +171,14 @@ err:
     return ret;
 }
 
+bool tinyusb_task_is_current(void)
+{
+    TINYUSB_TASK_ENTER_CRITICAL();
+    const bool current = p_tusb_task_ctx != NULL && p_tusb_task_ctx->handle == xTaskGetCurrentTaskHandle();
+    TINYUSB_TASK_EXIT_CRITICAL();
+    return current;
+}
+
 esp_err_t tinyusb_task_stop(void)
 {
     TINYUSB_TASK_ENTER_CRITICAL();
@@ -13,19 +13,29 @@
 #include <sys/fcntl.h>
 #include <sys/lock.h>
 #include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "esp_attr.h"
 #include "esp_log.h"
 #include "esp_vfs.h"
 #include "esp_vfs_dev.h"
 #include "tinyusb.h"
 #include "tinyusb_cdc_acm.h"
+#include "tinyusb_task.h"
 #include "vfs_tinyusb.h"
+#include "cdc.h"
 #include "sdkconfig.h"
 
 const static char *TAG = "tusb_vfs";
 
-// Token signifying that no character is available
-#define NONE -1
+// Bytes pulled from the CDC RX FIFO at a time; line ending conversion and
+// line splitting run over this buffer instead of the FIFO
+#define VFS_TUSB_RX_CHUNK 128
+// While blocked on a full TX FIFO, re-check that the host is still there
+#define VFS_TUSB_TX_POLL_MS 10
+// Longest a write() waits for the host to take data. A host that lets it
+// expire (port open, nobody reading) is not waited for again until it does.
+#define VFS_TUSB_TX_TIMEOUT_MS 100
 
 #define FD_CHECK(fd, ret_val) do {                      \
                                     if ((fd) != 0) {    \
@@ -60,9 +70,30 @@ typedef struct {
     uint32_t flags;
     char vfs_path[VFS_TUSB_MAX_PATH];
     int cdc_intf;
+    // Received bytes not yet returned by read(), guarded by read_lock
+    uint8_t rx_buf[VFS_TUSB_RX_CHUNK];
+    size_t rx_pos;
+    size_t rx_len;
+    // Given by the CDC driver when data arrives / TX space is freed
+    SemaphoreHandle_t rx_event;
+    SemaphoreHandle_t tx_event;
+    // A write timed out; cleared when the host takes data again
+    volatile bool tx_stalled;
+    StaticSemaphore_t rx_event_buf;
+    StaticSemaphore_t tx_event_buf;
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+    // Pending select() call, guarded by select_lock
+    bool select_active;
+    esp_vfs_select_sem_t select_sem;
+    fd_set *readfds;
+    fd_set *writefds;
+    fd_set readfds_orig;
+    fd_set writefds_orig;
+#endif
 } vfs_tinyusb_t;
 
 static vfs_tinyusb_t s_vfstusb;
+static portMUX_TYPE s_select_lock = portMUX_INITIALIZER_UNLOCKED;
 
 
 static esp_err_t apply_path(char const *path)
@@ -93,6 +124,9 @@ static esp_err_t vfstusb_init(int cdc_intf, char const *path)
     s_vfstusb.cdc_intf = cdc_intf;
     s_vfstusb.tx_mode = DEFAULT_TX_MODE;
     s_vfstusb.rx_mode = DEFAULT_RX_MODE;
+    s_vfstusb.rx_pos = s_vfstusb.rx_len = 0;
+    s_vfstusb.rx_event = xSemaphoreCreateBinaryStatic(&s_vfstusb.rx_event_buf);
+    s_vfstusb.tx_event = xSemaphoreCreateBinaryStatic(&s_vfstusb.tx_event_buf);
 
     return apply_path(path);
 }
@@ -104,47 +138,144 @@ static void vfstusb_deinit(void)
 {
     _lock_close(&(s_vfstusb.write_lock));
     _lock_close(&(s_vfstusb.read_lock));
+    vSemaphoreDelete(s_vfstusb.rx_event);
+    vSemaphoreDelete(s_vfstusb.tx_event);
     memset(&s_vfstusb, 0, sizeof(s_vfstusb));
 }
 
+static inline bool is_blocking(void)
+{
+    return !(s_vfstusb.flags & O_NONBLOCK);
+}
+
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+// Wake a pending select() if `fds_orig` asked for fd 0
+static void select_notify(fd_set *fds, const fd_set *fds_orig)
+{
+    portENTER_CRITICAL(&s_select_lock);
+    if (s_vfstusb.select_active && FD_ISSET(0, fds_orig)) {
+        FD_SET(0, fds);
+        esp_vfs_select_triggered(s_vfstusb.select_sem);
+    }
+    portEXIT_CRITICAL(&s_select_lock);
+}
+#endif
+
+// Called by the CDC driver from the TinyUSB task
+void tinyusb_cdc_vfs_rx(int itf)
+{
+    if (itf != s_vfstusb.cdc_intf || s_vfstusb.rx_event == NULL) {
+        return;
+    }
+    xSemaphoreGive(s_vfstusb.rx_event);
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+    select_notify(s_vfstusb.readfds, &s_vfstusb.readfds_orig);
+#endif
+}
+
+void tinyusb_cdc_vfs_tx_done(int itf)
+{
+    if (itf != s_vfstusb.cdc_intf || s_vfstusb.tx_event == NULL) {
+        return;
+    }
+    s_vfstusb.tx_stalled = false;
+    xSemaphoreGive(s_vfstusb.tx_event);
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+    select_notify(s_vfstusb.writefds, &s_vfstusb.writefds_orig);
+#endif
+}
+
 static int tusb_open(const char *path, int flags, int mode)
 {
     (void) mode;
     (void) path;
-    s_vfstusb.flags = flags | O_NONBLOCK; // for now only non-blocking mode is implemented
+    s_vfstusb.flags = flags;
     return 0;
 }
 
+// TX FIFO full: push it out and wait a while for the host to take it.
+// False if write() must not wait: non-blocking, no host, timed out since
+// `start`, or called from the TinyUSB task (which frees the FIFO).
+static bool tx_wait(TickType_t start)
+{
+    const int itf = s_vfstusb.cdc_intf;
+    if (!is_blocking() || s_vfstusb.tx_stalled || !tud_cdc_n_connected(itf) || tinyusb_task_is_current()) {
+        return false;
+    }
+    if (xTaskGetTickCount() - start >= pdMS_TO_TICKS(VFS_TUSB_TX_TIMEOUT_MS)) {
+        s_vfstusb.tx_stalled = true;
+        return false;
+    }
+    tud_cdc_n_write_flush(itf);
+    xSemaphoreTake(s_vfstusb.tx_event, pdMS_TO_TICKS(VFS_TUSB_TX_POLL_MS));
+    return true;
+}
+
+// Queue as much of `data` as fits, waiting for room in blocking mode.
+// Returns the number of bytes queued.
+static size_t write_block(const char *data, size_t size, TickType_t start)
+{
+    const int itf = s_vfstusb.cdc_intf;
+    size_t done = 0;
+    while (done < size) {
+        done += tud_cdc_n_write(itf, data + done, size - done);
+        if (done == size || !tx_wait(start)) {
+            break;
+        }
+    }
+    return done;
+}
+
+// Queue a line ending only as a whole, so CRLF is never split
+static bool write_line_ending(TickType_t start)
+{
+    static const char crlf[] = "\r\n";
+    const char *ending = crlf;
+    size_t len = 2;
+    if (s_vfstusb.tx_mode == ESP_LINE_ENDINGS_CR) {
+        len = 1;
+    } else if (s_vfstusb.tx_mode == ESP_LINE_ENDINGS_LF) {
+        ending = crlf + 1;
+        len = 1;
+    }
+    const int itf = s_vfstusb.cdc_intf;
+    while (tud_cdc_n_write_available(itf) < len) {
+        if (!tx_wait(start)) {
+            return false;
+        }
+    }
+    return tud_cdc_n_write(itf, ending, len) == len;
+}
+
 static ssize_t tusb_write(int fd, const void *data, size_t size)
 {
     FD_CHECK(fd, -1);
-    size_t written_sz = 0;
     const char *data_c = (const char *)data;
+    size_t written_sz = 0;
     _lock_acquire(&(s_vfstusb.write_lock));
-    for (size_t i = 0; i < size; i++) {
-        int c = data_c[i];
-        if (c != '\n') {
-            if (!tinyusb_cdcacm_write_queue_char(s_vfstusb.cdc_intf, c)) {
-                break; // can't write anymore
-            }
-        } else {
-            if (s_vfstusb.tx_mode == ESP_LINE_ENDINGS_CRLF || s_vfstusb.tx_mode == ESP_LINE_ENDINGS_CR) {
-                char cr = '\r';
-                if (!tinyusb_cdcacm_write_queue_char(s_vfstusb.cdc_intf, cr)) {
-                    break; // can't write anymore
-                }
-            }
-            if (s_vfstusb.tx_mode == ESP_LINE_ENDINGS_CRLF || s_vfstusb.tx_mode == ESP_LINE_ENDINGS_LF) {
-                char lf = '\n';
-                if (!tinyusb_cdcacm_write_queue_char(s_vfstusb.cdc_intf, lf)) {
-                    break; // can't write anymore
-                }
+    const TickType_t start = xTaskGetTickCount();
+    if (s_vfstusb.tx_mode == ESP_LINE_ENDINGS_LF) {
+        written_sz = write_block(data_c, size, start);
+    } else {
+        // Copy the runs between newlines as blocks, convert the newlines
+        while (written_sz < size) {
+            const char *nl = memchr(data_c + written_sz, '\n', size - written_sz);
+            const size_t run = nl ? (size_t)(nl - data_c) - written_sz : size - written_sz;
+            const size_t n = write_block(data_c + written_sz, run, start);
+            written_sz += n;
+            if (n < run || !nl || !write_line_ending(start)) {
+                break;
             }
+            written_sz++; // the newline
         }
-        written_sz++;
     }
+    // One flush per call; full packets already went out while queueing
     tud_cdc_n_write_flush(s_vfstusb.cdc_intf);
     _lock_release(&(s_vfstusb.write_lock));
+    if (written_sz == 0 && size > 0) {
+        errno = EWOULDBLOCK;
+        return -1;
+    }
     return written_sz;
 }
 
@@ -154,6 +285,71 @@ static int tusb_close(int fd)
     return 0;
 }
 
+static inline size_t rx_buffered(void)
+{
+    return s_vfstusb.rx_len - s_vfstusb.rx_pos;
+}
+
+// Refill the RX buffer from the FIFO, behind what is left in it (at most a
+// CR waiting for the byte after it); false if no new data
+static bool rx_fill(void)
+{
+    const size_t kept = rx_buffered();
+    memmove(s_vfstusb.rx_buf, s_vfstusb.rx_buf + s_vfstusb.rx_pos, kept);
+    s_vfstusb.rx_pos = 0;
+    s_vfstusb.rx_len = kept + tud_cdc_n_read(s_vfstusb.cdc_intf, s_vfstusb.rx_buf + kept, sizeof(s_vfstusb.rx_buf) - kept);
+    return s_vfstusb.rx_len > kept;
+}
+
+// CRLF mode: the only buffered byte is a CR, still waiting for the next one
+static inline bool rx_cr_pending(void)
+{
+    return s_vfstusb.rx_mode == ESP_LINE_ENDINGS_CRLF && rx_buffered() == 1 &&
+           s_vfstusb.rx_buf[s_vfstusb.rx_pos] == '\r';
+}
+
+// Copy buffered bytes into `out` up to and including the first line ending,
+// converted to '\n'. Returns the bytes stored, 0 if only a CR is buffered and
+// the byte after it has not arrived; `*eol` is set at line end.
+static size_t rx_copy_line(char *out, size_t size, bool *eol)
+{
+    const uint8_t *src = s_vfstusb.rx_buf + s_vfstusb.rx_pos;
+    size_t avail = MIN(rx_buffered(), size);
+    const uint8_t *lf = memchr(src, '\n', avail);
+    const uint8_t *cr = s_vfstusb.rx_mode == ESP_LINE_ENDINGS_LF ? NULL : memchr(src, '\r', lf ? (size_t)(lf - src) : avail);
+    const uint8_t *end = cr ? cr : lf;
+    size_t n = end ? (size_t)(end - src) + 1 : avail;
+    *eol = false;
+    if (cr && s_vfstusb.rx_mode == ESP_LINE_ENDINGS_CRLF && s_vfstusb.rx_pos + n == s_vfstusb.rx_len) {
+        // The CR needs the byte after it: return what precedes it, then wait
+        // for a refill to bring that byte in behind it
+        if (n > 1 || !rx_fill()) {
+            n--;
+            memcpy(out, src, n);
+            s_vfstusb.rx_pos += n;
+            return n;
+        }
+        src = s_vfstusb.rx_buf;
+    }
+    memcpy(out, src, n);
+    s_vfstusb.rx_pos += n;
+    *eol = end != NULL;
+    if (!cr) {
+        return n;
+    }
+    out[n - 1] = '\n';
+    if (s_vfstusb.rx_mode == ESP_LINE_ENDINGS_CRLF) {
+        // CR LF collapses, CR alone stays CR
+        if (s_vfstusb.rx_buf[s_vfstusb.rx_pos] == '\n') {
+            s_vfstusb.rx_pos++;
+        } else {
+            out[n - 1] = '\r';
+            *eol = false;
+        }
+    }
+    return n;
+}
+
 static ssize_t tusb_read(int fd, void *data, size_t size)
 {
     FD_CHECK(fd, -1);
@@ -161,41 +357,24 @@ static ssize_t tusb_read(int fd, void *data, size_t size)
     size_t received = 0;
     _lock_acquire(&(s_vfstusb.read_lock));
 
-    if (tud_cdc_n_available(s_vfstusb.cdc_intf) == 0) {
-        goto finish;
-    }
-    while (received < size) {
-        int c = tud_cdc_n_read_char(s_vfstusb.cdc_intf);
-        if ( c == NONE) { // if data ends
-            break;
+    // Return at most one line, whatever is available without waiting once
+    // something is; until then block, unless O_NONBLOCK
+    bool eol = false;
+    while (received < size && !eol) {
+        size_t n = 0;
+        if (rx_buffered() > 0 || rx_fill()) {
+            n = rx_copy_line(data_c + received, size - received, &eol);
         }
-
-        // Handle line endings. From configured mode -> LF mode
-        if (s_vfstusb.rx_mode == ESP_LINE_ENDINGS_CR) {
-            // Change CRs to newlines
-            if (c == '\r') {
-                c = '\n';
-            }
-        } else if (s_vfstusb.rx_mode == ESP_LINE_ENDINGS_CRLF) {
-            if (c == '\r') {
-                uint8_t next_char = NONE;
-                // Check if next char is newline. If yes, we got CRLF sequence
-                tud_cdc_n_peek(s_vfstusb.cdc_intf, &next_char);
-                if (next_char == '\n') {
-                    c = tud_cdc_n_read_char(s_vfstusb.cdc_intf); // Remove '\n' from the fifo
-                }
-            }
-        }
-
-        data_c[received] = (char) c;
-        ++received;
-        if (c == '\n') {
+        if (n > 0) {
+            received += n;
+        } else if (received == 0 && is_blocking()) {
+            xSemaphoreTake(s_vfstusb.rx_event, portMAX_DELAY);
+        } else {
             break;
         }
     }
-finish:
     _lock_release(&(s_vfstusb.read_lock));
-    if (received > 0) {
+    if (received > 0 || size == 0) {
         return received;
     }
     errno = EWOULDBLOCK;
@@ -229,6 +408,56 @@ static int tusb_fcntl(int fd, int cmd, int arg)
     return result;
 }
 
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+static esp_err_t tusb_start_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
+                                   esp_vfs_select_sem_t select_sem, void **end_select_args)
+{
+    (void) nfds;
+    *end_select_args = NULL;
+    const int itf = s_vfstusb.cdc_intf;
+
+    portENTER_CRITICAL(&s_select_lock);
+    if (s_vfstusb.select_active) {
+        portEXIT_CRITICAL(&s_select_lock);
+        return ESP_ERR_INVALID_STATE; // one select() at a time
+    }
+    s_vfstusb.select_active = true;
+    s_vfstusb.select_sem = select_sem;
+    s_vfstusb.readfds = readfds;
+    s_vfstusb.writefds = writefds;
+    s_vfstusb.readfds_orig = *readfds;
+    s_vfstusb.writefds_orig = *writefds;
+    FD_ZERO(readfds);
+    FD_ZERO(writefds);
+    FD_ZERO(exceptfds);
+
+    // Report what is ready already
+    bool ready = false;
+    if (FD_ISSET(0, &s_vfstusb.readfds_orig) && ((rx_buffered() > 0 && !rx_cr_pending()) || tud_cdc_n_available(itf) > 0)) {
+        FD_SET(0, readfds);
+        ready = true;
+    }
+    if (FD_ISSET(0, &s_vfstusb.writefds_orig) && tud_cdc_n_write_available(itf) > 0) {
+        FD_SET(0, writefds);
+        ready = true;
+    }
+    if (ready) {
+        esp_vfs_select_triggered(select_sem);
+    }
+    portEXIT_CRITICAL(&s_select_lock);
+    return ESP_OK;
+}
+
+static esp_err_t tusb_end_select(void *end_select_args)
+{
+    (void) end_select_args;
+    portENTER_CRITICAL(&s_select_lock);
+    s_vfstusb.select_active = false;
+    portEXIT_CRITICAL(&s_select_lock);
+    return ESP_OK;
+}
+#endif
+
 esp_err_t esp_vfs_tusb_cdc_unregister(char const *path)
 {
     ESP_LOGD(TAG, "Unregistering CDC-VFS driver");
@@ -277,6 +506,10 @@ esp_err_t esp_vfs_tusb_cdc_register(int cdc_intf, char const *path)
         .open = &tusb_open,
         .read = &tusb_read,
         .write = &tusb_write,
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+        .start_select = &tusb_start_select,
+        .end_select = &tusb_end_select,
+#endif
     };
 
     res = esp_vfs_register(s_vfstusb.vfs_path, &vfs, NULL);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+
+// ---------- Benchmark mode (BRIDGE_BENCH builds) ----------
+// In-band commands let a host harness (test/host/bridge_bench.cpp) switch
+// each bridge interface between normal bridging and benchmark modes without
+// any extra USB plumbing.
+//
+// Command: one transfer of exactly BENCH_CMD_LEN bytes
+//   [magic "PAIB":4][mode:1][reserved:1][source chunk size:2]
+// Reply on the same interface: bench_status_t, counters since last command.
+//
+// Modes:
+//   BRIDGE  normal forwarding (default)
+//   SINK    discard everything received, count bytes
+//   SOURCE  stream chunks of the requested size as fast as USB allows
+//   PING    echo every transfer back; bytes [8, 16) of transfers that are at
+//           least 16 bytes long are overwritten with the device receive time
+//           (esp_timer, us)
+
+#define BENCH_MAGIC "PAIB"
+#define BENCH_CMD_LEN 8
+#define BENCH_PING_TS_OFFSET 8
+
+enum bench_mode_t : uint8_t {
+  BENCH_BRIDGE = 0,
+  BENCH_SINK = 1,
+  BENCH_SOURCE = 2,
+  BENCH_PING = 3,
+};
+
+typedef struct __attribute__((packed)) {
+  char magic[4];
+  uint8_t mode;
+  uint8_t reserved[3];
+  uint64_t rx_bytes;
+  uint64_t tx_bytes;
+} bench_status_t;
+
+static_assert(sizeof(bench_status_t) == 24, "bench_status_t wire size");
+
+#if BRIDGE_BENCH
+void bench_init(void);
+// Offer a received transfer to the benchmark layer. Returns true if it was
+// consumed (command or benchmark traffic) and must not be bridged.
+bool bench_intercept(uint8_t itf, uint8_t *data, size_t len);
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <esp_err.h>
+#include <sdkconfig.h>
+
+#include "config.h"
+#include "route.h"
+
+// ---------- Bridge ----------
+// Forwards traffic between ports as the routing matrix (route.h) says: one
+// task serves every CDC port, woken by a notification bit per port, so idle
+// ports cost nothing and each chunk is mirrored and translated once however
+// many ports it goes to. UART frames are routed from the UART driver task.
+//
+// Ports are numbered like capture sources and translation programs: CDC
+// interfaces first (CONFIG_TINYUSB_CDC_COUNT of them), then the UART.
+
+#define BRIDGE_CDC_PORTS CONFIG_TINYUSB_CDC_COUNT
+#if BRIDGE_UART_ENABLED
+#define BRIDGE_PORT_UART BRIDGE_CDC_PORTS
+#define BRIDGE_PORTS (BRIDGE_CDC_PORTS + 1)
+#else
+#define BRIDGE_PORTS BRIDGE_CDC_PORTS
+#endif
+
+static_assert(BRIDGE_PORTS <= ROUTE_MAX_PORTS, "too many bridge ports");
+
+// Install the CDC ports (and the UART when enabled) and start forwarding
+esp_err_t bridge_init(void);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "record.h"
+
+// ---------- Capture channel ----------
+// Bridged traffic is mirrored to the host over a dedicated vendor-class bulk
+// IN interface, so the bridge ports themselves stay transparent.
+//
+// Records use the COBS/CRC-16 framing of record.h. A SYNC record goes out
+// every CAPTURE_HEARTBEAT_MS so the host can tell an idle link from a dead
+// one and re-anchor the 64-bit device time, followed by a PERF record with
+// the device's performance counters.
+//
+// With CAPTURE_STORE the same records are also written to files on the
+// device (capture_store.h), with CAPTURE_NET streamed as UDP datagrams over
+// USB networking (capture_net.h).
+
+// Largest payload mirrored in one record (bigger messages count as dropped)
+#define CAPTURE_MAX_PAYLOAD RECORD_LZ_MAX_PAYLOAD
+#define CAPTURE_HEARTBEAT_MS 1000
+
+typedef struct {
+  uint32_t records;  // records written to the capture channel
+  uint32_t filtered; // messages rejected by the capture filter
+  uint32_t dropped;  // records lost: IN FIFO full or payload too large
+  // Compression (CAPTURE_COMPRESS): ratio = raw_bytes / wire_bytes, CPU
+  // cost = compress_us per second of capture
+  uint32_t raw_bytes;   // records before compression
+  uint32_t wire_bytes;  // bytes queued on the capture channel
+  uint32_t compress_us; // time spent in the compressor
+} capture_stats_t;
+
+void capture_init(void);
+// Serializes the capture filter and channel between bridge sources running
+// in different tasks (TinyUSB callbacks, UART service) and control requests
+void capture_lock(void);
+void capture_unlock(void);
+// Mirror one framed message, subject to the capture filter; the record is
+// timestamped here
+void capture_mirror(uint8_t src_itf, const uint8_t *data, size_t len);
+// Push any buffered records to the host
+void capture_flush(void);
+const capture_stats_t *capture_stats(void);
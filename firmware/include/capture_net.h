@@ -0,0 +1,49 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ---------- Capture over USB networking ----------
+// With CAPTURE_NET the device also appears as a USB NCM network adapter,
+// runs a DHCP server on it (device CAPTURE_NET_ADDR, host gets the next
+// address) and streams the capture channel as UDP datagrams, so the host
+// receives it through its ordinary network stack.
+//
+// A host subscribes by sending any datagram to CAPTURE_NET_ADDR port
+// CAPTURE_NET_PORT; records then go to the address and port it came from.
+// The subscription lapses after CAPTURE_NET_TIMEOUT_MS without a datagram,
+// so receivers repeat theirs about once a second.
+//
+// Datagrams carry whole records in the wire format of record.h, as many as
+// fit in one Ethernet frame. Datagram loss goes unnoticed by the device;
+// it shows as a seq gap, and since the LZ chain of CAPTURE_COMPRESS
+// restarts at every heartbeat it costs at most the compressed records up to
+// the next one.
+//
+// Records are handed to a ring that a low-priority task batches into
+// datagrams; they are dropped (and the seq jumps) when the ring is full.
+
+typedef struct {
+  uint32_t datagrams; // datagrams sent
+  uint32_t bytes;     // record bytes sent
+  uint32_t dropped;   // records the ring had no room for
+  uint32_t errors;    // failed sends, each loses one datagram
+} capture_net_stats_t;
+
+// MAC address the host side of the link uses, as the 12 hex digits of the
+// NCM iMACAddress string; available before the USB stack starts
+const char *capture_net_host_mac(void);
+
+// Bring up the network interface and the sender task (after
+// tinyusb_driver_install)
+esp_err_t capture_net_init(void);
+
+// ---- Called by capture.cpp with capture_lock() held ----
+// A host is subscribed
+bool capture_net_active(void);
+// Queue one encoded record; false if it was dropped (`len` 0 stands for a
+// record that could not be encoded)
+bool capture_net_write(const uint8_t *wire, size_t len);
+
+const capture_net_stats_t *capture_net_stats(void);
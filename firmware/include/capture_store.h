@@ -0,0 +1,67 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ---------- Capture store ----------
+// With CAPTURE_STORE the capture stream is also recorded to files on a FAT
+// volume in the "capture" flash partition, which the device exposes to the
+// host as a USB mass-storage LUN on request. Gigabytes then move with the
+// host OS's mass-storage path instead of through the capture channel.
+//
+// Files hold exactly the wire bytes of the capture channel (record.h),
+// named CAPTURE_STORE_PATH/CAPnnnnn.BIN. A segment is closed and the next
+// one opened once it holds CAPTURE_STORE_SEGMENT_KB; segments only start at
+// a heartbeat, so each begins with a SYNC record that anchors device time.
+//
+// The bridge never waits for the flash: records are handed to a ring that
+// a low-priority task drains into the file, and are dropped (counted in
+// capture_store_status_t::dropped) when the ring is full.
+//
+// The volume belongs to either the device or the host. Exposing it stops
+// recording and closes the open segment first; while exposed, nothing is
+// recorded.
+
+enum capture_store_state_t : uint8_t {
+  STORE_OFF = 0,   // no storage (build option off or init failed)
+  STORE_IDLE,      // mounted on the device, not recording
+  STORE_ARMED,     // recording starts at the next heartbeat
+  STORE_RECORDING, // appending to the current segment
+  STORE_STOPPING,  // draining the ring before closing the segment
+  STORE_EXPOSED,   // mounted by the USB host
+};
+
+// CTRL_STORE_STATUS reply, little-endian on the wire
+typedef struct __attribute__((packed)) {
+  uint8_t state; // capture_store_state_t
+  uint8_t reserved[3];
+  uint32_t segment;  // number of the current (or last) segment file
+  uint32_t bytes;    // bytes in that segment
+  uint32_t dropped;  // records the ring had no room for
+  uint32_t errors;   // failed file operations, each one stops recording
+  uint32_t free_kb;  // free space on the volume, as of the last segment
+} capture_store_status_t;
+
+static_assert(sizeof(capture_store_status_t) == 24,
+              "capture_store_status_t wire size");
+
+// Mount the volume (formatting it if needed) and start the writer task
+esp_err_t capture_store_init(void);
+
+// ---- Called by capture.cpp with capture_lock() held ----
+bool capture_store_recording(void);
+// Start or rotate segments; call before writing the heartbeat's SYNC record
+void capture_store_heartbeat(void);
+// Queue one encoded record; false if it was dropped (`len` 0 stands for a
+// record that could not be encoded)
+bool capture_store_write(const uint8_t *wire, size_t len);
+
+// ---- Requests, safe from any task (the writer task carries them out) ----
+// Arm recording into a new segment; false unless idle
+bool capture_store_start(void);
+void capture_store_stop(void);
+// Hand the volume to the USB host (`usb`), which stops a recording, or back
+// to the device; false if the storage is not in a state to switch
+bool capture_store_expose(bool usb);
+void capture_store_status(capture_store_status_t *out);
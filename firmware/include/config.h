@@ -0,0 +1,99 @@
+#pragma once
+
+// ---------- Bridge build configuration ----------
+// Override with -D flags (platformio.ini build_flags) as needed.
+
+// Replace CDC1 with a hardware UART on one side of the bridge
+#ifndef BRIDGE_UART_ENABLED
+#define BRIDGE_UART_ENABLED 0
+#endif
+
+#ifndef BRIDGE_UART_PORT
+#define BRIDGE_UART_PORT UART_NUM_1
+#endif
+
+// 5 Mbaud is the ceiling of the 80 MHz APB clock with the minimum divider
+#ifndef BRIDGE_UART_BAUD
+#define BRIDGE_UART_BAUD 5000000
+#endif
+
+// Frame delimiter for hardware pattern detection, -1 to frame on idle only
+#ifndef BRIDGE_UART_PATTERN
+#define BRIDGE_UART_PATTERN '\n'
+#endif
+
+#ifndef BRIDGE_UART_PATTERN_LEN
+#define BRIDGE_UART_PATTERN_LEN 1
+#endif
+
+// Line idle time, in symbol periods, that closes a frame
+#ifndef BRIDGE_UART_IDLE_SYMBOLS
+#define BRIDGE_UART_IDLE_SYMBOLS 10
+#endif
+
+// Compile in the in-band benchmark commands (bench.h)
+#ifndef BRIDGE_BENCH
+#define BRIDGE_BENCH 0
+#endif
+
+// Compress capture records (lz.h); costs ~6 KB of RAM and some CPU per
+// record, pays off on repetitive traffic near the USB full-speed ceiling
+#ifndef CAPTURE_COMPRESS
+#define CAPTURE_COMPRESS 0
+#endif
+
+// Record the capture stream to files on a FAT partition that the host can
+// mount over USB (capture_store.h). Needs CONFIG_TINYUSB_MSC_ENABLED and a
+// partition table with a "capture" data/fat partition
+// (partitions_capture.csv). MSC takes one more pair of endpoints: on the
+// ESP32-S3 that leaves room for a single CDC port next to the capture
+// interface.
+#ifndef CAPTURE_STORE
+#define CAPTURE_STORE 0
+#endif
+
+#ifndef CAPTURE_STORE_PARTITION
+#define CAPTURE_STORE_PARTITION "capture"
+#endif
+
+#ifndef CAPTURE_STORE_PATH
+#define CAPTURE_STORE_PATH "/capture"
+#endif
+
+// Segment files are closed at the first heartbeat past this size
+#ifndef CAPTURE_STORE_SEGMENT_KB
+#define CAPTURE_STORE_SEGMENT_KB 4096
+#endif
+
+// Records waiting for the flash; absorbs erase stalls of ~100 ms at full
+// USB speed
+#ifndef CAPTURE_STORE_RING_KB
+#define CAPTURE_STORE_RING_KB 128
+#endif
+
+// Stream the capture channel as UDP over a USB NCM network interface
+// (capture_net.h). Needs CONFIG_TINYUSB_NET_MODE_NCM; NCM takes as many
+// endpoints as a CDC port, so on the ESP32-S3 it fits next to the capture
+// interface with one CDC port and no capture store.
+#ifndef CAPTURE_NET
+#define CAPTURE_NET 0
+#endif
+
+// Device address on the link; the DHCP server leases the next ones
+#ifndef CAPTURE_NET_ADDR
+#define CAPTURE_NET_ADDR "192.168.7.1"
+#endif
+
+#ifndef CAPTURE_NET_PORT
+#define CAPTURE_NET_PORT 5270
+#endif
+
+// Subscriptions lapse after this long without a datagram from the host
+#ifndef CAPTURE_NET_TIMEOUT_MS
+#define CAPTURE_NET_TIMEOUT_MS 3000
+#endif
+
+// Records waiting to be batched into datagrams
+#ifndef CAPTURE_NET_RING_KB
+#define CAPTURE_NET_RING_KB 32
+#endif
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+// ---------- Vendor control requests ----------
+// Device-recipient vendor requests (bmRequestType 0x40 OUT / 0xC0 IN) used by
+// the host to configure and inspect the bridge at runtime.
+
+enum control_request_t : uint8_t {
+  // OUT, no data: drop all capture filter rules
+  CTRL_FILTER_CLEAR = 0x10,
+  // OUT, wValue = rule index, data = filter_rule_t
+  CTRL_FILTER_STAGE = 0x11,
+  // OUT, no data: wValue = rule count, wIndex = fallback filter_action_t
+  CTRL_FILTER_COMMIT = 0x12,
+  // IN, data = capture_stats_t
+  CTRL_CAPTURE_STATS = 0x13,
+  // IN, data = int64 device time (esp_timer, us) sampled when the SETUP
+  // packet is handled; hosts bracket it with their own clock (NTP-style)
+  CTRL_CLOCK_SYNC = 0x14,
+  // OUT, wValue = byte offset, data = program bytes (translate.h)
+  CTRL_XLATE_STAGE = 0x20,
+  // OUT, no data: wValue = program length, wIndex = source interface
+  CTRL_XLATE_COMMIT = 0x21,
+  // OUT, no data: wIndex = source interface
+  CTRL_XLATE_CLEAR = 0x22,
+  // OUT, no data: wIndex = source port, wValue = destination port mask
+  CTRL_ROUTE_SET = 0x30,
+  // IN, data = destination mask per port (route.h), one byte each
+  CTRL_ROUTE_GET = 0x31,
+  // IN, data = perf_device_t (perf.h)
+  CTRL_PERF_DEVICE = 0x40,
+  // IN, wIndex = port, data = perf_port_t
+  CTRL_PERF_PORT = 0x41,
+  // OUT, no data: zero all performance counters
+  CTRL_PERF_RESET = 0x42,
+  // OUT, no data: record the capture stream into a new segment file from
+  // the next heartbeat on (capture_store.h)
+  CTRL_STORE_START = 0x50,
+  // OUT, no data: close the segment being recorded
+  CTRL_STORE_STOP = 0x51,
+  // OUT, no data: wValue = 1 hands the volume to the host as a USB drive,
+  // 0 takes it back; poll CTRL_STORE_STATUS for the outcome
+  CTRL_STORE_EXPOSE = 0x52,
+  // IN, data = capture_store_status_t
+  CTRL_STORE_STATUS = 0x53,
+};
+
+// Largest data stage accepted by any request
+#define CTRL_MAX_DATA_LEN 64
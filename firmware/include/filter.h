@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ---------- Capture filter ----------
+// Host-configurable match/mask table evaluated once per framed message before
+// it is mirrored to the capture channel. Bridged traffic is never filtered;
+// only what is copied to the host for capture.
+//
+// Rules are evaluated in order, first match wins. A rule matches when
+//   (header & mask) == match  &&  min_len <= len <= max_len
+// where `header` is the first FILTER_HEADER_LEN bytes of the message
+// (zero-padded for shorter messages). A matching rule then either drops the
+// message or passes one out of every `decimate` matches.
+//
+// The table itself is not locked; callers hold capture_lock() (capture.h).
+
+#define FILTER_HEADER_LEN 8
+#define FILTER_MAX_RULES 16
+
+enum filter_action_t : uint8_t {
+  FILTER_DROP = 0,
+  FILTER_PASS = 1,
+};
+
+// Wire format of one rule as uploaded by the host (little-endian, packed)
+typedef struct __attribute__((packed)) {
+  uint8_t match[FILTER_HEADER_LEN];
+  uint8_t mask[FILTER_HEADER_LEN];
+  uint16_t min_len;  // inclusive
+  uint16_t max_len;  // inclusive, 0 = unbounded
+  uint16_t decimate; // pass 1 of every N matches, 0 or 1 = every match
+  uint8_t itf_mask;  // bit per source interface, 0 = all interfaces
+  uint8_t action;    // filter_action_t
+} filter_rule_t;
+
+static_assert(sizeof(filter_rule_t) == 24, "filter_rule_t wire size changed");
+
+// Stage one rule into the shadow table (does not affect live filtering)
+bool filter_stage_rule(uint8_t index, const filter_rule_t *rule);
+// Atomically replace the live table with the first `count` staged rules.
+// `fallback` is applied to messages matched by no rule.
+bool filter_commit(uint8_t count, filter_action_t fallback);
+// Drop all rules, pass everything
+void filter_clear(void);
+// Evaluate the live table; true if the message should be captured
+bool filter_eval(uint8_t src_itf, const uint8_t *data, size_t len);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ---------- Streaming LZ compressor ----------
+// Low-RAM LZ77 for the capture stream. Blocks (one capture record each) are
+// compressed against a sliding history that spans previous blocks, so small
+// repetitive frames of polling protocols compress to a few bytes each.
+//
+// Block format is LZ4's sequence format, byte aligned so the host side can
+// decode with wide copies:
+//   token      [literals:4 | match - LZ_MIN_MATCH:4], 15 = length continues
+//   literals   extra length bytes (255 = continues), then the literals
+//   offset     u16le distance back into the history, 1..LZ_WINDOW
+//   match      extra length bytes (255 = continues)
+// The last sequence of a block has literals only and ends the block.
+//
+// Encoder and decoder must see the same blocks in the same order; after a
+// loss both sides restart from an empty history (lz_reset()).
+//
+// RAM: 2 * LZ_WINDOW history + 2^LZ_HASH_BITS * 2 bytes of match index.
+
+#define LZ_WINDOW 2048
+#define LZ_HASH_BITS 10
+#define LZ_MIN_MATCH 4
+// Worst-case compressed size of an `n`-byte block
+#define LZ_BOUND(n) ((n) + (n) / 255 + 16)
+
+typedef struct {
+  uint8_t hist[2 * LZ_WINDOW];
+  uint16_t index[1 << LZ_HASH_BITS]; // history position + 1, 0 = empty
+  size_t len;                        // bytes of history in use
+} lz_encoder_t;
+
+void lz_reset(lz_encoder_t *lz);
+
+// Compress one block of at most LZ_WINDOW bytes; the block becomes history
+// for the following ones. Returns the compressed size, or 0 if the block is
+// too large or `cap` too small (the history is reset in that case).
+size_t lz_compress(lz_encoder_t *lz, const uint8_t *in, size_t len,
+                   uint8_t *out, size_t cap);
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ---------- Performance counters ----------
+// Cheap always-on counters of the bridge, to tell device-side bottlenecks
+// from host-side ones. Updated with relaxed atomics from whichever task does
+// the work; readers get a consistent value per field, not per snapshot.
+//
+// All counters run from boot (or the last perf_reset()); hosts derive rates
+// from the difference of two snapshots. They are read through
+// CTRL_PERF_DEVICE / CTRL_PERF_PORT and sent on the capture channel as a
+// PERF record with every heartbeat (record.h).
+
+#define PERF_MAX_PORTS 8
+
+// Per bridge port (route.h numbering), little-endian on the wire
+typedef struct __attribute__((packed)) {
+  uint32_t rx_bytes;  // read from the port
+  uint32_t rx_chunks; // reads (CDC) or frames (UART)
+  uint32_t tx_bytes;  // queued for the port
+  uint32_t tx_chunks;
+  uint32_t tx_full;     // writes cut short by a full TX FIFO
+  uint16_t rx_fifo_hwm; // most bytes found waiting in the RX FIFO
+  uint16_t tx_fifo_hwm; // most bytes pending in the TX FIFO after a write
+  // Time from data being signalled on the port to it being forwarded, us
+  uint32_t latency_min;
+  uint32_t latency_max;
+  uint32_t latency_total; // average = latency_total / latency_count
+  uint32_t latency_count;
+} perf_port_t;
+
+static_assert(sizeof(perf_port_t) == 40, "perf_port_t wire size");
+
+typedef struct __attribute__((packed)) {
+  uint32_t uptime_ms;
+  uint32_t tud_loops; // passes of the TinyUSB task loop
+  uint8_t ports;      // number of perf_port_t that follow in a PERF record
+  uint8_t reserved[3];
+} perf_device_t;
+
+static_assert(sizeof(perf_device_t) == 12, "perf_device_t wire size");
+
+void perf_init(uint8_t ports);
+void perf_reset(void);
+
+void perf_rx(uint8_t port, size_t len, size_t fifo_level);
+// `queued` of `len` bytes made it into the TX FIFO, leaving `fifo_level`
+void perf_tx(uint8_t port, size_t len, size_t queued, size_t fifo_level);
+void perf_latency(uint8_t port, uint32_t us);
+void perf_task_loop(void);
+
+void perf_read_device(perf_device_t *out);
+bool perf_read_port(uint8_t port, perf_port_t *out);
@@ -1,7 +1,12 @@
 #pragma once
 
 #include <driver/gpio.h>
+// RGB LED is common anode (active low), LED_BUILTIN is active high
 #define LED_GREEN (gpio_num_t)0
 #define LED_BLUE (gpio_num_t)45
 #define LED_RED (gpio_num_t)46
 #define LED_BUILTIN (gpio_num_t)48
+
+// UART bridge (header D2 / D3); UART0 pins stay with the console
+#define UART_BRIDGE_TX (gpio_num_t)5
+#define UART_BRIDGE_RX (gpio_num_t)6
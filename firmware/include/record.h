@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lz.h"
+#include "perf.h"
+
+// ---------- Capture record protocol ----------
+// Records on the capture channel are COBS-encoded and terminated by a zero
+// byte, so a host that lost bytes (dropped USB packets, read hiccups) skips
+// to the next zero and is back in sync after at most one record.
+//
+// Decoded record (little-endian):
+//   [type:1][seq:4][time:4][body...][crc:2]
+//
+//   seq   increments for every record the device produced, including those
+//         it had to drop because the host was not reading: a jump in seq is
+//         exactly the number of records lost
+//   time  low 32 bits of esp_timer (us); SYNC records carry the high half
+//   crc   CRC-16/CCITT-FALSE over everything before it
+//
+// Bodies:
+//   DATA  [src_itf:1][payload...]
+//   SYNC  [time_hi:4][records:4][filtered:4][dropped:4]
+//         sent periodically as a heartbeat, also when the link is idle
+//   PERF  [perf_device_t][perf_port_t * ports]
+//         device performance counters (perf.h), follows every SYNC
+//
+// Compressed streams (CAPTURE_COMPRESS, lz.h) wrap each DATA record, CRC
+// included, in an LZ frame instead:
+//   LZ        [type:1][lz block...]   (no header, no CRC of its own)
+// The block decompresses to one complete record. RECORD_LZ_START marks a
+// block compressed against an empty history, RECORD_LZ one that continues
+// the chain; after any loss the host discards LZ frames until the next
+// RECORD_LZ_START.
+// Inside LZ blocks seq and time hold the difference to the previous record
+// of the chain (absolute after a reset), so they repeat from record to
+// record; the CRC covers the original values.
+//
+// Mirrored by core/include/CaptureDecoder.h on the host.
+
+enum record_type_t : uint8_t {
+  RECORD_DATA = 0x01,
+  RECORD_SYNC = 0x02,
+  RECORD_LZ = 0x03,
+  RECORD_LZ_START = 0x04,
+  RECORD_PERF = 0x05,
+};
+
+#define RECORD_HEADER_LEN 9
+#define RECORD_CRC_LEN 2
+#define RECORD_DATA_OVERHEAD (RECORD_HEADER_LEN + 1 + RECORD_CRC_LEN)
+#define RECORD_SYNC_LEN (RECORD_HEADER_LEN + 16 + RECORD_CRC_LEN)
+#define RECORD_PERF_MAX_LEN                                                    \
+  (RECORD_HEADER_LEN + sizeof(perf_device_t) +                                 \
+   PERF_MAX_PORTS * sizeof(perf_port_t) + RECORD_CRC_LEN)
+// Worst-case wire size of a decoded record of `n` bytes: one COBS code byte
+// per 254 data bytes, the leading code byte and the delimiter
+#define RECORD_ENCODED_MAX(n) ((n) + (n) / 254 + 2)
+// Largest payload of a compressed DATA record
+#define RECORD_LZ_MAX_PAYLOAD 1024
+#define RECORD_LZ_ENCODED_MAX                                                  \
+  RECORD_ENCODED_MAX(1 + LZ_BOUND(RECORD_DATA_OVERHEAD + RECORD_LZ_MAX_PAYLOAD))
+
+uint16_t record_crc16(const uint8_t *data, size_t len);
+
+// Encode one record into `out` (wire format, delimiter included). Returns
+// the number of bytes written, or 0 if `cap` is too small.
+size_t record_encode_data(uint8_t *out, size_t cap, uint32_t seq,
+                          uint64_t time_us, uint8_t src_itf,
+                          const uint8_t *payload, size_t len);
+size_t record_encode_sync(uint8_t *out, size_t cap, uint32_t seq,
+                          uint64_t time_us, uint32_t records,
+                          uint32_t filtered, uint32_t dropped);
+// `dev->ports` entries of `ports` are encoded
+size_t record_encode_perf(uint8_t *out, size_t cap, uint32_t seq,
+                          uint64_t time_us, const perf_device_t *dev,
+                          const perf_port_t *ports);
+
+// ---------- Compressed records ----------
+
+typedef struct {
+  lz_encoder_t lz;
+  uint32_t seq, time; // previous record of the chain (delta coding)
+  uint8_t raw[RECORD_DATA_OVERHEAD + RECORD_LZ_MAX_PAYLOAD];
+  uint8_t block[LZ_BOUND(RECORD_DATA_OVERHEAD + RECORD_LZ_MAX_PAYLOAD)];
+} record_compressor_t;
+
+// Start a new chain: the next record is compressed against an empty history
+// (RECORD_LZ_START). Required whenever a record produced by
+// record_encode_compressed() does not reach the host.
+void record_compressor_reset(record_compressor_t *c);
+
+// Encode a DATA record as an LZ frame (wire format, delimiter included).
+// Returns the number of bytes written, or 0 on failure (the chain restarts).
+size_t record_encode_compressed(record_compressor_t *c, uint8_t *out,
+                                size_t cap, uint32_t seq, uint64_t time_us,
+                                uint8_t src_itf, const uint8_t *payload,
+                                size_t len);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ---------- Routing matrix ----------
+// Every bridge port (CDC interfaces in order, then the hardware UART when one
+// is bridged) has a destination set: a bit per port that receives what the
+// port reads. A port routed to itself echoes, an empty set discards.
+//
+// Entries are single atomic bytes: the bridge reads one per received chunk,
+// the control endpoint may replace any of them at any time.
+
+#define ROUTE_MAX_PORTS 8
+
+typedef uint8_t route_mask_t;
+
+// Reset to the default table: CDC0 <-> UART when `has_uart`, otherwise
+// neighbouring CDC ports paired up (0 <-> 1, 2 <-> 3, ...) with an unpaired
+// last port echoing. Remaining ports start out unrouted.
+void route_init(uint8_t cdc_ports, bool has_uart);
+uint8_t route_ports(void);
+// Fails for an unknown source or a destination outside the port range
+bool route_set(uint8_t src, route_mask_t dst);
+route_mask_t route_get(uint8_t src);
+// Copy the whole table, one mask per port; returns the number of ports
+size_t route_snapshot(route_mask_t *out, size_t cap);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// ---------- Activity / status indicator ----------
+// Hot paths only raise a flag (one relaxed byte store, no locks, no RTOS
+// calls); a low-priority task samples the flags every STATUS_TICK_MS and
+// renders them on the LEDs of pinout.h:
+//
+//   builtin LED  activity, lit for STATUS_ACTIVITY_MS after the last chunk
+//   RGB          red: error (STATUS_ERROR_MS), blue: overflow / drops
+//                (STATUS_OVERFLOW_MS), green: activity; highest wins
+
+#define STATUS_TICK_MS 20
+#define STATUS_ACTIVITY_MS 40
+#define STATUS_OVERFLOW_MS 500
+#define STATUS_ERROR_MS 1000
+
+enum status_event_t : uint8_t {
+  STATUS_ACTIVITY = 0, // traffic forwarded
+  STATUS_OVERFLOW,     // data dropped for lack of buffer space
+  STATUS_ERROR,        // faults: read errors, translation faults
+  STATUS_EVENTS
+};
+
+extern std::atomic<bool> g_status_flags[STATUS_EVENTS];
+
+static inline void status_signal(status_event_t event) {
+  g_status_flags[event].store(true, std::memory_order_relaxed);
+}
+
+void status_init(void);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ---------- Protocol translation VM ----------
+// A host-uploaded bytecode program runs once per framed message, inline in
+// the bridge, and may rewrite, drop, duplicate or inject frames.
+//
+// Latency is bounded by construction: jumps only go forward, so every
+// instruction executes at most once, and the only per-byte instructions are
+// the checksum ops (bounded by the frame size).
+//
+// Machine model: one 16-bit accumulator, the frame being forwarded (edited
+// in place, may grow up to the caller's capacity). Frame offsets are signed
+// bytes: negative values count from the end (-1 = last byte). Range ends
+// are exclusive. Any out-of-range access faults and the frame is dropped.
+//
+// Encoding: opcode byte followed by its operands (16-bit immediates are
+// little-endian).
+
+enum xlate_op_t : uint8_t {
+  XOP_END = 0x00,      //                              pass (end of program)
+  XOP_PASS = 0x01,     //                              forward and stop
+  XOP_DROP = 0x02,     //                              drop and stop
+  XOP_LD8 = 0x10,      // off                          acc = frame[off]
+  XOP_LD16 = 0x11,     // off                          acc = u16le at off
+  XOP_LDLEN = 0x12,    //                              acc = frame length
+  XOP_ST8 = 0x18,      // off                          frame[off] = acc
+  XOP_ST16 = 0x19,     // off                          u16le at off = acc
+  XOP_SET8 = 0x1A,     // off imm8                     frame[off] = imm8
+  XOP_AND = 0x20,      // imm16                        acc &= imm16
+  XOP_ADD = 0x21,      // imm16                        acc += imm16
+  XOP_XOR = 0x22,      // imm16                        acc ^= imm16
+  XOP_JEQ = 0x30,      // imm16 rel                    skip rel bytes if ==
+  XOP_JNE = 0x31,      // imm16 rel                    skip rel bytes if !=
+  XOP_JLT = 0x32,      // imm16 rel                    skip rel bytes if <
+  XOP_JMP = 0x33,      // rel                          skip rel bytes
+  XOP_INSERT = 0x40,   // off n bytes[n]               insert before off
+  XOP_DELETE = 0x41,   // off n                        remove n bytes at off
+  XOP_CSUM_XOR = 0x50, // from to at                   frame[at] = xor
+  XOP_CSUM_CRC8 = 0x51, // from to at                  CRC-8/DVB-S2 (MSPv2)
+  XOP_INJECT = 0x60,   // n bytes[n]                   emit literal frame
+  XOP_EMIT = 0x61,     //                              emit copy of frame
+};
+
+enum xlate_verdict_t : uint8_t {
+  XLATE_PASS = 0,
+  XLATE_DROP = 1,
+  XLATE_FAULT = 2, // out-of-range access, frame is dropped
+};
+
+#define XLATE_MAX_CODE 256
+// Bridge ports that can carry a program (up to four CDC ports and the UART)
+#define XLATE_MAX_SOURCES 5
+
+// Receives injected or duplicated frames; they go out before the frame
+// being processed
+typedef void (*xlate_emit_cb_t)(void *arg, const uint8_t *data, size_t len);
+
+// Check that a program is well-formed: known opcodes, complete operands and
+// jump targets on instruction boundaries within the program
+bool xlate_verify(const uint8_t *code, size_t code_len);
+
+// Run a verified program over `frame` (`*len` bytes used, `cap` available)
+xlate_verdict_t xlate_run(const uint8_t *code, size_t code_len, uint8_t *frame,
+                          size_t *len, size_t cap, xlate_emit_cb_t emit,
+                          void *arg);
+
+// ---------- Program table ----------
+// Programs are uploaded in chunks into a staging area and verified before
+// they replace the live program of a source. Callers serialize access
+// (capture_lock(), shared with the capture filter).
+
+bool xlate_stage(uint16_t offset, const uint8_t *data, size_t len);
+bool xlate_commit(uint8_t src, uint16_t code_len);
+void xlate_clear(uint8_t src);
+bool xlate_active(uint8_t src);
+// Run the live program of `src`; sources without a program pass unchanged
+xlate_verdict_t xlate_apply(uint8_t src, uint8_t *frame, size_t *len,
+                            size_t cap, xlate_emit_cb_t emit, void *arg);
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "uart_link.h"
+
+// ---------- Hardware UART bridge side ----------
+// Drives uart_link with the ESP-IDF UART driver: RX/TX ring buffers, RX
+// FIFO-full and idle-timeout interrupts, and hardware pattern detection for
+// frame boundaries. Frames are delivered from a dedicated high-priority task.
+
+typedef void (*uart_bridge_frame_cb_t)(const uint8_t *frame, size_t len);
+
+esp_err_t uart_bridge_init(uart_bridge_frame_cb_t on_frame);
+// Queue bytes for transmission; blocks while the TX ring buffer is full
+size_t uart_bridge_write(const uint8_t *data, size_t len);
+const uart_link_stats_t *uart_bridge_stats(void);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ---------- UART link framing ----------
+// Hardware-independent half of the UART bridge. The driver glue
+// (uart_bridge.cpp) translates UART driver events into the calls below and
+// supplies the byte I/O through uart_link_ops_t, so a host-side stub UART can
+// drive the exact same framing logic.
+//
+// Frame boundaries come from, in order of preference:
+//   1. hardware pattern detection (a run of `pattern` characters)
+//   2. RX idle timeout reported by the driver
+//   3. the frame buffer filling up (frame is split)
+
+#define UART_LINK_FRAME_MAX 1024
+
+typedef struct {
+  void *ctx;
+  // Read exactly `len` bytes already buffered by the driver, returns count
+  int (*read)(void *ctx, uint8_t *buf, size_t len);
+  // Write `len` bytes to the wire, returns count accepted
+  int (*write)(void *ctx, const uint8_t *buf, size_t len);
+} uart_link_ops_t;
+
+typedef void (*uart_link_frame_cb_t)(void *arg, const uint8_t *frame,
+                                     size_t len);
+
+typedef struct {
+  uint32_t frames;    // frames delivered
+  uint32_t splits;    // frames cut because the buffer filled up
+  uint32_t overflows; // partial frames discarded after a driver overflow
+} uart_link_stats_t;
+
+typedef struct {
+  uart_link_ops_t ops;
+  uart_link_frame_cb_t on_frame;
+  void *arg;
+  uart_link_stats_t stats;
+  size_t len;
+  uint8_t buf[UART_LINK_FRAME_MAX];
+} uart_link_t;
+
+void uart_link_init(uart_link_t *link, const uart_link_ops_t *ops,
+                    uart_link_frame_cb_t on_frame, void *arg);
+// `available` bytes were received; `idle` if the line went quiet after them
+void uart_link_on_data(uart_link_t *link, size_t available, bool idle);
+// A pattern ends `end` bytes into the driver buffer (pattern included)
+void uart_link_on_pattern(uart_link_t *link, size_t end);
+// The driver lost data (FIFO or ring buffer overflow); drop the partial frame
+void uart_link_on_overflow(uart_link_t *link);
+// Send bytes from the other side of the bridge to the wire
+size_t uart_link_send(uart_link_t *link, const uint8_t *data, size_t len);
@@ -0,0 +1,119 @@
+#include "config.h"
+
+#if BRIDGE_BENCH
+
+#include <atomic>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <string.h>
+#include <tinyusb_cdc_acm.h>
+
+#include "bench.h"
+#include "bridge.h"
+
+static const char *TAG = "bench";
+
+#define BENCH_MAX_ITF BRIDGE_CDC_PORTS
+#define BENCH_CHUNK_MAX CONFIG_TINYUSB_CDC_TX_BUFSIZE
+#define BENCH_TASK_PRIO 5
+#define BENCH_TASK_STACK 3072
+
+typedef struct {
+  std::atomic<uint8_t> mode;
+  std::atomic<uint16_t> chunk;
+  std::atomic<uint64_t> rx_bytes;
+  std::atomic<uint64_t> tx_bytes;
+} bench_itf_t;
+
+static bench_itf_t s_itf[BENCH_MAX_ITF];
+static TaskHandle_t s_source_task = nullptr;
+
+#define ITF(val) static_cast<tinyusb_cdcacm_itf_t>(val)
+
+static void send(uint8_t itf, const uint8_t *data, size_t len) {
+  size_t n = tinyusb_cdcacm_write_queue(ITF(itf), data, len);
+  tinyusb_cdcacm_write_flush(ITF(itf), 0);
+  s_itf[itf].tx_bytes.fetch_add(n, std::memory_order_relaxed);
+}
+
+// Streams chunks on every interface in SOURCE mode, sleeps otherwise
+static void source_task(void *) {
+  static uint8_t pattern[BENCH_CHUNK_MAX];
+  for (size_t i = 0; i < sizeof(pattern); i++)
+    pattern[i] = (uint8_t)i;
+  for (;;) {
+    bool active = false;
+    for (uint8_t itf = 0; itf < BENCH_MAX_ITF; itf++) {
+      if (s_itf[itf].mode.load(std::memory_order_relaxed) != BENCH_SOURCE)
+        continue;
+      active = true;
+      size_t n = tinyusb_cdcacm_write_queue(ITF(itf), pattern,
+                                            s_itf[itf].chunk.load());
+      tinyusb_cdcacm_write_flush(ITF(itf), 0);
+      s_itf[itf].tx_bytes.fetch_add(n, std::memory_order_relaxed);
+      if (n == 0)
+        vTaskDelay(1); // TX FIFO full, let the host drain it
+    }
+    if (!active)
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
+static void command(uint8_t itf, const uint8_t *cmd) {
+  bench_itf_t &b = s_itf[itf];
+  bench_status_t status = {};
+  memcpy(status.magic, BENCH_MAGIC, sizeof(status.magic));
+  // Report counters of the mode being left, then start over
+  status.mode = b.mode.load();
+  status.rx_bytes = b.rx_bytes.exchange(0);
+  status.tx_bytes = b.tx_bytes.exchange(0);
+
+  uint16_t chunk = (uint16_t)(cmd[6] | (cmd[7] << 8));
+  if (chunk == 0 || chunk > BENCH_CHUNK_MAX)
+    chunk = BENCH_CHUNK_MAX;
+  b.chunk.store(chunk);
+  b.mode.store(cmd[4] <= BENCH_PING ? cmd[4] : (uint8_t)BENCH_BRIDGE);
+  ESP_LOGI(TAG, "itf%u: mode %u, chunk %u", itf, (unsigned)b.mode.load(),
+           (unsigned)chunk);
+
+  tinyusb_cdcacm_write_queue(ITF(itf), reinterpret_cast<uint8_t *>(&status),
+                             sizeof(status));
+  tinyusb_cdcacm_write_flush(ITF(itf), 0);
+  if (b.mode.load() == BENCH_SOURCE)
+    xTaskNotifyGive(s_source_task);
+}
+
+void bench_init(void) {
+  xTaskCreate(source_task, "bench_src", BENCH_TASK_STACK, nullptr,
+              BENCH_TASK_PRIO, &s_source_task);
+}
+
+bool bench_intercept(uint8_t itf, uint8_t *data, size_t len) {
+  if (itf >= BENCH_MAX_ITF)
+    return false;
+  if (len == BENCH_CMD_LEN && memcmp(data, BENCH_MAGIC, 4) == 0) {
+    command(itf, data);
+    return true;
+  }
+  bench_itf_t &b = s_itf[itf];
+  switch (b.mode.load(std::memory_order_relaxed)) {
+  case BENCH_SINK:
+  case BENCH_SOURCE:
+    b.rx_bytes.fetch_add(len, std::memory_order_relaxed);
+    return true;
+  case BENCH_PING:
+    b.rx_bytes.fetch_add(len, std::memory_order_relaxed);
+    if (len >= BENCH_PING_TS_OFFSET + sizeof(int64_t)) {
+      int64_t now = esp_timer_get_time();
+      memcpy(data + BENCH_PING_TS_OFFSET, &now, sizeof(now));
+    }
+    send(itf, data, len);
+    return true;
+  default:
+    return false;
+  }
+}
+
+#endif // BRIDGE_BENCH
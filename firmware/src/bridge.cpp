@@ -0,0 +1,203 @@
+#include <atomic>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <string.h>
+#include <tinyusb.h>
+#include <tinyusb_cdc_acm.h>
+
+#include "bench.h"
+#include "bridge.h"
+#include "capture.h"
+#include "perf.h"
+#include "status.h"
+#include "translate.h"
+#include "uart_bridge.h"
+
+extern "C" {
+#include "tusb.h"
+}
+
+static const char *TAG = "bridge";
+
+#define BRIDGE_TASK_PRIO 6
+#define BRIDGE_TASK_STACK 4096
+// Room for frames grown by the translation program (XOP_INSERT)
+#define XLATE_HEADROOM 64
+
+static_assert(BRIDGE_CDC_PORTS <= TINYUSB_CDC_ACM_MAX, "CDC port count");
+static_assert(BRIDGE_PORTS <= XLATE_MAX_SOURCES, "translation sources");
+
+#define ITF(val) static_cast<tinyusb_cdcacm_itf_t>(val)
+#define PORT_BIT(port) (1u << (port))
+
+static TaskHandle_t s_task = nullptr;
+// Only the bridge task reads CDC ports
+static uint8_t s_rx[CONFIG_TINYUSB_CDC_RX_BUFSIZE + XLATE_HEADROOM];
+// When each port's pending data was signalled (esp_timer, low 32 bits of
+// us, 0 = nothing pending), for perf_latency()
+static std::atomic<uint32_t> s_signalled[BRIDGE_PORTS];
+
+static inline uint32_t now_us(void) {
+  return (uint32_t)esp_timer_get_time() | 1;
+}
+
+// Run the translation program of `src` over a frame; false if it was dropped
+static bool translate(uint8_t src, uint8_t *frame, size_t *len, size_t cap,
+                      xlate_emit_cb_t emit, void *arg) {
+  capture_lock();
+  xlate_verdict_t verdict = xlate_apply(src, frame, len, cap, emit, arg);
+  capture_unlock();
+  if (verdict == XLATE_FAULT) {
+    ESP_LOGW(TAG, "Translation fault on port %u, frame dropped", src);
+    status_signal(STATUS_ERROR);
+  }
+  return verdict == XLATE_PASS;
+}
+
+// Queue `data` on every port in `dst`
+static void send(route_mask_t dst, const uint8_t *data, size_t len) {
+  for (unsigned todo = dst; todo; todo &= todo - 1) {
+    const unsigned port = __builtin_ctz(todo);
+#if BRIDGE_UART_ENABLED
+    if (port == BRIDGE_PORT_UART) {
+      perf_tx(port, len, uart_bridge_write(data, len), 0);
+      continue;
+    }
+#endif
+    const size_t queued = tinyusb_cdcacm_write_queue(ITF(port), data, len);
+    perf_tx(port, len, queued,
+            CFG_TUD_CDC_TX_BUFSIZE - tud_cdc_n_write_available(port));
+    if (queued < len)
+      status_signal(STATUS_OVERFLOW);
+  }
+}
+
+static void flush(route_mask_t dst) {
+  for (unsigned todo = dst & (PORT_BIT(BRIDGE_CDC_PORTS) - 1); todo;
+       todo &= todo - 1)
+    (void)tinyusb_cdcacm_write_flush(ITF(__builtin_ctz(todo)), 0);
+}
+
+static void emit_to_ports(void *arg, const uint8_t *data, size_t len) {
+  send((route_mask_t)(uintptr_t)arg, data, len);
+}
+
+// Mirror one chunk received on `src` to the capture channel, run its
+// translation program and send the result to every port it is routed to.
+// Programs rewrite in `scratch` (`cap` bytes), which may alias `data`.
+static void forward(uint8_t src, const uint8_t *data, size_t len,
+                    uint8_t *scratch, size_t cap) {
+  const route_mask_t dst = route_get(src);
+  // mirror to the host capture channel (each USB chunk is one message)
+  capture_mirror(src, data, len);
+  capture_flush();
+  if (dst && xlate_active(src)) {
+    if (scratch != data)
+      memcpy(scratch, data, len);
+    data = scratch;
+    if (!translate(src, scratch, &len, cap, emit_to_ports,
+                   (void *)(uintptr_t)dst))
+      len = 0;
+  }
+  if (len > 0)
+    send(dst, data, len);
+  flush(dst);
+  status_signal(STATUS_ACTIVITY);
+}
+
+// Read one chunk from a CDC port; true if more data may be waiting
+static bool receive(uint8_t port) {
+  const size_t waiting = tud_cdc_n_available(port);
+  size_t rx_size = 0;
+  esp_err_t ret = tinyusb_cdcacm_read(ITF(port), s_rx,
+                                      CONFIG_TINYUSB_CDC_RX_BUFSIZE, &rx_size);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "CDC read error on port %u: %s", port,
+             esp_err_to_name(ret));
+    status_signal(STATUS_ERROR);
+    s_signalled[port].store(0, std::memory_order_relaxed);
+    return false;
+  }
+  const bool more = rx_size == CONFIG_TINYUSB_CDC_RX_BUFSIZE;
+  if (rx_size > 0) {
+    perf_rx(port, rx_size, waiting);
+#if BRIDGE_BENCH
+    if (bench_intercept(port, s_rx, rx_size))
+      return true;
+#endif
+    ESP_LOGD(TAG, "Forward %u bytes from port %u to 0x%02x",
+             (unsigned)rx_size, port, route_get(port));
+    ESP_LOG_BUFFER_HEXDUMP(TAG, s_rx, rx_size, ESP_LOG_DEBUG);
+    forward(port, s_rx, rx_size, s_rx, sizeof(s_rx));
+  }
+  // Data left behind counts as signalled now
+  const uint32_t now = now_us();
+  const uint32_t since =
+      s_signalled[port].exchange(more ? now : 0, std::memory_order_relaxed);
+  if (rx_size > 0 && since != 0)
+    perf_latency(port, now - since);
+  return more;
+}
+
+static void bridge_task(void *) {
+  uint32_t pending = 0;
+  for (;;) {
+    uint32_t events = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &events, pending ? 0 : portMAX_DELAY);
+    pending |= events;
+    // One chunk per port and round keeps a busy port from starving the rest
+    for (uint32_t todo = pending; todo; todo &= todo - 1) {
+      const uint8_t port = (uint8_t)__builtin_ctz(todo);
+      if (!receive(port))
+        pending &= ~PORT_BIT(port);
+    }
+  }
+}
+
+// Runs in the TinyUSB task: hand the port over to the bridge task
+static void cdc_rx_callback(int itf, cdcacm_event_t *event) {
+  (void)event;
+  uint32_t idle = 0;
+  s_signalled[itf].compare_exchange_strong(idle, now_us(),
+                                           std::memory_order_relaxed);
+  xTaskNotify(s_task, PORT_BIT(itf), eSetBits);
+}
+
+#if BRIDGE_UART_ENABLED
+// wire -> host: called from the UART task once per detected frame
+static void forward_uart(const uint8_t *frame, size_t len) {
+  // the UART frame buffer is read-only, programs rewrite a copy
+  static uint8_t local[UART_LINK_FRAME_MAX + XLATE_HEADROOM];
+  const uint32_t t0 = now_us();
+  perf_rx(BRIDGE_PORT_UART, len, len);
+  forward(BRIDGE_PORT_UART, frame, len, local, sizeof(local));
+  perf_latency(BRIDGE_PORT_UART, now_us() - t0);
+}
+#endif
+
+esp_err_t bridge_init(void) {
+  route_init(BRIDGE_CDC_PORTS, BRIDGE_UART_ENABLED);
+  perf_init(BRIDGE_PORTS);
+  if (xTaskCreate(bridge_task, "bridge", BRIDGE_TASK_STACK, nullptr,
+                  BRIDGE_TASK_PRIO, &s_task) != pdPASS)
+    return ESP_ERR_NO_MEM;
+
+  tinyusb_config_cdcacm_t acm_cfg = {
+      .cdc_port = TINYUSB_CDC_ACM_0,
+      .callback_rx = &cdc_rx_callback,
+      .callback_rx_wanted_char = NULL,
+      .callback_line_state_changed = NULL,
+      .callback_line_coding_changed = NULL,
+  };
+  for (uint8_t port = 0; port < BRIDGE_CDC_PORTS; port++) {
+    acm_cfg.cdc_port = ITF(port);
+    ESP_ERROR_CHECK(tinyusb_cdcacm_init(&acm_cfg));
+  }
+#if BRIDGE_UART_ENABLED
+  ESP_ERROR_CHECK(uart_bridge_init(forward_uart));
+#endif
+  ESP_LOGI(TAG, "%u ports", (unsigned)BRIDGE_PORTS);
+  return ESP_OK;
+}
@@ -0,0 +1,189 @@
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include "capture.h"
+#include "capture_net.h"
+#include "capture_store.h"
+#include "config.h"
+#include "filter.h"
+#include "perf.h"
+#include "record.h"
+#include "status.h"
+
+extern "C" {
+#include "tusb.h"
+}
+
+#define CAPTURE_VENDOR_ITF 0
+
+static capture_stats_t s_stats = {};
+static StaticSemaphore_t s_lock_buf;
+static SemaphoreHandle_t s_lock = nullptr;
+static esp_timer_handle_t s_heartbeat = nullptr;
+// Sequence number of the next record (see record.h)
+static uint32_t s_seq = 0;
+// Encoded record under construction, guarded by s_lock
+#if CAPTURE_COMPRESS
+static uint8_t s_wire[RECORD_LZ_ENCODED_MAX];
+static record_compressor_t s_lz;
+#else
+static uint8_t s_wire[RECORD_ENCODED_MAX(RECORD_DATA_OVERHEAD +
+                                         CAPTURE_MAX_PAYLOAD)];
+#endif
+static_assert(sizeof(s_wire) >= RECORD_ENCODED_MAX(RECORD_PERF_MAX_LEN),
+              "PERF record must fit the wire buffer");
+
+void capture_lock(void) { xSemaphoreTake(s_lock, portMAX_DELAY); }
+
+void capture_unlock(void) { xSemaphoreGive(s_lock); }
+
+#if CFG_TUD_VENDOR
+// Records go to the capture channel while the host has it open, to the
+// capture store while it records and to a subscribed UDP receiver
+static bool sinks_active(void) {
+#if CAPTURE_STORE
+  if (capture_store_recording())
+    return true;
+#endif
+#if CAPTURE_NET
+  if (capture_net_active())
+    return true;
+#endif
+  return tud_vendor_n_mounted(CAPTURE_VENDOR_ITF);
+}
+
+// Records are all-or-nothing: a truncated record would cost the host the
+// following one too. The sequence number advances either way so the host
+// can count what was lost; each sink loses records on its own.
+static void write_wire(size_t n) {
+  s_seq++;
+  bool lost = false;
+  if (tud_vendor_n_mounted(CAPTURE_VENDOR_ITF)) {
+    if (n == 0 || tud_vendor_n_write_available(CAPTURE_VENDOR_ITF) < n) {
+      s_stats.dropped++;
+      lost = true;
+    } else {
+      tud_vendor_n_write(CAPTURE_VENDOR_ITF, s_wire, n);
+      s_stats.records++;
+      s_stats.wire_bytes += n;
+    }
+  }
+#if CAPTURE_STORE
+  if (capture_store_recording() && !capture_store_write(s_wire, n))
+    lost = true;
+#endif
+#if CAPTURE_NET
+  if (capture_net_active() && !capture_net_write(s_wire, n))
+    lost = true;
+#endif
+  if (!lost)
+    return;
+  status_signal(STATUS_OVERFLOW);
+#if CAPTURE_COMPRESS
+  // Some sink never sees this block, restart the history everywhere
+  record_compressor_reset(&s_lz);
+#endif
+}
+
+static size_t encode_data(uint8_t src_itf, const uint8_t *data, size_t len,
+                          int64_t now) {
+  s_stats.raw_bytes += RECORD_DATA_OVERHEAD + len;
+#if CAPTURE_COMPRESS
+  const int64_t t0 = esp_timer_get_time();
+  const size_t n =
+      record_encode_compressed(&s_lz, s_wire, sizeof(s_wire), s_seq,
+                               (uint64_t)now, src_itf, data, len);
+  s_stats.compress_us += (uint32_t)(esp_timer_get_time() - t0);
+  return n;
+#else
+  return record_encode_data(s_wire, sizeof(s_wire), s_seq, (uint64_t)now,
+                            src_itf, data, len);
+#endif
+}
+
+static void write_record(uint8_t src_itf, const uint8_t *data, size_t len,
+                         int64_t now) {
+  if (!filter_eval(src_itf, data, len)) {
+    s_stats.filtered++;
+    return;
+  }
+  if (!sinks_active())
+    return;
+  write_wire(len <= CAPTURE_MAX_PAYLOAD ? encode_data(src_itf, data, len, now)
+                                       : 0);
+}
+
+static size_t encode_perf(int64_t now) {
+  perf_device_t dev;
+  perf_port_t ports[PERF_MAX_PORTS];
+  perf_read_device(&dev);
+  for (uint8_t i = 0; i < dev.ports; i++)
+    perf_read_port(i, &ports[i]);
+  return record_encode_perf(s_wire, sizeof(s_wire), s_seq, (uint64_t)now,
+                            &dev, ports);
+}
+
+static void heartbeat(void *) {
+  const int64_t now = esp_timer_get_time();
+  capture_lock();
+#if CAPTURE_STORE
+  // New segments start here, so that each begins with this SYNC
+  capture_store_heartbeat();
+#endif
+  if (sinks_active()) {
+    write_wire(record_encode_sync(s_wire, sizeof(s_wire), s_seq,
+                                  (uint64_t)now, s_stats.records,
+                                  s_stats.filtered, s_stats.dropped));
+    write_wire(encode_perf(now));
+    tud_vendor_n_write_flush(CAPTURE_VENDOR_ITF);
+#if CAPTURE_COMPRESS
+    // Bound the damage of an undetected loss on the host side to one period
+    record_compressor_reset(&s_lz);
+#endif
+  }
+  capture_unlock();
+}
+#endif
+
+void capture_init(void) {
+  s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+#if CAPTURE_COMPRESS
+  record_compressor_reset(&s_lz);
+#endif
+#if CFG_TUD_VENDOR
+  const esp_timer_create_args_t args = {
+      .callback = heartbeat,
+      .arg = nullptr,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "capture_sync",
+      .skip_unhandled_events = true,
+  };
+  ESP_ERROR_CHECK(esp_timer_create(&args, &s_heartbeat));
+  ESP_ERROR_CHECK(
+      esp_timer_start_periodic(s_heartbeat, CAPTURE_HEARTBEAT_MS * 1000));
+#endif
+}
+
+void capture_mirror(uint8_t src_itf, const uint8_t *data, size_t len) {
+#if CFG_TUD_VENDOR
+  const int64_t now = esp_timer_get_time();
+  capture_lock();
+  write_record(src_itf, data, len, now);
+  capture_unlock();
+#else
+  (void)src_itf;
+  (void)data;
+  (void)len;
+#endif
+}
+
+void capture_flush(void) {
+#if CFG_TUD_VENDOR
+  capture_lock();
+  tud_vendor_n_write_flush(CAPTURE_VENDOR_ITF);
+  capture_unlock();
+#endif
+}
+
+const capture_stats_t *capture_stats(void) { return &s_stats; }
@@ -0,0 +1,262 @@
+#include "config.h"
+
+#if CAPTURE_NET
+
+#include <atomic>
+#include <dhcpserver/dhcpserver.h>
+#include <errno.h>
+#include <esp_check.h>
+#include <esp_event.h>
+#include <esp_log.h>
+#include <esp_mac.h>
+#include <esp_netif.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/message_buffer.h>
+#include <freertos/task.h>
+#include <lwip/pbuf.h>
+#include <lwip/sockets.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tinyusb_net.h>
+
+#include "capture_net.h"
+#include "record.h"
+
+static const char *TAG = "capture_net";
+
+#define NET_TASK_PRIO 3
+#define NET_TASK_STACK 4096
+// How often the sender looks for subscriptions while the ring is empty
+#define NET_POLL_MS 50
+// UDP payload of a 1500-byte IPv4 MTU
+#define NET_DATAGRAM_MAX 1472
+
+static std::atomic<bool> s_subscribed{false};
+static capture_net_stats_t s_stats = {};
+static esp_netif_t *s_netif = nullptr;
+static MessageBufferHandle_t s_ring = nullptr;
+static StaticMessageBuffer_t s_ring_buf;
+static uint8_t s_ring_mem[CAPTURE_NET_RING_KB * 1024];
+static char s_host_mac[2 * 6 + 1];
+// Sender task only
+static int s_sock = -1;
+static struct sockaddr_in s_peer;
+static int64_t s_peer_seen = 0;
+static uint8_t s_msg[RECORD_LZ_ENCODED_MAX];
+static uint8_t s_datagram[NET_DATAGRAM_MAX];
+
+static_assert(sizeof(s_msg) <= sizeof(s_datagram),
+              "largest capture record must fit one datagram");
+
+// The device keeps the factory Ethernet MAC, the host side gets the locally
+// administered address derived from it
+static void macs(uint8_t device[6], uint8_t host[6]) {
+  esp_read_mac(device, ESP_MAC_ETH);
+  esp_derive_local_mac(host, device);
+}
+
+const char *capture_net_host_mac(void) {
+  if (!s_host_mac[0]) {
+    uint8_t device[6], host[6];
+    macs(device, host);
+    snprintf(s_host_mac, sizeof(s_host_mac), "%02X%02X%02X%02X%02X%02X",
+             host[0], host[1], host[2], host[3], host[4], host[5]);
+  }
+  return s_host_mac;
+}
+
+// ---- esp_netif driver glue ----
+
+// Frames from the host are only valid during the callback
+static esp_err_t usb_recv(void *buffer, uint16_t len, void *) {
+  void *copy = malloc(len);
+  if (!copy)
+    return ESP_ERR_NO_MEM;
+  memcpy(copy, buffer, len);
+  return esp_netif_receive(s_netif, copy, len, copy);
+}
+
+static void usb_free_rx(void *, void *buffer) { free(buffer); }
+
+// Zero-copy transmit: the pbuf stays referenced while the frame waits in the
+// tinyusb_net queue and is released by usb_free_tx once TinyUSB copied it
+static esp_err_t usb_transmit_wrap(void *, void *buffer, size_t len,
+                                   void *netstack_buf) {
+  struct pbuf *p = static_cast<struct pbuf *>(netstack_buf);
+  pbuf_ref(p);
+  const esp_err_t err = tinyusb_net_send_async(buffer, len, p);
+  if (err != ESP_OK)
+    pbuf_free(p);
+  return err;
+}
+
+static esp_err_t usb_transmit(void *, void *buffer, size_t len) {
+  return tinyusb_net_send_sync(buffer, len, nullptr, pdMS_TO_TICKS(100));
+}
+
+static void usb_free_tx(void *buff_free_arg, void *) {
+  if (buff_free_arg)
+    pbuf_free(static_cast<struct pbuf *>(buff_free_arg));
+}
+
+static esp_err_t netif_start(void) {
+  uint8_t device[6], host[6];
+  macs(device, host);
+
+  esp_netif_ip_info_t ip = {};
+  ip.ip.addr = ipaddr_addr(CAPTURE_NET_ADDR);
+  ip.gw.addr = ip.ip.addr;
+  ip.netmask.addr = ipaddr_addr("255.255.255.0");
+  esp_netif_inherent_config_t base = {};
+  base.flags = (esp_netif_flags_t)(ESP_NETIF_DHCP_SERVER |
+                                   ESP_NETIF_FLAG_AUTOUP);
+  base.ip_info = &ip;
+  base.if_key = "usb_ncm";
+  base.if_desc = "capture";
+  base.route_prio = 1;
+  memcpy(base.mac, device, sizeof(base.mac));
+  esp_netif_driver_ifconfig_t driver = {};
+  driver.handle = &s_netif; // any non-null handle
+  driver.transmit = usb_transmit;
+  driver.transmit_wrap = usb_transmit_wrap;
+  driver.driver_free_rx_buffer = usb_free_rx;
+  esp_netif_config_t cfg = {};
+  cfg.base = &base;
+  cfg.driver = &driver;
+  cfg.stack = ESP_NETIF_NETSTACK_DEFAULT_ETH;
+  s_netif = esp_netif_new(&cfg);
+  ESP_RETURN_ON_FALSE(s_netif, ESP_FAIL, TAG, "Network interface");
+
+  // A capture link, not an uplink: keep the host's default route
+  dhcps_offer_t offer = 0;
+  ESP_RETURN_ON_ERROR(esp_netif_dhcps_option(
+                          s_netif, ESP_NETIF_OP_SET,
+                          ESP_NETIF_ROUTER_SOLICITATION_ADDRESS, &offer,
+                          sizeof(offer)),
+                      TAG, "DHCP server options");
+
+  tinyusb_net_config_t net = {};
+  memcpy(net.mac_addr, host, sizeof(net.mac_addr));
+  net.on_recv_callback = usb_recv;
+  net.free_tx_buffer = usb_free_tx;
+  ESP_RETURN_ON_ERROR(tinyusb_net_init(&net), TAG, "TinyUSB NCM");
+
+  esp_netif_action_start(s_netif, nullptr, 0, nullptr);
+  esp_netif_action_connected(s_netif, nullptr, 0, nullptr);
+  return ESP_OK;
+}
+
+// ---- Sender task ----
+
+// Any datagram to our port (re)subscribes its sender
+static void poll_subscriptions(void) {
+  uint8_t ignored[16];
+  struct sockaddr_in from;
+  socklen_t from_len = sizeof(from);
+  const int64_t now = esp_timer_get_time();
+  while (recvfrom(s_sock, ignored, sizeof(ignored), MSG_DONTWAIT,
+                  (struct sockaddr *)&from, &from_len) >= 0) {
+    if (!s_subscribed.load(std::memory_order_relaxed) ||
+        from.sin_addr.s_addr != s_peer.sin_addr.s_addr ||
+        from.sin_port != s_peer.sin_port)
+      ESP_LOGI(TAG, "Streaming to %s:%u", inet_ntoa(from.sin_addr),
+               (unsigned)ntohs(from.sin_port));
+    s_peer = from;
+    s_peer_seen = now;
+    s_subscribed.store(true, std::memory_order_relaxed);
+    from_len = sizeof(from);
+  }
+  if (s_subscribed.load(std::memory_order_relaxed) &&
+      now - s_peer_seen > CAPTURE_NET_TIMEOUT_MS * 1000ll) {
+    ESP_LOGI(TAG, "Subscriber went quiet, stream stopped");
+    s_subscribed.store(false, std::memory_order_relaxed);
+  }
+}
+
+// The TX queue refuses frames while the link is busy: wait for room rather
+// than lose the datagram, the ring absorbs what arrives meanwhile
+static void send_datagram(size_t len) {
+  while (s_subscribed.load(std::memory_order_relaxed)) {
+    if (sendto(s_sock, s_datagram, len, 0, (struct sockaddr *)&s_peer,
+               sizeof(s_peer)) == (ssize_t)len) {
+      s_stats.datagrams++;
+      s_stats.bytes += len;
+      return;
+    }
+    if (errno != ENOMEM && errno != ENOBUFS && errno != EAGAIN) {
+      s_stats.errors++;
+      return;
+    }
+    vTaskDelay(1);
+  }
+}
+
+static void net_task(void *) {
+  size_t pending = 0;
+  for (;;) {
+    // Batch whatever is queued, send once the ring runs dry
+    const size_t n = xMessageBufferReceive(
+        s_ring, s_msg, sizeof(s_msg), pending ? 0 : pdMS_TO_TICKS(NET_POLL_MS));
+    if (n > 0) {
+      if (pending + n > sizeof(s_datagram)) {
+        send_datagram(pending);
+        pending = 0;
+      }
+      memcpy(s_datagram + pending, s_msg, n);
+      pending += n;
+      continue;
+    }
+    if (pending) {
+      send_datagram(pending);
+      pending = 0;
+    }
+    poll_subscriptions();
+  }
+}
+
+esp_err_t capture_net_init(void) {
+  capture_net_host_mac();
+  ESP_RETURN_ON_ERROR(esp_netif_init(), TAG, "esp_netif");
+  // esp_netif posts IP events; the loop may already exist
+  const esp_err_t loop = esp_event_loop_create_default();
+  ESP_RETURN_ON_FALSE(loop == ESP_OK || loop == ESP_ERR_INVALID_STATE, loop,
+                      TAG, "Default event loop");
+  ESP_RETURN_ON_ERROR(netif_start(), TAG, "USB network interface");
+
+  s_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  ESP_RETURN_ON_FALSE(s_sock >= 0, ESP_FAIL, TAG, "Socket");
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(CAPTURE_NET_PORT);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  ESP_RETURN_ON_FALSE(bind(s_sock, (struct sockaddr *)&addr, sizeof(addr)) ==
+                          0,
+                      ESP_FAIL, TAG, "Bind to port %u", CAPTURE_NET_PORT);
+
+  s_ring = xMessageBufferCreateStatic(sizeof(s_ring_mem), s_ring_mem,
+                                      &s_ring_buf);
+  ESP_RETURN_ON_FALSE(xTaskCreate(net_task, "capture_net", NET_TASK_STACK,
+                                  nullptr, NET_TASK_PRIO, nullptr) == pdPASS,
+                      ESP_ERR_NO_MEM, TAG, "Capture net task");
+  ESP_LOGI(TAG, "Capture on udp://%s:%u", CAPTURE_NET_ADDR, CAPTURE_NET_PORT);
+  return ESP_OK;
+}
+
+bool capture_net_active(void) {
+  return s_subscribed.load(std::memory_order_relaxed);
+}
+
+bool capture_net_write(const uint8_t *wire, size_t len) {
+  if (len == 0 || len > sizeof(s_msg) ||
+      xMessageBufferSend(s_ring, wire, len, 0) != len) {
+    s_stats.dropped++;
+    return false;
+  }
+  return true;
+}
+
+const capture_net_stats_t *capture_net_stats(void) { return &s_stats; }
+
+#endif // CAPTURE_NET
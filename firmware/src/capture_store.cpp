@@ -0,0 +1,306 @@
+#include "config.h"
+
+#if CAPTURE_STORE
+
+#include <atomic>
+#include <dirent.h>
+#include <esp_check.h>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <esp_vfs_fat.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/message_buffer.h>
+#include <freertos/task.h>
+#include <stdio.h>
+#include <tinyusb_msc.h>
+#include <wear_levelling.h>
+
+#include "capture_store.h"
+#include "record.h"
+#include "status.h"
+
+static const char *TAG = "capture_store";
+
+#define STORE_TASK_PRIO 2
+#define STORE_TASK_STACK 4096
+// How often the writer looks at requests while the ring is empty
+#define STORE_POLL_MS 50
+// stdio buffer of the segment file: whole 4 KB flash blocks per write
+#define STORE_FILE_BUF 4096
+// One-byte message in the ring: close the segment, open the next one.
+// Encoded records are never shorter than two bytes.
+#define STORE_MARKER 0x00
+
+static std::atomic<uint8_t> s_state{STORE_OFF};
+// Set by the writer when the segment is full, taken by the next heartbeat
+static std::atomic<bool> s_rotate{false};
+// Pending expose request: -1 none, 0 device, 1 USB host
+static std::atomic<int8_t> s_expose{-1};
+static std::atomic<uint32_t> s_segment{0}, s_bytes{0}, s_dropped{0};
+static std::atomic<uint32_t> s_errors{0}, s_free_kb{0};
+
+static tinyusb_msc_storage_handle_t s_storage = nullptr;
+static MessageBufferHandle_t s_ring = nullptr;
+static StaticMessageBuffer_t s_ring_buf;
+// Writer task only
+static FILE *s_file = nullptr;
+static uint8_t s_msg[RECORD_LZ_ENCODED_MAX];
+
+static_assert(sizeof(s_msg) >= RECORD_ENCODED_MAX(RECORD_DATA_OVERHEAD +
+                                                   RECORD_LZ_MAX_PAYLOAD),
+              "largest capture record must fit the writer buffer");
+
+static void segment_path(char *out, size_t cap, uint32_t n) {
+  snprintf(out, cap, CAPTURE_STORE_PATH "/CAP%05u.BIN", (unsigned)n);
+}
+
+// Highest segment number on the volume, so new files never overwrite
+static uint32_t last_segment(void) {
+  uint32_t last = 0;
+  DIR *dir = opendir(CAPTURE_STORE_PATH);
+  if (!dir)
+    return 0;
+  while (struct dirent *e = readdir(dir)) {
+    unsigned n;
+    if (sscanf(e->d_name, "CAP%5u.BIN", &n) == 1 && n > last)
+      last = n;
+  }
+  closedir(dir);
+  return last;
+}
+
+static void update_free_space(void) {
+  uint64_t total = 0, free = 0;
+  if (esp_vfs_fat_info(CAPTURE_STORE_PATH, &total, &free) == ESP_OK)
+    s_free_kb.store((uint32_t)(free / 1024), std::memory_order_relaxed);
+}
+
+static void close_segment(void) {
+  if (!s_file)
+    return;
+  if (fclose(s_file) != 0) {
+    ESP_LOGE(TAG, "Closing segment %u failed", (unsigned)s_segment.load());
+    s_errors.fetch_add(1, std::memory_order_relaxed);
+  }
+  s_file = nullptr;
+  update_free_space();
+  ESP_LOGI(TAG, "Segment %u closed, %u bytes", (unsigned)s_segment.load(),
+           (unsigned)s_bytes.load());
+}
+
+// A failed file operation ends the recording; the data that made it to the
+// segment so far stays readable
+static void fail(const char *what) {
+  ESP_LOGE(TAG, "%s failed on segment %u, recording stopped", what,
+           (unsigned)s_segment.load());
+  s_errors.fetch_add(1, std::memory_order_relaxed);
+  status_signal(STATUS_ERROR);
+  uint8_t state = s_state.load();
+  if (state == STORE_RECORDING || state == STORE_STOPPING)
+    s_state.compare_exchange_strong(state, STORE_IDLE);
+  if (s_file) {
+    fclose(s_file);
+    s_file = nullptr;
+  }
+}
+
+static void next_segment(void) {
+  close_segment();
+  const uint32_t n = s_segment.load(std::memory_order_relaxed) + 1;
+  char path[32];
+  segment_path(path, sizeof(path), n);
+  s_segment.store(n, std::memory_order_relaxed);
+  s_bytes.store(0, std::memory_order_relaxed);
+  s_file = fopen(path, "wb");
+  if (!s_file) {
+    fail("Creating a segment");
+    return;
+  }
+  setvbuf(s_file, nullptr, _IOFBF, STORE_FILE_BUF);
+  ESP_LOGI(TAG, "Recording to %s", path);
+}
+
+static void append(const uint8_t *data, size_t len) {
+  if (!s_file)
+    return; // stragglers queued while the recording stopped
+  if (fwrite(data, 1, len, s_file) != len) {
+    fail("Writing");
+    return;
+  }
+  const uint32_t bytes =
+      s_bytes.fetch_add(len, std::memory_order_relaxed) + len;
+  if (bytes >= CAPTURE_STORE_SEGMENT_KB * 1024u)
+    s_rotate.store(true, std::memory_order_relaxed);
+}
+
+static bool mount(tinyusb_msc_mount_point_t where) {
+  tinyusb_msc_mount_point_t now;
+  tinyusb_msc_set_storage_mount_point(s_storage, where);
+  return tinyusb_msc_get_storage_mount_point(s_storage, &now) == ESP_OK &&
+         now == where;
+}
+
+// Carry out requests; runs whenever the ring is empty
+static void service(void) {
+  uint8_t state = s_state.load();
+  if (state == STORE_STOPPING) {
+    close_segment();
+    s_state.compare_exchange_strong(state, STORE_IDLE);
+  }
+
+  const int8_t expose = s_expose.exchange(-1);
+  if (expose == 1 && s_state.load() != STORE_EXPOSED) {
+    // Stop feeding first, then close what was queued before
+    s_state.store(STORE_IDLE);
+    while (size_t n = xMessageBufferReceive(s_ring, s_msg, sizeof(s_msg), 0))
+      if (n > 1)
+        append(s_msg, n);
+    close_segment();
+    if (mount(TINYUSB_MSC_STORAGE_MOUNT_USB)) {
+      s_state.store(STORE_EXPOSED);
+      ESP_LOGI(TAG, "Volume exposed to the USB host");
+    } else {
+      s_errors.fetch_add(1, std::memory_order_relaxed);
+      ESP_LOGE(TAG, "Exposing the volume failed");
+    }
+  } else if (expose == 0 && s_state.load() == STORE_EXPOSED) {
+    if (mount(TINYUSB_MSC_STORAGE_MOUNT_APP)) {
+      // The host may have removed or added segments
+      s_segment.store(last_segment(), std::memory_order_relaxed);
+      s_bytes.store(0, std::memory_order_relaxed);
+      update_free_space();
+      s_state.store(STORE_IDLE);
+      ESP_LOGI(TAG, "Volume back on the device");
+    } else {
+      s_errors.fetch_add(1, std::memory_order_relaxed);
+      ESP_LOGE(TAG, "Remounting the volume failed");
+    }
+  }
+}
+
+static void store_task(void *) {
+  for (;;) {
+    const size_t n = xMessageBufferReceive(s_ring, s_msg, sizeof(s_msg),
+                                           pdMS_TO_TICKS(STORE_POLL_MS));
+    if (n == 1 && s_msg[0] == STORE_MARKER)
+      next_segment();
+    else if (n > 0)
+      append(s_msg, n);
+    else
+      service();
+  }
+}
+
+static void on_msc_event(tinyusb_msc_storage_handle_t, tinyusb_msc_event_t *e,
+                         void *) {
+  ESP_LOGD(TAG, "MSC event %d, mount point %d", e->id, e->mount_point);
+}
+
+esp_err_t capture_store_init(void) {
+  const esp_partition_t *part =
+      esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                               ESP_PARTITION_SUBTYPE_DATA_FAT,
+                               CAPTURE_STORE_PARTITION);
+  ESP_RETURN_ON_FALSE(part, ESP_ERR_NOT_FOUND, TAG,
+                      "No FAT partition \"%s\" in the partition table",
+                      CAPTURE_STORE_PARTITION);
+  wl_handle_t wl = WL_INVALID_HANDLE;
+  ESP_RETURN_ON_ERROR(wl_mount(part, &wl), TAG, "Wear levelling mount");
+
+  // The device decides when the host gets the volume, not USB (un)plugging
+  tinyusb_msc_driver_config_t driver = {};
+  driver.user_flags.auto_mount_off = true;
+  driver.callback = on_msc_event;
+  ESP_RETURN_ON_ERROR(tinyusb_msc_install_driver(&driver), TAG, "MSC driver");
+
+  tinyusb_msc_storage_config_t cfg = {};
+  cfg.medium.wl_handle = wl;
+  cfg.fat_fs.base_path = const_cast<char *>(CAPTURE_STORE_PATH);
+  cfg.fat_fs.config.max_files = 2;
+  cfg.fat_fs.config.format_if_mount_failed = true;
+  cfg.mount_point = TINYUSB_MSC_STORAGE_MOUNT_APP;
+  ESP_RETURN_ON_ERROR(tinyusb_msc_new_storage_spiflash(&cfg, &s_storage), TAG,
+                      "MSC storage");
+
+  // The ring is the only large buffer; PSRAM is fast enough for it
+  const size_t ring = CAPTURE_STORE_RING_KB * 1024;
+  void *mem = heap_caps_malloc(ring, MALLOC_CAP_SPIRAM);
+  if (!mem)
+    mem = heap_caps_malloc(ring, MALLOC_CAP_8BIT);
+  ESP_RETURN_ON_FALSE(mem, ESP_ERR_NO_MEM, TAG, "Capture store ring");
+  s_ring = xMessageBufferCreateStatic(ring, static_cast<uint8_t *>(mem),
+                                      &s_ring_buf);
+
+  s_segment.store(last_segment());
+  update_free_space();
+  s_state.store(STORE_IDLE);
+  ESP_RETURN_ON_FALSE(xTaskCreate(store_task, "capture_store",
+                                  STORE_TASK_STACK, nullptr, STORE_TASK_PRIO,
+                                  nullptr) == pdPASS,
+                      ESP_ERR_NO_MEM, TAG, "Capture store task");
+  ESP_LOGI(TAG, "%u KB free, last segment %u", (unsigned)s_free_kb.load(),
+           (unsigned)s_segment.load());
+  return ESP_OK;
+}
+
+bool capture_store_recording(void) {
+  return s_state.load(std::memory_order_relaxed) == STORE_RECORDING;
+}
+
+void capture_store_heartbeat(void) {
+  static const uint8_t marker = STORE_MARKER;
+  uint8_t state = s_state.load();
+  if (state == STORE_ARMED) {
+    if (xMessageBufferSend(s_ring, &marker, 1, 0) == 1)
+      s_state.compare_exchange_strong(state, STORE_RECORDING);
+  } else if (state == STORE_RECORDING && s_rotate.exchange(false)) {
+    if (xMessageBufferSend(s_ring, &marker, 1, 0) != 1)
+      s_rotate.store(true); // ring full, try again next heartbeat
+  }
+}
+
+bool capture_store_write(const uint8_t *wire, size_t len) {
+  if (len == 0 || len > sizeof(s_msg) ||
+      xMessageBufferSend(s_ring, wire, len, 0) != len) {
+    s_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+bool capture_store_start(void) {
+  uint8_t state = STORE_IDLE;
+  return s_state.compare_exchange_strong(state, STORE_ARMED);
+}
+
+void capture_store_stop(void) {
+  uint8_t state = STORE_ARMED;
+  if (s_state.compare_exchange_strong(state, STORE_IDLE))
+    return;
+  state = STORE_RECORDING;
+  s_state.compare_exchange_strong(state, STORE_STOPPING);
+}
+
+bool capture_store_expose(bool usb) {
+  if (s_state.load() == STORE_OFF)
+    return false;
+  // The writer task only services requests once the ring runs dry, which
+  // steady traffic never lets it do while recording
+  if (usb)
+    capture_store_stop();
+  s_expose.store(usb ? 1 : 0);
+  return true;
+}
+
+void capture_store_status(capture_store_status_t *out) {
+  *out = {};
+  out->state = s_state.load(std::memory_order_relaxed);
+  out->segment = s_segment.load(std::memory_order_relaxed);
+  out->bytes = s_bytes.load(std::memory_order_relaxed);
+  out->dropped = s_dropped.load(std::memory_order_relaxed);
+  out->errors = s_errors.load(std::memory_order_relaxed);
+  out->free_kb = s_free_kb.load(std::memory_order_relaxed);
+}
+
+#endif // CAPTURE_STORE
@@ -0,0 +1,166 @@
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <string.h>
+
+#include "capture.h"
+#include "capture_store.h"
+#include "config.h"
+#include "control.h"
+#include "filter.h"
+#include "perf.h"
+#include "route.h"
+#include "translate.h"
+
+extern "C" {
+#include "tusb.h"
+}
+
+static const char *TAG = "control";
+
+// Data stage buffer; control transfers are serialized by TinyUSB
+static uint8_t s_buf[CTRL_MAX_DATA_LEN];
+
+// Reply to an IN request with `len` bytes (clipped to what the host asked for)
+static bool reply(uint8_t rhport, tusb_control_request_t const *req,
+                  const void *data, uint16_t len) {
+  if (len > sizeof(s_buf))
+    return false;
+  memcpy(s_buf, data, len);
+  return tud_control_xfer(rhport, req, s_buf,
+                          len < req->wLength ? len : req->wLength);
+}
+
+// Accept an OUT data stage of exactly `len` bytes into s_buf
+static bool expect(uint8_t rhport, tusb_control_request_t const *req,
+                   uint16_t len) {
+  if (req->wLength != len || len > sizeof(s_buf))
+    return false;
+  return tud_control_xfer(rhport, req, s_buf, len);
+}
+
+// Accept an OUT data stage of 1..CTRL_MAX_DATA_LEN bytes into s_buf
+static bool receive(uint8_t rhport, tusb_control_request_t const *req) {
+  if (req->wLength == 0 || req->wLength > sizeof(s_buf))
+    return false;
+  return tud_control_xfer(rhport, req, s_buf, req->wLength);
+}
+
+static bool on_setup(uint8_t rhport, tusb_control_request_t const *req) {
+  switch (req->bRequest) {
+  case CTRL_FILTER_CLEAR:
+    capture_lock();
+    filter_clear();
+    capture_unlock();
+    return tud_control_status(rhport, req);
+  case CTRL_FILTER_STAGE:
+    return expect(rhport, req, sizeof(filter_rule_t));
+  case CTRL_FILTER_COMMIT: {
+    if (req->wIndex > FILTER_PASS || req->wValue > 0xFF)
+      return false; // stall: unknown fallback action or rule count
+    capture_lock();
+    bool ok =
+        filter_commit((uint8_t)req->wValue, (filter_action_t)req->wIndex);
+    capture_unlock();
+    if (!ok)
+      return false;
+    ESP_LOGI(TAG, "Capture filter: %u rules", (unsigned)req->wValue);
+    return tud_control_status(rhport, req);
+  }
+  case CTRL_CAPTURE_STATS:
+    return reply(rhport, req, capture_stats(), sizeof(capture_stats_t));
+  case CTRL_CLOCK_SYNC: {
+    const int64_t now = esp_timer_get_time();
+    return reply(rhport, req, &now, sizeof(now));
+  }
+  case CTRL_XLATE_STAGE:
+    return receive(rhport, req);
+  case CTRL_XLATE_COMMIT: {
+    capture_lock();
+    bool ok = xlate_commit((uint8_t)req->wIndex, req->wValue);
+    capture_unlock();
+    if (!ok)
+      return false; // stall: program failed verification
+    ESP_LOGI(TAG, "Translation program: itf%u, %u bytes",
+             (unsigned)req->wIndex, (unsigned)req->wValue);
+    return tud_control_status(rhport, req);
+  }
+  case CTRL_XLATE_CLEAR:
+    capture_lock();
+    xlate_clear((uint8_t)req->wIndex);
+    capture_unlock();
+    return tud_control_status(rhport, req);
+  case CTRL_ROUTE_SET:
+    if (req->wValue > 0xFF || !route_set((uint8_t)req->wIndex,
+                                         (route_mask_t)req->wValue))
+      return false; // stall: unknown port
+    ESP_LOGI(TAG, "Route: port %u -> 0x%02x", (unsigned)req->wIndex,
+             (unsigned)req->wValue);
+    return tud_control_status(rhport, req);
+  case CTRL_ROUTE_GET: {
+    route_mask_t table[ROUTE_MAX_PORTS];
+    return reply(rhport, req, table, route_snapshot(table, ROUTE_MAX_PORTS));
+  }
+  case CTRL_PERF_DEVICE: {
+    perf_device_t dev;
+    perf_read_device(&dev);
+    return reply(rhport, req, &dev, sizeof(dev));
+  }
+  case CTRL_PERF_PORT: {
+    perf_port_t port;
+    if (!perf_read_port((uint8_t)req->wIndex, &port))
+      return false; // stall: unknown port
+    return reply(rhport, req, &port, sizeof(port));
+  }
+  case CTRL_PERF_RESET:
+    perf_reset();
+    return tud_control_status(rhport, req);
+#if CAPTURE_STORE
+  case CTRL_STORE_START:
+    if (!capture_store_start())
+      return false; // stall: recording, exposed or no storage
+    return tud_control_status(rhport, req);
+  case CTRL_STORE_STOP:
+    capture_store_stop();
+    return tud_control_status(rhport, req);
+  case CTRL_STORE_EXPOSE:
+    if (req->wValue > 1 || !capture_store_expose(req->wValue == 1))
+      return false;
+    return tud_control_status(rhport, req);
+  case CTRL_STORE_STATUS: {
+    capture_store_status_t status;
+    capture_store_status(&status);
+    return reply(rhport, req, &status, sizeof(status));
+  }
+#endif
+  default:
+    return false; // stall unknown request
+  }
+}
+
+static bool on_data(tusb_control_request_t const *req) {
+  switch (req->bRequest) {
+  case CTRL_FILTER_STAGE: {
+    filter_rule_t rule;
+    memcpy(&rule, s_buf, sizeof(rule));
+    return filter_stage_rule((uint8_t)req->wValue, &rule);
+  }
+  case CTRL_XLATE_STAGE:
+    return xlate_stage(req->wValue, s_buf, req->wLength);
+  default:
+    return true;
+  }
+}
+
+extern "C" bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage,
+                                           tusb_control_request_t const *req) {
+  if (req->bmRequestType_bit.type != TUSB_REQ_TYPE_VENDOR)
+    return false;
+  switch (stage) {
+  case CONTROL_STAGE_SETUP:
+    return on_setup(rhport, req);
+  case CONTROL_STAGE_DATA:
+    return on_data(req);
+  default:
+    return true;
+  }
+}
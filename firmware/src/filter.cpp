@@ -0,0 +1,88 @@
+#include <string.h>
+
+#include "filter.h"
+
+// Rules are compiled into a form that evaluates the header with a single
+// 64-bit AND/compare instead of a byte loop.
+typedef struct {
+  uint64_t match;
+  uint64_t mask;
+  uint16_t min_len;
+  uint16_t max_len;
+  uint16_t decimate;
+  uint16_t seen; // matches since last pass (decimation counter)
+  uint8_t itf_mask;
+  uint8_t action;
+} compiled_rule_t;
+
+static_assert(FILTER_HEADER_LEN == sizeof(uint64_t),
+              "compiled header compare assumes an 8-byte header");
+
+// Shadow table written by the host, compiled into the live table on commit.
+// Both are only touched from the bridge context (see filter.h).
+static filter_rule_t s_staged[FILTER_MAX_RULES];
+static compiled_rule_t s_rules[FILTER_MAX_RULES];
+static uint8_t s_count = 0;
+static uint8_t s_fallback = FILTER_PASS;
+
+static inline uint64_t load_header(const uint8_t *data, size_t len) {
+  uint64_t h = 0;
+  memcpy(&h, data, len < sizeof(h) ? len : sizeof(h));
+  return h;
+}
+
+bool filter_stage_rule(uint8_t index, const filter_rule_t *rule) {
+  if (index >= FILTER_MAX_RULES || rule == nullptr)
+    return false;
+  s_staged[index] = *rule;
+  return true;
+}
+
+bool filter_commit(uint8_t count, filter_action_t fallback) {
+  if (count > FILTER_MAX_RULES)
+    return false;
+  for (uint8_t i = 0; i < count; i++) {
+    const filter_rule_t &src = s_staged[i];
+    compiled_rule_t &dst = s_rules[i];
+    memcpy(&dst.mask, src.mask, sizeof(dst.mask));
+    memcpy(&dst.match, src.match, sizeof(dst.match));
+    dst.match &= dst.mask; // bits outside the mask can never match
+    dst.min_len = src.min_len;
+    dst.max_len = src.max_len ? src.max_len : UINT16_MAX;
+    dst.decimate = src.decimate > 1 ? src.decimate : 1;
+    dst.seen = 0;
+    dst.itf_mask = src.itf_mask ? src.itf_mask : 0xFF;
+    dst.action = src.action;
+  }
+  s_count = count;
+  s_fallback = fallback;
+  return true;
+}
+
+void filter_clear(void) {
+  s_count = 0;
+  s_fallback = FILTER_PASS;
+}
+
+bool filter_eval(uint8_t src_itf, const uint8_t *data, size_t len) {
+  if (s_count == 0)
+    return s_fallback == FILTER_PASS;
+  const uint64_t header = load_header(data, len);
+  const uint8_t itf_bit = (uint8_t)(1u << (src_itf & 7));
+  for (uint8_t i = 0; i < s_count; i++) {
+    compiled_rule_t &r = s_rules[i];
+    if (!(r.itf_mask & itf_bit))
+      continue;
+    if (len < r.min_len || len > r.max_len)
+      continue;
+    if ((header & r.mask) != r.match)
+      continue;
+    if (r.action != FILTER_PASS)
+      return false;
+    if (++r.seen < r.decimate)
+      return false;
+    r.seen = 0;
+    return true;
+  }
+  return s_fallback == FILTER_PASS;
+}
@@ -0,0 +1,115 @@
+#include <string.h>
+
+#include "lz.h"
+
+static inline uint32_t read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint32_t hash(uint32_t v) {
+  return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+void lz_reset(lz_encoder_t *lz) {
+  lz->len = 0;
+  memset(lz->index, 0, sizeof(lz->index));
+}
+
+// Keep the most recent LZ_WINDOW bytes, rebasing the index
+static void slide(lz_encoder_t *lz) {
+  const size_t delta = lz->len - LZ_WINDOW;
+  memmove(lz->hist, lz->hist + delta, LZ_WINDOW);
+  for (size_t i = 0; i < (1 << LZ_HASH_BITS); i++)
+    lz->index[i] = lz->index[i] > delta ? (uint16_t)(lz->index[i] - delta) : 0;
+  lz->len = LZ_WINDOW;
+}
+
+typedef struct {
+  uint8_t *p, *end;
+} out_t;
+
+static inline bool put_length(out_t *o, size_t n) {
+  for (; n >= 255; n -= 255) {
+    if (o->p >= o->end)
+      return false;
+    *o->p++ = 255;
+  }
+  if (o->p >= o->end)
+    return false;
+  *o->p++ = (uint8_t)n;
+  return true;
+}
+
+// Emit one sequence; `match` = 0 for the trailing literals-only sequence
+static bool put_sequence(out_t *o, const uint8_t *lit, size_t n_lit,
+                         size_t offset, size_t match) {
+  if (o->p >= o->end)
+    return false;
+  const size_t m = match ? match - LZ_MIN_MATCH : 0;
+  uint8_t *token = o->p++;
+  *token = (uint8_t)((n_lit < 15 ? n_lit : 15) << 4 | (m < 15 ? m : 15));
+  if (n_lit >= 15 && !put_length(o, n_lit - 15))
+    return false;
+  if ((size_t)(o->end - o->p) < n_lit)
+    return false;
+  memcpy(o->p, lit, n_lit);
+  o->p += n_lit;
+  if (!match)
+    return true;
+  if (o->end - o->p < 2)
+    return false;
+  *o->p++ = (uint8_t)(offset & 0xFF);
+  *o->p++ = (uint8_t)(offset >> 8);
+  return m < 15 || put_length(o, m - 15);
+}
+
+// Compress history bytes [ip, end), returns 0 if `o` runs out of room
+static size_t encode(lz_encoder_t *lz, size_t ip, size_t end, out_t *o) {
+  const uint8_t *const h = lz->hist;
+  const uint8_t *const begin = o->p;
+  size_t anchor = ip;
+  while (ip + LZ_MIN_MATCH <= end) {
+    const uint32_t v = read32(h + ip);
+    uint16_t &slot = lz->index[hash(v)];
+    const size_t cand = (size_t)slot - 1;
+    slot = (uint16_t)(ip + 1);
+    if (cand == (size_t)-1 || ip - cand > LZ_WINDOW || read32(h + cand) != v) {
+      ip++;
+      continue;
+    }
+    size_t m = LZ_MIN_MATCH;
+    while (ip + m < end && h[cand + m] == h[ip + m])
+      m++;
+    if (!put_sequence(o, h + anchor, ip - anchor, ip - cand, m))
+      return 0;
+    ip += m;
+    anchor = ip;
+    // Index the tail of the match so the next repeat can chain onto it
+    if (ip + 2 <= end)
+      lz->index[hash(read32(h + ip - 2))] = (uint16_t)(ip - 2 + 1);
+  }
+  if (!put_sequence(o, h + anchor, end - anchor, 0, 0))
+    return 0;
+  return (size_t)(o->p - begin);
+}
+
+size_t lz_compress(lz_encoder_t *lz, const uint8_t *in, size_t len,
+                   uint8_t *out, size_t cap) {
+  if (len > LZ_WINDOW) {
+    lz_reset(lz);
+    return 0;
+  }
+  if (lz->len + len > sizeof(lz->hist))
+    slide(lz);
+  memcpy(lz->hist + lz->len, in, len);
+  const size_t start = lz->len;
+  lz->len += len;
+  out_t o = {out, out + cap};
+  const size_t n = encode(lz, start, lz->len, &o);
+  // The decoder never sees a failed block, so neither may the history
+  if (n == 0)
+    lz_reset(lz);
+  return n;
+}
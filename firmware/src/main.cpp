@@ -5,26 +5,17 @@
 #include <stdint.h>
 
 #include <tinyusb.h>
-#include <tinyusb_cdc_acm.h>
 #include <tinyusb_default_config.h> // NEW: for TINYUSB_DEFAULT_CONFIG()
 
+#include "bench.h"
+#include "bridge.h"
+#include "capture.h"
+#include "capture_net.h"
+#include "capture_store.h"
+#include "config.h"
 #include "driver/gpio.h"
 #include "pinout.h"
-
-#include "freertos/timers.h"
-
-#define TRAFFIC_PULSE_MS 40
-
-static TimerHandle_t s_led_off_tmr = nullptr;
-
-static void led_off_cb(TimerHandle_t) { gpio_set_level(LED_BUILTIN, 0); }
-
-static inline void traffic_pulse_now(void) {
-  gpio_set_level(LED_BUILTIN, 1);
-  xTimerStop(s_led_off_tmr, 0);
-  xTimerChangePeriod(s_led_off_tmr, pdMS_TO_TICKS(TRAFFIC_PULSE_MS), 0);
-  xTimerStart(s_led_off_tmr, 0);
-}
+#include "status.h"
 
 extern "C" {
 #include "tusb.h"
@@ -58,7 +49,10 @@ uint8_t const *tud_descriptor_device_cb(void) {
 }
 
 // String table:
-// 0: LangID, 1: Manufacturer, 2: Product, 3: Serial, 4: CDC0 name, 5: CDC1 name
+// 0: LangID, 1: Manufacturer, 2: Product, 3: Serial, 4: CDC0 name, 5: CDC1 name,
+// 6: Capture interface name, 7..8: CDC2..CDC3 names, 9: capture store name,
+// 10: capture network interface name, 11: its host-side MAC address
+static char s_net_mac[2 * 6 + 1] = "000000000000"; // filled in by app_main
 static const char *const USB_STR[] = {
     (const char[]){0x09, 0x04}, // 0: English (US) 0x0409
     "ProtoAI",                  // 1
@@ -66,7 +60,18 @@ static const char *const USB_STR[] = {
     "ProtocolTranslator",       // 3
     "DUO(OPEN)",                // 4  (interface name)
     "DUAL_LOOPBACK(PRIVATE)",   // 5  (interface name)
+    "CAPTURE",                  // 6  (interface name)
+    "CHANNEL2",                 // 7  (interface name)
+    "CHANNEL3",                 // 8  (interface name)
+    "CAPTURE_STORE",            // 9  (interface name)
+    "CAPTURE_NET",              // 10 (interface name)
+    s_net_mac,                  // 11 (NCM iMACAddress)
 };
+#define STR_CDC(n) ((n) < 2 ? 4 + (n) : 5 + (n))
+#define STR_CAPTURE 6
+#define STR_STORE 9
+#define STR_NET 10
+#define STR_NET_MAC 11
 
 uint16_t const *tud_descriptor_string_cb(uint8_t index, uint16_t langid) {
   (void)langid;
@@ -94,42 +99,95 @@ uint16_t const *tud_descriptor_string_cb(uint8_t index, uint16_t langid) {
 }
 extern "C" {
 
-// Interface numbers
+// Interface numbers: a COMM + DATA pair per bridge CDC port, then capture,
+// then the capture store drive, then the COMM + DATA pair of the capture
+// network interface
+#define ITF_CDC_COMM(n) (2 * (n))
 enum {
-  ITF_CDC0_COMM = 0,
-  ITF_CDC0_DATA,
-  ITF_CDC1_COMM,
-  ITF_CDC1_DATA,
-  ITF_TOTAL
+  ITF_CAPTURE = ITF_CDC_COMM(BRIDGE_CDC_PORTS),
+  ITF_STORE = ITF_CAPTURE + CFG_TUD_VENDOR,
+  ITF_NET = ITF_STORE + CFG_TUD_MSC,
+  ITF_TOTAL = ITF_NET + 2 * CFG_TUD_NCM
 };
 
+#if CAPTURE_STORE && !CFG_TUD_MSC
+#error "CAPTURE_STORE needs CONFIG_TINYUSB_MSC_ENABLED"
+#endif
+#if CAPTURE_NET && !CFG_TUD_NCM
+#error "CAPTURE_NET needs CONFIG_TINYUSB_NET_MODE_NCM"
+#endif
+
 // Endpoint sizes (Full Speed)
 #define BULK_SZ 64
 #define INT_SZ 16
 
-// Unique EP addresses (change if you add other USB classes)
-#define EP_CDC0_NOTIF 0x81
-#define EP_CDC0_OUT 0x01
-#define EP_CDC0_IN 0x82
+// Unique EP addresses (change if you add other USB classes): CDC port n uses
+// endpoint numbers 2n+1 (notification IN, data OUT) and 2n+2 (data IN)
+#define EP_CDC_NOTIF(n) (0x81 + 2 * (n))
+#define EP_CDC_OUT(n) (0x01 + 2 * (n))
+#define EP_CDC_IN(n) (0x82 + 2 * (n))
+
+#define EP_CAPTURE_OUT EP_CDC_OUT(BRIDGE_CDC_PORTS)
+#define EP_CAPTURE_IN EP_CDC_IN(BRIDGE_CDC_PORTS)
+#define EP_STORE_OUT EP_CDC_OUT(BRIDGE_CDC_PORTS + CFG_TUD_VENDOR)
+#define EP_STORE_IN EP_CDC_IN(BRIDGE_CDC_PORTS + CFG_TUD_VENDOR)
+// NCM has the endpoint layout of a CDC port
+#define NET_SLOT (BRIDGE_CDC_PORTS + CFG_TUD_VENDOR + CFG_TUD_MSC)
+
+#ifdef TUP_DCD_ENDPOINT_MAX
+// The controller's endpoint count, not the bridge, limits the port count
+static_assert((EP_CDC_IN(BRIDGE_CDC_PORTS - 1 + CFG_TUD_VENDOR +
+                         CFG_TUD_MSC + CFG_TUD_NCM) &
+               0x7F) <
+                  TUP_DCD_ENDPOINT_MAX,
+              "not enough endpoints for CONFIG_TINYUSB_CDC_COUNT");
+#endif
 
-#define EP_CDC1_NOTIF 0x83
-#define EP_CDC1_OUT 0x03
-#define EP_CDC1_IN 0x84
+#define CFG_TOTAL_LEN                                                          \
+  (TUD_CONFIG_DESC_LEN + TUD_CDC_DESC_LEN * BRIDGE_CDC_PORTS +                 \
+   TUD_VENDOR_DESC_LEN * CFG_TUD_VENDOR + TUD_MSC_DESC_LEN * CFG_TUD_MSC +     \
+   TUD_CDC_NCM_DESC_LEN * CFG_TUD_NCM)
 
-#define CFG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_CDC_DESC_LEN * 2)
+#define CDC_DESCRIPTOR(n)                                                      \
+  TUD_CDC_DESCRIPTOR(ITF_CDC_COMM(n), STR_CDC(n), EP_CDC_NOTIF(n), INT_SZ,     \
+                     EP_CDC_OUT(n), EP_CDC_IN(n), BULK_SZ)
 
 // TUD CDC Descriptors function
 static uint8_t const cfg_desc[] = {
     TUD_CONFIG_DESCRIPTOR(1, ITF_TOTAL, 0 /* iConfiguration */, CFG_TOTAL_LEN,
                           TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
 
-    // CDC0 — iInterface = 4  => "CDC0"
-    TUD_CDC_DESCRIPTOR(ITF_CDC0_COMM, 4, EP_CDC0_NOTIF, INT_SZ, EP_CDC0_OUT,
-                       EP_CDC0_IN, BULK_SZ),
+    // CDC ports, in bridge port order
+    CDC_DESCRIPTOR(0),
+#if BRIDGE_CDC_PORTS > 1
+    CDC_DESCRIPTOR(1),
+#endif
+#if BRIDGE_CDC_PORTS > 2
+    CDC_DESCRIPTOR(2),
+#endif
+#if BRIDGE_CDC_PORTS > 3
+    CDC_DESCRIPTOR(3),
+#endif
+
+#if CFG_TUD_VENDOR
+    // Capture — iInterface = 6 => "CAPTURE" (bulk IN carries mirrored traffic)
+    TUD_VENDOR_DESCRIPTOR(ITF_CAPTURE, STR_CAPTURE, EP_CAPTURE_OUT,
+                          EP_CAPTURE_IN, BULK_SZ),
+#endif
+
+#if CFG_TUD_MSC
+    // Capture store — iInterface = 9 => "CAPTURE_STORE" (segment files)
+    TUD_MSC_DESCRIPTOR(ITF_STORE, STR_STORE, EP_STORE_OUT, EP_STORE_IN,
+                       BULK_SZ),
+#endif
 
-    // CDC1 — iInterface = 5  => "CDC1"
-    TUD_CDC_DESCRIPTOR(ITF_CDC1_COMM, 5, EP_CDC1_NOTIF, INT_SZ, EP_CDC1_OUT,
-                       EP_CDC1_IN, BULK_SZ),
+#if CFG_TUD_NCM
+    // Capture network — iInterface = 10 => "CAPTURE_NET" (UDP capture)
+    TUD_CDC_NCM_DESCRIPTOR(ITF_NET, STR_NET, STR_NET_MAC,
+                           EP_CDC_NOTIF(NET_SLOT), INT_SZ,
+                           EP_CDC_OUT(NET_SLOT), EP_CDC_IN(NET_SLOT), BULK_SZ,
+                           CFG_TUD_NET_MTU),
+#endif
 };
 
 uint8_t const *tud_descriptor_configuration_cb(uint8_t index) {
@@ -140,93 +198,6 @@ uint8_t const *tud_descriptor_configuration_cb(uint8_t index) {
 } // extern "C"
 
 static const char *TAG = "example";
-// Local stack buffer
-
-#define ITF(val) static_cast<tinyusb_cdcacm_itf_t>(val)
-
-// Blink task
-// static void blink_task(void *pvParameter) {
-//   auto pin = (gpio_num_t)(uintptr_t)pvParameter;
-//   gpio_reset_pin(pin);
-//   gpio_set_direction(pin, GPIO_MODE_OUTPUT);
-//   unsigned state = 0;
-//   while (1) {
-//     gpio_set_level(pin, state);
-//     state = !state;
-//     vTaskDelay(pdMS_TO_TICKS(1000)); // 1 second delay
-//   }
-// }
-
-// --- Bidirectional bridge helper ---
-// forward from src_itf -> dst_itf
-static void forward_bytes_between_cdc(tinyusb_cdcacm_itf_t src_itf,
-                                      tinyusb_cdcacm_itf_t dst_itf) {
-#if (CONFIG_TINYUSB_CDC_COUNT > 1)
-  uint8_t local[CONFIG_TINYUSB_CDC_RX_BUFSIZE];
-  size_t rx_size = 0;
-
-  esp_err_t ret = tinyusb_cdcacm_read(src_itf, local, sizeof(local), &rx_size);
-  if (ret == ESP_OK && rx_size > 0) {
-    ESP_LOGI(TAG, "Forward %u bytes: itf%d -> itf%d", (unsigned)rx_size,
-             (int)src_itf, (int)dst_itf);
-    ESP_LOG_BUFFER_HEXDUMP(TAG, local, rx_size, ESP_LOG_DEBUG);
-
-    // write to the OTHER interface
-    (void)tinyusb_cdcacm_write_queue(dst_itf, local, rx_size);
-    (void)tinyusb_cdcacm_write_flush(dst_itf, 0);
-    traffic_pulse_now(); // blink LED on traffic
-  } else if (ret != ESP_OK) {
-    ESP_LOGE(TAG, "CDC read error on itf%d: %s", (int)src_itf,
-             esp_err_to_name(ret));
-  }
-#else
-  // If only one CDC present, just read & echo (fallback)
-  uint8_t local[CONFIG_TINYUSB_CDC_RX_BUFSIZE];
-  size_t rx_size = 0;
-  esp_err_t ret = tinyusb_cdcacm_read(src_itf, local, sizeof(local), &rx_size);
-  if (ret == ESP_OK && rx_size > 0) {
-    ESP_LOGI(TAG, "Echo %u bytes on itf%d", (unsigned)rx_size, (int)src_itf);
-    (void)tinyusb_cdcacm_write_queue(src_itf, local, rx_size);
-    (void)tinyusb_cdcacm_write_flush(src_itf, 0);
-  }
-#endif
-}
-
-static void tinyusb_cdc_rx_callback(int itf, cdcacm_event_t *event) {
-  (void)event;
-
-  // --- ORIGINAL echo path (kept, but commented out) ---
-  // size_t rx_size = 0;
-  // esp_err_t ret = tinyusb_cdcacm_read(ITF(itf), buf,
-  //                                     CONFIG_TINYUSB_CDC_RX_BUFSIZE,
-  //                                     &rx_size);
-  // if (ret == ESP_OK && rx_size > 0) {
-  //   ESP_LOGI(TAG, "Data from channel %d (len=%u):", itf, (unsigned)rx_size);
-  //   ESP_LOG_BUFFER_HEXDUMP(TAG, buf, rx_size, ESP_LOG_INFO);
-  //
-  //   // echo back
-  //   tinyusb_cdcacm_write_queue(ITF(itf), buf, rx_size);
-  //   tinyusb_cdcacm_write_flush(ITF(itf), 0);
-  // } else if (ret != ESP_OK) {
-  //   ESP_LOGE(TAG, "CDC read error: %s", esp_err_to_name(ret));
-  // }
-
-  // --- NEW bidirectional forwarding ---
-#if (CONFIG_TINYUSB_CDC_COUNT > 1)
-  // if data arrives on 0, forward to 1; if on 1, forward to 0
-  if (itf == (int)TINYUSB_CDC_ACM_0) {
-    forward_bytes_between_cdc(TINYUSB_CDC_ACM_0, TINYUSB_CDC_ACM_1);
-  } else if (itf == (int)TINYUSB_CDC_ACM_1) {
-    forward_bytes_between_cdc(TINYUSB_CDC_ACM_1, TINYUSB_CDC_ACM_0);
-  } else {
-    // safety: for any other ports, just echo (shouldn't happen unless >2 CDCs)
-    forward_bytes_between_cdc(ITF(itf), ITF(itf));
-  }
-#else
-  // one-port fallback: behave like echo
-  forward_bytes_between_cdc(ITF(itf), ITF(itf));
-#endif
-}
 
 // Quality of life: log the descriptors on init
 static void device_event_handler(tinyusb_event_t *event, void *arg) {
@@ -250,6 +221,13 @@ extern "C" void app_main(void) {
   // xTaskCreate(blink_task, "blink_task1", configMINIMAL_STACK_SIZE * 2,
   //             (void *)LED_GREEN, 5, NULL);
 
+  status_init();
+  capture_init();
+#if CAPTURE_NET
+  // The host reads the MAC string while enumerating
+  memcpy(s_net_mac, capture_net_host_mac(), sizeof(s_net_mac));
+#endif
+
   // --- TinyUSB 2.0 style device install ---
   tinyusb_config_t tusb_cfg = TINYUSB_DEFAULT_CONFIG(
       device_event_handler /* optional */, NULL /* user arg */);
@@ -258,27 +236,22 @@ extern "C" void app_main(void) {
 
   ESP_ERROR_CHECK(tinyusb_driver_install(&tusb_cfg));
 
-  // --- CDC-ACM init (no usb_dev field anymore) ---
-  tinyusb_config_cdcacm_t acm_cfg = {
-      .cdc_port = TINYUSB_CDC_ACM_0,
-      .callback_rx = &tinyusb_cdc_rx_callback,
-      .callback_rx_wanted_char = NULL,
-      .callback_line_state_changed = NULL,
-      .callback_line_coding_changed = NULL,
-  };
-
-  gpio_reset_pin(LED_BUILTIN);
-  gpio_set_direction(LED_BUILTIN, GPIO_MODE_OUTPUT);
-  gpio_set_level(LED_BUILTIN, 0);
-  s_led_off_tmr = xTimerCreate("ledOff", pdMS_TO_TICKS(TRAFFIC_PULSE_MS),
-                               pdFALSE, nullptr, led_off_cb);
-
-  ESP_ERROR_CHECK(tinyusb_cdcacm_init(&acm_cfg));
-
-#if (CONFIG_TINYUSB_CDC_COUNT > 1)
-  acm_cfg.cdc_port = TINYUSB_CDC_ACM_1;
-  ESP_ERROR_CHECK(tinyusb_cdcacm_init(&acm_cfg));
+#if CAPTURE_STORE
+  // Without the volume the bridge and capture channel still work
+  if (capture_store_init() != ESP_OK)
+    ESP_LOGW(TAG, "Capture store unavailable");
 #endif
+#if CAPTURE_NET
+  if (capture_net_init() != ESP_OK)
+    ESP_LOGW(TAG, "Capture network unavailable");
+#endif
+
+#if BRIDGE_BENCH
+  bench_init();
+#endif
+
+  // --- CDC ports and routing ---
+  ESP_ERROR_CHECK(bridge_init());
 }
 
 // --- DFU Runtime support ---
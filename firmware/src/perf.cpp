@@ -0,0 +1,119 @@
+#include <atomic>
+#include <esp_timer.h>
+#include <tinyusb.h>
+
+#include "perf.h"
+
+typedef struct {
+  std::atomic<uint32_t> rx_bytes, rx_chunks, tx_bytes, tx_chunks, tx_full;
+  std::atomic<uint16_t> rx_fifo_hwm, tx_fifo_hwm;
+  std::atomic<uint32_t> latency_min, latency_max, latency_total,
+      latency_count;
+} perf_counters_t;
+
+static perf_counters_t s_ports[PERF_MAX_PORTS];
+static std::atomic<uint32_t> s_tud_loops{0};
+static uint8_t s_n_ports = 0;
+
+#define RELAXED std::memory_order_relaxed
+
+template <typename T>
+static inline void update_max(std::atomic<T> &max, T v) {
+  T cur = max.load(RELAXED);
+  while (v > cur && !max.compare_exchange_weak(cur, v, RELAXED))
+    ;
+}
+
+template <typename T>
+static inline void update_min(std::atomic<T> &min, T v) {
+  T cur = min.load(RELAXED);
+  while (v < cur && !min.compare_exchange_weak(cur, v, RELAXED))
+    ;
+}
+
+static inline uint16_t clip16(size_t v) {
+  return v < 0xFFFF ? (uint16_t)v : 0xFFFF;
+}
+
+void perf_init(uint8_t ports) {
+  s_n_ports = ports < PERF_MAX_PORTS ? ports : PERF_MAX_PORTS;
+  perf_reset();
+}
+
+void perf_reset(void) {
+  for (auto &p : s_ports) {
+    p.rx_bytes.store(0, RELAXED);
+    p.rx_chunks.store(0, RELAXED);
+    p.tx_bytes.store(0, RELAXED);
+    p.tx_chunks.store(0, RELAXED);
+    p.tx_full.store(0, RELAXED);
+    p.rx_fifo_hwm.store(0, RELAXED);
+    p.tx_fifo_hwm.store(0, RELAXED);
+    p.latency_min.store(UINT32_MAX, RELAXED);
+    p.latency_max.store(0, RELAXED);
+    p.latency_total.store(0, RELAXED);
+    p.latency_count.store(0, RELAXED);
+  }
+  s_tud_loops.store(0, RELAXED);
+}
+
+void perf_rx(uint8_t port, size_t len, size_t fifo_level) {
+  if (port >= PERF_MAX_PORTS)
+    return;
+  perf_counters_t &p = s_ports[port];
+  p.rx_bytes.fetch_add((uint32_t)len, RELAXED);
+  p.rx_chunks.fetch_add(1, RELAXED);
+  update_max(p.rx_fifo_hwm, clip16(fifo_level));
+}
+
+void perf_tx(uint8_t port, size_t len, size_t queued, size_t fifo_level) {
+  if (port >= PERF_MAX_PORTS)
+    return;
+  perf_counters_t &p = s_ports[port];
+  p.tx_bytes.fetch_add((uint32_t)queued, RELAXED);
+  p.tx_chunks.fetch_add(1, RELAXED);
+  if (queued < len)
+    p.tx_full.fetch_add(1, RELAXED);
+  update_max(p.tx_fifo_hwm, clip16(fifo_level));
+}
+
+void perf_latency(uint8_t port, uint32_t us) {
+  if (port >= PERF_MAX_PORTS)
+    return;
+  perf_counters_t &p = s_ports[port];
+  update_min(p.latency_min, us);
+  update_max(p.latency_max, us);
+  p.latency_total.fetch_add(us, RELAXED);
+  p.latency_count.fetch_add(1, RELAXED);
+}
+
+void perf_task_loop(void) { s_tud_loops.fetch_add(1, RELAXED); }
+
+// Counts TinyUSB task passes (weak hook of the esp_tinyusb component)
+extern "C" void tinyusb_task_loop_hook(void) { perf_task_loop(); }
+
+void perf_read_device(perf_device_t *out) {
+  *out = {};
+  out->uptime_ms = (uint32_t)(esp_timer_get_time() / 1000);
+  out->tud_loops = s_tud_loops.load(RELAXED);
+  out->ports = s_n_ports;
+}
+
+bool perf_read_port(uint8_t port, perf_port_t *out) {
+  if (port >= s_n_ports)
+    return false;
+  const perf_counters_t &p = s_ports[port];
+  out->rx_bytes = p.rx_bytes.load(RELAXED);
+  out->rx_chunks = p.rx_chunks.load(RELAXED);
+  out->tx_bytes = p.tx_bytes.load(RELAXED);
+  out->tx_chunks = p.tx_chunks.load(RELAXED);
+  out->tx_full = p.tx_full.load(RELAXED);
+  out->rx_fifo_hwm = p.rx_fifo_hwm.load(RELAXED);
+  out->tx_fifo_hwm = p.tx_fifo_hwm.load(RELAXED);
+  const uint32_t count = p.latency_count.load(RELAXED);
+  out->latency_min = count ? p.latency_min.load(RELAXED) : 0;
+  out->latency_max = p.latency_max.load(RELAXED);
+  out->latency_total = p.latency_total.load(RELAXED);
+  out->latency_count = count;
+  return true;
+}
@@ -0,0 +1,216 @@
+#include "record.h"
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), byte-wise table
+static const uint16_t k_crc_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7, 0x8108,
+    0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF, 0x1231, 0x0210,
+    0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6, 0x9339, 0x8318, 0xB37B,
+    0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE, 0x2462, 0x3443, 0x0420, 0x1401,
+    0x64E6, 0x74C7, 0x44A4, 0x5485, 0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE,
+    0xF5CF, 0xC5AC, 0xD58D, 0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6,
+    0x5695, 0x46B4, 0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D,
+    0xC7BC, 0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B, 0x5AF5,
+    0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12, 0xDBFD, 0xCBDC,
+    0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A, 0x6CA6, 0x7C87, 0x4CE4,
+    0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41, 0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD,
+    0xAD2A, 0xBD0B, 0x8D68, 0x9D49, 0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13,
+    0x2E32, 0x1E51, 0x0E70, 0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A,
+    0x9F59, 0x8F78, 0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E,
+    0xE16F, 0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E, 0x02B1,
+    0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256, 0xB5EA, 0xA5CB,
+    0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D, 0x34E2, 0x24C3, 0x14A0,
+    0x0481, 0x7466, 0x6447, 0x5424, 0x4405, 0xA7DB, 0xB7FA, 0x8799, 0x97B8,
+    0xE75F, 0xF77E, 0xC71D, 0xD73C, 0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657,
+    0x7676, 0x4615, 0x5634, 0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9,
+    0xB98A, 0xA9AB, 0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882,
+    0x28A3, 0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92, 0xFD2E,
+    0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9, 0x7C26, 0x6C07,
+    0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1, 0xEF1F, 0xFF3E, 0xCF5D,
+    0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8, 0x6E17, 0x7E36, 0x4E55, 0x5E74,
+    0x2E93, 0x3EB2, 0x0ED1, 0x1EF0,
+};
+
+static inline uint16_t crc_update(uint16_t crc, uint8_t byte) {
+  return (uint16_t)((crc << 8) ^ k_crc_table[(crc >> 8) ^ byte]);
+}
+
+uint16_t record_crc16(const uint8_t *data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++)
+    crc = crc_update(crc, data[i]);
+  return crc;
+}
+
+// Streaming COBS encoder: records are encoded straight from their pieces
+// (header, payload, CRC) without assembling them first. With `raw` set it
+// only concatenates, to build records for the compressor.
+typedef struct {
+  bool raw;
+  uint8_t *out;
+  size_t cap;
+  size_t pos;  // next output byte
+  size_t code; // position of the pending code byte
+  uint16_t crc;
+  bool overflow;
+} encoder_t;
+
+static void enc_begin(encoder_t *e, uint8_t *out, size_t cap,
+                      bool raw = false) {
+  e->raw = raw;
+  e->out = out;
+  e->cap = cap;
+  e->code = 0;
+  e->pos = raw ? 0 : 1;
+  e->crc = 0xFFFF;
+  e->overflow = cap < 2;
+}
+
+static inline void enc_byte(encoder_t *e, uint8_t byte) {
+  if (e->overflow)
+    return;
+  if (e->raw) {
+    if (e->pos >= e->cap)
+      e->overflow = true;
+    else
+      e->out[e->pos++] = byte;
+    return;
+  }
+  if (byte != 0) {
+    if (e->pos >= e->cap) {
+      e->overflow = true;
+      return;
+    }
+    e->out[e->pos++] = byte;
+  }
+  // Close the block on a zero or when it reaches the 254-byte maximum
+  if (byte == 0 || e->pos - e->code == 0xFF) {
+    e->out[e->code] = (uint8_t)(e->pos - e->code);
+    if (e->pos >= e->cap) {
+      e->overflow = true;
+      return;
+    }
+    e->code = e->pos++;
+  }
+}
+
+static void enc_bytes(encoder_t *e, const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    e->crc = crc_update(e->crc, data[i]);
+    enc_byte(e, data[i]);
+  }
+}
+
+static void enc_u32(encoder_t *e, uint32_t v) {
+  const uint8_t b[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16),
+                        (uint8_t)(v >> 24)};
+  enc_bytes(e, b, sizeof(b));
+}
+
+static void enc_header(encoder_t *e, record_type_t type, uint32_t seq,
+                       uint64_t time_us) {
+  const uint8_t t = type;
+  enc_bytes(e, &t, 1);
+  enc_u32(e, seq);
+  enc_u32(e, (uint32_t)time_us);
+}
+
+static size_t enc_end(encoder_t *e, bool crc = true) {
+  if (crc) {
+    const uint16_t sum = e->crc;
+    enc_byte(e, (uint8_t)(sum & 0xFF));
+    enc_byte(e, (uint8_t)(sum >> 8));
+  }
+  if (e->raw)
+    return e->overflow ? 0 : e->pos;
+  if (e->overflow || e->pos >= e->cap)
+    return 0;
+  e->out[e->code] = (uint8_t)(e->pos - e->code);
+  e->out[e->pos++] = 0; // delimiter
+  return e->pos;
+}
+
+static size_t data_record(uint8_t *out, size_t cap, bool raw, uint32_t seq,
+                          uint64_t time_us, uint8_t src_itf,
+                          const uint8_t *payload, size_t len) {
+  encoder_t e;
+  enc_begin(&e, out, cap, raw);
+  enc_header(&e, RECORD_DATA, seq, time_us);
+  enc_bytes(&e, &src_itf, 1);
+  enc_bytes(&e, payload, len);
+  return enc_end(&e);
+}
+
+size_t record_encode_data(uint8_t *out, size_t cap, uint32_t seq,
+                          uint64_t time_us, uint8_t src_itf,
+                          const uint8_t *payload, size_t len) {
+  return data_record(out, cap, false, seq, time_us, src_itf, payload, len);
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+void record_compressor_reset(record_compressor_t *c) {
+  lz_reset(&c->lz);
+  c->seq = c->time = 0;
+}
+
+size_t record_encode_compressed(record_compressor_t *c, uint8_t *out,
+                                size_t cap, uint32_t seq, uint64_t time_us,
+                                uint8_t src_itf, const uint8_t *payload,
+                                size_t len) {
+  const size_t raw = data_record(c->raw, sizeof(c->raw), true, seq, time_us,
+                                 src_itf, payload, len);
+  if (raw == 0)
+    return 0;
+  const uint8_t type = c->lz.len == 0 ? RECORD_LZ_START : RECORD_LZ;
+  // Delta-code the header against the previous record of the chain
+  const uint32_t time = (uint32_t)time_us;
+  put_u32(c->raw + 1, seq - c->seq);
+  put_u32(c->raw + 5, time - c->time);
+  c->seq = seq;
+  c->time = time;
+
+  const size_t n =
+      lz_compress(&c->lz, c->raw, raw, c->block, sizeof(c->block));
+  encoder_t e;
+  enc_begin(&e, out, cap);
+  enc_bytes(&e, &type, 1);
+  enc_bytes(&e, c->block, n);
+  const size_t wire = n ? enc_end(&e, false) : 0;
+  if (wire == 0)
+    record_compressor_reset(c);
+  return wire;
+}
+
+size_t record_encode_sync(uint8_t *out, size_t cap, uint32_t seq,
+                          uint64_t time_us, uint32_t records,
+                          uint32_t filtered, uint32_t dropped) {
+  encoder_t e;
+  enc_begin(&e, out, cap);
+  enc_header(&e, RECORD_SYNC, seq, time_us);
+  enc_u32(&e, (uint32_t)(time_us >> 32));
+  enc_u32(&e, records);
+  enc_u32(&e, filtered);
+  enc_u32(&e, dropped);
+  return enc_end(&e);
+}
+
+size_t record_encode_perf(uint8_t *out, size_t cap, uint32_t seq,
+                          uint64_t time_us, const perf_device_t *dev,
+                          const perf_port_t *ports) {
+  // Both structs are packed little-endian wire images
+  encoder_t e;
+  enc_begin(&e, out, cap);
+  enc_header(&e, RECORD_PERF, seq, time_us);
+  enc_bytes(&e, reinterpret_cast<const uint8_t *>(dev), sizeof(*dev));
+  enc_bytes(&e, reinterpret_cast<const uint8_t *>(ports),
+            dev->ports * sizeof(perf_port_t));
+  return enc_end(&e);
+}
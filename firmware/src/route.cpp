@@ -0,0 +1,47 @@
+#include <atomic>
+
+#include "route.h"
+
+static std::atomic<route_mask_t> s_routes[ROUTE_MAX_PORTS];
+static uint8_t s_ports = 0;
+
+#define BIT(port) ((route_mask_t)(1u << (port)))
+
+void route_init(uint8_t cdc_ports, bool has_uart) {
+  const uint8_t ports = cdc_ports + (has_uart ? 1 : 0);
+  s_ports = ports < ROUTE_MAX_PORTS ? ports : ROUTE_MAX_PORTS;
+  for (auto &r : s_routes)
+    r.store(0, std::memory_order_relaxed);
+  if (has_uart) {
+    const uint8_t uart = s_ports - 1;
+    route_set(0, BIT(uart));
+    route_set(uart, BIT(0));
+    return;
+  }
+  for (uint8_t a = 0; a < s_ports; a += 2) {
+    const uint8_t b = a + 1 < s_ports ? a + 1 : a;
+    route_set(a, BIT(b));
+    route_set(b, BIT(a));
+  }
+}
+
+uint8_t route_ports(void) { return s_ports; }
+
+bool route_set(uint8_t src, route_mask_t dst) {
+  if (src >= s_ports || (dst >> s_ports) != 0)
+    return false;
+  s_routes[src].store(dst, std::memory_order_relaxed);
+  return true;
+}
+
+route_mask_t route_get(uint8_t src) {
+  return src < ROUTE_MAX_PORTS ? s_routes[src].load(std::memory_order_relaxed)
+                               : 0;
+}
+
+size_t route_snapshot(route_mask_t *out, size_t cap) {
+  size_t n = s_ports < cap ? s_ports : cap;
+  for (size_t i = 0; i < n; i++)
+    out[i] = route_get((uint8_t)i);
+  return n;
+}
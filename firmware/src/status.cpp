@@ -0,0 +1,67 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "pinout.h"
+#include "status.h"
+
+#define STATUS_TASK_PRIO 1
+#define STATUS_TASK_STACK 2048
+
+std::atomic<bool> g_status_flags[STATUS_EVENTS];
+
+// Indexed by status_event_t
+static const uint16_t k_hold_ms[STATUS_EVENTS] = {
+    STATUS_ACTIVITY_MS,
+    STATUS_OVERFLOW_MS,
+    STATUS_ERROR_MS,
+};
+
+static void led_init(gpio_num_t pin, bool on) {
+  gpio_reset_pin(pin);
+  gpio_set_direction(pin, GPIO_MODE_OUTPUT);
+  gpio_set_level(pin, on);
+}
+
+// The RGB LED is common anode: a pin driven low lights its colour
+static inline void rgb(bool r, bool g, bool b) {
+  gpio_set_level(LED_RED, !r);
+  gpio_set_level(LED_GREEN, !g);
+  gpio_set_level(LED_BLUE, !b);
+}
+
+static void status_task(void *) {
+  // Ticks each state stays lit for, refreshed while its flag keeps firing
+  uint16_t hold[STATUS_EVENTS] = {};
+  uint8_t shown = 0xFF; // state bits currently on the LEDs
+  TickType_t wake = xTaskGetTickCount();
+  for (;;) {
+    uint8_t state = 0;
+    for (int e = 0; e < STATUS_EVENTS; e++) {
+      if (g_status_flags[e].exchange(false, std::memory_order_relaxed))
+        hold[e] = k_hold_ms[e] / STATUS_TICK_MS;
+      else if (hold[e] > 0)
+        hold[e]--;
+      if (hold[e] > 0)
+        state |= 1 << e;
+    }
+    // Touch the GPIOs only when something changes
+    if (state != shown) {
+      const bool error = state & (1 << STATUS_ERROR);
+      const bool overflow = !error && (state & (1 << STATUS_OVERFLOW));
+      const bool activity = state & (1 << STATUS_ACTIVITY);
+      gpio_set_level(LED_BUILTIN, activity);
+      rgb(error, activity && !error && !overflow, overflow);
+      shown = state;
+    }
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(STATUS_TICK_MS));
+  }
+}
+
+void status_init(void) {
+  led_init(LED_BUILTIN, false);
+  led_init(LED_RED, true);
+  led_init(LED_GREEN, true);
+  led_init(LED_BLUE, true);
+  xTaskCreate(status_task, "status", STATUS_TASK_STACK, nullptr,
+              STATUS_TASK_PRIO, nullptr);
+}
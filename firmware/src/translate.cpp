@@ -0,0 +1,294 @@
+#include <string.h>
+
+#include "translate.h"
+
+// Size of the instruction at code[pc], 0 if it is unknown or truncated
+static size_t op_size(const uint8_t *code, size_t pc, size_t code_len) {
+  size_t size;
+  switch (code[pc]) {
+  case XOP_END:
+  case XOP_PASS:
+  case XOP_DROP:
+  case XOP_LDLEN:
+  case XOP_EMIT:
+    size = 1;
+    break;
+  case XOP_LD8:
+  case XOP_LD16:
+  case XOP_ST8:
+  case XOP_ST16:
+  case XOP_JMP:
+    size = 2;
+    break;
+  case XOP_SET8:
+  case XOP_AND:
+  case XOP_ADD:
+  case XOP_XOR:
+  case XOP_DELETE:
+    size = 3;
+    break;
+  case XOP_JEQ:
+  case XOP_JNE:
+  case XOP_JLT:
+  case XOP_CSUM_XOR:
+  case XOP_CSUM_CRC8:
+    size = 4;
+    break;
+  case XOP_INSERT:
+    if (pc + 3 > code_len)
+      return 0;
+    size = 3 + code[pc + 2];
+    break;
+  case XOP_INJECT:
+    if (pc + 2 > code_len)
+      return 0;
+    size = 2 + code[pc + 1];
+    break;
+  default:
+    return 0;
+  }
+  return pc + size <= code_len ? size : 0;
+}
+
+bool xlate_verify(const uint8_t *code, size_t code_len) {
+  if (code_len > XLATE_MAX_CODE)
+    return false;
+  // Pass 1: mark instruction boundaries (code_len itself is a valid target)
+  uint8_t boundary[XLATE_MAX_CODE / 8 + 1] = {};
+  for (size_t pc = 0; pc < code_len;) {
+    const size_t size = op_size(code, pc, code_len);
+    if (size == 0)
+      return false;
+    boundary[pc / 8] |= 1u << (pc % 8);
+    pc += size;
+  }
+  boundary[code_len / 8] |= 1u << (code_len % 8);
+  // Pass 2: every jump must land on a boundary
+  for (size_t pc = 0; pc < code_len;) {
+    const size_t size = op_size(code, pc, code_len);
+    size_t target = 0;
+    switch (code[pc]) {
+    case XOP_JEQ:
+    case XOP_JNE:
+    case XOP_JLT:
+      target = pc + size + code[pc + 3];
+      break;
+    case XOP_JMP:
+      target = pc + size + code[pc + 1];
+      break;
+    default:
+      pc += size;
+      continue;
+    }
+    if (target > code_len || !(boundary[target / 8] & (1u << (target % 8))))
+      return false;
+    pc += size;
+  }
+  return true;
+}
+
+// CRC-8/DVB-S2 (poly 0xD5), as used by MSP v2
+struct Crc8Table {
+  uint8_t t[256];
+  constexpr Crc8Table() : t() {
+    for (int i = 0; i < 256; i++) {
+      uint8_t crc = (uint8_t)i;
+      for (int b = 0; b < 8; b++)
+        crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0xD5) : (uint8_t)(crc << 1);
+      t[i] = crc;
+    }
+  }
+};
+static constexpr Crc8Table s_crc8;
+
+// Operand decoders, only valid for opcodes that carry the operand
+static inline int8_t off8(const uint8_t *ins) { return (int8_t)ins[1]; }
+static inline uint16_t imm16(const uint8_t *ins) {
+  return (uint16_t)(ins[1] | (ins[2] << 8));
+}
+
+// Resolve a signed frame offset; `width` bytes must fit after it
+static inline bool locate(int8_t off, size_t len, size_t width, size_t *pos) {
+  size_t p;
+  if (off >= 0)
+    p = (size_t)off;
+  else if ((size_t)(-off) <= len)
+    p = len - (size_t)(-off);
+  else
+    return false;
+  if (p + width > len)
+    return false;
+  *pos = p;
+  return true;
+}
+
+// Range [from, to) for checksum ops; to == 0 means end of frame
+static inline bool locate_range(int8_t from, int8_t to, size_t len,
+                                size_t *begin, size_t *end) {
+  if (!locate(from, len, 0, begin))
+    return false;
+  if (to == 0)
+    *end = len;
+  else if (!locate(to, len, 0, end))
+    return false;
+  return *begin <= *end;
+}
+
+xlate_verdict_t xlate_run(const uint8_t *code, size_t code_len, uint8_t *frame,
+                          size_t *len, size_t cap, xlate_emit_cb_t emit,
+                          void *arg) {
+  uint16_t acc = 0;
+  size_t pc = 0;
+  size_t pos;
+  while (pc < code_len) {
+    const uint8_t *ins = code + pc;
+    const size_t size = op_size(code, pc, code_len);
+    pc += size;
+    switch (ins[0]) {
+    case XOP_END:
+    case XOP_PASS:
+      return XLATE_PASS;
+    case XOP_DROP:
+      return XLATE_DROP;
+    case XOP_LD8:
+      if (!locate(off8(ins), *len, 1, &pos))
+        return XLATE_FAULT;
+      acc = frame[pos];
+      break;
+    case XOP_LD16:
+      if (!locate(off8(ins), *len, 2, &pos))
+        return XLATE_FAULT;
+      acc = (uint16_t)(frame[pos] | (frame[pos + 1] << 8));
+      break;
+    case XOP_LDLEN:
+      acc = (uint16_t)*len;
+      break;
+    case XOP_ST8:
+      if (!locate(off8(ins), *len, 1, &pos))
+        return XLATE_FAULT;
+      frame[pos] = (uint8_t)acc;
+      break;
+    case XOP_ST16:
+      if (!locate(off8(ins), *len, 2, &pos))
+        return XLATE_FAULT;
+      frame[pos] = (uint8_t)acc;
+      frame[pos + 1] = (uint8_t)(acc >> 8);
+      break;
+    case XOP_SET8:
+      if (!locate(off8(ins), *len, 1, &pos))
+        return XLATE_FAULT;
+      frame[pos] = ins[2];
+      break;
+    case XOP_AND:
+      acc &= imm16(ins);
+      break;
+    case XOP_ADD:
+      acc = (uint16_t)(acc + imm16(ins));
+      break;
+    case XOP_XOR:
+      acc ^= imm16(ins);
+      break;
+    case XOP_JEQ:
+      if (acc == imm16(ins))
+        pc += ins[3];
+      break;
+    case XOP_JNE:
+      if (acc != imm16(ins))
+        pc += ins[3];
+      break;
+    case XOP_JLT:
+      if (acc < imm16(ins))
+        pc += ins[3];
+      break;
+    case XOP_JMP:
+      pc += ins[1];
+      break;
+    case XOP_INSERT: {
+      const size_t n = ins[2];
+      if (!locate(off8(ins), *len, 0, &pos) || *len + n > cap)
+        return XLATE_FAULT;
+      memmove(frame + pos + n, frame + pos, *len - pos);
+      memcpy(frame + pos, ins + 3, n);
+      *len += n;
+      break;
+    }
+    case XOP_DELETE: {
+      const size_t n = ins[2];
+      if (!locate(off8(ins), *len, n, &pos))
+        return XLATE_FAULT;
+      memmove(frame + pos, frame + pos + n, *len - pos - n);
+      *len -= n;
+      break;
+    }
+    case XOP_CSUM_XOR:
+    case XOP_CSUM_CRC8: {
+      size_t begin, end, at;
+      if (!locate_range(off8(ins), (int8_t)ins[2], *len, &begin, &end) ||
+          !locate((int8_t)ins[3], *len, 1, &at))
+        return XLATE_FAULT;
+      uint8_t sum = 0;
+      if (ins[0] == XOP_CSUM_XOR)
+        for (size_t i = begin; i < end; i++)
+          sum ^= frame[i];
+      else
+        for (size_t i = begin; i < end; i++)
+          sum = s_crc8.t[sum ^ frame[i]];
+      frame[at] = sum;
+      break;
+    }
+    case XOP_INJECT:
+      if (emit)
+        emit(arg, ins + 2, ins[1]);
+      break;
+    case XOP_EMIT:
+      if (emit)
+        emit(arg, frame, *len);
+      break;
+    default:
+      return XLATE_FAULT; // unreachable for verified programs
+    }
+  }
+  return XLATE_PASS;
+}
+
+// ---------- Program table ----------
+
+typedef struct {
+  uint16_t len;
+  uint8_t code[XLATE_MAX_CODE];
+} program_t;
+
+static uint8_t s_staged[XLATE_MAX_CODE];
+static program_t s_programs[XLATE_MAX_SOURCES];
+
+bool xlate_stage(uint16_t offset, const uint8_t *data, size_t len) {
+  if (offset + len > sizeof(s_staged))
+    return false;
+  memcpy(s_staged + offset, data, len);
+  return true;
+}
+
+bool xlate_commit(uint8_t src, uint16_t code_len) {
+  if (src >= XLATE_MAX_SOURCES || !xlate_verify(s_staged, code_len))
+    return false;
+  memcpy(s_programs[src].code, s_staged, code_len);
+  s_programs[src].len = code_len;
+  return true;
+}
+
+void xlate_clear(uint8_t src) {
+  if (src < XLATE_MAX_SOURCES)
+    s_programs[src].len = 0;
+}
+
+bool xlate_active(uint8_t src) {
+  return src < XLATE_MAX_SOURCES && s_programs[src].len > 0;
+}
+
+xlate_verdict_t xlate_apply(uint8_t src, uint8_t *frame, size_t *len,
+                            size_t cap, xlate_emit_cb_t emit, void *arg) {
+  if (!xlate_active(src))
+    return XLATE_PASS;
+  const program_t &p = s_programs[src];
+  return xlate_run(p.code, p.len, frame, len, cap, emit, arg);
+}
@@ -0,0 +1,164 @@
+#include "config.h"
+
+#if BRIDGE_UART_ENABLED
+
+#include <driver/uart.h>
+#include <esp_check.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#include "pinout.h"
+#include "status.h"
+#include "uart_bridge.h"
+
+static const char *TAG = "uart_bridge";
+
+// Ring buffers absorb ~25 ms of line time at 5 Mbaud between task wakeups
+#define UART_RX_RING (16 * 1024)
+#define UART_TX_RING (8 * 1024)
+#define UART_EVENT_DEPTH 32
+#define UART_PATTERN_DEPTH 64
+// Raise the RX interrupt well before the 128-byte hardware FIFO fills up
+#define UART_RX_FULL_THRESH 64
+#define UART_TASK_PRIO 12
+#define UART_TASK_STACK 4096
+
+static QueueHandle_t s_events = nullptr;
+static uart_link_t s_link;
+static uart_bridge_frame_cb_t s_on_frame = nullptr;
+
+static int drv_read(void *, uint8_t *buf, size_t len) {
+  return uart_read_bytes(BRIDGE_UART_PORT, buf, len, 0);
+}
+
+static int drv_write(void *, const uint8_t *buf, size_t len) {
+  return uart_write_bytes(BRIDGE_UART_PORT, buf, len);
+}
+
+static void deliver(void *, const uint8_t *frame, size_t len) {
+  s_on_frame(frame, len);
+}
+
+// Consume every pattern the driver has located, then whatever is left when
+// the line goes idle. Without pattern framing, data is consumed eagerly.
+static void drain(bool idle) {
+#if BRIDGE_UART_PATTERN >= 0
+  int pos;
+  while ((pos = uart_pattern_pop_pos(BRIDGE_UART_PORT)) >= 0)
+    uart_link_on_pattern(&s_link, (size_t)pos + BRIDGE_UART_PATTERN_LEN);
+  // Leave bytes in the ring buffer until their pattern (or the idle gap)
+  // shows up, unless a frame would not fit anyway
+  size_t buffered = 0;
+  uart_get_buffered_data_len(BRIDGE_UART_PORT, &buffered);
+  if (idle || buffered >= UART_LINK_FRAME_MAX)
+    uart_link_on_data(&s_link, buffered, idle);
+#else
+  size_t buffered = 0;
+  uart_get_buffered_data_len(BRIDGE_UART_PORT, &buffered);
+  uart_link_on_data(&s_link, buffered, idle);
+#endif
+}
+
+static void recover_overflow(void) {
+  uart_flush_input(BRIDGE_UART_PORT);
+  xQueueReset(s_events);
+#if BRIDGE_UART_PATTERN >= 0
+  uart_pattern_queue_reset(BRIDGE_UART_PORT, UART_PATTERN_DEPTH);
+#endif
+  uart_link_on_overflow(&s_link);
+}
+
+static void uart_event_task(void *) {
+  uart_event_t ev;
+  for (;;) {
+    if (xQueueReceive(s_events, &ev, portMAX_DELAY) != pdTRUE)
+      continue;
+    switch (ev.type) {
+    case UART_DATA:
+      drain(ev.timeout_flag);
+      break;
+    case UART_PATTERN_DET:
+      drain(false);
+      break;
+    case UART_FIFO_OVF:
+    case UART_BUFFER_FULL:
+      ESP_LOGW(TAG, "RX overflow (%d), frame dropped", (int)ev.type);
+      status_signal(STATUS_OVERFLOW);
+      recover_overflow();
+      break;
+    case UART_FRAME_ERR:
+    case UART_PARITY_ERR:
+      ESP_LOGW(TAG, "Line error (%d)", (int)ev.type);
+      status_signal(STATUS_ERROR);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+esp_err_t uart_bridge_init(uart_bridge_frame_cb_t on_frame) {
+  s_on_frame = on_frame;
+  const uart_link_ops_t ops = {
+      .ctx = nullptr,
+      .read = drv_read,
+      .write = drv_write,
+  };
+  uart_link_init(&s_link, &ops, deliver, nullptr);
+
+  uart_config_t cfg = {};
+  cfg.baud_rate = BRIDGE_UART_BAUD;
+  cfg.data_bits = UART_DATA_8_BITS;
+  cfg.parity = UART_PARITY_DISABLE;
+  cfg.stop_bits = UART_STOP_BITS_1;
+  cfg.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+  cfg.source_clk = UART_SCLK_APB;
+
+  ESP_RETURN_ON_ERROR(uart_driver_install(BRIDGE_UART_PORT, UART_RX_RING,
+                                          UART_TX_RING, UART_EVENT_DEPTH,
+                                          &s_events, 0),
+                      TAG, "driver install");
+  ESP_RETURN_ON_ERROR(uart_param_config(BRIDGE_UART_PORT, &cfg), TAG,
+                      "param config");
+  ESP_RETURN_ON_ERROR(uart_set_pin(BRIDGE_UART_PORT, UART_BRIDGE_TX,
+                                   UART_BRIDGE_RX, UART_PIN_NO_CHANGE,
+                                   UART_PIN_NO_CHANGE),
+                      TAG, "set pin");
+  ESP_RETURN_ON_ERROR(
+      uart_set_rx_full_threshold(BRIDGE_UART_PORT, UART_RX_FULL_THRESH), TAG,
+      "rx threshold");
+  ESP_RETURN_ON_ERROR(
+      uart_set_rx_timeout(BRIDGE_UART_PORT, BRIDGE_UART_IDLE_SYMBOLS), TAG,
+      "rx timeout");
+#if BRIDGE_UART_PATTERN >= 0
+  ESP_RETURN_ON_ERROR(
+      uart_enable_pattern_det_baud_intr(BRIDGE_UART_PORT, BRIDGE_UART_PATTERN,
+                                        BRIDGE_UART_PATTERN_LEN, 9, 0, 0),
+      TAG, "pattern detect");
+  ESP_RETURN_ON_ERROR(
+      uart_pattern_queue_reset(BRIDGE_UART_PORT, UART_PATTERN_DEPTH), TAG,
+      "pattern queue");
+#endif
+
+  uint32_t baud = 0;
+  uart_get_baudrate(BRIDGE_UART_PORT, &baud);
+  ESP_LOGI(TAG, "UART%d bridge @ %u baud", (int)BRIDGE_UART_PORT,
+           (unsigned)baud);
+
+  // Core 1 keeps the UART service away from the TinyUSB task
+  if (xTaskCreatePinnedToCore(uart_event_task, "uart_bridge", UART_TASK_STACK,
+                              nullptr, UART_TASK_PRIO, nullptr,
+                              1) != pdPASS)
+    return ESP_ERR_NO_MEM;
+  return ESP_OK;
+}
+
+size_t uart_bridge_write(const uint8_t *data, size_t len) {
+  return uart_link_send(&s_link, data, len);
+}
+
+const uart_link_stats_t *uart_bridge_stats(void) { return &s_link.stats; }
+
+#endif // BRIDGE_UART_ENABLED
@@ -0,0 +1,65 @@
+#include <string.h>
+
+#include "uart_link.h"
+
+static void emit(uart_link_t *link) {
+  if (link->len == 0)
+    return;
+  link->on_frame(link->arg, link->buf, link->len);
+  link->stats.frames++;
+  link->len = 0;
+}
+
+// Move `n` buffered bytes from the driver into the frame buffer, cutting
+// frames whenever the buffer fills up.
+static void pull(uart_link_t *link, size_t n) {
+  while (n > 0) {
+    size_t room = sizeof(link->buf) - link->len;
+    if (room == 0) {
+      link->stats.splits++;
+      emit(link);
+      room = sizeof(link->buf);
+    }
+    const size_t chunk = n < room ? n : room;
+    const int got = link->ops.read(link->ops.ctx, link->buf + link->len, chunk);
+    if (got <= 0)
+      return;
+    link->len += (size_t)got;
+    n -= (size_t)got;
+  }
+}
+
+void uart_link_init(uart_link_t *link, const uart_link_ops_t *ops,
+                    uart_link_frame_cb_t on_frame, void *arg) {
+  memset(link, 0, sizeof(*link));
+  link->ops = *ops;
+  link->on_frame = on_frame;
+  link->arg = arg;
+}
+
+void uart_link_on_data(uart_link_t *link, size_t available, bool idle) {
+  pull(link, available);
+  if (idle)
+    emit(link);
+}
+
+void uart_link_on_pattern(uart_link_t *link, size_t end) {
+  pull(link, end);
+  emit(link);
+}
+
+void uart_link_on_overflow(uart_link_t *link) {
+  link->stats.overflows++;
+  link->len = 0;
+}
+
+size_t uart_link_send(uart_link_t *link, const uint8_t *data, size_t len) {
+  size_t sent = 0;
+  while (sent < len) {
+    const int n = link->ops.write(link->ops.ctx, data + sent, len - sent);
+    if (n <= 0)
+      break;
+    sent += (size_t)n;
+  }
+  return sent;
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "CaptureDecoder.h"
+#include "record.h"
+
+// Capture compression on representative traffic: ratio on the wire (COBS
+// and record overhead included) and CPU cost of both codecs. Host numbers;
+// the ESP32-S3 encoder runs roughly 20-40x slower per byte than a desktop
+// core, so scale compress ns/record accordingly.
+
+using Clock = std::chrono::steady_clock;
+typedef std::vector<uint8_t> Bytes;
+
+// MSP v1 polling: attitude / analog / RC requests and their responses;
+// a sensor value changes every few responses
+static Bytes msp_frame(std::mt19937 &rng, size_t i) {
+  static uint8_t state[16] = {0xDC, 0x05, 0xDC, 0x05, 0xE8, 0x03, 0xDC, 0x05,
+                              0x10, 0x00, 0x20, 0x00, 0x30, 0x00, 0x40, 0x00};
+  if (rng() % 4 == 0)
+    state[rng() % 16] += (uint8_t)(rng() % 3) - 1;
+  static const uint8_t cmds[] = {108, 110, 105};
+  const uint8_t cmd = cmds[i % 3];
+  const bool request = (i / 3) % 2 == 0;
+  Bytes f = {'$', 'M', (uint8_t)(request ? '<' : '>')};
+  const uint8_t size = request ? 0 : (cmd == 105 ? 16 : 6 + (cmd == 110));
+  f.push_back(size);
+  f.push_back(cmd);
+  for (uint8_t b = 0; b < size; b++)
+    f.push_back(state[b]);
+  uint8_t x = 0;
+  for (size_t k = 3; k < f.size(); k++)
+    x ^= f[k];
+  f.push_back(x);
+  return f;
+}
+
+// Modbus RTU: read holding registers request and response
+static Bytes modbus_frame(std::mt19937 &rng, size_t i) {
+  if (i % 2 == 0)
+    return {0x01, 0x03, 0x00, 0x10, 0x00, 0x08, 0x45, 0xC9};
+  Bytes f = {0x01, 0x03, 0x10};
+  static uint8_t regs[8] = {0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47};
+  if (rng() % 4 == 0)
+    regs[rng() % 8] ^= 1;
+  uint16_t crc = 0xFFFF; // stands in for the CRC-16/MODBUS trailer
+  for (int r = 0; r < 8; r++) {
+    f.push_back(0x00);
+    f.push_back(regs[r]);
+    crc = (uint16_t)(crc * 31 + regs[r]);
+  }
+  f.push_back((uint8_t)crc);
+  f.push_back((uint8_t)(crc >> 8));
+  return f;
+}
+
+static Bytes random_frame(std::mt19937 &rng, size_t) {
+  Bytes f(16 + rng() % 240);
+  for (auto &b : f)
+    b = (uint8_t)rng();
+  return f;
+}
+
+static void bench(const char *name,
+                  const std::function<Bytes(std::mt19937 &, size_t)> &gen,
+                  size_t records) {
+  std::mt19937 rng(1);
+  std::vector<Bytes> frames;
+  for (size_t i = 0; i < records; i++)
+    frames.push_back(gen(rng, i));
+
+  static record_compressor_t enc;
+  record_compressor_reset(&enc);
+  Bytes wire(RECORD_LZ_ENCODED_MAX);
+  Bytes plain_stream, lz_stream;
+  size_t raw_total = 0;
+  double compress_ns = 0;
+  uint64_t time = 0;
+  for (size_t i = 0; i < frames.size(); i++) {
+    const Bytes &f = frames[i];
+    time += 250 + rng() % 8;
+    raw_total += RECORD_DATA_OVERHEAD + f.size();
+    // Uncompressed baseline
+    size_t n = record_encode_data(wire.data(), wire.size(), (uint32_t)i, time,
+                                  0, f.data(), f.size());
+    plain_stream.insert(plain_stream.end(), wire.begin(), wire.begin() + n);
+    // Compressed, restarting the chain once per 1000 records (heartbeat)
+    if (i % 1000 == 0)
+      record_compressor_reset(&enc);
+    const auto t0 = Clock::now();
+    n = record_encode_compressed(&enc, wire.data(), wire.size(), (uint32_t)i,
+                                 time, 0, f.data(), f.size());
+    compress_ns +=
+        std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+    lz_stream.insert(lz_stream.end(), wire.begin(), wire.begin() + n);
+  }
+
+  auto decode = [](const Bytes &stream, size_t &decoded) {
+    Capture::Decoder dec;
+    decoded = 0;
+    const auto t0 = Clock::now();
+    dec.push(stream.data(), stream.size(),
+             [&](const Capture::Record &) { decoded++; });
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+  };
+  size_t plain_n, lz_n;
+  const double plain_s = decode(plain_stream, plain_n);
+  const double lz_s = decode(lz_stream, lz_n);
+  if (plain_n != records || lz_n != records) {
+    fprintf(stderr, "%s: decoded %zu / %zu of %zu records\n", name, plain_n,
+            lz_n, records);
+    exit(1);
+  }
+  printf("%-8s ratio %5.2fx (%6.1f -> %5.1f B/record on the wire)  "
+         "compress %6.0f ns/record %6.1f MB/s  decode %6.1f MB/s "
+         "(plain %6.1f MB/s)\n",
+         name, (double)plain_stream.size() / lz_stream.size(),
+         (double)plain_stream.size() / records,
+         (double)lz_stream.size() / records, compress_ns / records,
+         raw_total / compress_ns * 1e3, raw_total / lz_s / 1e6,
+         raw_total / plain_s / 1e6);
+}
+
+int main() {
+  bench("msp", msp_frame, 300000);
+  bench("modbus", modbus_frame, 300000);
+  bench("random", random_frame, 100000);
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "CaptureDecoder.h"
+#include "record.h"
+
+// Fuzz-style throughput of the capture decoder: a stream of records with
+// random sizes and contents is damaged (bit flips, dropped and duplicated
+// spans, as seen after USB packet loss or read hiccups) and decoded in
+// random-sized reads. Reports wire throughput and what the decoder
+// recovered.
+
+using Clock = std::chrono::steady_clock;
+
+struct Stream {
+  std::vector<uint8_t> wire;
+  size_t records = 0;
+};
+
+static Stream generate(std::mt19937 &rng, size_t records, size_t max_payload) {
+  Stream s;
+  std::vector<uint8_t> payload(max_payload);
+  std::vector<uint8_t> buf(
+      RECORD_ENCODED_MAX(RECORD_DATA_OVERHEAD + max_payload));
+  uint64_t time = 0;
+  for (uint32_t seq = 0; seq < records; seq++) {
+    const size_t len = rng() % (max_payload + 1);
+    for (size_t i = 0; i < len; i++)
+      payload[i] = (uint8_t)(rng() % 4 ? rng() : 0); // plenty of zeros
+    time += rng() % 1000;
+    const size_t n = record_encode_data(buf.data(), buf.size(), seq, time,
+                                        (uint8_t)(seq % 3), payload.data(),
+                                        len);
+    s.wire.insert(s.wire.end(), buf.begin(), buf.begin() + n);
+  }
+  s.records = records;
+  return s;
+}
+
+// Damage `rate` of the stream's bytes spread over random events
+static void damage(std::mt19937 &rng, std::vector<uint8_t> &wire,
+                   double rate) {
+  const size_t events = (size_t)(wire.size() * rate / 32);
+  for (size_t e = 0; e < events; e++) {
+    const size_t at = rng() % wire.size();
+    switch (rng() % 3) {
+    case 0: // bit flip
+      wire[at] ^= (uint8_t)(1u << (rng() % 8));
+      break;
+    case 1: { // lost span (one USB packet)
+      const size_t n = std::min<size_t>(64, wire.size() - at);
+      wire.erase(wire.begin() + at, wire.begin() + at + n);
+      break;
+    }
+    default: { // duplicated span (host re-read)
+      const size_t n = std::min<size_t>(rng() % 64, wire.size() - at);
+      std::vector<uint8_t> copy(wire.begin() + at, wire.begin() + at + n);
+      wire.insert(wire.begin() + at, copy.begin(), copy.end());
+      break;
+    }
+    }
+  }
+}
+
+static void bench(const char *label, const Stream &s,
+                  const std::vector<uint8_t> &wire, std::mt19937 &rng) {
+  Capture::Decoder dec;
+  uint64_t payload_bytes = 0;
+  const auto t0 = Clock::now();
+  for (size_t at = 0; at < wire.size();) {
+    const size_t n = std::min<size_t>(1 + rng() % 4096, wire.size() - at);
+    dec.push(wire.data() + at, n,
+             [&](const Capture::Record &r) { payload_bytes += r.len; });
+    at += n;
+  }
+  const double sec = std::chrono::duration<double>(Clock::now() - t0).count();
+  const auto &st = dec.statistics();
+  printf("%-12s %8.1f MB/s %8.2f Mrec/s  decoded %7llu/%zu  corrupt %6llu  "
+         "gaps %6llu  lost %7llu  resets %llu\n",
+         label, wire.size() / sec / 1e6, st.records / sec / 1e6,
+         (unsigned long long)st.records, s.records,
+         (unsigned long long)st.corrupt, (unsigned long long)st.gaps,
+         (unsigned long long)st.lost, (unsigned long long)st.resets);
+  (void)payload_bytes;
+}
+
+int main() {
+  std::mt19937 rng(42);
+  for (size_t max_payload : {16, 256, 1024}) {
+    const Stream s = generate(rng, 2000000 / (max_payload / 16 + 1),
+                              max_payload);
+    printf("payload <= %zu B, %zu records, %.1f MB on the wire\n",
+           max_payload, s.records, s.wire.size() / 1e6);
+    bench("clean", s, s.wire, rng);
+    for (double rate : {1e-4, 1e-2}) {
+      std::vector<uint8_t> wire = s.wire;
+      damage(rng, wire, rate);
+      char label[32];
+      snprintf(label, sizeof(label), "damage %g", rate);
+      bench(label, s, wire, rng);
+    }
+  }
+  return 0;
+}
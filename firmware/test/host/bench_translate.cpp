@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "translate.h"
+
+// Per-frame latency of the translation VM on a typical rewrite: remap one
+// MSP command id and recompute the checksum over the whole frame.
+
+using Clock = std::chrono::steady_clock;
+
+static const uint8_t k_program[] = {
+    XOP_LD8, 4,                  // acc = cmd
+    XOP_JNE, 101, 0, 7,          // skip the rewrite unless cmd == 101
+    XOP_SET8, 4, 150,            // cmd = 150
+    XOP_CSUM_XOR, 3, 0xFF, 0xFF, // frame[-1] = xor [3, len - 1)
+    XOP_PASS,                    //
+};
+
+static void bench(size_t payload, size_t iterations) {
+  uint8_t frame[512] = {'$', 'M', '<', (uint8_t)payload, 101};
+  const size_t len = 6 + payload;
+  std::vector<double> samples;
+  samples.reserve(iterations);
+  for (size_t i = 0; i < iterations; i++) {
+    size_t n = len;
+    frame[4] = 101;
+    const auto t0 = Clock::now();
+    xlate_run(k_program, sizeof(k_program), frame, &n, sizeof(frame), nullptr,
+              nullptr);
+    const auto t1 = Clock::now();
+    samples.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  double sum = 0;
+  for (double s : samples)
+    sum += s;
+  printf("payload %4zu B: avg %7.1f ns  p50 %7.1f ns  p99 %7.1f ns  "
+         "max %8.1f ns\n",
+         payload, sum / samples.size(), samples[samples.size() / 2],
+         samples[samples.size() * 99 / 100], samples.back());
+}
+
+int main() {
+  if (!xlate_verify(k_program, sizeof(k_program))) {
+    fprintf(stderr, "benchmark program failed verification\n");
+    return 1;
+  }
+  for (size_t payload : {0, 16, 64, 255})
+    bench(payload, 1000000);
+  return 0;
+}
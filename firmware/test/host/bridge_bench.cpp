@@ -0,0 +1,515 @@
+// Bridge benchmark harness.
+//
+// Measures what the host actually sees through the bridge: closed-loop
+// latency histograms (portA -> portB, or PING echo on one port) and
+// sustained duplex throughput, swept over chunk sizes. With --usb it also
+// drives the device SINK/SOURCE modes to isolate raw USB throughput.
+//
+// --loopback replaces the board with a pty-based software bridge that
+// speaks the same in-band benchmark commands (bench.h), so the harness
+// itself can be exercised without hardware.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
+// ---------- Serial port I/O ----------
+
+static void make_raw(int fd) {
+  struct termios tio;
+  if (tcgetattr(fd, &tio) != 0)
+    return; // not a tty, nothing to configure
+  cfmakeraw(&tio);
+  tio.c_cc[VMIN] = 1;
+  tio.c_cc[VTIME] = 0;
+  tcsetattr(fd, TCSANOW, &tio);
+}
+
+static int open_port(const std::string &path) {
+  int fd = open(path.c_str(), O_RDWR | O_NOCTTY);
+  if (fd < 0)
+    throw std::runtime_error("open " + path + ": " + strerror(errno));
+  make_raw(fd);
+  tcflush(fd, TCIOFLUSH);
+  return fd;
+}
+
+static bool wait_fd(int fd, short events, int timeout_ms) {
+  struct pollfd p = {fd, events, 0};
+  return poll(&p, 1, timeout_ms) > 0 && (p.revents & events);
+}
+
+static void write_all(int fd, const uint8_t *data, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, data, len);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+      wait_fd(fd, POLLOUT, 100);
+      continue;
+    }
+    if (n <= 0)
+      throw std::runtime_error(std::string("write: ") + strerror(errno));
+    data += n;
+    len -= (size_t)n;
+  }
+}
+
+// Read exactly `len` bytes, false on timeout
+static bool read_exact(int fd, uint8_t *data, size_t len, int timeout_ms) {
+  while (len > 0) {
+    if (!wait_fd(fd, POLLIN, timeout_ms))
+      return false;
+    ssize_t n = read(fd, data, len);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+static void drain(int fd) {
+  uint8_t buf[4096];
+  while (wait_fd(fd, POLLIN, 50))
+    if (read(fd, buf, sizeof(buf)) <= 0)
+      break;
+}
+
+static bench_status_t bench_command(int fd, bench_mode_t mode,
+                                    uint16_t chunk = 0) {
+  uint8_t cmd[BENCH_CMD_LEN] = {};
+  memcpy(cmd, BENCH_MAGIC, 4);
+  cmd[4] = mode;
+  cmd[6] = (uint8_t)(chunk & 0xFF);
+  cmd[7] = (uint8_t)(chunk >> 8);
+  write_all(fd, cmd, sizeof(cmd));
+  bench_status_t status;
+  if (!read_exact(fd, reinterpret_cast<uint8_t *>(&status), sizeof(status),
+                  1000) ||
+      memcmp(status.magic, BENCH_MAGIC, 4) != 0)
+    throw std::runtime_error("no benchmark reply; is this a BRIDGE_BENCH "
+                             "build?");
+  return status;
+}
+
+// ---------- Software loopback ----------
+
+class Loopback {
+  struct Side {
+    int master = -1;
+    int slave = -1;
+    std::string path;
+    uint8_t mode = BENCH_BRIDGE;
+    uint16_t chunk = 64;
+    uint64_t rx = 0, tx = 0;
+  };
+  Side side[2];
+  std::atomic<bool> stopping{false};
+  std::thread thread;
+
+  static void open_pty(Side &s) {
+    s.master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (s.master < 0 || grantpt(s.master) || unlockpt(s.master))
+      throw std::runtime_error("cannot allocate pty");
+    s.path = ptsname(s.master);
+    // Keep the slave open so the master never sees a hangup
+    s.slave = open(s.path.c_str(), O_RDWR | O_NOCTTY);
+    make_raw(s.slave);
+    fcntl(s.master, F_SETFL, fcntl(s.master, F_GETFL) | O_NONBLOCK);
+  }
+
+  void send(Side &s, const uint8_t *data, size_t len) {
+    write_all(s.master, data, len);
+    s.tx += len;
+  }
+
+  void handle(int i, uint8_t *data, size_t len) {
+    Side &s = side[i];
+    if (len == BENCH_CMD_LEN && memcmp(data, BENCH_MAGIC, 4) == 0) {
+      bench_status_t status = {};
+      memcpy(status.magic, BENCH_MAGIC, 4);
+      status.mode = s.mode;
+      status.rx_bytes = s.rx;
+      status.tx_bytes = s.tx;
+      s.rx = s.tx = 0;
+      s.mode = data[4] <= BENCH_PING ? data[4] : (uint8_t)BENCH_BRIDGE;
+      s.chunk = (uint16_t)(data[6] | (data[7] << 8));
+      if (s.chunk == 0 || s.chunk > 4096)
+        s.chunk = 4096;
+      write_all(s.master, reinterpret_cast<uint8_t *>(&status),
+                sizeof(status));
+      return;
+    }
+    switch (s.mode) {
+    case BENCH_BRIDGE:
+      write_all(side[1 - i].master, data, len);
+      return;
+    case BENCH_PING:
+      s.rx += len;
+      if (len >= BENCH_PING_TS_OFFSET + sizeof(int64_t)) {
+        int64_t us = (int64_t)(now_ns() / 1000);
+        memcpy(data + BENCH_PING_TS_OFFSET, &us, sizeof(us));
+      }
+      send(s, data, len);
+      return;
+    default:
+      s.rx += len;
+      return;
+    }
+  }
+
+  void run() {
+    // Full-speed USB bulk transfers top out at 64-byte packets; reading in
+    // larger blocks mimics what the CDC driver hands the firmware
+    uint8_t buf[512];
+    std::vector<uint8_t> pattern(4096);
+    for (size_t i = 0; i < pattern.size(); i++)
+      pattern[i] = (uint8_t)i;
+    while (!stopping) {
+      struct pollfd p[2] = {{side[0].master, POLLIN, 0},
+                            {side[1].master, POLLIN, 0}};
+      bool sourcing =
+          side[0].mode == BENCH_SOURCE || side[1].mode == BENCH_SOURCE;
+      poll(p, 2, sourcing ? 0 : 10);
+      for (int i = 0; i < 2; i++) {
+        if (p[i].revents & POLLIN) {
+          ssize_t n = read(side[i].master, buf, sizeof(buf));
+          if (n > 0)
+            handle(i, buf, (size_t)n);
+        }
+        if (side[i].mode == BENCH_SOURCE &&
+            wait_fd(side[i].master, POLLOUT, 0)) {
+          ssize_t n = write(side[i].master, pattern.data(), side[i].chunk);
+          if (n > 0)
+            side[i].tx += (size_t)n;
+        }
+      }
+    }
+  }
+
+public:
+  Loopback() {
+    open_pty(side[0]);
+    open_pty(side[1]);
+    thread = std::thread([this] { run(); });
+  }
+  ~Loopback() {
+    stopping = true;
+    thread.join();
+    for (auto &s : side) {
+      close(s.slave);
+      close(s.master);
+    }
+  }
+  const std::string &path(int i) const { return side[i].path; }
+};
+
+// ---------- Latency ----------
+
+struct Latency {
+  std::vector<double> us;
+
+  double pct(double p) const { return us[(size_t)(p * (us.size() - 1))]; }
+
+  // log2 buckets: [0,1) [1,2) [2,4) ... us
+  std::vector<size_t> histogram() const {
+    std::vector<size_t> h(32, 0);
+    for (double v : us) {
+      size_t b = 0;
+      while (b + 1 < h.size() && v >= (double)(1ull << b))
+        b++;
+      h[b]++;
+    }
+    while (!h.empty() && h.back() == 0)
+      h.pop_back();
+    return h;
+  }
+};
+
+// Closed-loop: one chunk in flight, timestamp travels inside the payload
+static Latency measure_latency(int tx, int rx, size_t chunk, size_t count) {
+  std::vector<uint8_t> out(chunk), in(chunk);
+  for (size_t i = 16; i < chunk; i++)
+    out[i] = (uint8_t)i;
+  Latency result;
+  result.us.reserve(count);
+  for (uint64_t seq = 0; seq < count; seq++) {
+    const uint64_t t0 = now_ns();
+    memcpy(out.data(), &seq, sizeof(seq));
+    memcpy(out.data() + 8, &t0, sizeof(t0));
+    write_all(tx, out.data(), chunk);
+    if (!read_exact(rx, in.data(), chunk, 1000))
+      throw std::runtime_error("timeout waiting for chunk " +
+                               std::to_string(seq));
+    const uint64_t t1 = now_ns();
+    uint64_t echoed;
+    memcpy(&echoed, in.data(), sizeof(echoed));
+    if (echoed != seq)
+      throw std::runtime_error("chunk out of order at " + std::to_string(seq));
+    result.us.push_back((double)(t1 - t0) / 1e3);
+  }
+  std::sort(result.us.begin(), result.us.end());
+  return result;
+}
+
+// ---------- Throughput ----------
+
+// Stream chunks tx -> rx for `seconds`, returns bytes/s seen by the reader
+static double stream(int tx, int rx, size_t chunk, double seconds,
+                     std::atomic<bool> &go) {
+  std::atomic<bool> writing{true};
+  std::thread writer([&] {
+    std::vector<uint8_t> out(chunk, 0x5A);
+    while (!go)
+      std::this_thread::yield();
+    const uint64_t end = now_ns() + (uint64_t)(seconds * 1e9);
+    while (now_ns() < end)
+      write_all(tx, out.data(), chunk);
+    writing = false;
+  });
+  while (!go)
+    std::this_thread::yield();
+  uint8_t buf[4096];
+  uint64_t bytes = 0;
+  const uint64_t t0 = now_ns();
+  uint64_t last = t0;
+  while (writing || wait_fd(rx, POLLIN, 200)) {
+    if (!wait_fd(rx, POLLIN, 10))
+      continue;
+    ssize_t n = read(rx, buf, sizeof(buf));
+    if (n > 0) {
+      bytes += (size_t)n;
+      last = now_ns();
+    }
+  }
+  writer.join();
+  return last > t0 ? (double)bytes * 1e9 / (double)(last - t0) : 0;
+}
+
+static void duplex(int a, int b, size_t chunk, double seconds, double &ab,
+                   double &ba) {
+  std::atomic<bool> go{false};
+  std::thread t([&] { ba = stream(b, a, chunk, seconds, go); });
+  go = true;
+  ab = stream(a, b, chunk, seconds, go);
+  t.join();
+}
+
+// Device SOURCE mode: bytes/s read from the port
+static double usb_source(int fd, size_t chunk, double seconds) {
+  drain(fd);
+  bench_command(fd, BENCH_SOURCE, (uint16_t)chunk);
+  uint8_t buf[4096];
+  uint64_t bytes = 0;
+  const uint64_t t0 = now_ns(), end = t0 + (uint64_t)(seconds * 1e9);
+  while (now_ns() < end)
+    if (wait_fd(fd, POLLIN, 10)) {
+      ssize_t n = read(fd, buf, sizeof(buf));
+      if (n > 0)
+        bytes += (size_t)n;
+    }
+  const double rate = (double)bytes * 1e9 / (double)(now_ns() - t0);
+  // Stop streaming; the status reply is buried in the stream, so resync
+  uint8_t cmd[BENCH_CMD_LEN] = {};
+  memcpy(cmd, BENCH_MAGIC, 4);
+  write_all(fd, cmd, sizeof(cmd));
+  drain(fd);
+  return rate;
+}
+
+// Device SINK mode: bytes/s as counted by the device
+static double usb_sink(int fd, size_t chunk, double seconds) {
+  bench_command(fd, BENCH_SINK);
+  std::vector<uint8_t> out(chunk, 0xA5);
+  const uint64_t t0 = now_ns(), end = t0 + (uint64_t)(seconds * 1e9);
+  while (now_ns() < end)
+    write_all(fd, out.data(), chunk);
+  tcdrain(fd);
+  const uint64_t t1 = now_ns();
+  // Let the device count what is still in flight before reading its counter
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  bench_status_t status = bench_command(fd, BENCH_BRIDGE);
+  return (double)status.rx_bytes * 1e9 / (double)(t1 - t0);
+}
+
+// ---------- Reporting ----------
+
+struct Options {
+  std::vector<size_t> chunks = {16, 64, 256, 1024, 4096};
+  size_t count = 2000;
+  double seconds = 3;
+  bool loopback = false;
+  bool ping = false;
+  bool usb = false;
+  bool json = false;
+  std::vector<std::string> ports;
+};
+
+static void report_latency(const Options &opt, const char *test, size_t chunk,
+                           const Latency &l) {
+  auto h = l.histogram();
+  if (opt.json) {
+    printf("{\"test\":\"%s\",\"chunk\":%zu,\"count\":%zu,\"min_us\":%.1f,"
+           "\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f,"
+           "\"histogram_log2_us\":[",
+           test, chunk, l.us.size(), l.us.front(), l.pct(0.5), l.pct(0.9),
+           l.pct(0.99), l.us.back());
+    for (size_t i = 0; i < h.size(); i++)
+      printf(i ? ",%zu" : "%zu", h[i]);
+    printf("]}\n");
+    return;
+  }
+  printf("%s latency, chunk %zu B (%zu samples)\n", test, chunk, l.us.size());
+  printf("  min %.1f  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f us\n",
+         l.us.front(), l.pct(0.5), l.pct(0.9), l.pct(0.99), l.us.back());
+  const size_t peak = *std::max_element(h.begin(), h.end());
+  for (size_t b = 0; b < h.size(); b++) {
+    if (h[b] == 0)
+      continue;
+    const unsigned lo = b ? 1u << (b - 1) : 0, hi = 1u << b;
+    printf("  [%7u, %7u) us %8zu %s\n", lo, hi, h[b],
+           std::string(h[b] * 40 / peak, '#').c_str());
+  }
+}
+
+static void report_rate(const Options &opt, const char *test, size_t chunk,
+                        const char *a, double ra, const char *b = nullptr,
+                        double rb = 0) {
+  if (opt.json) {
+    printf("{\"test\":\"%s\",\"chunk\":%zu,\"%s_Bps\":%.0f", test, chunk, a,
+           ra);
+    if (b)
+      printf(",\"%s_Bps\":%.0f", b, rb);
+    printf("}\n");
+    return;
+  }
+  printf("%s, chunk %zu B: %s %.3f MB/s", test, chunk, a, ra / 1e6);
+  if (b)
+    printf(", %s %.3f MB/s", b, rb / 1e6);
+  printf("\n");
+}
+
+static std::vector<size_t> parse_list(const char *s) {
+  std::vector<size_t> out;
+  while (*s) {
+    char *end;
+    out.push_back(strtoul(s, &end, 10));
+    s = *end ? end + 1 : end;
+  }
+  return out;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: bridge_bench [options] <portA> <portB>\n"
+          "       bridge_bench [options] --ping <port>\n"
+          "       bridge_bench [options] --usb <port>\n"
+          "       bridge_bench [options] --loopback\n"
+          "options:\n"
+          "  --chunks 16,64,...  chunk sizes to sweep\n"
+          "  --count N           latency samples per chunk size\n"
+          "  --seconds S         throughput duration per chunk size\n"
+          "  --json              one JSON object per result line\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = [&] {
+      if (++i >= argc)
+        usage();
+      return argv[i];
+    };
+    if (arg == "--chunks")
+      opt.chunks = parse_list(value());
+    else if (arg == "--count")
+      opt.count = strtoul(value(), nullptr, 10);
+    else if (arg == "--seconds")
+      opt.seconds = atof(value());
+    else if (arg == "--loopback")
+      opt.loopback = true;
+    else if (arg == "--ping")
+      opt.ping = true;
+    else if (arg == "--usb")
+      opt.usb = true;
+    else if (arg == "--json")
+      opt.json = true;
+    else if (arg[0] == '-')
+      usage();
+    else
+      opt.ports.push_back(arg);
+  }
+
+  try {
+    std::unique_ptr<Loopback> loop;
+    if (opt.loopback) {
+      loop = std::make_unique<Loopback>();
+      opt.ports = {loop->path(0), loop->path(1)};
+    }
+    if (opt.ports.empty() || (!opt.ping && !opt.usb && opt.ports.size() < 2))
+      usage();
+
+    const int a = open_port(opt.ports[0]);
+    const int b = opt.ports.size() > 1 ? open_port(opt.ports[1]) : -1;
+    // The loopback always has both ends, so it runs every test
+    const bool bridge = b >= 0 && (opt.loopback || !(opt.ping || opt.usb));
+
+    for (size_t chunk : opt.chunks) {
+      chunk = std::max<size_t>(chunk, 16); // room for seq + timestamp
+      if (bridge) {
+        report_latency(opt, "bridge", chunk,
+                       measure_latency(a, b, chunk, opt.count));
+        double ab = 0, ba = 0;
+        duplex(a, b, chunk, opt.seconds, ab, ba);
+        report_rate(opt, "duplex", chunk, "a_to_b", ab, "b_to_a", ba);
+        drain(a);
+        drain(b);
+      }
+      if (opt.ping) {
+        bench_command(a, BENCH_PING);
+        report_latency(opt, "ping", chunk,
+                       measure_latency(a, a, chunk, opt.count));
+        bench_command(a, BENCH_BRIDGE);
+      }
+      if (opt.usb) {
+        report_rate(opt, "usb", chunk, "sink",
+                    usb_sink(a, chunk, opt.seconds), "source",
+                    usb_source(a, chunk, opt.seconds));
+      }
+    }
+    close(a);
+    if (b >= 0)
+      close(b);
+  } catch (const std::exception &e) {
+    fprintf(stderr, "bridge_bench: %s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
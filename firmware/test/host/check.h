@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Minimal assertion helpers for host-side firmware tests (unlike assert(),
+// these stay active in release builds)
+#define CHECK(COND)                                                            \
+  do {                                                                         \
+    if (!(COND)) {                                                             \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #COND); \
+      exit(1);                                                                 \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_EQ(A, B) CHECK((A) == (B))
+
+#define RUN(TEST)                                                              \
+  do {                                                                         \
+    TEST();                                                                    \
+    printf("[PASS] %s\n", #TEST);                                              \
+  } while (0)
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// MSC host test: the sense codes tinyusb_msc.c reports
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+  SCSI_SENSE_NONE = 0x00,
+  SCSI_SENSE_NOT_READY = 0x02,
+  SCSI_SENSE_MEDIUM_ERROR = 0x03,
+  SCSI_SENSE_ILLEGAL_REQUEST = 0x05,
+};
+
+enum {
+  SCSI_CMD_TEST_UNIT_READY = 0x00,
+  SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL = 0x1E,
+};
+
+bool tud_msc_set_sense(uint8_t lun, uint8_t sense_key, uint8_t add_sense_code,
+                       uint8_t add_sense_qualifier);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdbool.h>
+
+// MSC host test: deferred calls are queued until the test runs them, as
+// the TinyUSB task would
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*osal_task_func_t)(void *param);
+
+void usbd_defer_func(osal_task_func_t func, void *param, bool in_isr);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "esp_vfs_fat.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t ff_diskio_get_drive(BYTE *out_pdrv);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdio.h>
+
+// MSC host test: errors and warnings go to stderr, the rest is compiled out
+
+#define ESP_LOGE(tag, format, ...)                                             \
+  fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)                                             \
+  fprintf(stderr, "W %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ((void)(tag))
+#define ESP_LOGD(tag, format, ...) ((void)(tag))
+#define ESP_LOGV(tag, format, ...) ((void)(tag))
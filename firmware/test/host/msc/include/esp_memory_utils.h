@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// MSC host test: heap_caps allocations come from the C heap
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MALLOC_CAP_DMA (1 << 3)
+
+void *heap_caps_aligned_calloc(size_t alignment, size_t n, size_t size,
+                               uint32_t caps);
+void heap_caps_free(void *ptr);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,3 @@
+#pragma once
+
+// MSC host test: nothing of it is used
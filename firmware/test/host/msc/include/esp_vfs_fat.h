@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "wear_levelling.h"
+
+// MSC host test: the FatFs and VFS surface tinyusb_msc.c mounts through;
+// every call succeeds without touching the medium
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint8_t BYTE;
+typedef unsigned int UINT;
+typedef uint32_t DWORD;
+
+typedef struct {
+  int mounted;
+} FATFS;
+
+typedef enum {
+  FR_OK = 0,
+  FR_INT_ERR = 2,
+  FR_NO_FILESYSTEM = 13,
+} FRESULT;
+
+typedef struct {
+  BYTE fmt;
+  BYTE n_fat;
+  UINT align;
+  UINT n_root;
+  DWORD au_size;
+} MKFS_PARM;
+
+#define FM_ANY 0x07
+
+typedef struct {
+  bool format_if_mount_failed;
+  int max_files;
+  size_t allocation_unit_size;
+} esp_vfs_fat_mount_config_t;
+
+FRESULT f_mount(FATFS *fs, const char *path, BYTE opt);
+FRESULT f_mkfs(const char *path, const MKFS_PARM *opt, void *work, UINT len);
+void *ff_memalloc(UINT size);
+void ff_memfree(void *ptr);
+esp_err_t esp_vfs_fat_register(const char *base_path, const char *fat_drive,
+                               size_t max_files, FATFS **out_fs);
+esp_err_t esp_vfs_fat_unregister_path(const char *base_path);
+size_t esp_vfs_fat_get_allocation_unit_size(size_t sector_size,
+                                            size_t requested_size);
+
+#ifdef __cplusplus
+}
+#endif
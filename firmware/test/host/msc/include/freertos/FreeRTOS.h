@@ -0,0 +1,14 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+
+// MSC host test: FreeRTOS types
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "FreeRTOS.h"
+
+// MSC host test: single-threaded mutexes that know whether they are held,
+// so that a test catches a lock taken twice or never given back
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct msc_test_mutex {
+  bool held;
+} *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+
+#ifdef __cplusplus
+}
+#endif
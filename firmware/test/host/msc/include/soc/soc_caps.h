@@ -0,0 +1,5 @@
+#pragma once
+
+// MSC host test: SPI flash storage only
+
+#define SOC_SDMMC_HOST_SUPPORTED 0
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+// MSC host test: tinyusb_msc.c needs nothing of the driver itself
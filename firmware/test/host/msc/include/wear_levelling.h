@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdint.h>
+
+// MSC host test: the handle only has to be valid
+
+typedef int32_t wl_handle_t;
+
+#define WL_INVALID_HANDLE -1
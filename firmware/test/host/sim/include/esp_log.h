@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Simulated device build: log lines go to stderr in the ESP-IDF format,
+// debug and verbose levels are compiled out
+
+typedef enum {
+  ESP_LOG_NONE,
+  ESP_LOG_ERROR,
+  ESP_LOG_WARN,
+  ESP_LOG_INFO,
+  ESP_LOG_DEBUG,
+  ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+uint32_t esp_log_timestamp(void);
+
+#define SIM_LOG(letter, tag, format, ...)                                      \
+  fprintf(stderr, letter " (%u) %s: " format "\n",                             \
+          (unsigned)esp_log_timestamp(), tag, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, format, ...) SIM_LOG("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) SIM_LOG("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) SIM_LOG("I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ((void)(tag))
+#define ESP_LOGV(tag, format, ...) ((void)(tag))
+
+#define ESP_LOG_BUFFER_HEXDUMP(tag, buffer, len, level)                        \
+  ((void)(tag), (void)(buffer), (void)(len), (void)(level))
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <mutex>
+
+#include "FreeRTOS.h"
+
+// Simulated device build: mutexes only, which is all the firmware takes
+
+typedef struct {
+  std::timed_mutex mutex;
+} StaticSemaphore_t;
+
+typedef StaticSemaphore_t *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
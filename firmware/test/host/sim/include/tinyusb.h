@@ -0,0 +1,7 @@
+#pragma once
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+// Simulated device build: the driver is installed by sim_usb_init()
+// (sim.h) instead of tinyusb_driver_install()
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+// Simulated device build: the TinyUSB device API the firmware calls, served
+// by the pty-backed interfaces of sim_usb.cpp. FIFO sizes follow the
+// esp_tinyusb tusb_config.h of a full-speed device.
+
+#define CFG_TUD_CDC CONFIG_TINYUSB_CDC_COUNT
+#define CFG_TUD_CDC_RX_BUFSIZE CONFIG_TINYUSB_CDC_RX_BUFSIZE
+#define CFG_TUD_CDC_TX_BUFSIZE CONFIG_TINYUSB_CDC_TX_BUFSIZE
+#define CFG_TUD_VENDOR CONFIG_TINYUSB_VENDOR_COUNT
+#define CFG_TUD_MSC 0
+#define CFG_TUD_NCM 0
+
+#ifndef CFG_TUD_VENDOR_TX_BUFSIZE
+#define CFG_TUD_VENDOR_TX_BUFSIZE 64
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t tud_cdc_n_available(uint8_t itf);
+uint32_t tud_cdc_n_write_available(uint8_t itf);
+
+bool tud_vendor_n_mounted(uint8_t itf);
+uint32_t tud_vendor_n_write_available(uint8_t itf);
+uint32_t tud_vendor_n_write(uint8_t itf, const void *buffer, uint32_t len);
+uint32_t tud_vendor_n_write_flush(uint8_t itf);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+#include "esp_err.h"
+
+// ---------- Virtual ProtoAI device ----------
+// The bridge, routing, translation, capture filter, record framing and
+// performance counters of firmware/src built as a Linux program. ESP-IDF,
+// FreeRTOS and TinyUSB are replaced by the shims in sim/include: tasks and
+// esp_timer callbacks run on threads, and every USB interface is a pty
+// with the FIFO sizes of the real one, so the device pushes back on a slow
+// host the same way.
+//
+// The ptys are published as symlinks named like the udev by-id links of
+// the real device, with the USB identity spelled out:
+//
+//   usb-<vid>_<pid>_<manufacturer>_<product>_<serial>-if<nn>
+//
+// where <nn> is the interface number of the CDC port on the device
+// (2 * port). The capture interface gets the same name with a "-capture"
+// suffix and carries the raw capture stream (record.h). The host discovery
+// code (app/lib/serial.ts) lists these next to real serial ports.
+
+// Identity of the device descriptor in src/main.cpp
+#define SIM_USB_VID 0x0483
+#define SIM_USB_PID 0x5740
+#define SIM_USB_MANUFACTURER "ProtoAI"
+#define SIM_USB_PRODUCT "Dual_LoopBack"
+#define SIM_USB_SERIAL "ProtocolTranslator"
+
+// Directory of the links unless PROTOAI_SIM_DIR or --dir says otherwise
+#define SIM_DEFAULT_DIR "/tmp/protoai-sim"
+
+// Interface number of the capture pty in sim_usb_path()
+#define SIM_CAPTURE_ITF 0xFF
+
+// Allocate the ptys and start the simulated TinyUSB task; stands in for
+// tinyusb_driver_install()
+esp_err_t sim_usb_init(void);
+// pty of CDC port `itf`, or of the capture interface for SIM_CAPTURE_ITF
+std::string sim_usb_path(uint8_t itf);
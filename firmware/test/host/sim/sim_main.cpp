@@ -0,0 +1,146 @@
+// Virtual ProtoAI device (sim.h).
+//
+//   protoai_sim [--dir DIR] [--serial S]
+//       run until SIGINT / SIGTERM
+//   protoai_sim [--dir DIR] [--serial S] -- command [args...]
+//       run `command` against the device, exit with its status
+//
+// The port links are printed on stdout, one "<interface> <path>" line
+// each, once the device is up. The command and its children find the
+// directory in PROTOAI_SIM_DIR.
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "bridge.h"
+#include "capture.h"
+#include "sim.h"
+#include "status.h"
+
+// No LEDs: flags are raised and never rendered
+std::atomic<bool> g_status_flags[STATUS_EVENTS];
+
+static std::vector<std::string> s_links;
+
+static std::string link_name(const std::string &serial, unsigned itf) {
+  char name[128];
+  snprintf(name, sizeof(name), "usb-%04x_%04x_%s_%s_%s-if%02u", SIM_USB_VID,
+           SIM_USB_PID, SIM_USB_MANUFACTURER, SIM_USB_PRODUCT, serial.c_str(),
+           itf);
+  return name;
+}
+
+static bool publish(const std::string &dir, const std::string &name,
+                    const std::string &target) {
+  const std::string path = dir + "/" + name;
+  unlink(path.c_str()); // left behind by a simulation that was killed
+  if (symlink(target.c_str(), path.c_str()) != 0) {
+    fprintf(stderr, "protoai_sim: %s: %s\n", path.c_str(), strerror(errno));
+    return false;
+  }
+  s_links.push_back(path);
+  printf("%s %s\n", name.c_str(), path.c_str());
+  return true;
+}
+
+static void unpublish(void) {
+  for (const auto &path : s_links)
+    unlink(path.c_str());
+}
+
+static int run(char **argv, const sigset_t *signals) {
+  const pid_t pid = fork();
+  if (pid == 0) {
+    pthread_sigmask(SIG_UNBLOCK, signals, nullptr);
+    execvp(argv[0], argv);
+    fprintf(stderr, "protoai_sim: %s: %s\n", argv[0], strerror(errno));
+    _exit(127);
+  }
+  int status = 0;
+  if (pid < 0 || waitpid(pid, &status, 0) < 0)
+    return 1;
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: protoai_sim [--dir DIR] [--serial S] [-- command...]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  const char *env_dir = getenv("PROTOAI_SIM_DIR");
+  std::string dir = env_dir ? env_dir : SIM_DEFAULT_DIR;
+  std::string serial = SIM_USB_SERIAL;
+  char **command = nullptr;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--") {
+      command = i + 1 < argc ? &argv[i + 1] : nullptr;
+      break;
+    }
+    if (i + 1 >= argc)
+      usage();
+    if (arg == "--dir")
+      dir = argv[++i];
+    else if (arg == "--serial")
+      serial = argv[++i];
+    else
+      usage();
+  }
+  // The serial number is the one field of the link name that may vary
+  if (serial.empty() || serial.find_first_of("_-/") != std::string::npos) {
+    fprintf(stderr, "protoai_sim: serial must not contain '_', '-' or '/'\n");
+    return 2;
+  }
+
+  // Signals are taken with sigwait() on the main thread only
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  // The order of app_main (src/main.cpp)
+  capture_init();
+  ESP_ERROR_CHECK(sim_usb_init());
+#if BRIDGE_BENCH
+  bench_init();
+#endif
+  ESP_ERROR_CHECK(bridge_init());
+
+  bool ok = mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST;
+  if (!ok)
+    fprintf(stderr, "protoai_sim: %s: %s\n", dir.c_str(), strerror(errno));
+  for (uint8_t port = 0; ok && port < BRIDGE_CDC_PORTS; port++)
+    ok = publish(dir, link_name(serial, 2 * port), sim_usb_path(port));
+  ok = ok && publish(dir,
+                     link_name(serial, 2 * BRIDGE_CDC_PORTS) + "-capture",
+                     sim_usb_path(SIM_CAPTURE_ITF));
+  fflush(stdout);
+
+  int status = ok ? 0 : 1;
+  if (ok && command) {
+    setenv("PROTOAI_SIM_DIR", dir.c_str(), 1);
+    status = run(command, &signals);
+  } else if (ok) {
+    int sig;
+    sigwait(&signals, &sig);
+  }
+  unpublish();
+  // Device tasks never return; leave without running static destructors
+  // under their feet
+  fflush(stdout);
+  _exit(status);
+}
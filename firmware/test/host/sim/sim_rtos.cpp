@@ -0,0 +1,252 @@
+// FreeRTOS, esp_timer and logging shims of the simulated device (sim.h)
+
+#include <pthread.h>
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+using Clock = std::chrono::steady_clock;
+
+static const Clock::time_point s_boot = Clock::now();
+
+int64_t esp_timer_get_time(void) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                               s_boot)
+      .count();
+}
+
+uint32_t esp_log_timestamp(void) {
+  return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+  switch (code) {
+  case ESP_OK:
+    return "ESP_OK";
+  case ESP_FAIL:
+    return "ESP_FAIL";
+  case ESP_ERR_NO_MEM:
+    return "ESP_ERR_NO_MEM";
+  case ESP_ERR_INVALID_ARG:
+    return "ESP_ERR_INVALID_ARG";
+  case ESP_ERR_INVALID_STATE:
+    return "ESP_ERR_INVALID_STATE";
+  case ESP_ERR_INVALID_SIZE:
+    return "ESP_ERR_INVALID_SIZE";
+  case ESP_ERR_NOT_FOUND:
+    return "ESP_ERR_NOT_FOUND";
+  case ESP_ERR_TIMEOUT:
+    return "ESP_ERR_TIMEOUT";
+  default:
+    return "UNKNOWN ERROR";
+  }
+}
+
+static void set_thread_name(const char *name) {
+  char short_name[16]; // Linux limit, terminator included
+  strncpy(short_name, name ? name : "task", sizeof(short_name) - 1);
+  short_name[sizeof(short_name) - 1] = '\0';
+  pthread_setname_np(pthread_self(), short_name);
+}
+
+// Wait on `cv` until `ready` holds or `ticks` (ms) pass
+template <typename Ready>
+static bool wait_ticks(std::condition_variable &cv,
+                       std::unique_lock<std::mutex> &lock, TickType_t ticks,
+                       Ready ready) {
+  if (ticks == portMAX_DELAY) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  return cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+}
+
+// ---------- Tasks ----------
+
+struct sim_task {
+  std::mutex mutex;
+  std::condition_variable cv;
+  uint32_t value = 0;
+  bool pending = false;
+};
+
+// Threads that were not created by xTaskCreate() (main) get a task on
+// first use, so they can wait for notifications too
+static thread_local sim_task *t_current = nullptr;
+
+static sim_task *current(void) {
+  if (!t_current)
+    t_current = new sim_task();
+  return t_current;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+                       void *arg, UBaseType_t prio, TaskHandle_t *out) {
+  (void)stack;
+  (void)prio;
+  // Tasks live as long as the process, like on the device
+  sim_task *task = new sim_task();
+  if (out)
+    *out = task;
+  std::thread([=] {
+    set_thread_name(name);
+    t_current = task;
+    fn(arg);
+  }).detach();
+  return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) {
+  if (ticks)
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+  else
+    std::this_thread::yield();
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value,
+                       eNotifyAction action) {
+  {
+    std::scoped_lock lock(task->mutex);
+    switch (action) {
+    case eSetBits:
+      task->value |= value;
+      break;
+    case eIncrement:
+      task->value++;
+      break;
+    case eSetValueWithOverwrite:
+      task->value = value;
+      break;
+    case eNoAction:
+      break;
+    }
+    task->pending = true;
+  }
+  task->cv.notify_one();
+  return pdPASS;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit,
+                           uint32_t *value, TickType_t ticks) {
+  sim_task *task = current();
+  std::unique_lock lock(task->mutex);
+  if (!task->pending)
+    task->value &= ~clear_on_entry;
+  const bool got = wait_ticks(task->cv, lock, ticks, [&] {
+    return task->pending;
+  });
+  if (value)
+    *value = task->value;
+  if (!got)
+    return pdFALSE;
+  task->value &= ~clear_on_exit;
+  task->pending = false;
+  return pdTRUE;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  return xTaskNotify(task, 0, eIncrement);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  sim_task *task = current();
+  std::unique_lock lock(task->mutex);
+  wait_ticks(task->cv, lock, ticks, [&] { return task->value != 0; });
+  const uint32_t value = task->value;
+  if (value)
+    task->value = clear ? 0 : value - 1;
+  task->pending = false;
+  return value;
+}
+
+// ---------- Mutexes ----------
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer) {
+  return buffer;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+  if (ticks == portMAX_DELAY) {
+    sem->mutex.lock();
+    return pdTRUE;
+  }
+  return sem->mutex.try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE
+                                                                   : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  sem->mutex.unlock();
+  return pdTRUE;
+}
+
+// ---------- esp_timer ----------
+
+struct esp_timer {
+  esp_timer_create_args_t args;
+  std::mutex mutex;
+  std::condition_variable cv;
+  // Bumped by every start and stop; a thread serves one generation
+  uint64_t generation = 0;
+};
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args,
+                           esp_timer_handle_t *out) {
+  if (!args || !args->callback || !out)
+    return ESP_ERR_INVALID_ARG;
+  esp_timer *timer = new esp_timer();
+  timer->args = *args;
+  *out = timer;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+  if (!timer || period == 0)
+    return ESP_ERR_INVALID_ARG;
+  uint64_t generation;
+  {
+    std::scoped_lock lock(timer->mutex);
+    generation = ++timer->generation;
+  }
+  timer->cv.notify_all();
+  std::thread([timer, generation, period] {
+    set_thread_name(timer->args.name);
+    const auto interval = std::chrono::microseconds(period);
+    auto next = Clock::now() + interval;
+    std::unique_lock lock(timer->mutex);
+    for (;;) {
+      if (timer->cv.wait_until(lock, next, [&] {
+            return timer->generation != generation;
+          }))
+        return;
+      lock.unlock();
+      timer->args.callback(timer->args.arg);
+      lock.lock();
+      next += interval;
+      const auto now = Clock::now();
+      if (next < now && timer->args.skip_unhandled_events)
+        next = now + interval;
+    }
+  }).detach();
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (!timer)
+    return ESP_ERR_INVALID_ARG;
+  {
+    std::scoped_lock lock(timer->mutex);
+    timer->generation++;
+  }
+  timer->cv.notify_all();
+  return ESP_OK;
+}
@@ -0,0 +1,346 @@
+// TinyUSB shims of the simulated device (sim.h): CDC ports and the capture
+// interface as ptys, served by one thread that plays the TinyUSB task
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "esp_log.h"
+#include "sim.h"
+#include "tinyusb_cdc_acm.h"
+#include "tusb.h"
+
+static const char *TAG = "sim_usb";
+
+// Full-speed bulk packet: each pass of the TinyUSB task moves at most one
+// per endpoint, which keeps both directions of a port at the same pace
+#define SIM_PACKET 64
+
+// Bus bandwidth shared by all endpoints: 19 bulk packets per 1 ms frame,
+// the most a full-speed host schedules. Passes that moved data wait for
+// the bus, which also gives the bridge task time to run, as its higher
+// priority does on the device.
+#ifndef SIM_BUS_BYTES_PER_MS
+#define SIM_BUS_BYTES_PER_MS (19 * SIM_PACKET)
+#endif
+
+extern "C" void tinyusb_task_loop_hook(void);
+
+// Byte ring of a fixed capacity, like a TinyUSB endpoint FIFO
+class Fifo {
+public:
+  explicit Fifo(size_t capacity) : buf(capacity) {}
+
+  size_t level() const { return count; }
+  size_t room() const { return buf.size() - count; }
+
+  size_t push(const uint8_t *data, size_t len) {
+    len = std::min(len, room());
+    const size_t tail = (head + count) % buf.size();
+    const size_t first = std::min(len, buf.size() - tail);
+    memcpy(&buf[tail], data, first);
+    memcpy(&buf[0], data + first, len - first);
+    count += len;
+    return len;
+  }
+
+  size_t pop(uint8_t *out, size_t len) {
+    len = std::min(len, count);
+    const size_t first = std::min(len, buf.size() - head);
+    memcpy(out, &buf[head], first);
+    memcpy(out + first, &buf[0], len - first);
+    consume(len);
+    return len;
+  }
+
+  // Contiguous bytes at the head, for a write() straight from the ring
+  const uint8_t *front(size_t *len) const {
+    *len = std::min(count, buf.size() - head);
+    return &buf[head];
+  }
+  void consume(size_t len) {
+    head = (head + len) % buf.size();
+    count -= len;
+  }
+
+private:
+  std::vector<uint8_t> buf;
+  size_t head = 0, count = 0;
+};
+
+struct Pty {
+  int master = -1;
+  int slave = -1;
+  std::string path;
+};
+
+struct Cdc {
+  Pty pty;
+  std::mutex lock; // guards the FIFOs and the callback
+  Fifo rx{CFG_TUD_CDC_RX_BUFSIZE};
+  Fifo tx{CFG_TUD_CDC_TX_BUFSIZE};
+  tusb_cdcacm_callback_t on_rx = nullptr;
+  bool installed = false;
+};
+
+struct Vendor {
+  Pty pty;
+  std::mutex lock;
+  Fifo tx{CFG_TUD_VENDOR_TX_BUFSIZE};
+};
+
+static Cdc s_cdc[CFG_TUD_CDC];
+static Vendor s_vendor;
+static int s_wake = -1;
+
+static_assert(CFG_TUD_CDC <= TINYUSB_CDC_ACM_MAX, "CDC port count");
+
+static void wake(void) {
+  const uint64_t one = 1;
+  (void)!write(s_wake, &one, sizeof(one));
+}
+
+static esp_err_t open_pty(Pty &p) {
+  p.master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (p.master < 0 || grantpt(p.master) || unlockpt(p.master)) {
+    ESP_LOGE(TAG, "Cannot allocate pty: %s", strerror(errno));
+    return ESP_FAIL;
+  }
+  p.path = ptsname(p.master);
+  // Holding the slave open keeps the master from seeing a hangup while no
+  // host has the port open, like a plugged-in device without a reader
+  p.slave = open(p.path.c_str(), O_RDWR | O_NOCTTY);
+  if (p.slave < 0)
+    return ESP_FAIL;
+  struct termios tio;
+  if (tcgetattr(p.slave, &tio) == 0) {
+    cfmakeraw(&tio);
+    tcsetattr(p.slave, TCSANOW, &tio);
+  }
+  fcntl(p.master, F_SETFL, fcntl(p.master, F_GETFL) | O_NONBLOCK);
+  return ESP_OK;
+}
+
+// Send one packet from `fifo` to the pty, if the host has room for it;
+// returns the bytes sent
+static size_t transmit(int fd, Fifo &fifo) {
+  size_t len;
+  const uint8_t *data = fifo.front(&len);
+  const ssize_t n = write(fd, data, std::min(len, (size_t)SIM_PACKET));
+  if (n <= 0)
+    return 0;
+  fifo.consume((size_t)n);
+  return (size_t)n;
+}
+
+// Hold the task until the bus has carried `bytes`
+static void bus_wait(size_t bytes) {
+  using Clock = std::chrono::steady_clock;
+  static Clock::time_point free_at;
+  if (bytes == 0)
+    return;
+  const auto now = Clock::now();
+  free_at = std::max(free_at, now) +
+            std::chrono::microseconds(bytes * 1000 / SIM_BUS_BYTES_PER_MS);
+  std::this_thread::sleep_until(free_at);
+}
+
+// The TinyUSB task: move data between the ptys and the FIFOs, raise RX
+// callbacks. A full RX FIFO stops reading its pty, which is what NAKing
+// OUT transfers looks like to the host.
+static void usb_task(void) {
+  uint8_t packet[SIM_PACKET];
+  std::vector<pollfd> fds(CFG_TUD_CDC + 2);
+  for (;;) {
+    size_t moved = 0;
+    fds[0] = {s_wake, POLLIN, 0};
+    for (uint8_t i = 0; i < CFG_TUD_CDC; i++) {
+      Cdc &c = s_cdc[i];
+      std::scoped_lock lock(c.lock);
+      short events = 0;
+      if (c.installed && c.rx.room() > 0)
+        events |= POLLIN;
+      if (c.tx.level() > 0)
+        events |= POLLOUT;
+      fds[1 + i] = {c.pty.master, events, 0};
+    }
+    {
+      std::scoped_lock lock(s_vendor.lock);
+      // The capture interface ignores what the host sends
+      fds[1 + CFG_TUD_CDC] = {
+          s_vendor.pty.master,
+          (short)(POLLIN | (s_vendor.tx.level() > 0 ? POLLOUT : 0)), 0};
+    }
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      ESP_LOGE(TAG, "poll: %s", strerror(errno));
+      abort();
+    }
+    if (fds[0].revents & POLLIN) {
+      uint64_t count;
+      (void)!read(s_wake, &count, sizeof(count));
+    }
+
+    for (uint8_t i = 0; i < CFG_TUD_CDC; i++) {
+      Cdc &c = s_cdc[i];
+      const short revents = fds[1 + i].revents;
+      tusb_cdcacm_callback_t on_rx = nullptr;
+      {
+        std::scoped_lock lock(c.lock);
+        if (revents & POLLIN) {
+          const ssize_t n =
+              read(c.pty.master, packet, std::min(sizeof(packet), c.rx.room()));
+          if (n > 0) {
+            c.rx.push(packet, (size_t)n);
+            moved += (size_t)n;
+            on_rx = c.on_rx;
+          }
+        }
+        if (c.tx.level() > 0)
+          moved += transmit(c.pty.master, c.tx);
+      }
+      if (on_rx) {
+        cdcacm_event_t event = {CDC_EVENT_RX};
+        on_rx(i, &event);
+      }
+    }
+
+    const short revents = fds[1 + CFG_TUD_CDC].revents;
+    if (revents & POLLIN)
+      (void)!read(s_vendor.pty.master, packet, sizeof(packet));
+    {
+      std::scoped_lock lock(s_vendor.lock);
+      if (s_vendor.tx.level() > 0)
+        moved += transmit(s_vendor.pty.master, s_vendor.tx);
+    }
+    tinyusb_task_loop_hook();
+    bus_wait(moved);
+  }
+}
+
+esp_err_t sim_usb_init(void) {
+  s_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (s_wake < 0)
+    return ESP_FAIL;
+  for (auto &c : s_cdc)
+    if (open_pty(c.pty) != ESP_OK)
+      return ESP_FAIL;
+  if (open_pty(s_vendor.pty) != ESP_OK)
+    return ESP_FAIL;
+  std::thread([] {
+    pthread_setname_np(pthread_self(), "TinyUSB");
+    usb_task();
+  }).detach();
+  return ESP_OK;
+}
+
+std::string sim_usb_path(uint8_t itf) {
+  if (itf == SIM_CAPTURE_ITF)
+    return s_vendor.pty.path;
+  return itf < CFG_TUD_CDC ? s_cdc[itf].pty.path : std::string();
+}
+
+// ---------- esp_tinyusb CDC-ACM ----------
+
+esp_err_t tinyusb_cdcacm_init(const tinyusb_config_cdcacm_t *cfg) {
+  if (!cfg || cfg->cdc_port >= CFG_TUD_CDC || s_wake < 0)
+    return ESP_ERR_INVALID_ARG;
+  Cdc &c = s_cdc[cfg->cdc_port];
+  {
+    std::scoped_lock lock(c.lock);
+    if (c.installed)
+      return ESP_ERR_INVALID_STATE;
+    c.on_rx = cfg->callback_rx;
+    c.installed = true;
+  }
+  wake();
+  return ESP_OK;
+}
+
+size_t tinyusb_cdcacm_write_queue(tinyusb_cdcacm_itf_t itf,
+                                  const uint8_t *in_buf, size_t in_size) {
+  if (itf >= CFG_TUD_CDC)
+    return 0;
+  std::scoped_lock lock(s_cdc[itf].lock);
+  return s_cdc[itf].tx.push(in_buf, in_size);
+}
+
+esp_err_t tinyusb_cdcacm_write_flush(tinyusb_cdcacm_itf_t itf,
+                                     uint32_t timeout_ticks) {
+  (void)timeout_ticks;
+  if (itf >= CFG_TUD_CDC)
+    return ESP_ERR_INVALID_ARG;
+  wake();
+  return ESP_OK;
+}
+
+esp_err_t tinyusb_cdcacm_read(tinyusb_cdcacm_itf_t itf, uint8_t *out_buf,
+                              size_t out_buf_sz, size_t *rx_data_size) {
+  if (itf >= CFG_TUD_CDC)
+    return ESP_ERR_INVALID_ARG;
+  Cdc &c = s_cdc[itf];
+  bool was_full;
+  {
+    std::scoped_lock lock(c.lock);
+    was_full = c.rx.room() == 0;
+    *rx_data_size = c.rx.pop(out_buf, out_buf_sz);
+  }
+  // The TinyUSB task stopped reading the pty while the FIFO was full
+  if (was_full && *rx_data_size > 0)
+    wake();
+  return ESP_OK;
+}
+
+// ---------- TinyUSB device API ----------
+
+uint32_t tud_cdc_n_available(uint8_t itf) {
+  if (itf >= CFG_TUD_CDC)
+    return 0;
+  std::scoped_lock lock(s_cdc[itf].lock);
+  return (uint32_t)s_cdc[itf].rx.level();
+}
+
+uint32_t tud_cdc_n_write_available(uint8_t itf) {
+  if (itf >= CFG_TUD_CDC)
+    return 0;
+  std::scoped_lock lock(s_cdc[itf].lock);
+  return (uint32_t)s_cdc[itf].tx.room();
+}
+
+// The capture interface of a plugged-in device is always configured
+bool tud_vendor_n_mounted(uint8_t itf) { return itf == 0 && s_wake >= 0; }
+
+uint32_t tud_vendor_n_write_available(uint8_t itf) {
+  if (itf != 0)
+    return 0;
+  std::scoped_lock lock(s_vendor.lock);
+  return (uint32_t)s_vendor.tx.room();
+}
+
+uint32_t tud_vendor_n_write(uint8_t itf, const void *buffer, uint32_t len) {
+  if (itf != 0)
+    return 0;
+  std::scoped_lock lock(s_vendor.lock);
+  return (uint32_t)s_vendor.tx.push(static_cast<const uint8_t *>(buffer),
+                                    len);
+}
+
+uint32_t tud_vendor_n_write_flush(uint8_t itf) {
+  if (itf != 0)
+    return 0;
+  wake();
+  std::scoped_lock lock(s_vendor.lock);
+  return (uint32_t)s_vendor.tx.level();
+}
@@ -0,0 +1,162 @@
+#include <arpa/inet.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CaptureReceiver.h"
+#include "check.h"
+#include "record.h"
+
+// The test plays the device: a UDP socket on loopback that waits for the
+// receiver's subscription and answers with datagrams of encoded records,
+// packed the way capture_net.cpp packs them
+typedef std::vector<uint8_t> Bytes;
+
+struct Device {
+  int fd;
+  uint16_t port;
+  sockaddr_in peer;
+
+  Device() {
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    CHECK(fd >= 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK_EQ(bind(fd, (sockaddr *)&addr, sizeof(addr)), 0);
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr *)&addr, &len);
+    port = ntohs(addr.sin_port);
+    timeval timeout = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  }
+  ~Device() { close(fd); }
+
+  void await_subscription() {
+    char buf[64];
+    socklen_t len = sizeof(peer);
+    CHECK(recvfrom(fd, buf, sizeof(buf), 0, (sockaddr *)&peer, &len) > 0);
+  }
+
+  void send(const Bytes &datagram) {
+    CHECK_EQ(sendto(fd, datagram.data(), datagram.size(), 0,
+                    (sockaddr *)&peer, sizeof(peer)),
+             (ssize_t)datagram.size());
+  }
+};
+
+static Bytes data_record(uint32_t seq, const Bytes &payload) {
+  Bytes wire(RECORD_ENCODED_MAX(RECORD_DATA_OVERHEAD + payload.size()));
+  wire.resize(record_encode_data(wire.data(), wire.size(), seq, 100 + seq,
+                                 (uint8_t)(seq % 2), payload.data(),
+                                 payload.size()));
+  CHECK(!wire.empty());
+  return wire;
+}
+
+struct Collector {
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<Capture::Record> records;
+  std::vector<Bytes> payloads;
+  size_t batches = 0;
+
+  void operator()(Capture::Receiver::Batch &&batch) {
+    std::scoped_lock lock(mutex);
+    for (auto &r : batch.records) {
+      records.push_back(r);
+      payloads.emplace_back(r.payload, r.payload + r.len);
+    }
+    batches++;
+    cv.notify_all();
+  }
+
+  bool wait_for(size_t n) {
+    std::unique_lock lock(mutex);
+    return cv.wait_for(lock, std::chrono::seconds(5),
+                       [&] { return records.size() >= n; });
+  }
+};
+
+static void test_stream_over_udp() {
+  Device device;
+  Collector got;
+  Capture::Receiver::Options options;
+  options.device = "127.0.0.1";
+  options.port = device.port;
+  Capture::Receiver receiver([&](auto &&b) { got(std::move(b)); }, options);
+  CHECK(receiver.localPort() != 0);
+  device.await_subscription();
+
+  // 500 records in datagrams of at most 1472 bytes, whole records only
+  const uint32_t total = 500;
+  Bytes datagram;
+  for (uint32_t seq = 0; seq < total; seq++) {
+    Bytes wire = data_record(seq, Bytes(seq % 300, (uint8_t)seq));
+    if (datagram.size() + wire.size() > 1472) {
+      device.send(datagram);
+      datagram.clear();
+    }
+    datagram.insert(datagram.end(), wire.begin(), wire.end());
+  }
+  device.send(datagram);
+
+  CHECK(got.wait_for(total));
+  std::scoped_lock lock(got.mutex);
+  CHECK_EQ(got.records.size(), (size_t)total);
+  for (uint32_t seq = 0; seq < total; seq++) {
+    CHECK_EQ(got.records[seq].seq, seq);
+    CHECK_EQ(got.records[seq].src, seq % 2);
+    CHECK((got.payloads[seq] == Bytes(seq % 300, (uint8_t)seq)));
+  }
+  CHECK_EQ(receiver.statistics().gaps, 0u);
+  CHECK_EQ(receiver.statistics().corrupt, 0u);
+  CHECK(receiver.datagrams() > 1);
+}
+
+// A datagram lost on the way is a seq gap, the rest still decodes
+static void test_lost_datagram_is_a_gap() {
+  Device device;
+  Collector got;
+  Capture::Receiver::Options options;
+  options.device = "127.0.0.1";
+  options.port = device.port;
+  Capture::Receiver receiver([&](auto &&b) { got(std::move(b)); }, options);
+  device.await_subscription();
+
+  for (uint32_t seq = 0; seq < 30; seq++) {
+    if (seq / 10 == 1)
+      continue; // the second datagram never arrives
+    device.send(data_record(seq, Bytes(8, 0x55)));
+  }
+  CHECK(got.wait_for(20));
+  receiver.close();
+  CHECK(receiver.closed());
+  CHECK_EQ(receiver.statistics().gaps, 1u);
+  CHECK_EQ(receiver.statistics().lost, 10u);
+}
+
+static void test_bad_address_throws() {
+  Capture::Receiver::Options options;
+  options.device = "not an address";
+  bool threw = false;
+  try {
+    Capture::Receiver receiver([](auto &&) {}, options);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  CHECK(threw);
+}
+
+int main() {
+  RUN(test_stream_over_udp);
+  RUN(test_lost_datagram_is_a_gap);
+  RUN(test_bad_address_throws);
+  return 0;
+}
@@ -0,0 +1,140 @@
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+#include "CaptureDecoder.h"
+#include "Lz.h"
+#include "check.h"
+#include "lz.h"
+#include "record.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+// Compress blocks in order and check the addon decoder reproduces them
+static size_t round_trip(lz_encoder_t &enc, Lz::Decoder &dec,
+                         const Bytes &block) {
+  Bytes out(LZ_BOUND(block.size()));
+  const size_t n =
+      lz_compress(&enc, block.data(), block.size(), out.data(), out.size());
+  CHECK(n > 0);
+  const uint8_t *got;
+  size_t got_len;
+  CHECK(dec.decompress(out.data(), n, LZ_WINDOW, got, got_len));
+  CHECK_EQ(got_len, block.size());
+  CHECK(memcmp(got, block.data(), block.size()) == 0);
+  return n;
+}
+
+static void test_repetitive_blocks_shrink() {
+  lz_encoder_t enc;
+  lz_reset(&enc);
+  Lz::Decoder dec;
+  const Bytes poll = {'$', 'M', '<', 0, 101, 101, 0x11, 0x22, 0x33, 0x44,
+                      0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC};
+  const size_t first = round_trip(enc, dec, poll);
+  CHECK(first > poll.size()); // nothing to match yet: all literals
+  // Later copies match the history of earlier blocks
+  for (int i = 0; i < 100; i++)
+    CHECK(round_trip(enc, dec, poll) < 8);
+}
+
+static void test_random_and_structured_data() {
+  std::mt19937 rng(7);
+  lz_encoder_t enc;
+  lz_reset(&enc);
+  Lz::Decoder dec;
+  // Enough blocks to slide the encoder history and compact the decoder's
+  for (int i = 0; i < 2000; i++) {
+    Bytes block(rng() % (LZ_WINDOW + 1));
+    const int kind = rng() % 3;
+    for (size_t j = 0; j < block.size(); j++)
+      block[j] = kind == 0   ? (uint8_t)rng()
+                 : kind == 1 ? (uint8_t)(j % 3)  // short-offset overlap
+                             : (uint8_t)(j / 40); // long runs
+    round_trip(enc, dec, block);
+  }
+}
+
+static void test_oversized_block_rejected() {
+  lz_encoder_t enc;
+  lz_reset(&enc);
+  Bytes big(LZ_WINDOW + 1), out(LZ_BOUND(big.size()));
+  CHECK_EQ(lz_compress(&enc, big.data(), big.size(), out.data(), out.size()),
+           0u);
+  Bytes small(64);
+  CHECK_EQ(lz_compress(&enc, small.data(), small.size(), out.data(), 4), 0u);
+  CHECK_EQ(enc.len, 0u); // history restarted
+}
+
+static void test_decoder_rejects_bad_input() {
+  Lz::Decoder dec;
+  const uint8_t *out;
+  size_t n;
+  // Match offset reaching before the start of history
+  const uint8_t far[] = {0x10, 'a', 0x05, 0x00};
+  CHECK(!dec.decompress(far, sizeof(far), 64, out, n));
+  dec.reset();
+  // Output larger than allowed
+  const uint8_t lit[] = {0x40, 1, 2, 3, 4};
+  CHECK(!dec.decompress(lit, sizeof(lit), 3, out, n));
+  dec.reset();
+  CHECK(dec.decompress(lit, sizeof(lit), 4, out, n));
+}
+
+// Capture stream with compression: chain restarts, loss and recovery
+static Bytes lz_record(record_compressor_t &c, uint32_t seq,
+                       const Bytes &payload) {
+  Bytes wire(RECORD_LZ_ENCODED_MAX);
+  wire.resize(record_encode_compressed(&c, wire.data(), wire.size(), seq,
+                                       1000 + seq * 250, 1, payload.data(),
+                                       payload.size()));
+  CHECK(!wire.empty());
+  return wire;
+}
+
+static void test_compressed_capture_stream() {
+  static record_compressor_t enc;
+  record_compressor_reset(&enc);
+  Capture::Decoder dec;
+  std::vector<Capture::Record> seen;
+  auto feed = [&](const Bytes &wire) {
+    dec.push(wire.data(), wire.size(),
+             [&](const Capture::Record &r) { seen.push_back(r); });
+  };
+  const Bytes payload = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+  const Bytes first = lz_record(enc, 0, payload);
+  const Bytes second = lz_record(enc, 1, payload);
+  CHECK(second.size() < first.size());
+  feed(first);
+  feed(second);
+  CHECK_EQ(seen.size(), 2u);
+  // Header fields are restored from their deltas
+  CHECK_EQ(seen[1].seq, 1u);
+  CHECK_EQ(seen[1].time, 1250u);
+  CHECK_EQ(seen[1].src, 1);
+  // Frame 2 vanishes on the host side: frame 3 is chained to it and must
+  // be rejected, frames until the next reset are stale
+  lz_record(enc, 2, payload);
+  feed(lz_record(enc, 3, payload));
+  feed(lz_record(enc, 4, payload));
+  CHECK_EQ(seen.size(), 2u);
+  CHECK_EQ(dec.statistics().corrupt, 1u);
+  CHECK_EQ(dec.statistics().stale, 1u);
+  // Device restarts the history (heartbeat): decoding resumes
+  record_compressor_reset(&enc);
+  feed(lz_record(enc, 5, payload));
+  feed(lz_record(enc, 6, payload));
+  CHECK_EQ(seen.size(), 4u);
+  CHECK_EQ(seen[3].seq, 6u);
+  CHECK_EQ(dec.statistics().compressed, 6u);
+}
+
+int main() {
+  RUN(test_repetitive_blocks_shrink);
+  RUN(test_random_and_structured_data);
+  RUN(test_oversized_block_rejected);
+  RUN(test_decoder_rejects_bad_input);
+  RUN(test_compressed_capture_stream);
+  return 0;
+}
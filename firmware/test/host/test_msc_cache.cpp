@@ -0,0 +1,347 @@
+// Write queue and read cache of the MSC storage
+// (components/esp_tinyusb/tinyusb_msc.c) on an in-memory medium. The
+// TinyUSB callbacks are called the way the TinyUSB task calls them;
+// deferred calls only run when a test says so.
+
+#include <string.h>
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "check.h"
+#include "device/usbd_pvt.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include "msc_storage.h"
+#include "storage_spiflash.h"
+#include "tinyusb_msc.h"
+
+extern "C" {
+int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset,
+                          void *buffer, uint32_t bufsize);
+int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset,
+                           uint8_t *buffer, uint32_t bufsize);
+void tud_msc_write10_complete_cb(uint8_t lun);
+bool tud_msc_test_unit_ready_cb(uint8_t lun);
+int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void *buffer,
+                        uint16_t bufsize);
+}
+
+static constexpr uint32_t SECTOR = 512;
+static constexpr uint32_t SECTORS = 64;
+static constexpr uint32_t PER_BLOCK = CONFIG_TINYUSB_MSC_BLOCK_SIZE / SECTOR;
+static constexpr uint8_t ERASED = 0xEE;
+
+// The medium, and every write that reached it
+struct Write {
+  uint64_t addr;
+  size_t size;
+};
+static std::vector<uint8_t> disk(SECTORS *SECTOR, ERASED);
+static std::vector<Write> writes;
+
+static std::deque<std::pair<osal_task_func_t, void *>> deferred;
+static std::vector<msc_test_mutex *> mutexes;
+
+static esp_err_t medium_mount(BYTE) { return ESP_OK; }
+static esp_err_t medium_unmount(void) { return ESP_OK; }
+
+static esp_err_t medium_read(uint32_t lba, uint32_t offset, size_t size,
+                             void *dest) {
+  const uint64_t addr = (uint64_t)lba * SECTOR + offset;
+  CHECK(addr + size <= disk.size());
+  memcpy(dest, disk.data() + addr, size);
+  return ESP_OK;
+}
+
+static esp_err_t medium_write(uint32_t lba, uint32_t offset, size_t size,
+                              const void *src) {
+  const uint64_t addr = (uint64_t)lba * SECTOR + offset;
+  CHECK(addr + size <= disk.size());
+  memcpy(disk.data() + addr, src, size);
+  writes.push_back({addr, size});
+  return ESP_OK;
+}
+
+static esp_err_t medium_get_info(storage_info_t *info) {
+  info->total_sectors = SECTORS;
+  info->sector_size = SECTOR;
+  return ESP_OK;
+}
+
+static void medium_close(void) {}
+
+static const storage_medium_t medium = {
+    STORAGE_MEDIUM_TYPE_SPIFLASH, medium_mount, medium_unmount, medium_read,
+    medium_write, medium_get_info, medium_close,
+};
+
+// ESP-IDF, FatFs and TinyUSB, as far as tinyusb_msc.c needs them
+extern "C" {
+esp_err_t storage_spiflash_open_medium(wl_handle_t,
+                                       const storage_medium_t **out) {
+  *out = &medium;
+  return ESP_OK;
+}
+
+void usbd_defer_func(osal_task_func_t func, void *param, bool) {
+  deferred.emplace_back(func, param);
+}
+
+bool tud_msc_set_sense(uint8_t, uint8_t, uint8_t, uint8_t) { return true; }
+
+void *heap_caps_aligned_calloc(size_t, size_t n, size_t size, uint32_t) {
+  return calloc(n, size);
+}
+
+void heap_caps_free(void *ptr) { free(ptr); }
+
+const char *esp_err_to_name(esp_err_t code) {
+  return code == ESP_OK ? "ESP_OK" : "ESP_FAIL";
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  mutexes.push_back(new msc_test_mutex{false});
+  return mutexes.back();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t) {
+  // Single-threaded: a held mutex would never be given back
+  CHECK(!sem->held);
+  sem->held = true;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  CHECK(sem->held);
+  sem->held = false;
+  return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+  CHECK(!sem->held);
+  for (auto it = mutexes.begin(); it != mutexes.end(); ++it)
+    if (*it == sem) {
+      mutexes.erase(it);
+      break;
+    }
+  delete sem;
+}
+
+FRESULT f_mount(FATFS *, const char *, BYTE) { return FR_OK; }
+FRESULT f_mkfs(const char *, const MKFS_PARM *, void *, UINT) { return FR_OK; }
+void *ff_memalloc(UINT size) { return malloc(size); }
+void ff_memfree(void *ptr) { free(ptr); }
+
+esp_err_t ff_diskio_get_drive(BYTE *out_pdrv) {
+  *out_pdrv = 0;
+  return ESP_OK;
+}
+
+esp_err_t esp_vfs_fat_register(const char *, const char *, size_t,
+                               FATFS **out_fs) {
+  static FATFS fs;
+  *out_fs = &fs;
+  return ESP_OK;
+}
+
+esp_err_t esp_vfs_fat_unregister_path(const char *) { return ESP_OK; }
+
+size_t esp_vfs_fat_get_allocation_unit_size(size_t sector_size, size_t) {
+  return sector_size;
+}
+}
+
+static void on_event(tinyusb_msc_storage_handle_t, tinyusb_msc_event_t *,
+                     void *) {}
+
+// Run what the TinyUSB task has been asked to do later
+static void run_deferred() {
+  while (!deferred.empty()) {
+    auto call = deferred.front();
+    deferred.pop_front();
+    call.first(call.second);
+  }
+}
+
+static void check_unlocked() {
+  for (auto *mutex : mutexes)
+    CHECK(!mutex->held);
+}
+
+static tinyusb_msc_storage_handle_t setup() {
+  std::fill(disk.begin(), disk.end(), ERASED);
+  writes.clear();
+  tinyusb_msc_driver_config_t driver = {};
+  driver.callback = on_event;
+  CHECK_EQ(tinyusb_msc_install_driver(&driver), ESP_OK);
+  tinyusb_msc_storage_config_t config = {};
+  config.medium.wl_handle = 1;
+  config.mount_point = TINYUSB_MSC_STORAGE_MOUNT_USB;
+  tinyusb_msc_storage_handle_t handle = nullptr;
+  CHECK_EQ(tinyusb_msc_new_storage_spiflash(&config, &handle), ESP_OK);
+  return handle;
+}
+
+static void teardown(tinyusb_msc_storage_handle_t handle) {
+  run_deferred();
+  CHECK_EQ(tinyusb_msc_delete_storage(handle), ESP_OK);
+  CHECK_EQ(tinyusb_msc_uninstall_driver(), ESP_OK);
+  CHECK(mutexes.empty());
+}
+
+static std::vector<uint8_t> pattern(uint32_t lba, uint32_t count,
+                                    uint8_t seed) {
+  std::vector<uint8_t> out(count * SECTOR);
+  for (size_t i = 0; i < out.size(); i++)
+    out[i] = (uint8_t)(seed * 31 + lba * 7 + i);
+  return out;
+}
+
+// One WRITE10 command, split into FIFO-sized callbacks as TinyUSB does
+static void write10(uint32_t lba, uint32_t count, uint8_t seed) {
+  auto data = pattern(lba, count, seed);
+  for (uint32_t i = 0; i < count; i++) {
+    CHECK_EQ(tud_msc_write10_cb(0, lba + i, 0, data.data() + i * SECTOR,
+                                SECTOR),
+             (int32_t)SECTOR);
+    check_unlocked();
+  }
+  tud_msc_write10_complete_cb(0);
+  check_unlocked();
+}
+
+// One READ10 command, `chunk` bytes per callback
+static std::vector<uint8_t> read10(uint32_t lba, uint32_t count,
+                                   uint32_t chunk = SECTOR) {
+  std::vector<uint8_t> out(count * SECTOR);
+  for (uint32_t at = 0; at < out.size(); at += chunk) {
+    CHECK_EQ(tud_msc_read10_cb(0, lba + at / SECTOR, 0, out.data() + at,
+                               chunk),
+             (int32_t)chunk);
+    check_unlocked();
+  }
+  return out;
+}
+
+static bool on_disk(uint32_t lba, const std::vector<uint8_t> &data) {
+  return memcmp(disk.data() + lba * SECTOR, data.data(), data.size()) == 0;
+}
+
+static void test_partial_block_writes() {
+  auto handle = setup();
+  // The block written last stays open while it is incomplete
+  write10(1, 1, 1);
+  write10(2, PER_BLOCK - 2, 1);
+  run_deferred();
+  CHECK(writes.empty());
+  // Completing it writes the whole block at once
+  write10(0, 1, 1);
+  run_deferred();
+  CHECK_EQ(writes.size(), 1u);
+  CHECK_EQ(writes[0].addr, 0u);
+  CHECK_EQ(writes[0].size, (size_t)CONFIG_TINYUSB_MSC_BLOCK_SIZE);
+  CHECK(on_disk(0, pattern(0, 1, 1)));
+  CHECK(on_disk(1, pattern(1, 1, 1)));
+  CHECK(on_disk(2, pattern(2, PER_BLOCK - 2, 1)));
+  // A slot holds one range: a gap sends what it has to the medium first
+  writes.clear();
+  write10(PER_BLOCK + 0, 1, 2);
+  write10(PER_BLOCK + 2, 1, 2);
+  CHECK_EQ(writes.size(), 1u);
+  CHECK_EQ(writes[0].addr, (uint64_t)PER_BLOCK * SECTOR);
+  CHECK_EQ(writes[0].size, (size_t)SECTOR);
+  CHECK(on_disk(PER_BLOCK + 0, pattern(PER_BLOCK + 0, 1, 2)));
+  teardown(handle);
+  // Deleting the storage writes the open block
+  CHECK(on_disk(PER_BLOCK + 2, pattern(PER_BLOCK + 2, 1, 2)));
+}
+
+static void test_read_after_queued_write() {
+  auto handle = setup();
+  // Cache line filled while the block has queued bytes elsewhere in it
+  write10(1, 1, 3);
+  CHECK(writes.empty());
+  auto block = read10(0, PER_BLOCK);
+  CHECK(memcmp(block.data() + SECTOR, pattern(1, 1, 3).data(), SECTOR) == 0);
+  CHECK(block[0] == ERASED);
+  // A cached line follows writes queued after it was filled
+  CHECK(read10(PER_BLOCK * 2 + 1, 1)[0] == ERASED);
+  write10(PER_BLOCK * 2 + 1, 1, 4);
+  CHECK(read10(PER_BLOCK * 2 + 1, 1) == pattern(PER_BLOCK * 2 + 1, 1, 4));
+  // Whole blocks bypass the cache and see the queued bytes all the same
+  write10(PER_BLOCK * 3 + 2, 1, 5);
+  block = read10(PER_BLOCK * 3, PER_BLOCK, CONFIG_TINYUSB_MSC_BLOCK_SIZE);
+  CHECK(memcmp(block.data() + 2 * SECTOR,
+               pattern(PER_BLOCK * 3 + 2, 1, 5).data(), SECTOR) == 0);
+  teardown(handle);
+}
+
+static void test_slot_recycling() {
+  auto handle = setup();
+  static_assert(CONFIG_TINYUSB_MSC_WRITE_SLOTS == 2, "one slot per block");
+  write10(0, 1, 6);
+  write10(PER_BLOCK, 1, 6);
+  CHECK(writes.empty());
+  // A third block takes the slot used longest ago
+  write10(PER_BLOCK * 2, 1, 6);
+  CHECK_EQ(writes.size(), 1u);
+  CHECK_EQ(writes[0].addr, 0u);
+  CHECK(on_disk(0, pattern(0, 1, 6)));
+  // The recycled slot holds the new block only
+  CHECK(read10(PER_BLOCK * 2, 1) == pattern(PER_BLOCK * 2, 1, 6));
+  CHECK(read10(PER_BLOCK * 2 + 1, 1)[0] == ERASED);
+  CHECK(read10(PER_BLOCK, 1) == pattern(PER_BLOCK, 1, 6));
+  teardown(handle);
+}
+
+static void test_flush_on_idle_and_sync() {
+  auto handle = setup();
+  write10(3, 1, 7);
+  run_deferred();
+  CHECK(writes.empty());
+  // TEST UNIT READY: the host is idle
+  CHECK(tud_msc_test_unit_ready_cb(0));
+  check_unlocked();
+  CHECK_EQ(writes.size(), 1u);
+  CHECK(on_disk(3, pattern(3, 1, 7)));
+  // SYNCHRONIZE CACHE(10)
+  write10(PER_BLOCK + 1, 1, 8);
+  const uint8_t sync[16] = {0x35};
+  CHECK_EQ(tud_msc_scsi_cb(0, sync, nullptr, 0), 0);
+  check_unlocked();
+  CHECK_EQ(writes.size(), 2u);
+  CHECK(on_disk(PER_BLOCK + 1, pattern(PER_BLOCK + 1, 1, 8)));
+  teardown(handle);
+}
+
+static void test_mount_with_flush_pending() {
+  auto handle = setup();
+  // A deferred flush is still queued when the application takes the medium
+  write10(PER_BLOCK, PER_BLOCK, 9);
+  CHECK_EQ(deferred.size(), 1u);
+  CHECK_EQ(tinyusb_msc_set_storage_mount_point(handle,
+                                               TINYUSB_MSC_STORAGE_MOUNT_APP),
+           ESP_OK);
+  check_unlocked();
+  CHECK_EQ(writes.size(), 1u);
+  CHECK(on_disk(PER_BLOCK, pattern(PER_BLOCK, PER_BLOCK, 9)));
+  // ... and finds nothing left to do
+  run_deferred();
+  CHECK_EQ(writes.size(), 1u);
+  CHECK_EQ(tinyusb_msc_set_storage_mount_point(handle,
+                                               TINYUSB_MSC_STORAGE_MOUNT_USB),
+           ESP_OK);
+  teardown(handle);
+}
+
+int main() {
+  RUN(test_partial_block_writes);
+  RUN(test_read_after_queued_write);
+  RUN(test_slot_recycling);
+  RUN(test_flush_on_idle_and_sync);
+  RUN(test_mount_with_flush_pending);
+  printf("All MSC cache tests passed\n");
+  return 0;
+}
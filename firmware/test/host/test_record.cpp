@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "CaptureDecoder.h"
+#include "CaptureFile.h"
+#include "check.h"
+#include "record.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Decoded {
+  Capture::Record record;
+  Bytes payload;
+};
+
+static std::vector<Decoded> decode(Capture::Decoder &dec, const Bytes &wire) {
+  std::vector<Decoded> out;
+  dec.push(wire.data(), wire.size(), [&](const Capture::Record &r) {
+    out.push_back({r, Bytes(r.payload, r.payload + r.len)});
+  });
+  return out;
+}
+
+static Bytes data_record(uint32_t seq, uint64_t time, const Bytes &payload,
+                         uint8_t src = 0) {
+  Bytes wire(RECORD_ENCODED_MAX(RECORD_DATA_OVERHEAD + payload.size()));
+  size_t n = record_encode_data(wire.data(), wire.size(), seq, time, src,
+                                payload.data(), payload.size());
+  CHECK(n > 0);
+  wire.resize(n);
+  return wire;
+}
+
+static void test_crc_check_value() {
+  const char *s = "123456789";
+  CHECK_EQ(record_crc16((const uint8_t *)s, 9), 0x29B1);
+  CHECK_EQ(Capture::crc16((const uint8_t *)s, 9), 0x29B1);
+}
+
+static void test_round_trip() {
+  // Exercise zero runs and the 254-byte COBS block boundary
+  for (size_t len : {0, 1, 243, 244, 245, 253, 254, 255, 600, 1024}) {
+    Bytes payload(len);
+    for (size_t i = 0; i < len; i++)
+      payload[i] = (uint8_t)(i % 7 == 0 ? 0 : i);
+    Bytes wire = data_record(7, 1234, payload, 2);
+    CHECK(wire.size() <= RECORD_ENCODED_MAX(RECORD_DATA_OVERHEAD + len));
+    CHECK(memchr(wire.data(), 0, wire.size() - 1) == nullptr);
+    CHECK_EQ(wire.back(), 0);
+    Capture::Decoder dec;
+    auto out = decode(dec, wire);
+    CHECK_EQ(out.size(), 1u);
+    CHECK_EQ(out[0].record.type, Capture::DATA);
+    CHECK_EQ(out[0].record.seq, 7u);
+    CHECK_EQ(out[0].record.time, 1234u);
+    CHECK_EQ(out[0].record.src, 2);
+    CHECK((out[0].payload == payload));
+  }
+}
+
+static void test_encoder_respects_capacity() {
+  uint8_t out[16];
+  const uint8_t payload[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  CHECK_EQ(record_encode_data(out, sizeof(out), 0, 0, 0, payload, 8), 0u);
+  CHECK(record_encode_data(out, sizeof(out), 0, 0, 0, payload, 1) > 0);
+}
+
+static void test_resync_after_corruption() {
+  Capture::Decoder dec;
+  Bytes wire = data_record(0, 0, {1, 2, 3});
+  Bytes bad = data_record(1, 0, {4, 5, 6});
+  bad[3] ^= 0x40; // CRC mismatch
+  Bytes tail = data_record(2, 0, {7, 8, 9});
+  wire.insert(wire.end(), bad.begin(), bad.end());
+  // Garbage without a delimiter merges into the next frame, which is lost
+  const Bytes junk = {0x11, 0x22};
+  wire.insert(wire.end(), junk.begin(), junk.end());
+  wire.insert(wire.end(), tail.begin(), tail.end());
+  Bytes last = data_record(3, 0, {10});
+  wire.insert(wire.end(), last.begin(), last.end());
+  // Feed byte by byte to exercise partial frames
+  std::vector<Decoded> out;
+  for (uint8_t b : wire) {
+    auto got = decode(dec, Bytes{b});
+    out.insert(out.end(), got.begin(), got.end());
+  }
+  CHECK_EQ(out.size(), 2u);
+  CHECK_EQ(out[0].record.seq, 0u);
+  CHECK_EQ(out[1].record.seq, 3u);
+  CHECK_EQ(dec.statistics().corrupt, 2u);
+  CHECK_EQ(dec.statistics().gaps, 1u);
+  CHECK_EQ(dec.statistics().lost, 2u);
+}
+
+static void test_overlong_frame_is_dropped() {
+  Capture::Decoder dec(64);
+  Bytes wire(200, 0x55);
+  wire.push_back(0);
+  Bytes ok = data_record(0, 0, {1});
+  wire.insert(wire.end(), ok.begin(), ok.end());
+  CHECK_EQ(decode(dec, wire).size(), 1u);
+  CHECK_EQ(dec.statistics().corrupt, 1u);
+}
+
+static void test_sync_and_time_extension() {
+  Capture::Decoder dec;
+  Bytes wire(RECORD_ENCODED_MAX(RECORD_SYNC_LEN));
+  const uint64_t t0 = 0x5FFFFFF00ull;
+  wire.resize(record_encode_sync(wire.data(), wire.size(), 0, t0, 10, 2, 1));
+  auto out = decode(dec, wire);
+  CHECK_EQ(out.size(), 1u);
+  CHECK_EQ(out[0].record.type, Capture::SYNC);
+  CHECK_EQ(out[0].record.time, t0);
+  CHECK_EQ(out[0].record.records, 10u);
+  CHECK_EQ(out[0].record.dropped, 1u);
+  // DATA records carry 32 bits; the decoder carries across the wrap
+  out = decode(dec, data_record(1, t0 + 0x200, {1}));
+  CHECK_EQ(out[0].record.time, t0 + 0x200);
+  // A sequence going backwards is a device restart, not a gap
+  out = decode(dec, data_record(0, 5, {1}));
+  CHECK_EQ(dec.statistics().resets, 1u);
+  CHECK_EQ(dec.statistics().gaps, 0u);
+  CHECK_EQ(out[0].record.time, 5u);
+}
+
+static Bytes perf_record(uint32_t seq, uint32_t uptime_ms, uint32_t loops,
+                         uint32_t rx_bytes) {
+  perf_device_t dev = {};
+  dev.uptime_ms = uptime_ms;
+  dev.tud_loops = loops;
+  dev.ports = 2;
+  perf_port_t ports[2] = {};
+  ports[1].rx_bytes = rx_bytes;
+  ports[1].tx_full = 3;
+  ports[1].tx_fifo_hwm = 512;
+  ports[1].latency_min = 40;
+  ports[1].latency_max = 900;
+  Bytes wire(RECORD_ENCODED_MAX(RECORD_PERF_MAX_LEN));
+  wire.resize(record_encode_perf(wire.data(), wire.size(), seq,
+                                 uptime_ms * 1000ull, &dev, ports));
+  CHECK(!wire.empty());
+  return wire;
+}
+
+static void test_perf_snapshot_and_rates() {
+  Capture::Decoder dec;
+  CHECK(!dec.device().valid);
+  // PERF records update the device snapshot instead of being passed on
+  CHECK_EQ(decode(dec, perf_record(0, 1000, 5000, 100)).size(), 0u);
+  const auto &d = dec.device();
+  CHECK(d.valid);
+  CHECK_EQ(d.uptime_ms, 1000u);
+  CHECK_EQ(d.ports.size(), 2u);
+  CHECK_EQ(d.ports[1].tx_full, 3u);
+  CHECK_EQ(d.ports[1].tx_fifo_hwm, 512);
+  CHECK_EQ(d.ports[1].latency_max, 900u);
+  CHECK(d.tud_loop_rate == 0);
+  // Rates come from consecutive snapshots, 32-bit counters may wrap
+  decode(dec, perf_record(1, 1500, 6000, 0xFFFFFF00u));
+  CHECK(dec.device().tud_loop_rate == 2000);
+  CHECK(dec.device().ports[1].rx_rate == (0xFFFFFF00u - 100) * 2.0);
+  decode(dec, perf_record(2, 2000, 6000, 0x100));
+  CHECK(dec.device().ports[1].rx_rate == 0x200 * 2.0);
+  CHECK_EQ(dec.statistics().records, 3u);
+  CHECK_EQ(dec.statistics().corrupt, 0u);
+}
+
+// A capture store segment starts with a SYNC and holds plain wire records;
+// decoding it from the mapping, in pieces split mid-record, loses nothing
+static void test_mapped_segment() {
+  Bytes file(RECORD_ENCODED_MAX(RECORD_SYNC_LEN));
+  file.resize(record_encode_sync(file.data(), file.size(), 0,
+                                 0x100000000ull + 10, 0, 0, 0));
+  for (uint32_t seq = 1; seq <= 100; seq++) {
+    Bytes payload(seq * 3, (uint8_t)seq);
+    Bytes wire = data_record(seq, 10 + seq, payload, (uint8_t)(seq % 3));
+    file.insert(file.end(), wire.begin(), wire.end());
+  }
+  char path[] = "/tmp/capture_segment_XXXXXX";
+  const int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  CHECK_EQ(write(fd, file.data(), file.size()), (ssize_t)file.size());
+  close(fd);
+
+  auto mapped = Capture::File::create(path);
+  CHECK_EQ(mapped->size(), file.size());
+  CHECK(memcmp(mapped->data(), file.data(), file.size()) == 0);
+  Capture::Decoder dec;
+  std::vector<Capture::Record> out;
+  for (size_t off = 0; off < mapped->size(); off += 1000)
+    dec.push(mapped->data() + off, std::min<size_t>(1000, mapped->size() - off),
+             [&](const Capture::Record &r) { out.push_back(r); });
+  CHECK_EQ(out.size(), 101u);
+  CHECK_EQ(out[0].type, Capture::SYNC);
+  CHECK_EQ(out[100].seq, 100u);
+  CHECK_EQ(out[100].time, 0x100000000ull + 110);
+  CHECK_EQ(out[100].len, 300u);
+  CHECK_EQ(dec.statistics().gaps, 0u);
+  mapped.reset();
+  unlink(path);
+
+  // Empty segments map to nothing, missing ones throw
+  char empty[] = "/tmp/capture_segment_XXXXXX";
+  close(mkstemp(empty));
+  CHECK_EQ(Capture::File::create(empty)->size(), 0u);
+  unlink(empty);
+  bool threw = false;
+  try {
+    Capture::File::create(empty);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  CHECK(threw);
+}
+
+int main() {
+  RUN(test_crc_check_value);
+  RUN(test_round_trip);
+  RUN(test_encoder_respects_capacity);
+  RUN(test_resync_after_corruption);
+  RUN(test_overlong_frame_is_dropped);
+  RUN(test_sync_and_time_extension);
+  RUN(test_perf_snapshot_and_rates);
+  RUN(test_mapped_segment);
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include "check.h"
+#include "route.h"
+
+static void test_default_pairs() {
+  route_init(4, false);
+  CHECK_EQ(route_ports(), 4);
+  CHECK_EQ(route_get(0), 0x02);
+  CHECK_EQ(route_get(1), 0x01);
+  CHECK_EQ(route_get(2), 0x08);
+  CHECK_EQ(route_get(3), 0x04);
+}
+
+static void test_default_odd_and_single() {
+  // An unpaired last port echoes
+  route_init(3, false);
+  CHECK_EQ(route_get(2), 0x04);
+  route_init(1, false);
+  CHECK_EQ(route_ports(), 1);
+  CHECK_EQ(route_get(0), 0x01);
+}
+
+static void test_default_uart() {
+  // UART is the port after the CDC ports; only CDC0 is bridged to it
+  route_init(2, true);
+  CHECK_EQ(route_ports(), 3);
+  CHECK_EQ(route_get(0), 0x04);
+  CHECK_EQ(route_get(2), 0x01);
+  CHECK_EQ(route_get(1), 0);
+}
+
+static void test_set() {
+  route_init(3, false);
+  // fan-out and discard
+  CHECK(route_set(0, 0x06));
+  CHECK_EQ(route_get(0), 0x06);
+  CHECK(route_set(1, 0));
+  CHECK_EQ(route_get(1), 0);
+  // unknown source or destination
+  CHECK(!route_set(3, 0x01));
+  CHECK(!route_set(0, 0x08));
+  CHECK_EQ(route_get(0), 0x06);
+  CHECK_EQ(route_get(ROUTE_MAX_PORTS), 0);
+}
+
+static void test_snapshot() {
+  route_init(2, true);
+  route_mask_t table[ROUTE_MAX_PORTS] = {};
+  CHECK_EQ(route_snapshot(table, ROUTE_MAX_PORTS), 3u);
+  CHECK_EQ(table[0], 0x04);
+  CHECK_EQ(table[1], 0);
+  CHECK_EQ(table[2], 0x01);
+  CHECK_EQ(route_snapshot(table, 1), 1u);
+}
+
+int main() {
+  RUN(test_default_pairs);
+  RUN(test_default_odd_and_single);
+  RUN(test_default_uart);
+  RUN(test_set);
+  RUN(test_snapshot);
+  return 0;
+}
@@ -0,0 +1,154 @@
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "translate.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Run {
+  xlate_verdict_t verdict;
+  Bytes frame;
+  std::vector<Bytes> emitted;
+};
+
+static void collect(void *arg, const uint8_t *data, size_t len) {
+  static_cast<std::vector<Bytes> *>(arg)->emplace_back(data, data + len);
+}
+
+static Run run(const Bytes &code, Bytes frame, size_t cap = 64) {
+  CHECK(xlate_verify(code.data(), code.size()));
+  Run r;
+  size_t len = frame.size();
+  frame.resize(cap);
+  r.verdict = xlate_run(code.data(), code.size(), frame.data(), &len, cap,
+                        collect, &r.emitted);
+  frame.resize(len);
+  r.frame = frame;
+  return r;
+}
+
+// MSP v1 request: '$' 'M' '<' size cmd payload... xor(size..payload)
+static Bytes msp(uint8_t cmd, const Bytes &payload) {
+  Bytes f = {'$', 'M', '<', (uint8_t)payload.size(), cmd};
+  f.insert(f.end(), payload.begin(), payload.end());
+  uint8_t sum = 0;
+  for (size_t i = 3; i < f.size(); i++)
+    sum ^= f[i];
+  f.push_back(sum);
+  return f;
+}
+
+static void test_empty_program_passes() {
+  auto r = run({}, {1, 2, 3});
+  CHECK_EQ(r.verdict, XLATE_PASS);
+  CHECK((r.frame == Bytes{1, 2, 3}));
+}
+
+static void test_remap_msp_command() {
+  // if cmd == 101 (MSP_STATUS): cmd = 150 (MSP_STATUS_EX), fix checksum
+  const Bytes code = {
+      XOP_LD8, 4,                  // acc = cmd
+      XOP_JNE, 101, 0, 7,          // skip the next 7 bytes unless 101
+      XOP_SET8, 4, 150,            // cmd = 150
+      XOP_CSUM_XOR, 3, 0xFF, 0xFF, // frame[-1] = xor [3, len - 1)
+      XOP_PASS,                    //
+  };
+  auto r = run(code, msp(101, {0xAA, 0x55}));
+  CHECK_EQ(r.verdict, XLATE_PASS);
+  CHECK((r.frame == msp(150, {0xAA, 0x55})));
+  // other commands are untouched
+  r = run(code, msp(102, {0x01}));
+  CHECK((r.frame == msp(102, {0x01})));
+}
+
+static void test_drop_and_length_guard() {
+  // drop frames shorter than 4 bytes, pass the rest
+  const Bytes code = {XOP_LDLEN, XOP_JLT, 4, 0, 1, XOP_PASS, XOP_DROP};
+  CHECK_EQ(run(code, {1, 2, 3}).verdict, XLATE_DROP);
+  CHECK_EQ(run(code, {1, 2, 3, 4}).verdict, XLATE_PASS);
+}
+
+static void test_insert_delete() {
+  const Bytes code = {XOP_INSERT, 1, 2, 0xA0, 0xA1, XOP_DELETE, 0xFF, 1};
+  auto r = run(code, {1, 2, 3});
+  CHECK((r.frame == Bytes{1, 0xA0, 0xA1, 2}));
+  // growing past capacity faults
+  CHECK_EQ(run(code, {1, 2, 3}, 4).verdict, XLATE_FAULT);
+}
+
+static void test_inject_and_emit() {
+  const Bytes code = {XOP_INJECT, 2, 0xBE, 0xEF, XOP_EMIT, XOP_DROP};
+  auto r = run(code, {7});
+  CHECK_EQ(r.verdict, XLATE_DROP);
+  CHECK_EQ(r.emitted.size(), 2u);
+  CHECK((r.emitted[0] == Bytes{0xBE, 0xEF}));
+  CHECK((r.emitted[1] == Bytes{7}));
+}
+
+static void test_crc8_dvb_s2() {
+  // CRC-8/DVB-S2 check value of "123456789" is 0xBC
+  Bytes frame = {'1', '2', '3', '4', '5', '6', '7', '8', '9', 0};
+  const Bytes code = {XOP_CSUM_CRC8, 0, 0xFF, 0xFF};
+  CHECK_EQ(run(code, frame).frame.back(), 0xBC);
+}
+
+static void test_out_of_range_faults() {
+  CHECK_EQ(run({XOP_LD8, 5}, {1, 2}).verdict, XLATE_FAULT);
+  CHECK_EQ(run({XOP_LD16, 0xFF}, {1, 2}).verdict, XLATE_FAULT);
+  CHECK_EQ(run({XOP_ST8, 0xFD}, {1, 2}).verdict, XLATE_FAULT);
+}
+
+static void test_verify_rejects_bad_programs() {
+  const Bytes unknown = {0x7F};
+  const Bytes truncated = {XOP_SET8, 1};
+  const Bytes mid_jump = {XOP_JMP, 1, XOP_SET8, 0, 0};
+  const Bytes past_end = {XOP_JMP, 1};
+  const Bytes inject_overrun = {XOP_INJECT, 4, 1, 2};
+  CHECK(!xlate_verify(unknown.data(), unknown.size()));
+  CHECK(!xlate_verify(truncated.data(), truncated.size()));
+  CHECK(!xlate_verify(mid_jump.data(), mid_jump.size()));
+  CHECK(!xlate_verify(past_end.data(), past_end.size()));
+  CHECK(!xlate_verify(inject_overrun.data(), inject_overrun.size()));
+  const Bytes jump_to_end = {XOP_JMP, 0};
+  CHECK(xlate_verify(jump_to_end.data(), jump_to_end.size()));
+}
+
+static void test_program_table() {
+  const uint8_t code[] = {XOP_DROP};
+  uint8_t frame[8] = {1};
+  size_t len = 1;
+  CHECK(!xlate_active(0));
+  CHECK_EQ(xlate_apply(0, frame, &len, sizeof(frame), nullptr, nullptr),
+           XLATE_PASS);
+  CHECK(xlate_stage(0, code, sizeof(code)));
+  CHECK(!xlate_commit(XLATE_MAX_SOURCES, sizeof(code)));
+  CHECK(xlate_commit(0, sizeof(code)));
+  CHECK_EQ(xlate_apply(0, frame, &len, sizeof(frame), nullptr, nullptr),
+           XLATE_DROP);
+  CHECK_EQ(xlate_apply(1, frame, &len, sizeof(frame), nullptr, nullptr),
+           XLATE_PASS);
+  xlate_clear(0);
+  CHECK(!xlate_active(0));
+  // staged programs that fail verification never go live
+  const uint8_t bad[] = {0x7F};
+  CHECK(xlate_stage(0, bad, sizeof(bad)));
+  CHECK(!xlate_commit(0, sizeof(bad)));
+  CHECK(!xlate_active(0));
+  CHECK(!xlate_stage(XLATE_MAX_CODE, code, sizeof(code)));
+}
+
+int main() {
+  RUN(test_empty_program_passes);
+  RUN(test_remap_msp_command);
+  RUN(test_drop_and_length_guard);
+  RUN(test_insert_delete);
+  RUN(test_inject_and_emit);
+  RUN(test_crc8_dvb_s2);
+  RUN(test_out_of_range_faults);
+  RUN(test_verify_rejects_bad_programs);
+  RUN(test_program_table);
+  return 0;
+}
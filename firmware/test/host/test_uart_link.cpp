@@ -0,0 +1,121 @@
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "uart_link.h"
+
+// Stub UART: bytes "received" on the wire wait in `rx` until the link reads
+// them, bytes sent by the link land in `tx`.
+struct StubUart {
+  std::string rx;
+  std::string tx;
+  std::vector<std::string> frames;
+
+  void receive(const std::string &bytes) { rx += bytes; }
+
+  static int read(void *ctx, uint8_t *buf, size_t len) {
+    auto self = static_cast<StubUart *>(ctx);
+    len = len < self->rx.size() ? len : self->rx.size();
+    memcpy(buf, self->rx.data(), len);
+    self->rx.erase(0, len);
+    return (int)len;
+  }
+
+  static int write(void *ctx, const uint8_t *buf, size_t len) {
+    auto self = static_cast<StubUart *>(ctx);
+    self->tx.append(reinterpret_cast<const char *>(buf), len);
+    return (int)len;
+  }
+
+  static void on_frame(void *arg, const uint8_t *frame, size_t len) {
+    auto self = static_cast<StubUart *>(arg);
+    self->frames.emplace_back(reinterpret_cast<const char *>(frame), len);
+  }
+};
+
+static uart_link_t link_for(StubUart &uart) {
+  uart_link_t link;
+  const uart_link_ops_t ops = {&uart, StubUart::read, StubUart::write};
+  uart_link_init(&link, &ops, StubUart::on_frame, &uart);
+  return link;
+}
+
+static void test_pattern_frames() {
+  StubUart uart;
+  auto link = link_for(uart);
+  uart.receive("hello\nworld\n");
+  uart_link_on_pattern(&link, 6);
+  uart_link_on_pattern(&link, 6);
+  CHECK_EQ(uart.frames.size(), 2u);
+  CHECK_EQ(uart.frames[0], "hello\n");
+  CHECK_EQ(uart.frames[1], "world\n");
+  CHECK_EQ(link.stats.frames, 2u);
+}
+
+static void test_idle_closes_frame() {
+  StubUart uart;
+  auto link = link_for(uart);
+  uart.receive("abc");
+  uart_link_on_data(&link, 3, false);
+  CHECK(uart.frames.empty());
+  uart.receive("de");
+  uart_link_on_data(&link, 2, true);
+  CHECK_EQ(uart.frames.size(), 1u);
+  CHECK_EQ(uart.frames[0], "abcde");
+}
+
+static void test_partial_then_pattern() {
+  StubUart uart;
+  auto link = link_for(uart);
+  // Data drained before its pattern arrived stays part of the same frame
+  uart.receive("$M<");
+  uart_link_on_data(&link, 3, false);
+  uart.receive("\x01\n");
+  uart_link_on_pattern(&link, 2);
+  CHECK_EQ(uart.frames.size(), 1u);
+  CHECK_EQ(uart.frames[0], std::string("$M<\x01\n"));
+}
+
+static void test_split_on_full_buffer() {
+  StubUart uart;
+  auto link = link_for(uart);
+  uart.receive(std::string(UART_LINK_FRAME_MAX + 10, 'x'));
+  uart_link_on_data(&link, UART_LINK_FRAME_MAX + 10, true);
+  CHECK_EQ(uart.frames.size(), 2u);
+  CHECK_EQ(uart.frames[0].size(), (size_t)UART_LINK_FRAME_MAX);
+  CHECK_EQ(uart.frames[1].size(), 10u);
+  CHECK_EQ(link.stats.splits, 1u);
+}
+
+static void test_overflow_discards_partial() {
+  StubUart uart;
+  auto link = link_for(uart);
+  uart.receive("garbage");
+  uart_link_on_data(&link, 7, false);
+  uart_link_on_overflow(&link);
+  uart.receive("ok\n");
+  uart_link_on_pattern(&link, 3);
+  CHECK_EQ(uart.frames.size(), 1u);
+  CHECK_EQ(uart.frames[0], "ok\n");
+  CHECK_EQ(link.stats.overflows, 1u);
+}
+
+static void test_send() {
+  StubUart uart;
+  auto link = link_for(uart);
+  const uint8_t data[] = {1, 2, 3};
+  CHECK_EQ(uart_link_send(&link, data, sizeof(data)), sizeof(data));
+  CHECK_EQ(uart.tx, std::string("\x01\x02\x03"));
+}
+
+int main() {
+  RUN(test_pattern_frames);
+  RUN(test_idle_closes_frame);
+  RUN(test_partial_then_pattern);
+  RUN(test_split_on_full_buffer);
+  RUN(test_overflow_discards_partial);
+  RUN(test_send);
+  return 0;
+}